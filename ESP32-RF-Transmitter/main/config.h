@@ -1,49 +1,50 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-///// Below is all transmitted codes to control the underwater LEDs (Decimal and Binary).
-const int rfDecimalCodeBrightness = 334849;
-const int rfDecimalCodeSleepTimer = 334850;
-const int rfDecimalCodePower = 334851;
-const int rfDecimalCode4H = 334852;
-const int rfDecimalCode8H = 334853;
-const int rfDecimalCode12H = 334854;
-const int rfDecimalCodeFlash = 334855;
-const int rfDecimalCodeWhite = 334856;
-const int rfDecimalCodeFade = 334857;
-const int rfDecimalCodeRed = 334858;
-const int rfDecimalCodeGreen = 334859;
-const int rfDecimalCodeBlue = 334860;
-const int rfDecimalCodeOrange = 334861;
-const int rfDecimalCodeSeaGreen = 334862;
-const int rfDecimalCodeTeal = 334863;
-const int rfDecimalCodeOrangeYellow = 334864;
-const int rfDecimalCodeCyan = 334865;
-const int rfDecimalCodeIndigo = 334866;
-const int rfDecimalCodeYellow = 334867;
-const int rfDecimalCodeAzure = 334868;
-const int rfDecimalCodeMagenta = 334869;
+#include "rf_pulse_train.h"
 
-const char rfBinaryCodeBrightness[] = "000001010001110000000001";
-const char rfBinaryCodeSleepTimer[] = "000001010001110000000010";
-const char rfBinaryCodePower[] = "000001010001110000000011";
-const char rfBinaryCode4H[] = "000001010001110000000100";
-const char rfBinaryCode8H[] = "000001010001110000000101";
-const char rfBinaryCode12H[] = "000001010001110000000110";
-const char rfBinaryCodeFlash[] = "000001010001110000000111";
-const char rfBinaryCodeWhite[] = "000001010001110000001000";
-const char rfBinaryCodeFade[] = "000001010001110000001001";
-const char rfBinaryCodeRed[] = "000001010001110000001010";
-const char rfBinaryCodeGreen[] = "000001010001110000001011";
-const char rfBinaryCodeBlue[] = "000001010001110000001100";
-const char rfBinaryCodeOrange[] = "000001010001110000001101";
-const char rfBinaryCodeSeaGreen[] = "000001010001110000001110";
-const char rfBinaryCodeTeal[] = "000001010001110000001111";
-const char rfBinaryCodeOrangeYellow[] = "000001010001110000010000";
-const char rfBinaryCodeCyan[] = "000001010001110000010001";
-const char rfBinaryCodeIndigo[] = "000001010001110000010010";
-const char rfBinaryCodeYellow[] = "000001010001110000010011";
-const char rfBinaryCodeAzure[] = "000001010001110000010100";
-const char rfBinaryCodeMagenta[] = "000001010001110000010101";
+///// Below is all transmitted codes to control the underwater LEDs.
+// X(name, decimal code). The binary form the app writes to the power state path is the same code as 24 bits
+// (e.g. Power is "000001010001110000000011"); codes from the RF code path are sent as RF_CODE_BITS bits.
+#define RF_CODES(X) \
+  X(Brightness,   334849) \
+  X(SleepTimer,   334850) \
+  X(Power,        334851) \
+  X(4H,           334852) \
+  X(8H,           334853) \
+  X(12H,          334854) \
+  X(Flash,        334855) \
+  X(White,        334856) \
+  X(Fade,         334857) \
+  X(Red,          334858) \
+  X(Green,        334859) \
+  X(Blue,         334860) \
+  X(Orange,       334861) \
+  X(SeaGreen,     334862) \
+  X(Teal,         334863) \
+  X(OrangeYellow, 334864) \
+  X(Cyan,         334865) \
+  X(Indigo,       334866) \
+  X(Yellow,       334867) \
+  X(Azure,        334868) \
+  X(Magenta,      334869)
 
-#endif // CONFIG_H
\ No newline at end of file
+#define RF_CODE_BITS 25   // 24 bits plus a leading zero, as the RF code path has always been sent
+#define RF_BINARY_BITS 24 // the power state path's binary strings
+
+#define RF_DECIMAL_CODE(name, code) const int rfDecimalCode##name = code;
+RF_CODES(RF_DECIMAL_CODE)
+#undef RF_DECIMAL_CODE
+
+// Every code pre-encoded, in both widths it's sent in, as the pulse train the transmitter sends (see rf_pulse_train.h)
+#define RF_CODE_PULSE_TRAIN(name, code) encodeRfPulseTrain(code, RF_CODE_BITS),
+#define RF_BINARY_PULSE_TRAIN(name, code) encodeRfPulseTrain(code, RF_BINARY_BITS),
+constexpr RfPulseTrain rfCodePulseTrains[] = {
+  RF_CODES(RF_CODE_PULSE_TRAIN)
+  RF_CODES(RF_BINARY_PULSE_TRAIN)
+};
+#undef RF_CODE_PULSE_TRAIN
+#undef RF_BINARY_PULSE_TRAIN
+const size_t NUM_RF_CODES = sizeof(rfCodePulseTrains) / sizeof(rfCodePulseTrains[0]);
+
+#endif // CONFIG_H
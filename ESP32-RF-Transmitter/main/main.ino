@@ -10,20 +10,32 @@ TODO:
     1. Connect to the WiFi network
     2. Use the Firebase-ESP32 library to establish a connection to the Firebase database
     3. Establish a data stream to monitor changes to the RF color code, brightness, or power state which will all be within the UnderwaterLEDs node.
-    4. When change is detected, the correct RF code will be sent to the RF transmitter to change the color, brightness, or power state of the UnderwaterLEDs.
+    4. When change is detected, the correct RF code will be queued and sent to the RF transmitter to change the color, brightness, or power state of the UnderwaterLEDs.
+        The stream is handled by a task on one core and the RF transmitter by loop() on the other,
+        connected by a lock-free queue, so neither waits on the other.
         The database will also set a timestamp value to indicate when the change was made.
     5. Wi-Fi and Firebase connections will be re-established if they are lost.
 */
 #include "version.h"
 #include "secrets.h"
 #include "config.h"
+#include "loop_profiler.h"
+#include "latency_histogram.h"
+#include "rf_command_queue.h"
+#include "rf_transmitter.h"
+#include "spsc_queue.h"
+#include "path_hash.h"
 #include <WiFi.h>
 #include <FirebaseESP32.h>
-#include <RCSwitch.h>
 
 // Provide the RTDB payload printing info and other helper functions.
 #include <addons/RTDBHelper.h>
 
+// Set to true to print loop latency, stream payload size and free heap reports every minute
+#ifndef PROFILE
+#define PROFILE (false)
+#endif
+
 // Define base path to check for configuration values
 #define FB_STREAM_PATH_CONFIG "Config/ESP32"
 
@@ -39,19 +51,69 @@ String FB_STREAM_RF_CODE_PATH = "/decimalCode"; // the value of this key will be
 String FB_STREAM_BRIGHTNESS_PATH = "/brightnessLevel"; // the value of this key will be a value 1-5 and will increment until 5 is hit and then reset to 1.
 String FB_STREAM_POWER_STATE_PATH = "/powerState"; // the value of this key will be a string (i.e. "111111111111111100000001")
 
+// Fields of the streamed node that drive the LEDs, in the order of streamFieldPaths
+enum LedNodeField : int8_t {
+  FIELD_NONE = -1,
+  FIELD_RF_CODE,
+  FIELD_BRIGHTNESS,
+  FIELD_POWER_STATE,
+  NUM_LED_NODE_FIELDS
+};
+String* const streamFieldPaths[NUM_LED_NODE_FIELDS] = {&FB_STREAM_RF_CODE_PATH, &FB_STREAM_BRIGHTNESS_PATH, &FB_STREAM_POWER_STATE_PATH};
+uint32_t streamFieldHashes[NUM_LED_NODE_FIELDS]; // hashes of the paths above, see hashStreamFieldPaths()
+
+// In-memory copy of the streamed node, kept current from the stream's put/patch events (the initial snapshot
+// included), so every command is answered from local state instead of a GET. Stream task only
+struct LedNodeMirror {
+  bool has[NUM_LED_NODE_FIELDS];
+  int colorCode;
+  int brightnessLevel;
+  uint32_t powerCode; // the power state string, parsed
+  uint8_t powerBits;
+};
+LedNodeMirror ledNode = {};
+unsigned long mirrorUpdates = 0; // field values taken from the stream
+
 // Define Firebase Data object
 FirebaseData stream;
 FirebaseData fbdo;
 FirebaseAuth auth;
 FirebaseConfig config;
 
-// Define the RCSwitch object and the pin to which the RF transmitter is connected
-RCSwitch rfTransmitter = RCSwitch();
+// The RF transmitter pin and the RCSwitch protocol 1 timing the LED receiver expects
 const int RF_TRANSMITTER_PIN = 16;
+#define RF_PULSE_LENGTH 390 // microseconds
+#define RF_REPEAT_TRANSMIT 10
+#define RF_COMMAND_GAP 100 // ms between two commands, so repeated brightness steps are seen as separate presses
+
+// The Firebase stream runs in its own task on the core with the Wi-Fi stack. loop() (on ARDUINO_RUNNING_CORE)
+// only drives the RF transmitter, whose timer interrupt is attached from setup() and so runs on that core too.
+#define STREAM_TASK_CORE 0
+#define STREAM_TASK_STACK 16384 // bytes; the TLS stream needs more than the loop task's 8KB
+#define STREAM_TASK_PRIORITY 1
+
+// A stream event turned into an RF command, handed from the stream task to loop()
+struct RfStreamEvent {
+  RfCommandType type;
+  uint32_t code;
+  uint8_t bits;
+  unsigned long receivedAt; // millis() when the stream delivered it
+};
+#define RF_EVENT_QUEUE_SIZE 16 // power of two
+SpscQueue<RfStreamEvent, RF_EVENT_QUEUE_SIZE> rfEvents;
+
+// Sends the queued commands from a timer interrupt (see rf_transmitter.h and rf_command_queue.h). Used by loop() only
+RfTransmitter rfTransmitter(RF_TRANSMITTER_PIN, RF_PULSE_LENGTH, RF_REPEAT_TRANSMIT);
+RfCommandQueue rfCommands;
+LatencyHistogram rfCommandLatency; // from the stream event to its transmission starting
+unsigned long lastRfReport = 0;
 
 // flag to check if the program is starting up. If so, don't send data.
 bool isStartingUp = true;
 
+// Profiles each pass of the stream task, stream payload sizes and free heap (see loop_profiler.h)
+LoopProfiler profiler("ESP32 RF Transmitter");
+
 void setup() {
   // initialize serial communication
   Serial.begin(115200);
@@ -77,9 +139,7 @@ void setup() {
   Serial.println();
 
   // Configure RF transmitter
-  rfTransmitter.enableTransmit(RF_TRANSMITTER_PIN);
-  rfTransmitter.setRepeatTransmit(10);
-  rfTransmitter.setPulseLength(390);
+  rfTransmitter.begin();
 
   // Or use legacy authenticate method
   config.database_url = SECRET_DATABASE_URL;
@@ -94,6 +154,7 @@ void setup() {
 
   // Get the stream configuration from the database
   getStreamPathConfig();
+  hashStreamFieldPaths();
 
   // begin Firebase RTDB stream
   if (!Firebase.beginStream(stream, FB_BASE_STREAM_PATH))
@@ -101,66 +162,235 @@ void setup() {
     Serial.println("Can't begin stream connection...");
     Serial.printf("REASON: %s\n", stream.errorReason().c_str());
   }
+
+  // From here on the stream is only touched by its task
+  xTaskCreatePinnedToCore(streamTask, "stream", STREAM_TASK_STACK, nullptr, STREAM_TASK_PRIORITY, nullptr, STREAM_TASK_CORE);
 }
 
+// RF side: take the stream's events, merge superseded colours and keep the transmitter busy
 void loop() {
+  RfStreamEvent event;
+  while (rfEvents.pop(event)) {
+    rfCommands.push(event.type, event.code, event.bits, event.receivedAt);
+  }
+
+  rfTransmitter.update();
+  sendNextRfCommand();
+
+  if (PROFILE && millis() - lastRfReport >= PROFILE_REPORT_INTERVAL) {
+    lastRfReport = millis();
+    printRfCommandReport();
+  }
+
+  vTaskDelay(1); // the pulses are timed by the interrupt, this only sets how soon a queued command starts
+}
+
+// Stream side, pinned to STREAM_TASK_CORE
+void streamTask(void* parameter) {
   while (millis() < 4147200000) { // 48 days so it resets number before it overloads.
-    if (!Firebase.ready()) {
-        return;
-    }
+    readStream();
+    vTaskDelay(1); // let the idle task (and its watchdog) run on this core
+  }
+  vTaskDelete(nullptr);
+}
+
+// Read the stream and hand any RF commands in it to loop()
+void readStream() {
+  // ends the profiled pass on every return below
+  LoopProfileScope pass(profiler, PROFILE);
 
-    if (!Firebase.readStream(stream)) {
-      Serial.println("Can't read stream data...");
-      Serial.printf("REASON: %s\n", stream.errorReason().c_str());
+  if (!Firebase.ready()) {
+    return;
+  }
+
+  if (!Firebase.readStream(stream)) {
+    Serial.println("Can't read stream data...");
+    Serial.printf("REASON: %s\n", stream.errorReason().c_str());
+  }
+
+  if (stream.streamTimeout()) {
+    Serial.println("stream timed out, resuming...\n");
+
+    if (!stream.httpConnected()) {
+      Serial.printf("error code: %d, reason: %s\n\n", stream.httpCode(), stream.errorReason().c_str());
     }
+  }
 
-    if (stream.streamTimeout()) {
-      Serial.println("stream timed out, resuming...\n");
+  if (stream.streamAvailable()) {
+    Serial.printf("stream path, %s\nevent path, %s\ndata type, %s\nevent type, %s\n\n",
+              stream.streamPath().c_str(),
+              stream.dataPath().c_str(),
+              stream.dataType().c_str(),
+              stream.eventType().c_str());
+    printResult(stream); // see addons/RTDBHelper.h
+    Serial.println();
 
-      if (!stream.httpConnected()) {
-        Serial.printf("error code: %d, reason: %s\n\n", stream.httpCode(), stream.errorReason().c_str());
+    // A single field is looked up by its path's hash; a JSON value (the initial snapshot, or a put/patch
+    // of the whole node) only updates the mirror
+    String eventPath = stream.dataPath();
+    LedNodeField field = streamFieldFor(eventPath.c_str());
+    if (field != FIELD_NONE) {
+      String stringValue = field == FIELD_POWER_STATE ? stream.stringData() : String();
+      if (setMirrorField(field, stream.dataType() == "null", stream.intData(), stringValue.c_str()) && !isStartingUp) {
+        sendFieldCommand(field);
       }
+    } else if (stream.dataType() == "json") {
+      updateMirrorFromJson(eventPath, stream.eventType() == "put");
     }
 
-    if (stream.streamAvailable()) {
-      Serial.printf("stream path, %s\nevent path, %s\ndata type, %s\nevent type, %s\n\n",
-                stream.streamPath().c_str(),
-                stream.dataPath().c_str(),
-                stream.dataType().c_str(),
-                stream.eventType().c_str());
-      printResult(stream); // see addons/RTDBHelper.h
-      Serial.println();
-
-      if (!isStartingUp) {
-        if (stream.dataPath() == FB_STREAM_RF_CODE_PATH) {
-          // Send the value via the RF transmitter
-          rfTransmitter.send(stream.intData(), 25); // 25 is the number of bits to be transmitted; adjust if needed 24 not enough for 1776964 so adjusting to 25
-          Serial.printf("Sent stream value: %d\n", stream.intData());
-        }
-        else if (stream.dataPath() == FB_STREAM_BRIGHTNESS_PATH /* special case for repeated command*/ ) {
-          // get Code(Decimal) value from database
-          Firebase.getInt(fbdo, FB_BASE_STREAM_PATH + FB_STREAM_RF_CODE_PATH);
-          Serial.printf("Color code value to send: %d\n", fbdo.intData());
-
-          // Send the value via the RF transmitter
-          rfTransmitter.send(fbdo.intData(), 25); // 25 is the number of bits to be transmitted; adjust if needed
-        }
-        else if (stream.dataPath() == FB_STREAM_POWER_STATE_PATH) {
-          // sending power state binary rather than decimal
-          rfTransmitter.send(stream.stringData().c_str());
-          Serial.printf("Sent stream value: %s\n", stream.stringData().c_str());
-        }
-      }
-      else {
-        isStartingUp = false;
-        Serial.printf("Started up, not sending stream value.\n");
+    if (isStartingUp) {
+      isStartingUp = false;
+      Serial.printf("Started up, not sending stream value.\n");
+    }
+
+    Serial.printf("Received stream payload size: %d (Max. %d)\n\n", stream.payloadLength(), stream.maxPayloadLength());
+
+    if (PROFILE) {
+      profiler.recordMessage(stream.payloadLength());
+    }
+  }
+}
+
+// Precompute the hashes of the field paths, once they've been loaded by getStreamPathConfig()
+void hashStreamFieldPaths() {
+  for (int i = 0; i < NUM_LED_NODE_FIELDS; i++) {
+    streamFieldHashes[i] = hashPath(streamFieldPaths[i]->c_str());
+  }
+}
+
+// The field an event path refers to, or FIELD_NONE
+LedNodeField streamFieldFor(const char* path) {
+  uint32_t hash = hashPath(path);
+  for (int i = 0; i < NUM_LED_NODE_FIELDS; i++) {
+    if (streamFieldHashes[i] == hash && strcmp(streamFieldPaths[i]->c_str(), path) == 0) {
+      return (LedNodeField)i;
+    }
+  }
+  return FIELD_NONE;
+}
+
+// Store a field's new value in the mirror; a null value (the field was deleted) clears it.
+// Returns true if the field now holds a valid value
+bool setMirrorField(LedNodeField field, bool isNull, int intValue, const char* stringValue) {
+  if (isNull) {
+    ledNode.has[field] = false;
+    return false;
+  }
+  switch (field) {
+    case FIELD_RF_CODE:
+      ledNode.colorCode = intValue;
+      break;
+    case FIELD_BRIGHTNESS:
+      ledNode.brightnessLevel = intValue;
+      break;
+    case FIELD_POWER_STATE:
+      // parsed once here rather than on every repeat
+      if (!parseRfBinaryCode(stringValue, ledNode.powerCode, ledNode.powerBits)) {
+        Serial.printf("Invalid power state code: %s\n", stringValue);
+        ledNode.has[field] = false;
+        return false;
       }
+      break;
+    default:
+      return false;
+  }
+  ledNode.has[field] = true;
+  mirrorUpdates++;
+  return true;
+}
 
-      Serial.printf("Received stream payload size: %d (Max. %d)\n\n", stream.payloadLength(), stream.maxPayloadLength());
+// Update the mirror from a JSON value at `eventPath` (the node itself or a parent of some of its fields).
+// A put replaces everything below its path, so the fields it doesn't contain are cleared; a patch only
+// sets the fields it contains.
+void updateMirrorFromJson(const String& eventPath, bool replace) {
+  FirebaseJson& json = stream.jsonObject();
+  bool isRoot = eventPath == "/";
+  for (int i = 0; i < NUM_LED_NODE_FIELDS; i++) {
+    const String& fieldPath = *streamFieldPaths[i];
+    if (!isRoot && !(fieldPath.startsWith(eventPath) && fieldPath.charAt(eventPath.length()) == '/')) {
+      continue;
+    }
+    FirebaseJsonData value;
+    json.get(value, isRoot ? fieldPath : fieldPath.substring(eventPath.length()));
+    if (value.success) {
+      setMirrorField((LedNodeField)i, value.type == "null", value.intValue, value.stringValue.c_str());
+    } else if (replace) {
+      ledNode.has[i] = false;
     }
   }
 }
 
+// Queue the RF command for a field that just changed, from the mirror
+void sendFieldCommand(LedNodeField field) {
+  switch (field) {
+    case FIELD_RF_CODE:
+      // A newer colour replaces one that hasn't been sent yet
+      queueRfEvent(RF_COMMAND_COLOR, ledNode.colorCode, RF_CODE_BITS);
+      Serial.printf("Queued stream value: %d\n", ledNode.colorCode);
+      break;
+    case FIELD_BRIGHTNESS:
+      // special case for repeated command: a brightness step sends the current colour code again
+      if (!ledNode.has[FIELD_RF_CODE]) {
+        Serial.println("No color code in the node, brightness step not sent.");
+        return;
+      }
+      queueRfEvent(RF_COMMAND_BRIGHTNESS, ledNode.colorCode, RF_CODE_BITS);
+      Serial.printf("Color code value to send: %d\n", ledNode.colorCode);
+      break;
+    case FIELD_POWER_STATE:
+      // sending power state binary rather than decimal
+      queueRfEvent(RF_COMMAND_POWER, ledNode.powerCode, ledNode.powerBits);
+      Serial.printf("Queued power state code: %lu (%d bits)\n", (unsigned long)ledNode.powerCode, ledNode.powerBits);
+      break;
+    default:
+      break;
+  }
+}
+
+// Hand an RF command to loop(), stamped with the time the stream delivered it
+void queueRfEvent(RfCommandType type, uint32_t code, uint8_t bits) {
+  RfStreamEvent event;
+  event.type = type;
+  event.code = code;
+  event.bits = bits;
+  event.receivedAt = millis();
+  if (!rfEvents.push(event)) {
+    Serial.println("RF event queue full, command dropped.");
+  }
+}
+
+// Start the next queued RF command once the transmitter is free and the gap after the last one has passed
+void sendNextRfCommand() {
+  if (rfTransmitter.isBusy() || millis() - rfTransmitter.finishedAt() < RF_COMMAND_GAP) {
+    return;
+  }
+  RfCommand command;
+  if (!rfCommands.pop(command)) {
+    return;
+  }
+  // The codes in config.h are pre-encoded, anything else is encoded now
+  const RfPulseTrain* train = findRfPulseTrain(rfCodePulseTrains, NUM_RF_CODES, command.code, command.bits);
+  if (train != nullptr) {
+    rfTransmitter.start(*train);
+  } else {
+    rfTransmitter.start(encodeRfPulseTrain(command.code, command.bits));
+  }
+  rfCommandLatency.record(millis() - command.queuedAt);
+  Serial.printf("Sending RF code: %lu (%d bits)\n", (unsigned long)command.code, command.bits);
+}
+
+// Print the stream event -> RF latency, the queue depths and how many commands were merged or dropped
+void printRfCommandReport() {
+  rfCommandLatency.printTo(Serial, "Stream event -> RF");
+  Serial.printf("RF event queue: depth %u, high water %u/%u, dropped %lu\n",
+                (unsigned)rfEvents.size(), (unsigned)rfEvents.highWater(), (unsigned)rfEvents.capacity(),
+                (unsigned long)rfEvents.dropped());
+  Serial.printf("RF commands queued: %lu (waiting %u), coalesced: %lu, dropped: %lu, transmissions: %lu\n",
+                rfCommands.commandsQueued, (unsigned)rfCommands.count(), rfCommands.commandsCoalesced, rfCommands.commandsDropped,
+                rfTransmitter.transmissions);
+  Serial.printf("Node mirror updates: %lu\n", mirrorUpdates);
+}
+
 /// Function to get the stream path from Firebase.
 /// Used to change the stream path from the app without having to recompile the code.
 void getStreamPathConfig() {
@@ -6,6 +6,7 @@
   - Send a PATCH request to Firebase (for showing runtime)
   - Read data from the Nano 33 IoT via UART (TX/RX pins) 
     (Nano 33 IoT is acting as Bluetooth central device and is reading sensor data from a peripheral MKR 1010)
+    (Data arrives as compact binary frames, see serial_frame.h, and is converted to JSON only for Firebase)
   - Send data to Firebase via PATCH request (for real-time monitoring)
   - Send a log entry of data values every minute (for long term monitoring)
   - Reconnect to server if disconnected (i.e. perihperal MKR 1010 is turned off/not sending data for some reason)
@@ -24,11 +25,37 @@
 #include "version.h"
 #include "secrets.h"
 #include "on_board_led.h"
+#include "loop_profiler.h"
+#include "sensor_readings.h"
+#include "serial_frame.h"
+#include "cooperative_scheduler.h"
+#include "upload_queue.h"
+#include "sensor_rollup.h"
+#include "flash_ring_log.h"
+#include "http_request.h"
+#include "tls_stats.h"
+#include "http_pipeline.h"
+#include "latency_histogram.h"
+#include "memory_monitor.h"
+#include "line_reader.h"
+#include "trace_recorder.h"
+#include "pipeline_timing.h"
+#include "metrics_writer.h"
 
 // #Defines
+#ifndef DEBUG
 #define DEBUG (false) // Set to true to enable debug output for SSL and startup serial messages
+#endif
+#ifndef PROFILE
+#define PROFILE (false) // Set to true to print loop latency, message size and free RAM reports every minute
+#endif
+#ifndef TRACE
+#define TRACE (false) // Set to true to write a trace of the Nano frames and Firebase requests to Serial (see trace_recorder.h)
+#endif
+#define TRACE_COUNTER_INTERVAL 5000 // ms between the link/upload counters in the trace
 
 #define SERVER_PORT 80
+#define TLS_SESSION_CACHE_SIZE 1 // TLS sessions kept for resumption, one per host (only Firebase is used)
 
 // MKR 1010 ETH shield and board config
 byte mac[] = SECRET_ETH_SHIELD_MAC;
@@ -40,17 +67,17 @@ IPAddress myDns(SECRET_DNS_GATEWAY);
 const int rand_pin = A5;
 
 // Initialize the SSL client library
-// We input an EthernetClient, our trust anchors, and the analog pin
+// We input an EthernetClient, our trust anchors, the analog pin and the size of the session cache
 EthernetClient base_client;
 #if DEBUG
-SSLClient firebaseClient(base_client, TAs, (size_t)TAs_NUM, rand_pin, 1, SSLClient::SSL_DUMP);
+SSLClient firebaseClient(base_client, TAs, (size_t)TAs_NUM, rand_pin, TLS_SESSION_CACHE_SIZE, SSLClient::SSL_DUMP);
 #else
-SSLClient firebaseClient(base_client, TAs, (size_t)TAs_NUM, rand_pin);
+SSLClient firebaseClient(base_client, TAs, (size_t)TAs_NUM, rand_pin, TLS_SESSION_CACHE_SIZE);
 #endif
-// Variables to measure the speed
-unsigned long beginMicros, endMicros;
-unsigned long byteCount = 0;
-bool printWebData = true;  // set to false for better speed measurement
+
+// Handshake timing, full vs. resumed counts and failure reasons of the Firebase connection (see tls_stats.h)
+TlsConnectionStats tlsStats;
+bool printWebData = true;  // print each Firebase request's latency
 
 // Setup for UDP NTP client & RTC
 unsigned int localPort = SECRET_LOCAL_PORT;
@@ -69,27 +96,201 @@ EthernetServer server(SERVER_PORT);
 RTCZero rtc;
 
 const char firebaseHost[] = SECRET_DATABASE_URL;
+#ifdef SECRET_DATABASE_PORT
+const uint16_t firebasePort = SECRET_DATABASE_PORT; // e.g. a local TLS stand-in server for testing
+#else
+const uint16_t firebasePort = 443; // 443 is the standard port for HTTPS
+#endif
 // const char firebaseAuth[] = SECRET_DATABASE_SECRET; // Add in auth later
 
-// global paths to upload realtime + log sensor data and debug data to Firebase
-const char* firebaseRealtimeDataPath = "/CurrentConditions.json";
-const char* firebaseLogSensorDataPath = "/Log/SensorData.json";
-const char* firebaseDebugLogSensorDataPath = "/Debug/Log/SensorData.json";
+// global nodes to upload realtime + log sensor data and debug data to in Firebase, per monitor (see deviceNodePath())
+const char* firebaseRealtimeDataNode = "CurrentConditions";
+const char* firebaseLogSensorDataNode = "Log/SensorData";
+const char* firebaseDebugLogSensorDataNode = "Debug/Log/SensorData";
+#define DEVICE_NODE_PATH_SIZE 48 // "Devices/<id>/<node>/<epoch>"
+// The 1 minute log grows by 1440 entries a day. Set to false to stop uploading it once the app only
+// reads the rollups below; the rollups are still built from the Nano's 1 minute log frames.
+#define UPLOAD_MINUTE_LOG (true)
 const char* firebaseDebugBLEConnectivityDataPath = "/Debug/PeripheralConnected.json";
 const char* firebaseDebugErrorMessagesDataPath = "/Debug/ErrorMessage.json";
 
 bool recentlyDisconnected = false; // Tracks if we've recently disconnected
+bool reconnecting = false; // reconnectToServer() is running (it keeps receiving from the Nano while it waits)
 static unsigned long lastDisconnectTime = 0;  // Timestamp of the last disconnect
 const unsigned long disconnectDelay = 15000;  // Delay before trying to reconnect, in milliseconds
 int watchdogTimeoutInterval = 30000; // 30 seconds
 
-bool socketsInUse[MAX_SOCK_NUM] = {false}; // MAX_SOCK_NUM is defined in EthernetLarge.h
+// Connections to the local API, indexed by socket number (MAX_SOCK_NUM is defined in EthernetLarge.h).
+// Each socket moves through its own states, so a slow client or one waiting on the Nano never blocks loop()
+enum LocalSocketState : uint8_t {
+  SOCKET_FREE,
+  SOCKET_READING_REQUEST,
+  SOCKET_AWAITING_NANO_STATUS,
+  SOCKET_AWAITING_CALIBRATION,
+  SOCKET_AWAITING_METRICS // /metrics waits for the Nano's status, and answers without it on timeout
+};
+
+struct LocalSocket {
+  EthernetClient client;
+  HttpRequestParser request;
+  LocalSocketState state = SOCKET_FREE;
+  unsigned long since = 0; // when the socket entered its current state
+};
+
+LocalSocket localSockets[MAX_SOCK_NUM];
+const unsigned long localRequestTimeout = 5000; // clients that don't finish sending their request in time get a 408
+const unsigned long nanoReplyTimeout = 5000;    // requests waiting on the Nano get a 504 after this
+const size_t localReadChunkSize = 64;           // bytes read from a socket per pass of loop()
+
+void handleLedStatusRoute(uint8_t socketNum, const HttpRequestParser& request);
+void handleNanoStatusRoute(uint8_t socketNum, const HttpRequestParser& request);
+void handlePhCalibrationRoute(uint8_t socketNum, const HttpRequestParser& request);
+void handleMetricsRoute(uint8_t socketNum, const HttpRequestParser& request);
+
+// Local API routes
+const HttpRoute localRoutes[] = {
+  {"/status", handleLedStatusRoute},
+  {"/status/nano", handleNanoStatusRoute},
+  {"/calibrate/ph", handlePhCalibrationRoute},
+  {"/metrics", handleMetricsRoute}
+};
+const size_t NUM_LOCAL_ROUTES = sizeof(localRoutes) / sizeof(localRoutes[0]);
+
+// Profiles loop() latency, bytes per Nano message and free RAM (see loop_profiler.h)
+LoopProfiler profiler("MKR Central Hub");
+
+// Reassembles the binary frames sent by the Nano over Serial1 (see serial_frame.h)
+FrameReader nanoFrameReader;
+
+// Record mode: the frames in and the requests out, for replaying and load testing the hub from a PC
+// (tools/hub_load_test.py). Trace lines start with '@' so they can be picked out of the normal Serial output.
+TraceRecorder trace(Serial);
+
+// Batches log entries into multi-key PATCHes and collapses bursts of realtime updates (see upload_queue.h).
+// The log queues are shared by every monitor (each entry keeps its device), realtime updates are per monitor.
+LogUploadQueue logUploads;
+LogUploadQueue debugLogUploads;
+RealtimeCoalescer realtimeUploads[FRAME_MAX_DEVICES];
+
+// What a Firebase request carried, so its response can be matched back to the data (see onFirebaseResponse())
+enum FirebaseRequestTag : uint8_t {
+  REQUEST_REALTIME,
+  REQUEST_LOG,
+  REQUEST_DEBUG_LOG,
+  REQUEST_ROLLUP_15_MINUTES, // in the same order as rollupTiers
+  REQUEST_ROLLUP_HOURLY,
+  REQUEST_ROLLUP_DAILY,
+  REQUEST_TIMESTAMP,
+  REQUEST_OTHER,
+  NUM_REQUEST_TAGS
+};
+const char* const requestTagNames[NUM_REQUEST_TAGS] = {"realtime", "log", "debugLog", "rollup15Minutes", "rollupHourly", "rollupDaily", "timestamp", "other"};
+
+// Long term history at coarser resolutions, so week or month charts read a few hundred points.
+// Each tier is rolled up from the one before it (1 minute log -> 15 minutes -> 1 hour -> 1 day, see sensor_rollup.h)
+// and uploaded to its own node in batches: the 15 minute and hourly tiers every 4 entries, the daily tier as it comes.
+// Each monitor is rolled up separately, its rollups share the tier's upload queue.
+struct RollupTier {
+  const char* node;
+  FirebaseRequestTag tag;
+  SensorRollup rollups[FRAME_MAX_DEVICES]; // indexed by device
+  LogUploadQueue uploads;
+};
+const int NUM_ROLLUP_TIERS = 3;
+static_assert(FRAME_MAX_DEVICES == 3, "rollupTiers sets up one rollup per device");
+RollupTier rollupTiers[NUM_ROLLUP_TIERS] = {
+  {"Log/Rollups/15Minutes", REQUEST_ROLLUP_15_MINUTES,
+    {SensorRollup(ROLLUP_15_MINUTES), SensorRollup(ROLLUP_15_MINUTES), SensorRollup(ROLLUP_15_MINUTES)}, LogUploadQueue(4, 3600000)},
+  {"Log/Rollups/Hourly", REQUEST_ROLLUP_HOURLY,
+    {SensorRollup(ROLLUP_HOUR), SensorRollup(ROLLUP_HOUR), SensorRollup(ROLLUP_HOUR)}, LogUploadQueue(4, 4 * 3600000UL)},
+  {"Log/Rollups/Daily", REQUEST_ROLLUP_DAILY,
+    {SensorRollup(ROLLUP_DAY), SensorRollup(ROLLUP_DAY), SensorRollup(ROLLUP_DAY)}, LogUploadQueue(1, 0)}
+};
+
+// The 1 minute log entries are written to flash as they arrive and only marked uploaded once Firebase has
+// acknowledged them, so a lost connection, the reconnect backoff or a reset doesn't lose them (see flash_ring_log.h).
+// A full entry takes a 128 byte record, so 48KB (11 of its 12 sectors in use) holds about 340 entries: about
+// 5.5 hours with one monitor, 1.9 hours each with three. Reduce it if the sketch no longer fits.
+// An upload programs the region with the array's zeros, and FlashRingLog::begin() formats it as it has no sector
+// magic, so uploading a sketch discards any entries still stored.
+#define STORED_LOG_FLASH_SIZE (48 * 1024)
+static_assert(LOG_ENTRY_MAX_PACKED_SIZE <= FLASH_LOG_MAX_RECORD, "a log entry must fit in one flash log record");
+__attribute__((__aligned__(256))) const uint8_t storedLogFlash[STORED_LOG_FLASH_SIZE] = {};
+SamdFlash storedLogDevice(storedLogFlash, sizeof(storedLogFlash));
+FlashRingLog storedLog(storedLogDevice);
+bool storedLogReady = false;
+uint32_t logBatchLastSeq = 0; // last stored log entry in the batch in logUploads, committed once it's acknowledged
+
+void onFirebaseResponse(uint8_t tag, int status, unsigned long latencyMs, const HttpResponseParser& response);
+
+// Requests pipelined on the keep-alive Firebase connection, matched to their responses in order (see http_pipeline.h)
+HttpPipeline firebaseRequests(onFirebaseResponse);
+LatencyHistogram requestLatency[NUM_REQUEST_TAGS]; // round trip of each request type
+unsigned long firebaseRequestsFailed = 0; // answered with an error status or never answered
+unsigned long firebaseRetries = 0;
+unsigned long firebaseReconnects = 0;
+SensorReadings realtimeInFlight; // the realtime write waiting for its response, put back if it fails
+bool realtimeWriteInFlight = false;
+uint8_t realtimeInFlightDevice = 0;
+uint8_t nextRealtimeDevice = 0; // monitors take turns at the one realtime write in flight
+
+// The latest status frame of each monitor, /status/nano is answered once the last one has arrived
+NanoStatus nanoDeviceStatus[FRAME_MAX_DEVICES];
+bool nanoStatusReceived = false; // a complete set of status frames has arrived since boot
+
+// Where the time goes between a monitor reading its sensors and Firebase acknowledging the realtime write,
+// served by /metrics. The monitor and Nano stages come from the frame's PipelineStamp (see pipeline_timing.h),
+// the UART stage is measured here against the Nano's send time, the rest on the hub's own clock.
+enum PipelineStage : uint8_t {
+  STAGE_READ,   // monitor: newest sensor read -> BLE notification
+  STAGE_BLE,    // notification -> Nano, over the link's base delay
+  STAGE_NANO,   // Nano: notification received -> frame written to the UART
+  STAGE_UART,   // frame written -> parsed here, over the link's base delay
+  STAGE_QUEUE,  // parsed -> realtime write sent (coalescing and waiting for the write in flight)
+  STAGE_SERVER, // write sent -> Firebase acknowledged it
+  STAGE_TOTAL,  // sum of the stages above that were measured
+  NUM_PIPELINE_STAGES
+};
+const char* const pipelineStageNames[NUM_PIPELINE_STAGES] = {"read", "ble", "nano", "uart", "queue", "server", "total"};
+LatencyHistogram stageLatency[NUM_PIPELINE_STAGES];
+OneWayDelay uartDelay;
+
+// When the oldest sample in a realtime write was parsed, and how long it had taken to get here
+struct SampleTiming {
+  unsigned long parsedAt = 0;
+  unsigned long ageAtParse = 0;
+};
+SampleTiming realtimePendingTiming[FRAME_MAX_DEVICES];
+SampleTiming realtimeInFlightTiming;
+
+#define TASK_STACK_WINDOW 512 // stack painted below each scheduler task when profiling (see CooperativeScheduler::trackStack())
+
+// Room for one log entry in a batch:
+// "[Devices/<id>/]<node>/<epoch>": {<sensors>, "timestamp": {".sv": "timestamp"}, "min": {<sensors>}, "max": {<sensors>},
+//   "stddev": {<sensors>}, "count": {<sensors>}}
+const size_t LOG_ENTRY_JSON_CAPACITY = JSON_OBJECT_SIZE(SENSOR_COUNT + 5) + JSON_OBJECT_SIZE(1)
+  + 4 * JSON_OBJECT_SIZE(SENSOR_COUNT) + DEVICE_NODE_PATH_SIZE; // + key copy
+
+// Log batches are built in one fixed document (a few KB) rather than a heap allocation per batch
+const size_t LOG_BATCH_JSON_CAPACITY = JSON_OBJECT_SIZE(UPLOAD_LOG_BATCH_SIZE) + UPLOAD_LOG_BATCH_SIZE * LOG_ENTRY_JSON_CAPACITY;
+StaticJsonDocument<LOG_BATCH_JSON_CAPACITY> logBatchJson;
+
+// The /status/nano response: connected, rssi or time since connection, bleSamplesDropped, bleReconnect{5}, realtimeChanges{3}
+// of the original monitor, devices[the same 5 of each monitor],
+// uartLink{3}, uploads{8}, storedLog{5}, tls{4 + failures}, latency{per request type: count, p50, p90, p99}, memory{7}
+const size_t NANO_DEVICE_STATUS_JSON_CAPACITY = JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(3);
+const size_t NANO_STATUS_JSON_CAPACITY = JSON_OBJECT_SIZE(12) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(3)
+  + JSON_ARRAY_SIZE(FRAME_MAX_DEVICES) + FRAME_MAX_DEVICES * NANO_DEVICE_STATUS_JSON_CAPACITY
+  + JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(5)
+  + JSON_OBJECT_SIZE(7) + JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(TLS_FAIL_REASON_COUNT)
+  + JSON_OBJECT_SIZE(NUM_REQUEST_TAGS) + NUM_REQUEST_TAGS * JSON_OBJECT_SIZE(4);
 
-extern "C" char* sbrk(int incr);
-int freeRam();
 void display_freeram();
 
 void setup() {
+  // Paint the free RAM first so the stack high-watermark covers everything (see memory_monitor.h)
+  memoryMonitor.begin();
+
   Ethernet.init(5);   // MKR ETH shield
 
   // initialize serial communication
@@ -107,6 +308,19 @@ void setup() {
     Serial.println(RELEASE_VERSION);
   }
   
+  if (TRACE) {
+    trace.begin(RELEASE_VERSION);
+  }
+
+  // Log entries that weren't uploaded before the last reset are sent again once connected
+  storedLogReady = storedLog.begin();
+  if (storedLogReady) {
+    Serial.print(F("Stored log entries waiting for upload: "));
+    Serial.println(storedLog.pending());
+  } else {
+    Serial.println(F("Stored log unavailable, log entries will only be kept in RAM."));
+  }
+
   Serial1.begin(115200);
   establishSerialConnectionWithNano();
 
@@ -119,7 +333,7 @@ void setup() {
   // start the Ethernet connection:
   connectToEthernet();
   // Give the Ethernet shield time to initialize
-  delay(2000);
+  scheduler.delay(2000);
 
   // Initialize and set the RTC to the time from the NTP server
   setRTCFromNTPServer();
@@ -147,79 +361,70 @@ void setup() {
     display_freeram();  // Display free RAM after attempting to connect
   }
 
-  // time measurement for data transfer rate during server connection
-  beginMicros = micros();
+  if (PROFILE) {
+    scheduler.trackStack(TASK_STACK_WINDOW);
+    scheduler.schedule(printRequestLatencies, nullptr, PROFILE_REPORT_INTERVAL);
+    scheduler.schedule(printMemoryReport, nullptr, PROFILE_REPORT_INTERVAL);
+  }
+  if (TRACE) {
+    scheduler.schedule(traceCounters, nullptr, TRACE_COUNTER_INTERVAL);
+  }
 
   Serial.println(F("Checking for data from Nano33IoT..."));
   setOnBoardLEDColor(0, 0, 255, LED_INTENSITY_HIGH); // blue
 
+  // From here on receiving and uploading data shouldn't allocate (see printMemoryReport())
+  memoryMonitor.markSteadyState();
+
   // Kick the watchdog
   Watchdog.reset();
 }
 
 void loop() {
-  // Check for incoming client requests and handle them
-  EthernetClient localClient = server.available();
-  if (localClient) {
-    uint8_t socketNum = localClient.getSocketNumber();
-    if (!socketsInUse[socketNum]) {
-        socketsInUse[socketNum] = true; // Mark this socket as in use
-        Serial.println("New Client detected.");
-        Serial.print("Socket number: ");
-        Serial.println(socketNum);
-        handleClientRequests(localClient);
-    } else {
-        Serial.print("Ongoing operation detected on socket ");
-        Serial.println(socketNum);
-    }
+  if (PROFILE) {
+    profiler.beginLoop();
   }
 
-  // read any incoming data from the server: (server disconects, etc.)
+  // run any due background tasks (LED fades)
+  scheduler.run();
+
+  memoryMonitor.update();
+
+  // Accept new local API clients and advance the ones already connected
+  serviceLocalClients();
+
+  // read the responses to the requests in flight; a lost or unparseable response means the connection has to be reset
   if (firebaseClient.connected()) {
-    readServerResponse();
+    if (!firebaseRequests.poll(firebaseClient)) {
+      Serial.println(F("Firebase response timed out or connection closing. Stopping client."));
+      firebaseClient.stop();
+    }
   } else {
     if (handleDisconnection()) {
       lastDisconnectTime = millis();  // Update the last disconnect time
-      flushSerial1(); // Flush any incoming serial data immediately after disconnection
-      return; // Exit the loop to avoid further processing if disconnected
     }
   }
 
+  // Keep reading the Nano while disconnected, the data is queued (and the log stored) until the connection is back.
+  // processSensorDataFromNano() only reconnects once disconnectDelay has passed.
   if (Serial1.available() > 0) {
-    // Ensure a delay has passed before reconnecting
-    if (millis() - lastDisconnectTime > disconnectDelay) {
-      // Read and process data from the Nano 33 IoT and route correctly
-      processSensorDataFromNano(localClient);
-    } else {
-      flushSerial1(); // disregard incoming nano data during delay period
-      // lets keep checking if our firebase connection is closed successfully
-      if (firebaseClient.m_soft_connected(__func__)) {
-        Serial.println(F("Soft check failed: SSL connection was not closed properly."));
-      } else {
-        // Serial.println(F("SSL connection closed properly."));
-      }
-    }
+    processSensorDataFromNano();
   }
 
+  // Send any batched uploads that are due
+  flushUploadQueues();
+
   // Kick the watchdog to reset the timer
   Watchdog.reset();
-}
 
-int freeRam() {
-  char top;
-  return &top - reinterpret_cast<char*>(sbrk(0));
+  if (PROFILE) {
+    profiler.endLoop();
+  }
 }
 
 void display_freeram(){
   Serial.print(F("- SRAM left: "));
   Serial.println(freeRam());
-  Serial.println((int)sbrk(0));
-}
-
-void flushSerial1() {
-  while (Serial1.available() > 0) {
-      Serial1.read(); // Read and discard the incoming byte
-  }
 }
 
 bool handleDisconnection() {
@@ -232,183 +437,238 @@ bool handleDisconnection() {
   return false;  // No disconnection was handled
 }
 
-bool readRequestPath(EthernetClient& client, String& requestPath, String& queryString) {
-  bool currentLineIsBlank = true;
-  String currentLine = "";
-  bool requestLineParsed = false;
-  bool isHeaderSection = false;
+void serviceLocalClients() {
+  // server.available() returns a socket with data waiting; only sockets that aren't being served yet are taken on
+  EthernetClient newClient = server.available();
+  if (newClient) {
+    uint8_t socketNum = newClient.getSocketNumber();
+    if (socketNum < MAX_SOCK_NUM && localSockets[socketNum].state == SOCKET_FREE) {
+      LocalSocket& socket = localSockets[socketNum];
+      socket.client = newClient;
+      socket.request.reset();
+      socket.state = SOCKET_READING_REQUEST;
+      socket.since = millis();
+      Serial.print(F("New client on socket "));
+      Serial.println(socketNum);
+    }
+  }
 
-  while (client.available()) {
-      char c = client.read();
-      Serial.write(c); // Echo to serial monitor for debugging
+  for (uint8_t socketNum = 0; socketNum < MAX_SOCK_NUM; socketNum++) {
+    LocalSocket& socket = localSockets[socketNum];
+    switch (socket.state) {
+      case SOCKET_FREE:
+        break;
+      case SOCKET_READING_REQUEST:
+        readLocalRequest(socketNum);
+        break;
+      case SOCKET_AWAITING_NANO_STATUS:
+      case SOCKET_AWAITING_CALIBRATION:
+      case SOCKET_AWAITING_METRICS:
+        // Discard anything else the client sends so server.available() keeps returning new clients
+        while (socket.client.available() > 0) {
+          socket.client.read();
+        }
+        if (!socket.client.connected()) {
+          socket.client.stop();
+          markSocketAsFree(socketNum);
+        } else if (millis() - socket.since > nanoReplyTimeout && socket.state == SOCKET_AWAITING_METRICS) {
+          // The hub's own metrics are still worth a scrape, the Nano's are the last ones it sent
+          respondWithMetrics(socketNum, false);
+        } else if (millis() - socket.since > nanoReplyTimeout) {
+          Serial.println(F("Timed out waiting for the Nano."));
+          respondToLocalClient(socketNum, 504, socket.state == SOCKET_AWAITING_CALIBRATION
+            ? "Calibration failed or no response" : "Error: No response from Nano");
+        }
+        break;
+    }
+  }
+}
 
-      if (c == '\n' || c == '\r') {
-          if (currentLineIsBlank && isHeaderSection) {
-              // End of headers detected after an empty line, indicating that headers are fully parsed.
-              break; 
-          }
-          if (!requestLineParsed && currentLine.length() > 0) {
-              // Parsing the request line
-              int firstSpace = currentLine.indexOf(' ');
-              int secondSpace = currentLine.indexOf(' ', firstSpace + 1);
-              if (firstSpace != -1 && secondSpace != -1) {
-                  requestPath = currentLine.substring(firstSpace + 1, secondSpace);
-                  int questionMark = requestPath.indexOf('?');
-                  if (questionMark != -1) {
-                      queryString = requestPath.substring(questionMark + 1);
-                      requestPath = requestPath.substring(0, questionMark);
-                  }
-                  Serial.println("\nRequest Path: '" + requestPath + "', Query String: '" + queryString + "'");
-                  requestLineParsed = true;
-                  isHeaderSection = true; // Start expecting headers next
-              }
-          } else if (isHeaderSection) {
-              // Processing and ignoring headers
-              if (currentLine.length() > 0) {
-                  Serial.println("Processing Header: " + currentLine);
-              }
-          }
-          currentLine = ""; // Reset current line
-          currentLineIsBlank = true;
-      } else {
-          currentLine += c;
-          currentLineIsBlank = false;
-      }
+// Parse whatever part of the request has arrived, then route it once it's complete
+void readLocalRequest(uint8_t socketNum) {
+  LocalSocket& socket = localSockets[socketNum];
+
+  int available = socket.client.available();
+  if (available > 0) {
+    uint8_t chunk[localReadChunkSize];
+    int length = socket.client.read(chunk, available < (int)sizeof(chunk) ? available : sizeof(chunk));
+    for (int i = 0; i < length && !socket.request.isDone() && !socket.request.hasError(); i++) {
+      socket.request.feed((char)chunk[i]);
+    }
+  }
+
+  if (socket.request.isDone()) {
+    Serial.print(F("Request: "));
+    Serial.print(socket.request.method());
+    Serial.print(' ');
+    Serial.print(socket.request.path());
+    Serial.print(F(", query: '"));
+    Serial.print(socket.request.query());
+    Serial.println('\'');
+
+    const HttpRoute* route = findHttpRoute(localRoutes, NUM_LOCAL_ROUTES, socket.request.path());
+    if (route != nullptr) {
+      route->handler(socketNum, socket.request);
+    } else {
+      Serial.println(F("Responding with 404 Not Found..."));
+      respondToLocalClient(socketNum, 404, "Error: Not Found");
+    }
+  } else if (socket.request.hasError()) {
+    Serial.println(F("Bad Request or Incomplete Request..."));
+    respondToLocalClient(socketNum, socket.request.errorStatus(), "Error: Bad Request");
+  } else if (!socket.client.connected()) {
+    socket.client.stop();
+    markSocketAsFree(socketNum);
+  } else if (millis() - socket.since > localRequestTimeout) {
+    respondToLocalClient(socketNum, 408, "Error: Request Timeout");
   }
-  return requestLineParsed;
 }
 
-void handleClientRequests(EthernetClient& client) {
-  uint8_t socketNum = client.getSocketNumber();
-
-  String requestPath, queryString;
-  if (readRequestPath(client, requestPath, queryString)) {
-      if (requestPath == "/status") {
-          Serial.println("Responding with LED status...");
-          respondWithLEDStatus(client);
-          client.stop();  // It's safe to close connection here
-          markSocketAsFree(socketNum); // Mark the socket as free after the client is stopped
-      } else if (requestPath == "/status/nano") {
-          Serial.println("Requesting Nano status...");
-          requestNanoStatus();
-          // Do not close the client connection here, wait for the response from the Nano
-          // Make sure to close the connection after the Nano response is processed and sent
-      } else if (requestPath == "/calibrate/ph") {
-          Serial.println("Calibrating pH...");
-          handlePhCalibration(client, queryString);
-          client.stop();  // Close connection if response is immediate
-          // Serial.println("Client Disconnected.");
-          markSocketAsFree(socketNum);
-      } else {
-          // Respond with a 404 Not Found error for unrecognized paths
-          Serial.println("Responding with 404 Not Found...");
-          client.println("HTTP/1.1 404 Not Found");
-          client.println("Content-Type: text/plain");
-          client.println("Connection: close");
-          client.println();
-          client.println("Error: Not Found");
-          client.stop();  // Close the client connection here as well
-          // Serial.println("Client Disconnected.");
-          markSocketAsFree(socketNum);
-      }
-  } else {
-      // If path could not be read, also return a 404 error
-      Serial.println("Bad Request or Incomplete Request...");
-      client.println("HTTP/1.1 400 Bad Request");
-      client.println("Content-Type: text/plain");
-      client.println("Connection: close");
-      client.println();
-      client.println("Error: Not Found");
-      client.stop();  // Close the client connection
-      markSocketAsFree(socketNum);
+// Send a plain text response and close the connection
+void respondToLocalClient(uint8_t socketNum, int status, const char* body) {
+  LocalSocket& socket = localSockets[socketNum];
+  sendHttpResponse(socket.client, status, "text/plain", body);
+  socket.client.stop();
+  markSocketAsFree(socketNum);
+}
+
+bool isAwaitingNano(LocalSocketState state) {
+  for (uint8_t socketNum = 0; socketNum < MAX_SOCK_NUM; socketNum++) {
+    if (localSockets[socketNum].state == state) {
+      return true;
+    }
   }
+  return false;
 }
 
 void markSocketAsFree(uint8_t socketNum) {
   // Ensure the socket number is valid before marking it free (should always be valid)
   if (socketNum < MAX_SOCK_NUM) {
-      socketsInUse[socketNum] = false; // Reset the flag indicating this socket is no longer in use
-      Serial.println("Socket " + String(socketNum) + " marked as free.");
+      localSockets[socketNum].state = SOCKET_FREE; // Reset the flag indicating this socket is no longer in use
+      Serial.print(F("Socket "));
+      Serial.print(socketNum);
+      Serial.println(F(" marked as free."));
   } else {
-      Serial.print("Error: Invalid socket number " + String(socketNum) + " provided.");
+      Serial.print(F("Error: Invalid socket number "));
+      Serial.print(socketNum);
+      Serial.println(F(" provided."));
   }
 }
 
-void handlePhCalibration(EthernetClient& localClient, String queryString) {
-    // Extract calibration values from the query string
-    String lowCal = getValue(queryString, "low_cal=");
-    String midCal = getValue(queryString, "mid_cal=");
-    String highCal = getValue(queryString, "high_cal=");
-
-    if (midCal.length() > 0 && lowCal.length() > 0 && highCal.length() > 0) {
-        String calibrationCommand = "CALIBRATE_PH " + lowCal + "," + midCal + "," + highCal;
-        Serial1.println(calibrationCommand);
-
-        // Wait for a response or timeout
-        String response = "";
-        long timeout = millis() + 5000;  // 5-second timeout
-        while (millis() < timeout && response.length() == 0) {
-            if (Serial1.available() > 0) {
-                char c = Serial1.read();
-                if (c == '\n') break;  // End of message
-                response += c;
-            }
-        }
+void handleLedStatusRoute(uint8_t socketNum, const HttpRequestParser& request) {
+    int red, green, blue, intensity;
+    getOnBoardLEDColor(&red, &green, &blue, &intensity); // Fetch the current LED status
 
-        if (response.length() > 0 && response == "CALIBRATION_SUCCESS") {
-            localClient.println("HTTP/1.1 200 OK");
-            localClient.println("Content-Type: text/plain");
-            localClient.println("Connection: close");
-            localClient.println();
-            localClient.println("Calibration successful: " + response);
-        } else if (response == "PENDING_OPERATION") {
-            localClient.println("HTTP/1.1 202 Accepted");
-            localClient.println("Content-Type: text/plain");
-            localClient.println("Connection: close");
-            localClient.println();
-            localClient.println("Calibration pending until peripheral connection.");
-        } else {
-            localClient.println("HTTP/1.1 504 Gateway Timeout");
-            localClient.println("Content-Type: text/plain");
-            localClient.println("Connection: close");
-            localClient.println();
-            localClient.println("Calibration failed or no response");
-        }
-    } else {
-        localClient.println("HTTP/1.1 400 Bad Request");
-        localClient.println("Content-Type: text/plain");
-        localClient.println("Connection: close");
-        localClient.println();
-        localClient.println("Missing one or more calibration parameters");
+    char jsonResponse[64];
+    snprintf(jsonResponse, sizeof(jsonResponse), "{\"red\":%d,\"green\":%d,\"blue\":%d,\"intensity\":%d}",
+             red, green, blue, intensity);
+    Serial.print(F("Sending LED status response: "));
+    Serial.println(jsonResponse);
+
+    LocalSocket& socket = localSockets[socketNum];
+    sendHttpResponse(socket.client, 200, "application/json", jsonResponse);
+    socket.client.stop();
+    markSocketAsFree(socketNum);
+}
+
+void handleNanoStatusRoute(uint8_t socketNum, const HttpRequestParser& request) {
+    // The response is sent by respondToNanoStatusRequests() when the Nano's status frame arrives.
+    // Requests that come in while one is already outstanding share its reply.
+    if (!isAwaitingNano(SOCKET_AWAITING_NANO_STATUS) && !isAwaitingNano(SOCKET_AWAITING_METRICS)) {
+        requestNanoStatus();
     }
+    localSockets[socketNum].state = SOCKET_AWAITING_NANO_STATUS;
+    localSockets[socketNum].since = millis();
 }
 
-String getValue(String data, String key) {
-    int found = data.indexOf(key);
-    if (found == -1) return "";
+void handleMetricsRoute(uint8_t socketNum, const HttpRequestParser& request) {
+    // Like /status/nano, the response is sent once the Nano's status frames are in (see respondToMetricsRequests()),
+    // so the BLE counters are current. Waiting on /status/nano and /metrics share one status request.
+    if (!isAwaitingNano(SOCKET_AWAITING_NANO_STATUS) && !isAwaitingNano(SOCKET_AWAITING_METRICS)) {
+        requestNanoStatus();
+    }
+    localSockets[socketNum].state = SOCKET_AWAITING_METRICS;
+    localSockets[socketNum].since = millis();
+}
+
+void handlePhCalibrationRoute(uint8_t socketNum, const HttpRequestParser& request) {
+    // Extract calibration values from the query string
+    char lowCal[12], midCal[12], highCal[12];
+    if (!request.queryParam("low_cal", lowCal, sizeof(lowCal)) ||
+        !request.queryParam("mid_cal", midCal, sizeof(midCal)) ||
+        !request.queryParam("high_cal", highCal, sizeof(highCal)) ||
+        lowCal[0] == '\0' || midCal[0] == '\0' || highCal[0] == '\0') {
+        respondToLocalClient(socketNum, 400, "Missing one or more calibration parameters");
+        return;
+    }
+    // Which monitor to calibrate, the original one if not given
+    char device[4] = "";
+    if (request.queryParam("device", device, sizeof(device)) && device[0] != '\0' && !isNumber(device)) {
+        respondToLocalClient(socketNum, 400, "Invalid device parameter");
+        return;
+    }
+    // The Nano's reply doesn't say which command it answers, so only one calibration can be outstanding
+    if (isAwaitingNano(SOCKET_AWAITING_CALIBRATION)) {
+        respondToLocalClient(socketNum, 503, "Calibration already in progress");
+        return;
+    }
+
+    Serial.println(F("Calibrating pH..."));
+    Serial1.print(F("CALIBRATE_PH "));
+    Serial1.print(lowCal);
+    Serial1.print(',');
+    Serial1.print(midCal);
+    Serial1.print(',');
+    Serial1.print(highCal);
+    if (device[0] != '\0') {
+        Serial1.print(',');
+        Serial1.print(device);
+    }
+    Serial1.println();
 
-    int startIndex = found + key.length();
-    int endIndex = data.indexOf('&', startIndex);
-    if (endIndex == -1) endIndex = data.length();
+    // The response is sent by handleNanoReply() when the Nano answers, or on timeout
+    localSockets[socketNum].state = SOCKET_AWAITING_CALIBRATION;
+    localSockets[socketNum].since = millis();
+}
 
-    return data.substring(startIndex, endIndex);
+// A command reply from the Nano; currently only calibration requests wait on one
+void handleNanoReply(const uint8_t* payload, size_t length) {
+  char reply[48];
+  if (length >= sizeof(reply)) {
+    length = sizeof(reply) - 1;
+  }
+  memcpy(reply, payload, length);
+  reply[length] = '\0';
+  Serial.print(F("Reply from Nano: "));
+  Serial.println(reply);
+
+  for (uint8_t socketNum = 0; socketNum < MAX_SOCK_NUM; socketNum++) {
+    if (localSockets[socketNum].state != SOCKET_AWAITING_CALIBRATION) {
+      continue;
+    }
+    if (strcmp(reply, "CALIBRATION_SUCCESS") == 0) {
+      respondToLocalClient(socketNum, 200, "Calibration successful: CALIBRATION_SUCCESS");
+    } else if (strcmp(reply, "PENDING_OPERATION") == 0) {
+      respondToLocalClient(socketNum, 202, "Calibration pending until peripheral connection.");
+    } else {
+      respondToLocalClient(socketNum, 504, "Calibration failed or no response");
+    }
+  }
 }
 
 void establishSerialConnectionWithNano() {
   unsigned long lastAttemptTime = 0;
   const unsigned long attemptInterval = 1000; // half second
+  LineReader debugCommand;
+  LineReader nanoReply;
 
   Serial.println(F("Establishing handshake with Nano 33 IoT..."));
   // keep sending connection message to Nano until we receive a response
   while (true) {
     // Check if debug command is received
-    if (Serial.available()) {
-      String command = Serial.readStringUntil('\n');
-      command.trim();
-      if (command == "DEBUG") {
-        Serial.println(F("Debug mode enabled, skipping connection with Nano."));
-        return;
-      }
+    if (debugCommand.poll(Serial) && strcmp(debugCommand.line(), "DEBUG") == 0) {
+      Serial.println(F("Debug mode enabled, skipping connection with Nano."));
+      return;
     }
 
     // if enough time has passed since the last attempt
@@ -421,11 +681,10 @@ void establishSerialConnectionWithNano() {
     }
 
     // wait for acknowledgment from Nano
-    if (Serial1.available()) {
-      String received = Serial1.readStringUntil('\n');
-      received.trim(); // remove any leading/trailing white space or special characters
-      Serial.println("\tReceived: " + received); // Print any received message
-      if (received == "NANO_CONNECTED") {
+    if (nanoReply.poll(Serial1)) {
+      Serial.print(F("\tReceived: ")); // Print any received message
+      Serial.println(nanoReply.line());
+      if (strcmp(nanoReply.line(), "NANO_CONNECTED") == 0) {
         Serial.println(F("Serial connection with Nano established!"));
         return;
       }
@@ -494,12 +753,12 @@ void setRTCFromNTPServer() {
 
   for(int attempt = 0; attempt < maxAttempts && !packetReceived; attempt++) {
     int waitTime = attempt == 0 ? 0 : 4000; // 5000ms initially, 4000ms after the first attempt
-    delay(waitTime);
+    scheduler.delay(waitTime);
     // send an NTP packet to a time server
     sendNTPpacket(timeServer);
 
     // wait to see if a reply is available (must be > 4 seconds to resist a denial of service)
-    delay(1000);
+    scheduler.delay(1000);
 
     if (Udp.parsePacket()) {
       Serial.println(F("Received NTP packet!"));
@@ -555,36 +814,21 @@ void setRTCFromNTPServer() {
     // Write a new entry to Firebase with the server's timestamp
     StaticJsonDocument<256> jsonPayload;
     jsonPayload["timestamp"][".sv"] = "timestamp";
-    sendJsonPatchRequest("/timestamp.json", jsonPayload);
+    sendJsonPatchRequest("/timestamp.json", jsonPayload, REQUEST_OTHER);
 
-    // Read the timestamp back from Firebase
-    sendGetRequest("/timestamp.json", processFirebaseTimestampResponse);
-  }
-}
-
-void processFirebaseTimestampResponse() {
-  // Wait for the server to respond
-  unsigned long timeout = millis();
-  while (firebaseClient.available() == 0) {
-    if (millis() - timeout > 5000) {
-      Serial.println(">>> Client Timeout !");
-      firebaseClient.stop();
-      return;
+    // Read the timestamp back from Firebase; onFirebaseResponse() sets the RTC from the reply
+    sendGetRequest("/timestamp.json", REQUEST_TIMESTAMP);
+    while (firebaseRequests.inFlight() > 0 && firebaseRequests.poll(firebaseClient)) {
+      scheduler.run();
+      yield();
     }
   }
+}
 
-  // Read all the lines of the reply from server
-  String response = "";
-  while (firebaseClient.available()) {
-    response += firebaseClient.readStringUntil('\n');
-  }
-
-  // Optional: Add a delay to ensure the request has completed
-  delay(100);
-
-  // Parse the response
-  StaticJsonDocument<200> doc;
-  DeserializationError error = deserializeJson(doc, response);
+// Set the RTC from the body of GET /timestamp.json: {"timestamp": <ms since the epoch>}
+void processFirebaseTimestampResponse(const HttpResponseParser& response) {
+  StaticJsonDocument<64> doc;
+  DeserializationError error = deserializeJson(doc, response.body(), response.bodyLength());
 
   if (error) {
     Serial.print(F("deserializeJson() failed: "));
@@ -592,10 +836,8 @@ void processFirebaseTimestampResponse() {
     return;
   }
 
-  // Get the timestamp
-  unsigned long timestamp = doc["timestamp"].as<unsigned long>();
-  // Convert the timestamp from milliseconds to seconds
-  unsigned long epoch = timestamp / 1000;
+  // Get the timestamp and convert it from milliseconds to seconds
+  unsigned long epoch = doc["timestamp"].as<uint64_t>() / 1000;
 
   // Set the RTC
   rtc.setEpoch(epoch);
@@ -608,13 +850,7 @@ bool connectToServer() {
   Serial.println(F(" ..."));
 
   // if you get a connection, report back via serial:
-  auto start = millis();
-  // specify the server and port, 443 is the standard port for HTTPS
-  if (firebaseClient.connect(firebaseHost, 443)) {
-    auto time = millis() - start;
-    Serial.print(F("Took: "));
-    Serial.print(time);
-    Serial.println(F("ms"));
+  if (connectFirebaseClient()) {
     setOnBoardLEDColor(0, 255, 0, LED_INTENSITY_HIGH); // green
     return true;
   } else {
@@ -625,7 +861,58 @@ bool connectToServer() {
   }
 }
 
+// Open the TLS connection to Firebase. SSLClient offers the session cached from the last connection,
+// so a reconnect is normally an abbreviated handshake instead of a full certificate check and key exchange.
+bool connectFirebaseClient() {
+  firebaseRequests.abort(); // nothing sent on an old connection will be answered on the new one
+
+  SSLSession* session = firebaseClient.getSession(firebaseHost);
+  if (session != nullptr) {
+    tlsStats.beginHandshake(session->session_id, session->session_id_len);
+  } else {
+    tlsStats.beginHandshake(nullptr, 0);
+  }
+
+  if (!firebaseClient.connect(firebaseHost, firebasePort)) {
+    TlsFailureReason reason = tlsFailureReason(firebaseClient.getWriteError());
+    tlsStats.recordFailure(reason);
+    if (reason == TLS_FAIL_HANDSHAKE) {
+      // Don't offer a session the server may no longer accept on the next attempt
+      firebaseClient.removeSession(firebaseHost);
+    }
+    tlsStats.printTo(Serial);
+    return false;
+  }
+
+  session = firebaseClient.getSession(firebaseHost);
+  bool resumed = session != nullptr ? tlsStats.endHandshake(session->session_id, session->session_id_len)
+                                    : tlsStats.endHandshake(nullptr, 0);
+  Serial.print(resumed ? F("Resumed TLS session. Took: ") : F("Full TLS handshake. Took: "));
+  Serial.print(tlsStats.lastHandshakeMs());
+  Serial.println(F("ms"));
+  tlsStats.printTo(Serial);
+  return true;
+}
+
+TlsFailureReason tlsFailureReason(int sslError) {
+  switch (sslError) {
+    case SSLClient::SSL_CLIENT_CONNECT_FAIL:
+      return TLS_FAIL_TCP;
+    case SSLClient::SSL_BR_CONNECT_FAIL:
+      return TLS_FAIL_HANDSHAKE;
+    case SSLClient::SSL_CLIENT_WRTIE_ERROR: // (sic) spelling from SSLClient
+    case SSLClient::SSL_BR_WRITE_ERROR:
+      return TLS_FAIL_WRITE;
+    case SSLClient::SSL_OUT_OF_MEMORY:
+      return TLS_FAIL_MEMORY;
+    default:
+      return TLS_FAIL_OTHER;
+  }
+}
+
 void reconnectToServer() {
+  reconnecting = true;
+  firebaseReconnects++;
   // Check if we are actually closed before trying
   if (firebaseClient.m_soft_connected(__func__)) {
     Serial.println(F("Soft check failed: SSL connection was not closed properly."));
@@ -643,17 +930,12 @@ void reconnectToServer() {
     // Kick the watchdog to reset the timer
     Watchdog.reset();
 
-    auto start = millis();
-    int result = firebaseClient.connect(firebaseHost, 443);
+    bool result = connectFirebaseClient();
     display_freeram();  // Display free RAM after attempting to reconnect
 
     if (result) {
       // Handle connection success
-      auto time = millis() - start;
       Serial.println(F("Reconnected to server!"));
-      Serial.print(F("Took: "));
-      Serial.print(time);
-      Serial.println(F("ms"));
       // Flicker onboard LED green
       setOnBoardLEDColor(0, 255, 0, LED_INTENSITY_HIGH); // green
       connected = true;
@@ -678,12 +960,12 @@ void reconnectToServer() {
         unsigned long delayTime = retryDelay;
         while (delayTime > 0) {
             unsigned long chunk = min(delayTime, 10000); // Kick the watchdog every 10 seconds
-            delay(chunk);
+            waitAndReceiveFromNano(chunk);
             Watchdog.reset();
             delayTime -= chunk;
         }
       } else {
-        delay(retryDelay);
+        waitAndReceiveFromNano(retryDelay);
         Watchdog.reset();
       }
 
@@ -695,13 +977,15 @@ void reconnectToServer() {
     attempt++;
   }
 
+  reconnecting = false;
+
   if (!connected) {
     Serial.println(F("Failed to reconnect after multiple attempts."));
     setOnBoardLEDColor(255, 0, 0, LED_INTENSITY_HIGH); // red
-    delay(5000);
+    scheduler.delay(5000);
     setOnBoardLEDColor(0, 0, 0, LED_INTENSITY_HIGH); // off
 
-    // Perform a system reset
+    // Perform a system reset (the stored log entries are uploaded after it)
     NVIC_SystemReset();
   } else {
     display_freeram();  // Display free RAM after successful connection
@@ -710,174 +994,720 @@ void reconnectToServer() {
   }
 }
 
-void processSensorDataFromNano(EthernetClient& localClient) {
-  StaticJsonDocument<256> jsonPayload;
-  DeserializationError error = deserializeJson(jsonPayload, Serial1);
-  if (error.c_str() == "InvalidInput") {
-    // ignore "InvalidInput" case (likely due to Nano not connected which only occurs in testing)
-    //// documentation: https://arduinojson.org/v6/api/misc/deserializationerror/
+// Wait between reconnection attempts while still taking in the Nano's frames, so the log entries
+// sent meanwhile are stored instead of overflowing the UART buffer
+void waitAndReceiveFromNano(unsigned long ms) {
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    scheduler.run();
+    if (Serial1.available() > 0) {
+      processSensorDataFromNano();
+    }
+    yield();
+  }
+}
+
+void processSensorDataFromNano() {
+  // Read whatever bytes have arrived; only act once a complete frame that passes the CRC check is in
+  // Corrupted or dropped frames are counted by the reader instead of silently disappearing
+  if (!nanoFrameReader.poll(Serial1)) {
+    return;
+  }
+
+  Serial.print(F("Frame received from Nano 33 IoT! Type: "));
+  Serial.print(nanoFrameReader.type());
+  Serial.print(F(", device: "));
+  Serial.print(nanoFrameReader.device());
+  Serial.print(F(", sequence: "));
+  Serial.print(nanoFrameReader.sequence());
+  Serial.print(F(", size: "));
+  Serial.println(nanoFrameReader.wireLength());
+
+  if (PROFILE) {
+    profiler.recordMessage(nanoFrameReader.wireLength());
+  }
+  if (TRACE) {
+    trace.frame(nanoFrameReader.type(), nanoFrameReader.device(), nanoFrameReader.sequence(), nanoFrameReader.payload(), nanoFrameReader.payloadLength());
+  }
+
+  uint8_t updateType = nanoFrameReader.type();
+  uint8_t device = nanoFrameReader.device();
+  if (device >= FRAME_MAX_DEVICES) {
+    Serial.println(F("Frame from an unknown device. Ignoring data."));
     return;
   }
-  else if (error) {
-    // this oftentimes occurs when the input is empty (inbetween sensor readings)
-    // use this case to catch that and not send unnecessary data to Firebase
-    // Serial.print(F("\ndeserializeJson() failed: "));
-    // Serial.println(error.c_str());
+
+  if (updateType == FRAME_REPLY) {
+    handleNanoReply(nanoFrameReader.payload(), nanoFrameReader.payloadLength());
     return;
   }
-  
-  // Print the received JSON object in a human-readable format
-  Serial.println(F("Data received from Nano 33 IoT!"));
-  Serial.println(F("Received JSON payload:"));
-  serializeJsonPretty(jsonPayload, Serial);
-  Serial.println();
 
-  Serial.print(F("JSON Object Size: "));
-  Serial.println(measureJson(jsonPayload));
-
-  // Read the value at the "type" key to route data correctly
-  const char* updateType = jsonPayload["type"];
-  jsonPayload.remove("type"); // Remove the "type" key from the JSON payload
-
-  // Determine the correct data path based on the "type" key value
-  if (strcmp(updateType, "status") == 0) {
-      respondWithStatus(localClient, jsonPayload);
-  } else if (strcmp(updateType, "realtime") == 0 || strcmp(updateType, "realtime-debug") == 0) {
-    Serial.println(F("Hi!"));
-    // if the server's disconnected, stop the client:
-    if (!firebaseClient.connected()) {
-      display_freeram();  // Display free RAM before attempting to reconnect
-      reconnectToServer();
-      display_freeram();  // Display free RAM after attempting to reconnect
-      Serial.println(F("Reconnected to server. Sending sensor data..."));
-      recentlyDisconnected = false; // Reset flag on successful reconnection
+  // Status responses go back to the app, not to Firebase. The Nano sends one per monitor, the response
+  // is built once the last one is in.
+  if (updateType == FRAME_STATUS) {
+    NanoStatus status;
+    if (!unpackNanoStatus(nanoFrameReader.payload(), nanoFrameReader.payloadLength(), status)) {
+      Serial.println(F("Malformed status frame. Ignoring data."));
       return;
     }
-    Serial.println(F("Hello!"));
-    // freeRam before sending data
-    display_freeram();
-    sendJsonPatchRequest(firebaseRealtimeDataPath, jsonPayload);
-    // freeRam after sending data
-    display_freeram();
-    Serial.println(F("Sent realtime data to Firebase."));
-  } else if (strcmp(updateType, "log") == 0 || strcmp(updateType, "log-debug") == 0) {
-    const char* firebasePath = (strcmp(updateType, "log") == 0) ? firebaseLogSensorDataPath : firebaseDebugLogSensorDataPath;
-    if (!firebaseClient.connected()) {
-      reconnectToServer();
-      Serial.println(F("Reconnected to server. Sending log data..."));
-      recentlyDisconnected = false; // Reset flag on successful reconnection
+    nanoDeviceStatus[device] = status;
+    uint8_t deviceCount = min(status.deviceCount, (uint8_t)FRAME_MAX_DEVICES);
+    if (device + 1 < deviceCount) {
+      return;
+    }
+    nanoStatusReceived = true;
+    respondToMetricsRequests();
+    if (!isAwaitingNano(SOCKET_AWAITING_NANO_STATUS)) {
+      return;
+    }
+
+    StaticJsonDocument<NANO_STATUS_JSON_CAPACITY> jsonPayload;
+    // The original monitor's status stays at the top level for older clients
+    nanoDeviceStatusToJson(nanoDeviceStatus[0], jsonPayload.to<JsonObject>());
+    JsonArray devices = jsonPayload.createNestedArray("devices");
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      nanoDeviceStatusToJson(nanoDeviceStatus[i], devices.createNestedObject());
+    }
+    // Health of the Nano -> MKR UART link
+    JsonObject link = jsonPayload.createNestedObject("uartLink");
+    link["frames"] = nanoFrameReader.framesReceived;
+    link["crcErrors"] = nanoFrameReader.crcErrors;
+    link["droppedFrames"] = nanoFrameReader.droppedFrames;
+    // Upload batching (requests sent vs. updates/log entries received)
+    JsonObject uploads = jsonPayload.createNestedObject("uploads");
+    uploads["requests"] = firebaseRequests.requestsSent;
+    uploads["inFlight"] = firebaseRequests.inFlight();
+    uploads["failed"] = firebaseRequestsFailed;
+    uploads["retries"] = firebaseRetries;
+    uploads["timeouts"] = firebaseRequests.timeouts;
+    unsigned long realtimeUpdates = 0;
+    for (uint8_t i = 0; i < FRAME_MAX_DEVICES; i++) {
+      realtimeUpdates += realtimeUploads[i].updatesReceived;
+    }
+    uploads["realtimeUpdates"] = realtimeUpdates;
+    unsigned long pendingLogEntries = logUploads.count() + debugLogUploads.count();
+    unsigned long droppedLogEntries = logUploads.droppedEntries + debugLogUploads.droppedEntries;
+    for (int i = 0; i < NUM_ROLLUP_TIERS; i++) {
+      pendingLogEntries += rollupTiers[i].uploads.count();
+      droppedLogEntries += rollupTiers[i].uploads.droppedEntries;
+    }
+    uploads["pendingLogEntries"] = pendingLogEntries;
+    uploads["droppedLogEntries"] = droppedLogEntries;
+    // Log entries kept in flash until they're uploaded
+    JsonObject stored = jsonPayload.createNestedObject("storedLog");
+    stored["pending"] = storedLog.pending();
+    stored["dropped"] = storedLog.recordsDropped;
+    stored["corrupt"] = storedLog.corruptRecords;
+    stored["sectorsErased"] = storedLog.sectorsErased;
+    stored["writeErrors"] = storedLog.writeErrors;
+    // Round trip of each type of Firebase request (percentiles are bucket upper bounds, see latency_histogram.h)
+    JsonObject latency = jsonPayload.createNestedObject("latency");
+    for (int i = 0; i < NUM_REQUEST_TAGS; i++) {
+      JsonObject tagLatency = latency.createNestedObject(requestTagNames[i]);
+      tagLatency["count"] = requestLatency[i].count();
+      tagLatency["p50"] = requestLatency[i].percentile(50);
+      tagLatency["p90"] = requestLatency[i].percentile(90);
+      tagLatency["p99"] = requestLatency[i].percentile(99);
+    }
+    // Heap, stack and steady state allocations (see memory_monitor.h)
+    MemoryStats memory = memoryMonitor.stats();
+    JsonObject memoryObj = jsonPayload.createNestedObject("memory");
+    memoryObj["freeRam"] = memory.freeRam;
+    memoryObj["minFreeRam"] = memory.minFreeRam;
+    memoryObj["heapInUse"] = memory.heapInUse;
+    memoryObj["heapFree"] = memory.heapFree;
+    memoryObj["heapFreeBlocks"] = memory.heapFreeBlocks;
+    memoryObj["stackHighWater"] = memory.stackHighWater;
+    memoryObj["steadyStateAllocations"] = memoryMonitor.steadyStateAllocations();
+    // Cost of (re)connecting to Firebase
+    JsonObject tls = jsonPayload.createNestedObject("tls");
+    tls["fullHandshakes"] = tlsStats.fullHandshakes();
+    tls["resumedHandshakes"] = tlsStats.resumedHandshakes();
+    tls["fullHandshakeAvgMs"] = tlsStats.fullHandshakeMs.mean();
+    tls["resumedHandshakeAvgMs"] = tlsStats.resumedHandshakeMs.mean();
+    JsonObject tlsFailures = tls.createNestedObject("failures");
+    for (int i = 0; i < TLS_FAIL_REASON_COUNT; i++) {
+      tlsFailures[tlsFailureReasonNames[i]] = tlsStats.failures((TlsFailureReason)i);
     }
-    handleLogType(firebasePath, jsonPayload);
+    respondToNanoStatusRequests(jsonPayload);
+    return;
+  }
+
+  // Log frames can carry the spread (min/max/stddev) of each sensor after the means,
+  // realtime frames the sample's timing so far (see pipeline_timing.h)
+  const uint8_t* payload = nanoFrameReader.payload();
+  size_t payloadLength = nanoFrameReader.payloadLength();
+  bool isRealtimeFrame = updateType == FRAME_REALTIME || updateType == FRAME_REALTIME_DEBUG;
+  size_t readingsLength = payloadLength > SENSOR_READINGS_PACKED_SIZE ? SENSOR_READINGS_PACKED_SIZE : payloadLength;
+  const uint8_t* trailer = payload + readingsLength;
+  size_t trailerLength = payloadLength - readingsLength;
+
+  SensorReadings readings;
+  SensorSpreads spreads;
+  PipelineStamp stamp;
+  if (!unpackSensorReadings(payload, readingsLength, readings) ||
+      (trailerLength > 0 && (isRealtimeFrame ? !unpackPipelineStamp(trailer, trailerLength, stamp)
+                                             : !unpackSensorSpreads(trailer, trailerLength, spreads)))) {
+    Serial.println(F("Malformed sensor frame. Ignoring data."));
+    return;
+  }
+  printSensorReadings(Serial, readings);
+
+  // Readings are queued here and sent by flushUploadQueues(), so several of them share one request
+  if (isRealtimeFrame) {
+    // A frame from a Nano without the stamp only has the stages from here on
+    unsigned long ageAtParse = trailerLength > 0 ? recordPipelineStamp(stamp) : 0;
+    if (!realtimeUploads[device].isPending()) {
+      realtimePendingTiming[device].parsedAt = millis();
+      realtimePendingTiming[device].ageAtParse = ageAtParse;
+    }
+    realtimeUploads[device].update(readings);
+  } else if (updateType == FRAME_LOG) {
+    uint32_t epoch = rtc.getEpoch();
+    if (UPLOAD_MINUTE_LOG) {
+      storeLogEntry(epoch, device, readings, spreads);
+    }
+    rollUpLogEntry(epoch, device, readings, spreads);
+  } else if (updateType == FRAME_LOG_DEBUG) {
+    debugLogUploads.add(rtc.getEpoch(), readings, spreads, device);
   } else {
     Serial.println(F("Invalid update type. Ignoring data."));
     return;
   }
+
+  // if the server's disconnected, reconnect so the queued data can go out, once disconnectDelay has passed
+  // (not from inside reconnectToServer()'s own wait)
+  if (!firebaseClient.connected() && !reconnecting && millis() - lastDisconnectTime > disconnectDelay) {
+    display_freeram();  // Display free RAM before attempting to reconnect
+    reconnectToServer();
+    display_freeram();  // Display free RAM after attempting to reconnect
+    Serial.println(F("Reconnected to server. Sending queued data..."));
+    recentlyDisconnected = false; // Reset flag on successful reconnection
+  }
+}
+
+// Send the realtime and log uploads that are due. Anything that can't be sent stays queued.
+void flushUploadQueues() {
+  if (!firebaseClient.connected()) {
+    return;
+  }
+
+  // Only one realtime write is in flight at a time, so a failed write can't overwrite newer values.
+  // The monitors take turns, starting after the one that sent last.
+  for (uint8_t i = 0; i < FRAME_MAX_DEVICES && !realtimeWriteInFlight; i++) {
+    uint8_t device = (nextRealtimeDevice + i) % FRAME_MAX_DEVICES;
+    RealtimeCoalescer& uploads = realtimeUploads[device];
+    if (!uploads.isFlushDue()) {
+      continue;
+    }
+    // JSON is only used as the final encoding for Firebase
+    StaticJsonDocument<256> jsonPayload;
+    sensorReadingsToJson(uploads.latest(), jsonPayload);
+    char node[DEVICE_NODE_PATH_SIZE];
+    deviceNodePath(node, sizeof(node), device, firebaseRealtimeDataNode);
+    char path[DEVICE_NODE_PATH_SIZE + 6];
+    snprintf(path, sizeof(path), "/%s.json", node);
+    if (sendJsonPatchRequest(path, jsonPayload, REQUEST_REALTIME)) {
+      stageLatency[STAGE_QUEUE].record(millis() - realtimePendingTiming[device].parsedAt);
+      realtimeInFlightTiming = realtimePendingTiming[device];
+      realtimeInFlight = uploads.latest();
+      realtimeInFlightDevice = device;
+      realtimeWriteInFlight = true;
+      uploads.clear();
+      nextRealtimeDevice = (device + 1) % FRAME_MAX_DEVICES;
+      Serial.println(F("Sent realtime data to Firebase."));
+    }
+    break;
+  }
+
+  refillLogUploads();
+  if (logUploads.isFlushDue()) {
+    handleLogType(firebaseLogSensorDataNode, logUploads, REQUEST_LOG);
+  }
+  if (debugLogUploads.isFlushDue()) {
+    handleLogType(firebaseDebugLogSensorDataNode, debugLogUploads, REQUEST_DEBUG_LOG);
+  }
+  for (int i = 0; i < NUM_ROLLUP_TIERS; i++) {
+    if (rollupTiers[i].uploads.isFlushDue()) {
+      handleLogType(rollupTiers[i].node, rollupTiers[i].uploads, rollupTiers[i].tag);
+    }
+  }
 }
 
-void respondWithStatus(EthernetClient& client, const JsonDocument& jsonPayload) {
-  uint8_t socketNum = client.getSocketNumber();
-
-  if (client.connected()) {
-    client.println("HTTP/1.1 200 OK");
-    client.println("Content-Type: application/json");
-    client.println("Connection: close");
-    client.println();
-    serializeJson(jsonPayload, client);
-    client.stop();  // Close the client connection
-    Serial.println("Sent status response: ");
-    serializeJsonPretty(jsonPayload, Serial);
-    Serial.println();
-    markSocketAsFree(socketNum);
+// Where a monitor's data goes in Firebase: device 0 (the original monitor) keeps the original nodes,
+// the others are under Devices/<id>/, e.g. "Devices/1/CurrentConditions"
+void deviceNodePath(char* out, size_t size, uint8_t device, const char* node) {
+  if (device == 0) {
+    snprintf(out, size, "%s", node);
+  } else {
+    snprintf(out, size, "Devices/%u/%s", device, node);
   }
 }
 
-void handleLogType(const char* path, const JsonDocument& jsonPayload) {
-    StaticJsonDocument<256> jsonToSend;
-    unsigned long epoch = rtc.getEpoch();
-    jsonToSend[String(epoch)] = jsonPayload;
+// Write a 1 minute log entry to flash; it's read back into logUploads by refillLogUploads().
+// If it can't be stored it's queued in RAM only. When logUploads is already full of stored entries the
+// RAM only entry is dropped instead: adding it would push out a stored entry that logBatchLastSeq still
+// covers, and the next acknowledged batch would commit that entry without it having been uploaded.
+void storeLogEntry(uint32_t epoch, uint8_t device, const SensorReadings& readings, const SensorSpreads& spreads) {
+  LogEntry entry;
+  entry.epoch = epoch;
+  entry.device = device;
+  entry.readings = readings;
+  entry.spreads = spreads;
+  uint8_t packed[LOG_ENTRY_MAX_PACKED_SIZE];
+  if (storedLogReady && storedLog.append(packed, packLogEntry(entry, packed))) {
+    return;
+  }
+  if (logUploads.count() == UPLOAD_LOG_BATCH_SIZE && logBatchLastSeq > storedLog.committedSequence()) {
+    logUploads.droppedEntries++;
+    return;
+  }
+  logUploads.add(epoch, readings, spreads, device);
+}
+
+// Move stored log entries into logUploads, up to a batch, while no batch is waiting for its response.
+// Entries are replayed in the order they were stored, and committed in onFirebaseResponse().
+void refillLogUploads() {
+  if (!storedLogReady || logUploads.isInFlight()) {
+    return;
+  }
+  uint8_t packed[LOG_ENTRY_MAX_PACKED_SIZE];
+  size_t length;
+  uint32_t seq;
+  while (logUploads.count() < UPLOAD_LOG_BATCH_SIZE && storedLog.readNext(packed, sizeof(packed), length, seq)) {
+    LogEntry entry;
+    if (unpackLogEntry(packed, length, entry)) {
+      logUploads.add(entry.epoch, entry.readings, entry.spreads, entry.device);
+    }
+    logBatchLastSeq = seq;
+  }
+}
 
-    JsonObject timestampObj = jsonToSend[String(epoch)].createNestedObject("timestamp");
-    timestampObj[".sv"] = "timestamp";
+// Feed a monitor's 1 minute log entry into its rollups. When a tier finishes a period its rollup is queued
+// for upload and fed into the next tier.
+void rollUpLogEntry(uint32_t epoch, uint8_t device, const SensorReadings& readings, const SensorSpreads& spreads) {
+  LogEntry entry;
+  entry.epoch = epoch;
+  entry.device = device;
+  entry.readings = readings;
+  entry.spreads = spreads;
+  for (int i = 0; i < NUM_ROLLUP_TIERS; i++) {
+    LogEntry finished;
+    if (!rollupTiers[i].rollups[device].add(entry, finished)) {
+      break;
+    }
+    rollupTiers[i].uploads.add(finished.epoch, finished.readings, finished.spreads, finished.device);
+    entry = finished;
+  }
+}
 
-    sendJsonPatchRequest(path, jsonToSend);
+// The upload queue a log or rollup request was sent from
+LogUploadQueue& logQueueFor(FirebaseRequestTag tag) {
+  if (tag >= REQUEST_ROLLUP_15_MINUTES && tag < REQUEST_ROLLUP_15_MINUTES + NUM_ROLLUP_TIERS) {
+    return rollupTiers[tag - REQUEST_ROLLUP_15_MINUTES].uploads;
+  }
+  return tag == REQUEST_LOG ? logUploads : debugLogUploads;
 }
 
-void readServerResponse() {
-  // check again if we are actually connected here
-  if (!firebaseClient.m_soft_connected(__func__)) {
-    Serial.println(F("Soft check failed: SSL connection was not closed properly."));
+// Add the present sensor readings to a JSON object keyed by their Firebase names
+void sensorReadingsToJson(const SensorReadings& readings, JsonDocument& jsonPayload) {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (readings.has((SensorId)i)) {
+      jsonPayload[sensorRegistry[i].jsonKey] = readings.values[i];
+    }
+  }
+}
+
+// One monitor's status, as sent by the Nano
+void nanoDeviceStatusToJson(const NanoStatus& status, JsonObject json) {
+  json["connected"] = status.connected;
+  if (status.connected) {
+    json["rssi"] = status.rssi;
   } else {
-    // Read all the lines of the reply from server and print them to Serial
-    size_t byteCount = 0;
-    while (firebaseClient.available()) {
-      size_t len = firebaseClient.available();
-      byte buffer[80];
-      if (len > 80) len = 80;
-      firebaseClient.read(buffer, len);
-      if (printWebData) {
-        Serial.write(buffer, len);
+    json["timeSinceLastConnection"] = status.timeSinceLastConnection;
+  }
+  json["bleSamplesDropped"] = status.bleSamplesDropped;
+  // How long the Nano took to get data streaming again after the peripheral dropped (ms)
+  JsonObject reconnect = json.createNestedObject("bleReconnect");
+  reconnect["count"] = status.bleReconnects;
+  reconnect["fullDiscoveries"] = status.bleFullDiscoveries;
+  reconnect["p50"] = status.bleReconnectP50;
+  reconnect["p90"] = status.bleReconnectP90;
+  reconnect["p99"] = status.bleReconnectP99;
+  // Realtime values the Nano held back because they were within their deadband
+  JsonObject realtime = json.createNestedObject("realtimeChanges");
+  realtime["reported"] = status.realtimeValuesReported;
+  realtime["suppressed"] = status.realtimeValuesSuppressed;
+  realtime["heartbeats"] = status.realtimeHeartbeats;
+}
+
+// Answer every local client waiting on /status/nano
+void respondToNanoStatusRequests(const JsonDocument& jsonPayload) {
+  for (uint8_t socketNum = 0; socketNum < MAX_SOCK_NUM; socketNum++) {
+    LocalSocket& socket = localSockets[socketNum];
+    if (socket.state != SOCKET_AWAITING_NANO_STATUS) {
+      continue;
+    }
+    sendHttpHeaders(socket.client, 200, "application/json");
+    serializeJson(jsonPayload, socket.client);
+    socket.client.stop();  // Close the client connection
+    markSocketAsFree(socketNum);
+  }
+  Serial.println(F("Sent status response: "));
+  serializeJsonPretty(jsonPayload, Serial);
+  Serial.println();
+}
+
+// Add a realtime sample's stages up to the hub to the stage histograms
+// @return ms the sample took to get here, over the stages that were measured
+unsigned long recordPipelineStamp(const PipelineStamp& stamp) {
+  unsigned long age = 0;
+  // in the same order as STAGE_READ, STAGE_BLE, STAGE_NANO
+  const uint16_t stages[] = {stamp.readAge, stamp.bleDelay, stamp.nanoHold};
+  for (int i = 0; i < 3; i++) {
+    if (stages[i] != PIPELINE_TIME_UNKNOWN) {
+      stageLatency[STAGE_READ + i].record(stages[i]);
+      age += stages[i];
+    }
+  }
+  uint16_t uart = uartDelay.add(stamp.sentAt, millis());
+  stageLatency[STAGE_UART].record(uart);
+  return age + uart;
+}
+
+// Answer every local client waiting on /metrics, once the Nano's status frames are in
+void respondToMetricsRequests() {
+  for (uint8_t socketNum = 0; socketNum < MAX_SOCK_NUM; socketNum++) {
+    if (localSockets[socketNum].state == SOCKET_AWAITING_METRICS) {
+      respondWithMetrics(socketNum, true);
+    }
+  }
+}
+
+void respondWithMetrics(uint8_t socketNum, bool nanoAnswered) {
+  LocalSocket& socket = localSockets[socketNum];
+  sendHttpHeaders(socket.client, 200, "text/plain; version=0.0.4");
+  writeMetrics(socket.client, nanoAnswered);
+  socket.client.stop();
+  markSocketAsFree(socketNum);
+}
+
+// The per monitor counters from the Nano's status frames, served as e.g. pond_ble_reconnects_total{device="1"}
+const int NUM_NANO_COUNTERS = 6;
+const char* const nanoCounterNames[NUM_NANO_COUNTERS] = {"pond_ble_samples_dropped_total", "pond_ble_reconnects_total",
+  "pond_ble_full_discoveries_total", "pond_realtime_values_reported_total", "pond_realtime_values_suppressed_total",
+  "pond_realtime_heartbeats_total"};
+const char* const nanoCounterHelp[NUM_NANO_COUNTERS] = {"Sensor packets the Nano missed, by their sequence numbers.",
+  "Times the Nano got a monitor streaming again after it dropped.",
+  "Reconnects that needed a full attribute discovery.",
+  "Realtime values the Nano sent on.",
+  "Realtime values the Nano held back because they were within their deadband.",
+  "Unchanged realtime values sent because their heartbeat was due."};
+
+uint32_t nanoCounterValue(const NanoStatus& status, int counter) {
+  switch (counter) {
+    case 0: return status.bleSamplesDropped;
+    case 1: return status.bleReconnects;
+    case 2: return status.bleFullDiscoveries;
+    case 3: return status.realtimeValuesReported;
+    case 4: return status.realtimeValuesSuppressed;
+    default: return status.realtimeHeartbeats;
+  }
+}
+
+// Everything /status/nano reports plus the pipeline stage latencies, in the Prometheus text format
+// (see metrics_writer.h). `nanoAnswered` is false when the Nano didn't send its status in time,
+// its metrics are then the last ones it sent.
+void writeMetrics(Print& out, bool nanoAnswered) {
+  MetricsWriter metrics(out);
+  char labels[40];
+
+  metrics.family("pond_uptime_seconds", "gauge", "Seconds since the hub started.");
+  metrics.sample("pond_uptime_seconds", nullptr, millis() / 1000);
+
+  // Where the time goes from a sensor read to Firebase's acknowledgement
+  metrics.family("pond_pipeline_stage_seconds", "histogram", "Time realtime samples spent in each stage on the way to Firebase.");
+  for (int i = 0; i < NUM_PIPELINE_STAGES; i++) {
+    snprintf(labels, sizeof(labels), "stage=\"%s\"", pipelineStageNames[i]);
+    metrics.histogram("pond_pipeline_stage_seconds", labels, stageLatency[i]);
+  }
+  metrics.family("pond_firebase_request_seconds", "histogram", "Round trip of each type of Firebase request.");
+  for (int i = 0; i < NUM_REQUEST_TAGS; i++) {
+    snprintf(labels, sizeof(labels), "request=\"%s\"", requestTagNames[i]);
+    metrics.histogram("pond_firebase_request_seconds", labels, requestLatency[i]);
+  }
+
+  // Nano -> MKR UART link
+  metrics.family("pond_uart_frames_total", "counter", "Frames received from the Nano.");
+  metrics.sample("pond_uart_frames_total", nullptr, nanoFrameReader.framesReceived);
+  metrics.family("pond_uart_frame_errors_total", "counter", "Frames from the Nano that were dropped, by reason.");
+  metrics.sample("pond_uart_frame_errors_total", "reason=\"crc\"", nanoFrameReader.crcErrors);
+  metrics.sample("pond_uart_frame_errors_total", "reason=\"overflow\"", nanoFrameReader.overflows);
+  metrics.sample("pond_uart_frame_errors_total", "reason=\"version\"", nanoFrameReader.versionErrors);
+  metrics.family("pond_uart_dropped_frames_total", "counter", "Frames missing according to the sequence numbers.");
+  metrics.sample("pond_uart_dropped_frames_total", nullptr, nanoFrameReader.droppedFrames);
+
+  // Firebase uploads and the connection they go over
+  metrics.family("pond_firebase_requests_total", "counter", "Requests sent to Firebase.");
+  metrics.sample("pond_firebase_requests_total", nullptr, firebaseRequests.requestsSent);
+  metrics.family("pond_firebase_request_failures_total", "counter", "Requests answered with an error status or not answered.");
+  metrics.sample("pond_firebase_request_failures_total", nullptr, firebaseRequestsFailed);
+  metrics.family("pond_firebase_retries_total", "counter", "Failed requests whose data was queued again.");
+  metrics.sample("pond_firebase_retries_total", nullptr, firebaseRetries);
+  metrics.family("pond_firebase_timeouts_total", "counter", "Requests that got no response in time.");
+  metrics.sample("pond_firebase_timeouts_total", nullptr, firebaseRequests.timeouts);
+  metrics.family("pond_firebase_requests_in_flight", "gauge", "Requests waiting for their response.");
+  metrics.sample("pond_firebase_requests_in_flight", nullptr, (unsigned long)firebaseRequests.inFlight());
+  metrics.family("pond_firebase_reconnects_total", "counter", "Times the connection to Firebase was reconnected.");
+  metrics.sample("pond_firebase_reconnects_total", nullptr, firebaseReconnects);
+  metrics.family("pond_tls_handshakes_total", "counter", "TLS handshakes with Firebase, full or resumed.");
+  metrics.sample("pond_tls_handshakes_total", "type=\"full\"", (unsigned long)tlsStats.fullHandshakes());
+  metrics.sample("pond_tls_handshakes_total", "type=\"resumed\"", (unsigned long)tlsStats.resumedHandshakes());
+  metrics.family("pond_tls_failures_total", "counter", "Failed TLS connections, by reason.");
+  for (int i = 0; i < TLS_FAIL_REASON_COUNT; i++) {
+    snprintf(labels, sizeof(labels), "reason=\"%s\"", tlsFailureReasonNames[i]);
+    metrics.sample("pond_tls_failures_total", labels, (unsigned long)tlsStats.failures((TlsFailureReason)i));
+  }
+
+  // Queue depths and what they had to drop
+  metrics.family("pond_upload_queue_entries", "gauge", "Log entries waiting in each upload queue.");
+  for (int tag = REQUEST_LOG; tag <= REQUEST_ROLLUP_DAILY; tag++) {
+    snprintf(labels, sizeof(labels), "queue=\"%s\"", requestTagNames[tag]);
+    metrics.sample("pond_upload_queue_entries", labels, (unsigned long)logQueueFor((FirebaseRequestTag)tag).count());
+  }
+  metrics.family("pond_upload_queue_dropped_total", "counter", "Log entries dropped from each full upload queue.");
+  for (int tag = REQUEST_LOG; tag <= REQUEST_ROLLUP_DAILY; tag++) {
+    snprintf(labels, sizeof(labels), "queue=\"%s\"", requestTagNames[tag]);
+    metrics.sample("pond_upload_queue_dropped_total", labels, logQueueFor((FirebaseRequestTag)tag).droppedEntries);
+  }
+  metrics.family("pond_stored_log_pending_entries", "gauge", "Log entries in flash that Firebase hasn't acknowledged.");
+  metrics.sample("pond_stored_log_pending_entries", nullptr, (unsigned long)storedLog.pending());
+  metrics.family("pond_stored_log_dropped_total", "counter", "Log entries overwritten in flash before they were uploaded.");
+  metrics.sample("pond_stored_log_dropped_total", nullptr, storedLog.recordsDropped);
+  metrics.family("pond_realtime_updates_total", "counter", "Realtime frames received for each monitor.");
+  for (uint8_t i = 0; i < FRAME_MAX_DEVICES; i++) {
+    snprintf(labels, sizeof(labels), "device=\"%u\"", i);
+    metrics.sample("pond_realtime_updates_total", labels, realtimeUploads[i].updatesReceived);
+  }
+  metrics.family("pond_realtime_writes_total", "counter", "Realtime writes sent for each monitor, several updates can share one.");
+  for (uint8_t i = 0; i < FRAME_MAX_DEVICES; i++) {
+    snprintf(labels, sizeof(labels), "device=\"%u\"", i);
+    metrics.sample("pond_realtime_writes_total", labels, realtimeUploads[i].writesFlushed);
+  }
+
+  // The Nano and its monitors, from its last status frames
+  metrics.family("pond_nano_up", "gauge", "Whether the Nano answered this scrape's status request.");
+  metrics.sample("pond_nano_up", nullptr, (unsigned long)nanoAnswered);
+  if (nanoStatusReceived) {
+    uint8_t deviceCount = min(nanoDeviceStatus[0].deviceCount, (uint8_t)FRAME_MAX_DEVICES);
+    metrics.family("pond_ble_connected", "gauge", "Whether the Nano is connected to each monitor.");
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      snprintf(labels, sizeof(labels), "device=\"%u\"", i);
+      metrics.sample("pond_ble_connected", labels, (unsigned long)nanoDeviceStatus[i].connected);
+    }
+    metrics.family("pond_ble_rssi_dbm", "gauge", "Signal strength of each connected monitor.");
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      if (nanoDeviceStatus[i].connected) {
+        snprintf(labels, sizeof(labels), "device=\"%u\"", i);
+        metrics.sample("pond_ble_rssi_dbm", labels, (float)nanoDeviceStatus[i].rssi, 0);
+      }
+    }
+    for (int counter = 0; counter < NUM_NANO_COUNTERS; counter++) {
+      metrics.family(nanoCounterNames[counter], "counter", nanoCounterHelp[counter]);
+      for (uint8_t i = 0; i < deviceCount; i++) {
+        snprintf(labels, sizeof(labels), "device=\"%u\"", i);
+        metrics.sample(nanoCounterNames[counter], labels, (unsigned long)nanoCounterValue(nanoDeviceStatus[i], counter));
+      }
+    }
+    // The Nano only sends these percentiles (bucket upper bounds, see latency_histogram.h), not the histogram
+    metrics.family("pond_ble_reconnect_seconds", "gauge", "Percentiles of the time the Nano took to get each monitor streaming again.");
+    for (uint8_t i = 0; i < deviceCount; i++) {
+      const uint16_t percentiles[] = {nanoDeviceStatus[i].bleReconnectP50, nanoDeviceStatus[i].bleReconnectP90, nanoDeviceStatus[i].bleReconnectP99};
+      const char* const quantiles[] = {"0.5", "0.9", "0.99"};
+      for (int q = 0; q < 3; q++) {
+        snprintf(labels, sizeof(labels), "device=\"%u\",quantile=\"%s\"", i, quantiles[q]);
+        metrics.sample("pond_ble_reconnect_seconds", labels, percentiles[q] / 1000.0f);
       }
-      byteCount += len;
     }
-    // Optional: Add a delay to ensure the request has completed
-    delay(100);
-
-    // int len = firebaseClient.available();
-    // if (len > 0) {
-    //   byte buffer[80];
-    //   if (len > 80) len = 80;
-    //   firebaseClient.read(buffer, len);
-    //   if (printWebData) {
-    //     Serial.write(buffer, len); // show in the serial monitor (slows some boards)
-    //   }
-    //   byteCount = byteCount + len;
-    // }
-    // // Optional: Add a delay to ensure the request has completed
-    // delay(100);
   }
+
+  // Memory (see memory_monitor.h)
+  MemoryStats memory = memoryMonitor.stats();
+  metrics.family("pond_free_ram_bytes", "gauge", "Bytes between the heap and the stack.");
+  metrics.sample("pond_free_ram_bytes", nullptr, (unsigned long)memory.freeRam);
+  metrics.family("pond_min_free_ram_bytes", "gauge", "Lowest free RAM seen since boot.");
+  metrics.sample("pond_min_free_ram_bytes", nullptr, (unsigned long)memory.minFreeRam);
+  metrics.family("pond_heap_in_use_bytes", "gauge", "Bytes in allocated heap blocks.");
+  metrics.sample("pond_heap_in_use_bytes", nullptr, (unsigned long)memory.heapInUse);
+  metrics.family("pond_steady_state_allocations_total", "counter", "Heap allocations after setup.");
+  metrics.sample("pond_steady_state_allocations_total", nullptr, (unsigned long)memoryMonitor.steadyStateAllocations());
+
+  metrics.flush();
 }
 
-void processServerResponse() {
-  // // Wait for the server to respond
-  // unsigned long timeout = millis();
-  // while (firebaseClient.available() == 0) {
-  //   if (millis() - timeout > 5000) {
-  //     Serial.println(">>> Client Timeout !");
-  //     firebaseClient.stop();
-  //     return;
-  //   }
-  // }
-  // Read all the lines of the reply from server and print them to Serial
-  size_t byteCount = 0;
-  while (firebaseClient.available()) {
-    size_t len = firebaseClient.available();
-    byte buffer[80];
-    if (len > 80) len = 80;
-    firebaseClient.read(buffer, len);
-    if (printWebData) {
-      Serial.write(buffer, len);
+// Send a log queue's entries as one multi-location PATCH at the root, so a batch can hold entries of every
+// monitor: each is keyed by its full path, "<node>/<epoch>" or "Devices/<id>/<node>/<epoch>"
+void handleLogType(const char* node, LogUploadQueue& queue, FirebaseRequestTag tag) {
+    JsonDocument& jsonToSend = logBatchJson;
+    jsonToSend.clear();
+
+    for (uint8_t i = 0; i < queue.count(); i++) {
+      const LogEntry& entry = queue.entry(i);
+      char entryKey[DEVICE_NODE_PATH_SIZE]; // copied into the document
+      deviceNodePath(entryKey, sizeof(entryKey), entry.device, node);
+      size_t keyLength = strlen(entryKey);
+      snprintf(entryKey + keyLength, sizeof(entryKey) - keyLength, "/%lu", (unsigned long)entry.epoch);
+      JsonObject entryObj = jsonToSend.createNestedObject(entryKey);
+      for (int j = 0; j < SENSOR_COUNT; j++) {
+        if (entry.readings.has((SensorId)j)) {
+          entryObj[sensorRegistry[j].jsonKey] = entry.readings.values[j];
+        }
+      }
+      JsonObject timestampObj = entryObj.createNestedObject("timestamp");
+      timestampObj[".sv"] = "timestamp";
+
+      if (entry.spreads.present) {
+        JsonObject minObj = entryObj.createNestedObject("min");
+        JsonObject maxObj = entryObj.createNestedObject("max");
+        JsonObject stddevObj = entryObj.createNestedObject("stddev");
+        JsonObject countObj = entryObj.createNestedObject("count");
+        for (int j = 0; j < SENSOR_COUNT; j++) {
+          if (entry.spreads.has((SensorId)j)) {
+            minObj[sensorRegistry[j].jsonKey] = entry.spreads.values[j].minimum;
+            maxObj[sensorRegistry[j].jsonKey] = entry.spreads.values[j].maximum;
+            stddevObj[sensorRegistry[j].jsonKey] = entry.spreads.values[j].stddev;
+            countObj[sensorRegistry[j].jsonKey] = entry.spreads.values[j].count;
+          }
+        }
+      }
+    }
+
+    Serial.print(F("Sending log batch of "));
+    Serial.print(queue.count());
+    Serial.println(F(" entries."));
+    // The entries stay queued until the server acknowledges them (see onFirebaseResponse())
+    if (sendJsonPatchRequest("/.json", jsonToSend, tag)) {
+      queue.markInFlight();
     }
-    byteCount += len;
+}
+
+// Called by firebaseRequests for every response (or missing response) to a request, in the order they were sent.
+// Successful writes release their data, writes that failed on the server's side (5xx) or got no answer are retried.
+void onFirebaseResponse(uint8_t tag, int status, unsigned long latencyMs, const HttpResponseParser& response) {
+  bool success = status >= 200 && status < 300;
+  bool retry = status == HTTP_STATUS_NONE || status >= 500;
+
+  if (status != HTTP_STATUS_NONE) {
+    requestLatency[tag].record(latencyMs);
+  }
+  if (TRACE) {
+    trace.response(tag, status, latencyMs);
+  }
+  if (!success) {
+    firebaseRequestsFailed++;
+    Serial.print(F("Firebase "));
+    Serial.print(requestTagNames[tag]);
+    Serial.print(F(" request failed, status: "));
+    Serial.print(status);
+    Serial.print(F(", response: "));
+    Serial.println(response.body());
+    if (retry) {
+      firebaseRetries++;
+    }
+  } else if (printWebData) {
+    Serial.print(F("Firebase "));
+    Serial.print(requestTagNames[tag]);
+    Serial.print(F(" request took "));
+    Serial.print(latencyMs);
+    Serial.println(F("ms"));
+  }
+
+  switch (tag) {
+    case REQUEST_REALTIME:
+      realtimeWriteInFlight = false;
+      if (success) {
+        stageLatency[STAGE_SERVER].record(latencyMs);
+        stageLatency[STAGE_TOTAL].record(realtimeInFlightTiming.ageAtParse + millis() - realtimeInFlightTiming.parsedAt);
+      } else if (retry) {
+        realtimeUploads[realtimeInFlightDevice].requeue(realtimeInFlight);
+        realtimePendingTiming[realtimeInFlightDevice] = realtimeInFlightTiming; // the requeued sample is the oldest
+      }
+      break;
+    case REQUEST_LOG:
+    case REQUEST_DEBUG_LOG:
+    case REQUEST_ROLLUP_15_MINUTES:
+    case REQUEST_ROLLUP_HOURLY:
+    case REQUEST_ROLLUP_DAILY: {
+      LogUploadQueue& queue = logQueueFor((FirebaseRequestTag)tag);
+      // Other errors (4xx) won't go away by sending the same data again, so the batch is dropped
+      if (!success && retry) {
+        queue.requeue();
+      } else {
+        queue.acknowledge();
+        if (tag == REQUEST_LOG && logBatchLastSeq > storedLog.committedSequence()) {
+          storedLog.commit(logBatchLastSeq);
+        }
+      }
+      break;
+    }
+    case REQUEST_TIMESTAMP:
+      if (success) {
+        processFirebaseTimestampResponse(response);
+      }
+      break;
+    default:
+      break;
   }
-  // Optional: Add a delay to ensure the request has completed
-  delay(100);
 }
 
-void sendJsonPatchRequest(const char* path, const StaticJsonDocument<256>& jsonPayload) {
-  Serial.println(F("Serializing JSON payload..."));
-  Serial.print(F("Free RAM before serialization: "));
-  Serial.println(freeRam());
+// Print heap/stack usage along with the profile report, and flag allocations in the steady state
+long printMemoryReport(void* context) {
+  memoryMonitor.printTo(Serial);
+  Serial.print(F("[memory] deepest scheduler task stack: "));
+  Serial.println(scheduler.deepestTaskStack());
+  if (memoryMonitor.steadyStateAllocations() > 0) {
+    Serial.println(F("[memory] WARNING: heap allocations after setup, the ingest/upload path should not allocate"));
+  }
+  return PROFILE_REPORT_INTERVAL;
+}
 
-  Serial.println(jsonPayload.capacity());
-  Serial.println(jsonPayload.memoryUsage());
-  Serial.print(F("jsonPayload.overflowed?: "));
-  Serial.println(jsonPayload.overflowed());
+// Print the round trip latency of each request type along with the profile report
+long printRequestLatencies(void* context) {
+  Serial.println(F("Firebase request latency:"));
+  for (int i = 0; i < NUM_REQUEST_TAGS; i++) {
+    if (requestLatency[i].count() > 0) {
+      requestLatency[i].printTo(Serial, requestTagNames[i]);
+    }
+  }
+  return PROFILE_REPORT_INTERVAL;
+}
 
-  Serial.println(F("Sending JSON patch request..."));
+// Write the UART link, upload and memory counters to the trace, so a load test can tell where data was lost
+long traceCounters(void* context) {
+  trace.counter("framesReceived", nanoFrameReader.framesReceived);
+  trace.counter("crcErrors", nanoFrameReader.crcErrors);
+  trace.counter("overflows", nanoFrameReader.overflows);
+  trace.counter("droppedFrames", nanoFrameReader.droppedFrames);
+  trace.counter("requestsSent", firebaseRequests.requestsSent);
+  trace.counter("requestsFailed", firebaseRequestsFailed);
+  trace.counter("timeouts", firebaseRequests.timeouts);
+  unsigned long droppedLogEntries = logUploads.droppedEntries + debugLogUploads.droppedEntries;
+  for (int i = 0; i < NUM_ROLLUP_TIERS; i++) {
+    droppedLogEntries += rollupTiers[i].uploads.droppedEntries;
+  }
+  trace.counter("droppedLogEntries", droppedLogEntries);
+  trace.counter("storedLogPending", storedLog.pending());
+  trace.counter("storedLogDropped", storedLog.recordsDropped);
+  trace.counter("minFreeRam", memoryMonitor.stats().minFreeRam);
+  return TRACE_COUNTER_INTERVAL;
+}
 
-  if (firebaseClient.available() != 0) {
-    Serial.println(F("Firebase client not available."));
-    return;
+// Send a PATCH request with the serialized JSON document as the body; the response is handled by onFirebaseResponse()
+// Returns false if the request could not be sent (the caller keeps the data queued)
+bool sendJsonPatchRequest(const char* path, const JsonDocument& jsonPayload, FirebaseRequestTag tag) {
+  if (!firebaseRequests.canSend()) {
+    Serial.println(F("Too many Firebase requests in flight."));
+    return false;
   }
 
   // Calculate content length by serializing to a temporary buffer or using measureJson
@@ -898,39 +1728,32 @@ void sendJsonPatchRequest(const char* path, const StaticJsonDocument<256>& jsonP
   firebaseClient.println();
   // Serialize JSON directly to the client, effectively sending the payload
   serializeJson(jsonPayload, firebaseClient);
-  Serial.println(F("Sent JSON patch request directly using serializeJson."));
-
-  Serial.print(F("Free RAM after serialization: "));
-  Serial.println(freeRam());
+  firebaseRequests.sent(tag);
+  if (TRACE) {
+    trace.request(tag, "PATCH", path, contentLength);
+  }
+  return true;
 }
 
 /// Checks if the data is a number or a string and creates corresponding JSON payload syntax
-bool isNumber(const String &data) {
+bool isNumber(const char* data) {
   char *endptr;
-  float val = strtod(data.c_str(), &endptr);
-  return endptr != data.c_str() && *endptr == '\0';
+  strtod(data, &endptr);
+  return endptr != data && *endptr == '\0';
 }
 
-void sendPatchRequest(const char* path, const char* key, const String& data) {
-  // Check if the data is a number or a string
-  bool isString = !isNumber(data);
-
-  /// Construct the JSON payload
-  String payload = "{\"";
-  payload += key;
-  payload += "\": ";
-  // Add double quotes if the data type is a string
-  if (isString) {
-    payload += "\"";
+bool sendPatchRequest(const char* path, const char* key, const char* data, FirebaseRequestTag tag) {
+  if (!firebaseRequests.canSend()) {
+    return false;
   }
-  // Add data
-  payload += data;
-  // Add closing double quotes if the data type is a string
-  if (isString) {
-    payload += "\"";
+
+  // Construct the JSON payload, adding double quotes if the data is a string
+  char payload[96];
+  int length = snprintf(payload, sizeof(payload), isNumber(data) ? "{\"%s\": %s}" : "{\"%s\": \"%s\"}", key, data);
+  if (length < 0 || length >= (int)sizeof(payload)) {
+    Serial.println(F("PATCH payload too long."));
+    return false;
   }
-  // Close the JSON object
-  payload += "}";
 
   firebaseClient.print("PATCH ");
   firebaseClient.print(path);
@@ -942,33 +1765,23 @@ void sendPatchRequest(const char* path, const char* key, const String& data) {
   firebaseClient.println(firebaseHost);
   firebaseClient.println("Content-Type: application/json");
   firebaseClient.print("Content-Length: ");
-  firebaseClient.println(strlen(payload.c_str()));
+  firebaseClient.println(length);
   firebaseClient.println("Connection: keep-alive");
   firebaseClient.println();
   firebaseClient.println(payload);
-
-  // Process the response
-  // processServerResponse();
+  firebaseRequests.sent(tag);
+  if (TRACE) {
+    trace.request(tag, "PATCH", path, length);
+  }
+  return true;
 }
 
-void sendGetRequest(const char* path) {
-  firebaseClient.print("GET ");
-  firebaseClient.print(path);
-  // firebaseClient.print("?auth=");
-  // firebaseClient.print(firebaseAuth);
-  firebaseClient.println(" HTTP/1.1");
-  firebaseClient.println("User-Agent: SSLClientOverEthernet");
-  firebaseClient.print("Host: ");
-  firebaseClient.println(firebaseHost);
-  firebaseClient.println("Connection: keep-alive");
-  firebaseClient.println();
-
-  // process the response
-  // processServerResponse();
-}
+// The response is handled by onFirebaseResponse()
+bool sendGetRequest(const char* path, FirebaseRequestTag tag) {
+  if (!firebaseRequests.canSend()) {
+    return false;
+  }
 
-// Overloaded sendGetRequest function to handle and return the response to pass elsewhere
-void sendGetRequest(const char* path, void (*processResponse)()) {
   firebaseClient.print("GET ");
   firebaseClient.print(path);
   // firebaseClient.print("?auth=");
@@ -979,12 +1792,18 @@ void sendGetRequest(const char* path, void (*processResponse)()) {
   firebaseClient.println(firebaseHost);
   firebaseClient.println("Connection: keep-alive");
   firebaseClient.println();
-
-  // process the response
-  processResponse();
+  firebaseRequests.sent(tag);
+  if (TRACE) {
+    trace.request(tag, "GET", path, 0);
+  }
+  return true;
 }
 
-void sendPutRequest(const char* path, const char* data) {
+bool sendPutRequest(const char* path, const char* data, FirebaseRequestTag tag) {
+  if (!firebaseRequests.canSend()) {
+    return false;
+  }
+
   firebaseClient.print("PUT ");
   firebaseClient.print(path);
   // firebaseClient.print("?auth=");
@@ -999,27 +1818,11 @@ void sendPutRequest(const char* path, const char* data) {
   firebaseClient.println("Connection: keep-alive");
   firebaseClient.println();
   firebaseClient.println(data);
-
-  // process the response
-  // processServerResponse();
-}
-
-void respondWithLEDStatus(EthernetClient& localClient) {
-    int red, green, blue, intensity;
-    getOnBoardLEDColor(&red, &green, &blue, &intensity); // Fetch the current LED status
-
-    // Construct JSON string
-    String jsonResponse = "{\"red\":" + String(red) + ",\"green\":" + String(green) + ",\"blue\":" + String(blue) + ",\"intensity\":" + String(intensity) + "}";
-    Serial.println("Sending LED status response: " + jsonResponse);
-
-    // Send HTTP headers
-    localClient.println("HTTP/1.1 200 OK");
-    localClient.println("Content-Type: application/json"); // Indicate the response type is JSON
-    localClient.println("Connection: close");  // The connection will be closed after completion of the response
-    localClient.println();  // End of HTTP headers
-
-    // Send the JSON response
-    localClient.println(jsonResponse);
+  firebaseRequests.sent(tag);
+  if (TRACE) {
+    trace.request(tag, "PUT", path, strlen(data));
+  }
+  return true;
 }
 
 void requestNanoStatus() {
@@ -1031,20 +1834,10 @@ void requestNanoStatus() {
 
 void disconnectFromServer() {
   display_freeram();  // Display free RAM before attempting to connect
-  endMicros = micros();
   Serial.println();
   Serial.println(F("Server disconnected. Stopping client."));
   firebaseClient.stop();
-  Serial.print(F("Received "));
-  Serial.print(byteCount);
-  Serial.print(F(" bytes in "));
-  float seconds = (float)(endMicros - beginMicros) / 1000000.0;
-  Serial.print(seconds, 4);
-  float rate = (float)byteCount / seconds / 1000.0;
-  Serial.print(F(", rate = "));
-  Serial.print(rate);
-  Serial.print(F(" kbytes/second"));
-  Serial.println();
+  firebaseRequests.abort(); // requests still waiting for a response are retried after reconnecting
 
   setOnBoardLEDColor(255, 0, 0, LED_INTENSITY_HIGH); // red
 
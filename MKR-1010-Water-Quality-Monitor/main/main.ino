@@ -12,6 +12,10 @@
   - Flow Meter (to monitor waterfall flow rate to ensure adequate water circulation)
 
   The data is captured and relayed to my Central device (Nano 33 IoT board) via Bluetooth Low Energy (BLE).
+
+  To run from solar/battery power each sensor is only sampled as often as it is changing (see adaptive_sampler.h),
+  the CPU sleeps between samples (see low_power.h), the LCD backlight is only on after the button is pressed,
+  and a power report characteristic notifies the measured duty cycle and the estimated current draw.
 */
 
 ///////////// Version Control //////////////
@@ -20,6 +24,8 @@
 ///////////// Configuration & Helper Files //////////////
 #include "config.h"
 #include "lcd_display.h" // file created to easily print messages to LCD
+#include "lcd_framebuffer.h" // shadow buffer for the sensor screen
+#include "loop_profiler.h" // loop latency, message size and free RAM reporting
 
 ///////////// Watchdog Timer Library //////////////
 #include <Adafruit_SleepyDog.h>
@@ -36,9 +42,17 @@
 #include <DallasTemperature.h>
 #include <NewPing.h>
 #include "ph_grav_no_eeprom.h"
+#include "adc_sampler.h" // background sampling of the analog sensor pins
+#include "sensor_readings.h" // SensorId
+#include "sensor_packet.h" // all readings packed into one BLE notification
+#include "running_stats.h" // outlier filter and running statistics per sensor
+#include "fixed_point.h" // integer conversions from ADC counts to sensor units
+#include "adaptive_sampler.h" // per sensor sample intervals from how much each one is changing
+#include "low_power.h" // idle sleep between samples and the CPU duty cycle
 
 ///////////// LCD Variables //////////////
 LiquidCrystal_I2C lcd(0x27, 20, 4); // set the LCD address to 0x27 for a 20 chars and 4 line display
+LcdFramebuffer lcdFramebuffer(lcd); // shadow buffer, only changed cells are sent to the display
 byte degree[8] = { // Custom degree symbol
   0b01110,
 	0b01010,
@@ -54,7 +68,11 @@ byte degree[8] = { // Custom degree symbol
 #define ONE_WIRE_BUS 5 // Data wire is plugged into pin #5 on MKR 1010
 OneWire oneWire(ONE_WIRE_BUS);
 DallasTemperature ds18b20(&oneWire);
+DeviceAddress ds18b20Address; // cached so reads don't search the OneWire bus every time
 float tempC;
+float tempF;
+unsigned long temperatureRequestTime = 0; // when the current (asynchronous) conversion was started
+unsigned long temperatureConversionTime = 750; // conversion time for the sensor's resolution, set in setup()
 
 ///////////// TD-A02YYMW-V2.0 Ultrasonic Sensor (Water Level) Variables //////////////
 #define TRIGGER_PIN  6  // Arduino pin tied to trigger pin on the ultrasonic sensor.
@@ -74,77 +92,157 @@ float turbidityOffset = 0.46;
 #define PH_SENSOR_PIN A3
 Gravity_pH pH = Gravity_pH(PH_SENSOR_PIN);
 
+//////////// Background ADC Sampler ////////////
+// A1/A2/A3 are sampled round robin in the ADC interrupt, so reads below never wait on the ADC
+AdcSampler adcSampler;
+int8_t turbidityChannel;
+int8_t tdsChannel;
+int8_t pHChannel;
+
+//////////// Fixed Point Sensor Conversions ////////////
+// ADC counts to sensor units without any per-sample float math (the SAMD21 has no FPU).
+// Each conversion is set up in float once and rebuilt only when its calibration changes.
+FixedPolynomial tdsCurve;       // ppm from the TDS counts, input scale compensated for the water temperature
+FixedPolynomial turbidityCurve; // NTU from the turbidity voltage (counts to volts minus turbidityOffset)
+FixedInterpolation pHTable;     // pH from the pH counts through the Gravity_pH calibration points
+uint16_t pHTableCalCount = 0;   // Gravity_pH calibration count the table was built from
+
 // BLE configuartion
 BLEService sensorDataService(sensorDataServiceUuid); // Custom service for data transfer
-BLEFloatCharacteristic temperatureCharacteristic(temperatureCharacteristicUuid, BLERead | BLENotify);
-BLEFloatCharacteristic waterLevelCharacteristic(waterLevelCharacteristicUuid, BLERead | BLENotify);
-BLEIntCharacteristic turbidityValueCharacteristic(turbidityValueCharacteristicUuid, BLERead | BLENotify);
-BLEFloatCharacteristic turbidityVoltageCharacteristic(turbidityVoltageCharacteristicUuid, BLERead | BLENotify);
-BLEIntCharacteristic totalDissolvedSolidsCharacteristic(totalDissolvedSolidsCharacteristicUuid, BLERead | BLENotify);
-BLEFloatCharacteristic pHCharacteristic(pHCharacteristicUuid, BLERead | BLENotify);
-
-// Global sensor array variables that will be used to average out values
-// Arrays will be of size 5 and newest values in will overwrite the oldest values
-const int ARRAY_SIZE = 5; // modify this to change the size of the array for averaging sensor values
-float temperatureValues[ARRAY_SIZE] = {0};
-int totalDissolvedSolidsValues[ARRAY_SIZE] = {0};
-int turbidityValues[ARRAY_SIZE] = {0};
-float turbidityVoltageValues[ARRAY_SIZE] = {0};
-float waterLevelValues[ARRAY_SIZE] = {0};
-float pHValues[ARRAY_SIZE] = {0};
-int arrayIndex = 0;
+// One single value characteristic per sensor (temperatureCharacteristic, turbidityCharacteristic, ...) typed by sensor_registry.h
+#define SENSOR_CHARACTERISTIC(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, uuid, reader) \
+  BLETypedCharacteristic<valueType> jsonKey##Characteristic(uuid, BLERead | BLENotify);
+POND_SENSORS(SENSOR_CHARACTERISTIC)
+// All readings plus a sequence number, timestamp and the newest reading's age in one notification (see sensor_packet.h)
+BLECharacteristic sensorPacketCharacteristic(sensorPacketCharacteristicUuid, BLERead | BLENotify, SENSOR_PACKET_SIZE, true);
+uint16_t sensorPacketSequence = 0;
+// Duty cycle, estimated current and sampling rates, notified every POWER_REPORT_INTERVAL (see sensor_packet.h)
+BLECharacteristic powerReportCharacteristic(powerReportCharacteristicUuid, BLERead | BLENotify, POWER_REPORT_SIZE, true);
+bool centralConnected = false;
+
+// Each sensor value goes through a Hampel outlier filter and into running statistics that are
+// averaged over each BLE update interval (indexed by SensorId).
+// The minimum deviations (from sensor_registry.h) keep small real changes from being treated as outliers.
+#define SENSOR_FILTER(id, jsonKey, valueType, units, packetScale, minDeviation, ...) HampelFilter<float>(HAMPEL_THRESHOLD, minDeviation),
+HampelFilter<float> sensorFilters[SENSOR_COUNT] = {
+  POND_SENSORS(SENSOR_FILTER)
+};
+RunningStats<float> sensorStats[SENSOR_COUNT];
+float intervalMeans[SENSOR_COUNT] = {0}; // last mean written to each characteristic
 
 // Global constants
 const float ANALOG_TO_VOLTAGE = VREF / 4095.0; // 12-bit ADC
-const unsigned long DATA_CAPTURE_INTERVAL = 500; // half second
+const unsigned long DATA_CAPTURE_INTERVAL = 500; // half second, the fastest a sensor is sampled
+const unsigned long STABLE_CAPTURE_INTERVAL = 15000; // 15 seconds, the slowest (once its readings have settled)
 const unsigned long BLE_UPDATE_INTERVAL = 3000; // 3 seconds
-unsigned long lastDataCapture = 0;
+const unsigned long BLE_UPDATE_INTERVAL_STABLE = 15000; // once every sensor is at its slowest sample interval
 unsigned long lastBLEUpdate = 0;
 int watchdogTimeoutInterval = 8000; // 8 second timeout interval
-bool initialValue = true; // flag to not print out sensor values on LCD on first run
+bool initialValue = true; // flag to not print out sensor values on LCD until the boot messages are cleared
+
+// How often each sensor is sampled (indexed by SensorId). A sensor that stays within its realtime deadband
+// backs off from DATA_CAPTURE_INTERVAL to STABLE_CAPTURE_INTERVAL, one that moves is sampled at the full rate again.
+#define SENSOR_SAMPLER(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, ...) \
+  AdaptiveSampler(DATA_CAPTURE_INTERVAL, STABLE_CAPTURE_INTERVAL, deadband, relativeDeadband),
+AdaptiveSampler sensorSamplers[SENSOR_COUNT] = {
+  POND_SENSORS(SENSOR_SAMPLER)
+};
+SensorReadings latestReadings; // last value read from each sensor, drawn on the LCD
+unsigned long lastSampleTime = 0; // the newest reading's age goes in each sensor packet (see pipeline_timing.h)
+bool allSensorsStable = false;
+
+// Sensor screen layout (indexed by SensorId): column, row, width, label, decimals, unit
+// Character 8 draws the custom degree symbol (custom character 0)
+const LcdField sensorScreenLayout[SENSOR_COUNT] = {
+  {0, 0, 12, "Temp: ", 1, "\x08"},      // Temp: 72.3°
+  {0, 1, 20, "Pond Level: ", 2, " in"}, // Pond Level: 12.34 in
+  {12, 2, 8, "", 0, " NTU"},            //             1234 NTU
+  {0, 2, 12, "Turb: ", 2, "V"},         // Turb: 3.21V
+  {0, 3, 20, "TDS Value: ", 0, " ppm"}, // TDS Value: 123 ppm
+  {12, 0, 8, "pH: ", 2, ""}             //             pH: 7.01
+};
 
-float convertAnalogToVoltage(int analogValue) {
-  return analogValue * ANALOG_TO_VOLTAGE;
+///////////// Low Power //////////////
+// Between passes of loop() the CPU sleeps until the next sample is due, at most one scheduler tick so
+// the LCD tasks and BLE.poll() keep their timing
+IdleSleep idleSleep;
+// The ADC sampler only runs from ADC_SAMPLER_WARMUP before an analog sensor is due, so while the readings are
+// stable it isn't converting (and interrupting the CPU) through the gaps between samples
+#define ADC_SAMPLER_WARMUP 400 // ms, filling every channel's window takes about 300ms at the core's ADC sample time
+bool adcSampling = false;
+unsigned long adcSamplingStart = 0;
+// The LCD backlight is on while booting and for LCD_BACKLIGHT_TIMEOUT after the button is pressed
+#define LCD_BUTTON_PIN 4 // momentary button to ground
+#define LCD_BACKLIGHT_TIMEOUT 30000 // 30 seconds
+bool backlightOn = true;
+unsigned long lastBacklightDemand = 0;
+unsigned long backlightOnSince = 0;
+unsigned long backlightOnMillis = 0; // backlight on time in the current power report window
+// Connection interval asked of the central while every sensor is stable (units of 1.25ms). ArduinoBLE asks for it
+// when a central connects, so a change applies from the next connection.
+#define BLE_STABLE_CONNECTION_INTERVAL_MIN 400 // 500ms
+#define BLE_STABLE_CONNECTION_INTERVAL_MAX 640 // 800ms, under half the 2 second supervision timeout ArduinoBLE asks for
+#define POWER_REPORT_INTERVAL 60000 // 1 minute
+unsigned long powerReportWindowStart = 0;
+// Typical current of each part of the monitor for the power report's estimate (mA). These are datasheet figures,
+// measure the real draw before sizing a battery or panel.
+#define CURRENT_CPU_ACTIVE_MA 6.5   // SAMD21 at 48MHz
+#define CURRENT_CPU_IDLE_MA 2.5     // SAMD21 in IDLE sleep
+#define CURRENT_RADIO_MA 25.0       // NINA-W102 advertising or connected
+#define CURRENT_LCD_MA 2.0          // 20x4 LCD and I2C backpack, backlight off
+#define CURRENT_BACKLIGHT_MA 25.0
+#define CURRENT_SENSORS_MA 55.0     // turbidity (40 max), TDS, pH, DS18B20 and ultrasonic boards
+
+///////////// Profiling //////////////
+#ifndef PROFILE
+#define PROFILE (false) // Set to true to print loop latency, BLE bytes per update and free RAM reports every minute
+#endif
+LoopProfiler profiler("Water Quality Monitor");
+
+// Scale the TDS curve's input for the current water temperature (called whenever tempC changes)
+void updateTdsCompensation() {
+  float compensationCoefficient = 1.0 + 0.0191 * (tempC - 25.0);
+  tdsCurve.setInput(ANALOG_TO_VOLTAGE / compensationCoefficient);
 }
 
-// Function to calculate average of an array
-template <typename T>
-float average(T arr[], int size) {
-  float sum = 0.0;
-  int count = 0;
-  for (int i = 0; i < size; i++) {
-    if (arr[i] != 0) {
-      sum += arr[i];
-      count++;
-    }
-  }
-  return count == 0 ? 0 : sum / count;
+// Set up the fixed point sensor conversions
+void setupSensorConversions() {
+  // tds = (133.42 v^3 - 255.86 v^2 + 857.39 v) * 0.5 of the compensated voltage
+  const float tdsCoefficients[] = {133.42 * 0.5, -255.86 * 0.5, 857.39 * 0.5, 0};
+  tdsCurve.setCoefficients(tdsCoefficients, 3);
+  updateTdsCompensation();
+
+  // for 3.3V output this is the quadratic equation: y = -2572.2x² + 8700.5x - 4352.9
+  //// source: https://forum.arduino.cc/t/getting-ntu-from-turbidity-sensor-on-3-3v/658067/14
+  const float turbidityCoefficients[] = {-1120.4, 5742.3, -4352.9};
+  turbidityCurve.setCoefficients(turbidityCoefficients, 2);
+  turbidityCurve.setInput(ANALOG_TO_VOLTAGE, -turbidityOffset);
+
+  buildPHTable();
 }
 
-// Function to calculate the integer average of an array. 
-// Done for readability & integer characteristics in the updateBLECharacteristics function
-template <typename T>
-int intAverage(T arr[], int size) {
-  int sum = 0;
-  int count = 0;
-  for (int i = 0; i < size; i++) {
-    if (arr[i] != 0) {
-      sum += static_cast<int>(arr[i]);
-      count++;
-    }
-  }
-  return count == 0 ? 0 : round(static_cast<float>(sum) / count);
+// Rebuild the pH lookup table from the current Gravity_pH calibration
+void buildPHTable() {
+  float voltages_mV[FIXED_INTERPOLATION_MAX_POINTS];
+  float phs[FIXED_INTERPOLATION_MAX_POINTS];
+  uint8_t count = pH.get_cal_points(voltages_mV, phs);
+  pHTable.setPoints(voltages_mV, phs, count, ANALOG_TO_VOLTAGE * 1000);
+  pHTableCalCount = pH.get_cal_count();
 }
 
-// Function to append value to array if it's within 5% of average
-template <typename T>
-void appendValueToAverageArray(T arr[], int size, T value) {
-  float avg = average(arr, size);
-  if (avg == 0 || (value >= 0.95 * avg && value <= 1.05 * avg)) {
-    arr[arrayIndex] = value;
-  }
+// Filter a new sensor value and add it to the sensor's statistics for the current interval
+void addSensorValue(SensorId id, float value) {
+  sensorStats[id].add(sensorFilters[id].filter(value));
 }
 
+// Mean of the sensor's values since the last call (the previous mean if there were none), then start a new interval
+float takeIntervalMean(SensorId id) {
+  if (sensorStats[id].count() > 0) {
+    intervalMeans[id] = sensorStats[id].mean();
+    sensorStats[id].reset();
+  }
+  return intervalMeans[id];
+}
 
 void setup() {
   Serial.begin(115200);
@@ -156,11 +254,10 @@ void setup() {
   lcd.init(); // initialize the lcd
   lcd.backlight(); // turn on backlight
   lcd.createChar(0, degree); // create custom degree symbol
-  lcd.setCursor(3, 0); // set cursor to first column, second row
   lcd.blink(); // turn on blinking cursor
-  lcdPrettyPrint("Booting up...", lcd); // helper function from lcd_display.h for readability
-  lcd.setCursor(2, 1);
-  lcdPrettyPrint("Software v" + String(RELEASE_VERSION), lcd);
+  // Boot messages are printed in the background by the scheduler while the sensors and BLE are set up
+  lcdPrettyPrintAsync(3, 0, "Booting up..."); // helper function from lcd_display.h for readability
+  lcdPrettyPrintAsync(2, 1, ("Software v" + String(RELEASE_VERSION)).c_str());
 
   // Initialize the watchdog with an 8 second timeout
   Watchdog.enable(watchdogTimeoutInterval);
@@ -169,245 +266,414 @@ void setup() {
   // Ultrasonic and pH do not need pinMode setup. Pins are set up in the NewPing and Atlas pH libraries
   analogReadResolution(12); // change to 12 bits for compatibility with MKR 1010 
   ds18b20.begin(); // begin the temperature sensor
+  ds18b20.getAddress(ds18b20Address, 0);
+  temperatureConversionTime = ds18b20.millisToWaitForConversion(ds18b20.getResolution(ds18b20Address));
+  // First conversion is blocking so there is a valid temperature for the initial readings,
+  // after that conversions run in the background and readTemperature() just collects the result
+  ds18b20.requestTemperaturesByAddress(ds18b20Address);
+  tempC = ds18b20.getTempC(ds18b20Address);
+  tempF = DallasTemperature::toFahrenheit(tempC);
+  setupSensorConversions();
+  ds18b20.setWaitForConversion(false);
+  ds18b20.requestTemperaturesByAddress(ds18b20Address);
+  temperatureRequestTime = millis();
+
   pinMode(TDS_SENSOR_PIN, INPUT);
   pinMode(TURBIDITY_SENSOR_PIN, INPUT);
+  pinMode(LCD_BUTTON_PIN, INPUT_PULLUP);
+
+  // Start sampling the analog sensors in the background and wait for a full window of results
+  turbidityChannel = adcSampler.addChannel(TURBIDITY_SENSOR_PIN);
+  tdsChannel = adcSampler.addChannel(TDS_SENSOR_PIN);
+  pHChannel = adcSampler.addChannel(PH_SENSOR_PIN);
+  adcSampler.begin();
+  while (!adcSampler.isFull(pHChannel)) { // the last channel in the round robin
+    adcSampler.poll();
+  }
+  adcSampling = true;
+  adcSamplingStart = millis();
   
   //////////// Setting up the Bluetooth service ////////////
   if (!BLE.begin()) {
     Serial.println("Starting BLE failed!");
-    lcd.setCursor(5, 2);
-    lcdPrettyPrint("BLE failed!", lcd); 
-    while (1);
+    lcdPrettyPrintAsync(5, 2, "BLE failed!");
+    while (1) {
+      scheduler.run(); // finish printing the boot messages, then wait for the watchdog to reset the board
+    }
   }
 
   BLE.setLocalName(peripheralName);
   BLE.setAdvertisedService(sensorDataService);
 
-  sensorDataService.addCharacteristic(temperatureCharacteristic);
-  sensorDataService.addCharacteristic(totalDissolvedSolidsCharacteristic);
-  sensorDataService.addCharacteristic(turbidityValueCharacteristic);
-  sensorDataService.addCharacteristic(turbidityVoltageCharacteristic);
-  sensorDataService.addCharacteristic(waterLevelCharacteristic);
-  sensorDataService.addCharacteristic(pHCharacteristic);
+#define ADD_SENSOR_CHARACTERISTIC(id, jsonKey, ...) sensorDataService.addCharacteristic(jsonKey##Characteristic);
+  POND_SENSORS(ADD_SENSOR_CHARACTERISTIC)
+  sensorDataService.addCharacteristic(sensorPacketCharacteristic);
+  sensorDataService.addCharacteristic(powerReportCharacteristic);
 
   BLE.addService(sensorDataService);
 
-  // Read sensor values to obtain initial values so not sending 0
-  readSensorValues();
-  // set initalValue flag to false to print out future values to LCD
-  initialValue = false;
+  // Read sensor values to obtain initial values so not sending 0 (every sensor's first sample is due straight away)
+  // (initialValue stays true until the boot messages are cleared from the LCD, see loop())
+  sampleDueSensors();
 
   BLE.advertise();
 
-  lcd.setCursor(1, 3);
-  lcdPrettyPrint("Boot up complete!", lcd, true, 2000); // clearing LCD after 2 seconds
-  lcd.noBlink(); // Turn off blinking cursor before starting loop
+  lcdPrettyPrintAsync(1, 3, "Boot up complete!", true, 2000); // clearing LCD after 2 seconds
+
+  idleSleep.startWindow();
+  powerReportWindowStart = millis();
+  backlightOnSince = millis();
 
   // Kick the watchdog
   Watchdog.reset();
 }
 
 void loop() {
-  // read sensor values every data capture interval (1/2 second) and append to array for averaging
-  // and update BLE characteristics every BLE update interval (3 seconds)
+  // sample each sensor when its adaptive interval is due (every 1/2 second to 15 seconds) into its running statistics,
+  // update the BLE characteristics every BLE update interval while a central is connected, and sleep in between
+  if (PROFILE) {
+    profiler.beginLoop();
+  }
 
-  if (millis() - lastDataCapture >= DATA_CAPTURE_INTERVAL) {
-    lastDataCapture = millis();
+  // run any due LCD animations
+  scheduler.run();
 
-    // read sensor values and update average arrays
-    readSensorValues();
+  // once the boot messages have been printed and cleared, start printing sensor values to the LCD
+  if (initialValue && !lcdPrettyPrintBusy()) {
+    lcd.noBlink(); // Turn off blinking cursor
+    initialValue = false;
+    lcdFramebuffer.begin(); // start refreshing the sensor screen
+    lastBacklightDemand = millis(); // the backlight stays on for a while after booting
   }
-  
-  BLEDevice central = BLE.central();
 
-  if (central) {
-    Serial.print("Connected to central: ");
-    Serial.println(central.address());
-
-    while (central.connected()) {
-      // read sensor values every data capture interval (1/2 second)
-      if (millis() - lastDataCapture >= DATA_CAPTURE_INTERVAL) {
-        lastDataCapture = millis();
-
-        // read sensor values and update average arrays
-        readSensorValues();
-        // Serial.println("Sensor values read.");
- 
-        if (millis() - lastBLEUpdate >= BLE_UPDATE_INTERVAL) {
-          lastBLEUpdate = millis();
-
-          // update the BLE characteristics with the average values
-          updateBLECharacteristics();
-          // Serial.println("BLE characteristics updated.");
-        }
+  updateBacklight();
+  updateAdcSampler();
+  sampleDueSensors();
+  updateStability();
+
+  BLEDevice central = BLE.central();
+  bool connected = central.connected();
+  if (connected != centralConnected) {
+    centralConnected = connected;
+    if (connected) {
+      Serial.print("Connected to central: ");
+      Serial.println(central.address());
+      // sample at the full rate again so the central gets fresh values
+      for (int i = 0; i < SENSOR_COUNT; i++) {
+        sensorSamplers[i].reset();
       }
-      // Kick the watchdog to reset the timer
-      Watchdog.reset();
+    } else {
+      Serial.println("Disconnected from central.");
     }
-    Serial.print("Disconnected from central: ");
-    Serial.println(central.address());
   }
 
-  // If not connected, ensure the device is still advertising for new connections
-  if (!central.connected()) {
-    if (!BLE.advertising()) {
-      BLE.advertise();
-      Serial.println("Restarting advertising after disconnection.");
+  if (connected) {
+    if (millis() - lastBLEUpdate >= notifyInterval()) {
+      lastBLEUpdate = millis();
+
+      // update the BLE characteristics with the mean values
+      updateBLECharacteristics();
     }
+  } else if (!BLE.advertising()) {
+    // If not connected, ensure the device is still advertising for new connections
+    BLE.advertise();
+    Serial.println("Restarting advertising after disconnection.");
+  }
+
+  if (millis() - powerReportWindowStart >= POWER_REPORT_INTERVAL) {
+    updatePowerReport();
   }
 
   // Kick the watchdog to reset the timer
   Watchdog.reset();
+
+  if (PROFILE) {
+    profiler.endLoop();
+  }
+
+  idleSleep.sleep(min(timeUntilNextSample(), (unsigned long)SCHEDULER_TICK_MS));
 }
 
-float readTemperature() {
-  // Read the temperature from the sensor
-  ds18b20.requestTemperatures();
-  tempC = ds18b20.getTempCByIndex(0); // Update global tempC variable for TDS calculation
-  float tempF = ds18b20.getTempFByIndex(0);
+// Sensors read from the ADC sampler (the analog column of POND_SENSORS)
+bool isAnalogSensor(SensorId id) {
+  return sensorRegistry[id].analog;
+}
+
+// Each sensor's read function, from the reader column of POND_SENSORS (indexed by SensorId)
+#define SENSOR_READER(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, uuid, reader) \
+  []() -> float { return reader(); },
+float (*const sensorReaders[])() = {
+  POND_SENSORS(SENSOR_READER)
+};
+static_assert(sizeof(sensorReaders) / sizeof(sensorReaders[0]) == SENSOR_COUNT, "every sensor needs a reader");
 
-  // update LCD if not sending initial values
-  if (!initialValue) {
-    lcd.setCursor(0, 0);
-    lcd.print("Temp: ");
-    lcd.print(tempF, 1);
-    lcd.write(byte(0));
+float readSensor(SensorId id) {
+  return sensorReaders[id]();
+}
+
+// Analog sensors are only read once every channel's window has been filled since the sampler started
+bool adcSamplerWarm() {
+  return adcSampling && adcSampler.isFull(pHChannel); // the last channel in the round robin
+}
+
+// About how long until the ADC sampler is warm, ADC_SAMPLER_WARMUP if it isn't running
+unsigned long adcWarmupRemaining() {
+  if (!adcSampling) {
+    return ADC_SAMPLER_WARMUP;
+  }
+  if (adcSamplerWarm()) {
+    return 0;
   }
+  unsigned long running = millis() - adcSamplingStart;
+  return running >= ADC_SAMPLER_WARMUP ? 0 : ADC_SAMPLER_WARMUP - running;
+}
 
-  return tempF;
+// ms until the next sensor can be sampled (analog sensors also wait for the ADC sampler to warm up)
+unsigned long timeUntilNextSample() {
+  unsigned long now = millis();
+  unsigned long next = STABLE_CAPTURE_INTERVAL;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    unsigned long wait = sensorSamplers[i].timeUntilDue(now);
+    if (isAnalogSensor((SensorId)i)) {
+      wait = max(wait, adcWarmupRemaining());
+    }
+    next = min(next, wait);
+  }
+  return next;
 }
 
-int readTotalDissolvedSolids() {
-  float tdsVoltage = convertAnalogToVoltage(analogRead(TDS_SENSOR_PIN));
-  float compensationCoefficient = 1.0 + 0.0191 * (tempC - 25.0);
-  float compensationVoltage = tdsVoltage / compensationCoefficient;
-  float tdsValue = (133.42 * pow(compensationVoltage, 3) - 255.86 * pow(compensationVoltage, 2) + 857.39 * compensationVoltage) * 0.5; 
-  
-  // update LCD
-  if (!initialValue) {
-    lcd.setCursor(0, 3);
-    lcd.print("TDS Value: ");
-    lcd.print(tdsValue, 0);
-    if (tdsValue < 1000) {
-      lcd.print(" ppm  ");
+// Run the ADC sampler only around the analog sensors' samples (see ADC_SAMPLER_WARMUP)
+void updateAdcSampler() {
+  unsigned long now = millis();
+  unsigned long untilDue = STABLE_CAPTURE_INTERVAL;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (isAnalogSensor((SensorId)i)) {
+      untilDue = min(untilDue, sensorSamplers[i].timeUntilDue(now));
     }
-    else {
-      lcd.print(" ppm ");
+  }
+  if (!adcSampling && untilDue <= ADC_SAMPLER_WARMUP) {
+    adcSampler.begin();
+    adcSampling = true;
+    adcSamplingStart = now;
+  } else if (adcSampling && untilDue > 2 * ADC_SAMPLER_WARMUP) {
+    adcSampler.stop();
+    adcSampling = false;
+  }
+}
+
+// Read every sensor whose sample is due, add it to the sensor's statistics and let its sampler set the next interval
+void sampleDueSensors() {
+  unsigned long now = millis();
+  bool adcReady = adcSamplerWarm();
+  bool sampled = false;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    SensorId id = (SensorId)i;
+    if (!sensorSamplers[i].isDue(now) || (isAnalogSensor(id) && !adcReady)) {
+      continue;
     }
+    float value = readSensor(id);
+    latestReadings.set(id, value);
+    // Add the value (with outliers replaced) to the running statistics. The sampler sees the raw value, so a spike
+    // speeds sampling up until the outlier filter has enough samples around it.
+    addSensorValue(id, value);
+    sensorSamplers[i].add(value, now);
+    sampled = true;
+  }
+  if (sampled) {
+    lastSampleTime = now;
   }
 
-  return round(tdsValue);
+  // Draw the latest values into the LCD framebuffer, the display itself is updated by its refresh task
+  if (sampled && !initialValue && backlightOn) {
+    renderSensorScreen(latestReadings);
+  }
 }
 
-int readTurbidityValue() {
-  // turbidity is the measure of cloudiness in the water. Range is 0 to 3000 NTU
-  float turbidityVoltage = convertAnalogToVoltage(analogRead(TURBIDITY_SENSOR_PIN)) - turbidityOffset;
-  
-  // update LCD
-  if (!initialValue) {
-    lcd.setCursor(0, 2);
-    lcd.print("Turb: ");
-    lcd.print(turbidityVoltage, 2);
-    lcd.print("V ");
-  }
-  // Convert the voltage to NTU (valid range is 2.5 to 4.21V)
-  if (turbidityVoltage <= 2.5) {
-    if (!initialValue) {
-      lcd.print(3000);
-      lcd.print(" NTU"); 
+// Once every sensor has settled, notify less often and ask the next central for a longer connection interval
+void updateStability() {
+  bool stable = true;
+  for (int i = 0; i < SENSOR_COUNT && stable; i++) {
+    stable = sensorSamplers[i].isStable();
+  }
+  if (stable == allSensorsStable) {
+    return;
+  }
+  allSensorsStable = stable;
+  if (stable) {
+    BLE.setConnectionInterval(BLE_STABLE_CONNECTION_INTERVAL_MIN, BLE_STABLE_CONNECTION_INTERVAL_MAX);
+    Serial.println("Sensors stable, notifying every 15 seconds.");
+  } else {
+    BLE.setConnectionInterval(0, 0); // no preference
+    Serial.println("Sensors changing, notifying every 3 seconds.");
+  }
+}
+
+unsigned long notifyInterval() {
+  return allSensorsStable ? BLE_UPDATE_INTERVAL_STABLE : BLE_UPDATE_INTERVAL;
+}
+
+// Keep the LCD backlight on while the button is held and for LCD_BACKLIGHT_TIMEOUT after
+void updateBacklight() {
+  unsigned long now = millis();
+  if (digitalRead(LCD_BUTTON_PIN) == LOW) {
+    lastBacklightDemand = now;
+    if (!backlightOn) {
+      setBacklight(true);
     }
-    return 3000;
+  } else if (backlightOn && !initialValue && now - lastBacklightDemand >= LCD_BACKLIGHT_TIMEOUT) {
+    setBacklight(false);
+  }
+}
+
+// Switch the backlight, the sensor screen is only refreshed while it's on
+void setBacklight(bool on) {
+  unsigned long now = millis();
+  if (backlightOn) {
+    backlightOnMillis += now - backlightOnSince;
   }
-  else if (turbidityVoltage > 4.21) {
+  backlightOn = on;
+  backlightOnSince = now;
+  if (on) {
+    lcd.backlight();
     if (!initialValue) {
-      lcd.print(0);
-      lcd.print(" NTU   "); // padding spcaes added to overwrite unused spaces from previous print
+      renderSensorScreen(latestReadings);
+      lcdFramebuffer.begin();
     }
+  } else {
+    lcd.noBacklight();
+    lcdFramebuffer.end();
+  }
+}
+
+// Notify the duty cycle, backlight share and estimated current since the last report, with the current rates
+void updatePowerReport() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - powerReportWindowStart;
+  unsigned long backlightMillis = backlightOnMillis + (backlightOn ? now - backlightOnSince : 0);
+  float dutyCycle = idleSleep.dutyCycle();
+  float backlight = elapsed > 0 ? (float)min(backlightMillis, elapsed) / elapsed : 0;
+  float current = CURRENT_RADIO_MA + CURRENT_LCD_MA + CURRENT_SENSORS_MA + CURRENT_BACKLIGHT_MA * backlight
+    + CURRENT_CPU_ACTIVE_MA * dutyCycle + CURRENT_CPU_IDLE_MA * (1 - dutyCycle);
+
+  PowerReport report;
+  report.dutyCycle = round(dutyCycle * 1000);
+  report.backlightOn = round(backlight * 1000);
+  report.estimatedCurrent = round(current * 10);
+  report.notifyInterval = notifyInterval();
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    report.sampleIntervals[i] = min(sensorSamplers[i].interval() / 100, 255UL);
+  }
+  uint8_t packed[POWER_REPORT_SIZE];
+  powerReportCharacteristic.writeValue(packed, packPowerReport(report, packed));
+
+  Serial.print("Duty cycle: ");
+  Serial.print(dutyCycle * 100, 1);
+  Serial.print("%, backlight: ");
+  Serial.print(backlight * 100, 1);
+  Serial.print("%, estimated current: ");
+  Serial.print(current, 1);
+  Serial.println("mA");
+
+  idleSleep.startWindow();
+  powerReportWindowStart = now;
+  backlightOnMillis = 0;
+  backlightOnSince = now;
+}
+
+float readTemperature() {
+  // Collect the temperature once the background conversion is done and start the next one,
+  // otherwise keep returning the last value instead of blocking for the conversion
+  if (millis() - temperatureRequestTime >= temperatureConversionTime) {
+    float lastTempC = tempC;
+    tempC = ds18b20.getTempC(ds18b20Address); // Update global tempC variable for TDS calculation
+    tempF = DallasTemperature::toFahrenheit(tempC);
+    if (tempC != lastTempC) {
+      updateTdsCompensation();
+    }
+    ds18b20.requestTemperaturesByAddress(ds18b20Address);
+    temperatureRequestTime = millis();
+  }
+
+  return tempF;
+}
+
+int readTotalDissolvedSolids() {
+  // Temperature compensated cubic of the TDS voltage, the compensation is folded into the curve's input scale
+  return q16Round(tdsCurve.convert(adcSampler.readRaw(tdsChannel)));
+}
+
+int readTurbidityValue() {
+  // turbidity is the measure of cloudiness in the water. Range is 0 to 3000 NTU
+  q16_t turbidityVoltage = turbidityCurve.input(adcSampler.readRaw(turbidityChannel));
+
+  // Convert the voltage to NTU (valid range is 2.5 to 4.21V, quadratic set up in setupSensorConversions())
+  if (turbidityVoltage <= toQ16(2.5)) {
+    return 3000;
+  }
+  else if (turbidityVoltage > toQ16(4.21)) {
     return 0;
   }
   else {
-    // for 3.3V output this is the quadratic equation: y = -2572.2x² + 8700.5x - 4352.9
-    //// source: https://forum.arduino.cc/t/getting-ntu-from-turbidity-sensor-on-3-3v/658067/14
-    float ntuValue = round(-1120.4 * sq(turbidityVoltage) + 5742.3 * turbidityVoltage - 4352.9);
-    if (!initialValue) {
-      lcd.print(ntuValue);
-      if (ntuValue >= 1000) {
-        lcd.print(" NTU");
-      }
-      else if (ntuValue >= 100 || ntuValue < -9) {
-        lcd.print(" NTU ");
-      }
-      else {
-        lcd.print(" NTU  "); // padding spaces
-      }
-    }
-    return ntuValue;
+    return q16Round(turbidityCurve.evaluate(turbidityVoltage));
   }
 }
 
 float readTurbidityVoltage() {
-  return convertAnalogToVoltage(analogRead(TURBIDITY_SENSOR_PIN)) - turbidityOffset;
+  return q16ToFloat(turbidityCurve.input(adcSampler.readRaw(turbidityChannel)));
 }
 
 float readWaterLevel() {
   // Read the distance from the A02YYMW sensor
   float distance = sonar.ping_in();
 
-  // Update LCD
-  if (!initialValue) {
-    lcd.setCursor(0, 1);
-    lcd.print("Pond Level: ");
-    if (distance <= MAX_DISTANCE) {
-      lcd.print(distance);
-      lcd.print(" in");
-    }
-    else {
-      lcd.print("N/A ");
-    }
-  }
-
   return distance;
 }
 
 float readPH() {
-  // Read the pH from the Atlas Scientific pH sensor. Refer to ph_grav_no_eeprom.h for more info 
-  float pH_value = pH.read_ph();
-
-  // Update LCD
-  if (!initialValue) {
-    lcd.setCursor(12, 0);
-    lcd.print("pH: ");
-    if (pH_value < 10.0) {
-      lcd.print(pH_value, 2);
-    }
-    else {
-      lcd.print(pH_value, 1);
-    }
+  // Read the pH from the Atlas Scientific pH sensor using the background sampled counts. Refer to ph_grav_no_eeprom.h for more info
+  // (the table is the same piecewise line as Gravity_pH::read_ph(), rebuilt if the probe is recalibrated)
+  if (pH.get_cal_count() != pHTableCalCount) {
+    buildPHTable();
   }
+  float pH_value = q16ToFloat(pHTable.convert(adcSampler.readRaw(pHChannel)));
 
   return pH_value;
 }
 
-void readSensorValues() {
-  // Read and Append sensor values directly to their associated storage arrays if within 5% of average
-  appendValueToAverageArray(temperatureValues, ARRAY_SIZE, readTemperature());
-  appendValueToAverageArray(totalDissolvedSolidsValues, ARRAY_SIZE, readTotalDissolvedSolids());
-  appendValueToAverageArray(turbidityValues, ARRAY_SIZE, readTurbidityValue());
-  appendValueToAverageArray(turbidityVoltageValues, ARRAY_SIZE, readTurbidityVoltage());
-  appendValueToAverageArray(waterLevelValues, ARRAY_SIZE, readWaterLevel());
-  appendValueToAverageArray(pHValues, ARRAY_SIZE, readPH());
-
-  // increment the array index 
-  arrayIndex = (arrayIndex + 1) % ARRAY_SIZE;
+// Lay out the sensor screen in the LCD framebuffer (RAM only, no I2C traffic)
+void renderSensorScreen(const SensorReadings& readings) {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    const LcdField& field = sensorScreenLayout[i];
+    if (i == SENSOR_WATER_LEVEL && readings.values[i] > MAX_DISTANCE) {
+      lcdFramebuffer.printField(field, "N/A");
+    } else {
+      lcdFramebuffer.printField(field, readings.values[i]);
+    }
+  }
 }
 
 void updateBLECharacteristics() {
-  // Calculate the average of the sensor arrays and write the values to the BLE characteristics
-  // Note some of the characteristics are int types so those averages are rounded to nearest integer
-  temperatureCharacteristic.writeValue(average(temperatureValues, ARRAY_SIZE));
-  totalDissolvedSolidsCharacteristic.writeValue(intAverage(totalDissolvedSolidsValues, ARRAY_SIZE));
-  turbidityValueCharacteristic.writeValue(intAverage(turbidityValues, ARRAY_SIZE));
-  turbidityVoltageCharacteristic.writeValue(average(turbidityVoltageValues, ARRAY_SIZE));
-  waterLevelCharacteristic.writeValue(average(waterLevelValues, ARRAY_SIZE));
-  pHCharacteristic.writeValue(average(pHValues, ARRAY_SIZE));
+  // Take the mean of each sensor over the interval
+  SensorPacket packet;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    packet.readings.set((SensorId)i, takeIntervalMean((SensorId)i));
+  }
+
+  // Write the whole snapshot to the packed characteristic first, it's the one current centrals subscribe to
+  packet.sequence = sensorPacketSequence++;
+  packet.timestamp = millis();
+  packet.readAge = pipelineTime(millis() - lastSampleTime);
+  uint8_t packed[SENSOR_PACKET_SIZE];
+  sensorPacketCharacteristic.writeValue(packed, packSensorPacket(packet, packed));
+
+  // Keep the single value characteristics up to date for older centrals
+  // Note the whole number sensors' characteristics are ints so those means are rounded to nearest integer
+#define WRITE_SENSOR_CHARACTERISTIC(id, jsonKey, valueType, ...) \
+  jsonKey##Characteristic.writeValue(toSensorValueType<valueType>(packet.readings.values[SENSOR_##id]));
+  POND_SENSORS(WRITE_SENSOR_CHARACTERISTIC)
+
+  if (PROFILE) {
+    // the packed characteristic plus every single value characteristic is written per update
+    profiler.recordMessage(SENSOR_PACKET_SIZE + SENSOR_VALUES_SIZE);
+  }
 }
@@ -3,10 +3,12 @@
 
   It will perform the following functions:
   1. Connect to the MKR WiFi 1010 board via TX/RX pins
-  2. Connect to the sensor data peripheral device at my pond via BLE 
-  3. Read and subscribe to sensor data updates from the peripheral device
+  2. Connect to the sensor data peripheral devices (one monitor per pond, up to FRAME_MAX_DEVICES) via BLE
+  3. Subscribe to sensor data updates from every peripheral device at once, each tagged with its device ID
   4. Send sensor data to the main board via UART
-    - This board will send both realtime values and average values gathered over a 1 minute interval for logging purposes
+    - This board will send both realtime values (only the sensors that changed past their deadband, plus a 5 minute heartbeat)
+      and average values gathered over a 1 minute interval for logging purposes
+    - Data is sent as compact binary frames (see serial_frame.h), the MKR converts them to JSON for Firebase
     - The main board will be responsible for sending the data to my Firebase RTDB via Ethernet & REST APIs
 
   Potential Feature Additions:
@@ -23,36 +25,112 @@
 #include "version.h"
 #include "config.h"
 #include <ArduinoBLE.h>
-#include <ArduinoJson.h>
+#include "loop_profiler.h"
+#include "sensor_readings.h"
+#include "running_stats.h"
+#include "sensor_packet.h"
+#include "change_reporter.h"
+#include "serial_frame.h"
+#include "cooperative_scheduler.h"
+#include "line_reader.h"
+#include "memory_monitor.h"
+#include "latency_histogram.h"
+#include "pipeline_timing.h"
 
 // #Defines
+#ifndef DEBUG
 #define DEBUG (false) // Set to true to enable debug output and fake data generation
-
-// Global variables to store the sensor data to calculate average values over a 1 minute interval
-const int MAX_SENSOR_VALUES = 60; // The maximum number of sensor values to store in the arrays
-
-// Arrays for sensor values
-float temperatureValues[MAX_SENSOR_VALUES] = {0};
-float waterLevelValues[MAX_SENSOR_VALUES] = {0};
-int turbidityValues[MAX_SENSOR_VALUES] = {0};
-float turbidityVoltageValues[MAX_SENSOR_VALUES] = {0};
-int totalDissolvedSolidsValues[MAX_SENSOR_VALUES] = {0};
-float pHValues[MAX_SENSOR_VALUES] = {0};
+#endif
+#ifndef PROFILE
+#define PROFILE (false) // Set to true to print loop latency, message size and free RAM reports every minute
+#endif
 
 // Global constants for data logging
-unsigned long lastDataLogSent = 0;
 const unsigned long dataLogInterval = 60000; // 1 minute
-const int NUM_SENSORS = 6; // change this if you add/remove sensors
-
-int numValues[NUM_SENSORS] = {0, 0, 0, 0, 0, 0}; // The number of values stored for each sensor
-int currentIndex[NUM_SENSORS] = {0, 0, 0, 0, 0, 0}; // The current index for each sensor's array
-
-bool isPeripheralConnected = false;
-unsigned long lastConnectionTime = 0; // Store the last connection time in milliseconds
-const unsigned long peripheralTimeout = 15000; // 15 seconds
-int lastRssi = 0; // Global variable to store the last RSSI reading
+const int NUM_SENSORS = SENSOR_COUNT; // add/remove sensors in sensor_registry.h
+
+// UUIDs of the monitor's single value characteristics (indexed by SensorId)
+#define SENSOR_CHARACTERISTIC_UUID(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, uuid, reader) uuid,
+const char* const sensorCharacteristicUuids[NUM_SENSORS] = {
+  POND_SENSORS(SENSOR_CHARACTERISTIC_UUID)
+};
+
+// The event handler for each sensor's single value characteristic (indexed by SensorId)
+template <SensorId id>
+void onSensorValueUpdated(BLEDevice peripheral, BLECharacteristic characteristic);
+#define SENSOR_VALUE_HANDLER(id, ...) onSensorValueUpdated<SENSOR_##id>,
+const BLECharacteristicEventHandler sensorValueHandlers[NUM_SENSORS] = {
+  POND_SENSORS(SENSOR_VALUE_HANDLER)
+};
+
+// One monitor per name in peripheralNames (config.h), its index is the device ID sent to the MKR
+const uint8_t NUM_DEVICES = sizeof(peripheralNames) / sizeof(peripheralNames[0]);
+static_assert(NUM_DEVICES <= FRAME_MAX_DEVICES, "peripheralNames has more monitors than FRAME_MAX_DEVICES");
+
+// Everything kept per monitor. The monitors stay connected together, and their notifications are
+// handled by the BLE event handlers as BLE.poll() delivers them, so no connection blocks the others
+// or the MKR's commands.
+struct MonitorDevice {
+  BLEDevice peripheral;
+  bool connected = false;
+  unsigned long lastConnectionTime = 0; // when the connection was made or dropped
+  int lastRssi = 0;
+
+  // Fast reconnect: after the first connection the peripheral's address and characteristic layout are kept,
+  // so the scan can match it by address and only the data service is discovered instead of every attribute.
+  // If the address isn't seen within cachedAddressScanTimeout, the service doesn't have the characteristics it
+  // had, or another board answers to the monitor's name, the cache is stale and a full discovery is used again.
+  char cachedAddress[18] = "";  // "aa:bb:cc:dd:ee:ff", empty until the first connection
+  bool cachedPacketLayout = false; // the peripheral has the packed sensor characteristic
+  unsigned long disconnectTime = 0; // when the last connection dropped, 0 before the first one
+  LatencyHistogram reconnectLatency; // disconnect -> data streaming again
+  unsigned long fullDiscoveries = 0;
+
+  // Packed sensor characteristic statistics (see sensor_packet.h)
+  bool haveSequence = false;
+  uint16_t expectedSequence = 0;
+  unsigned long packetsReceived = 0;
+  unsigned long packetsDropped = 0; // gaps in the packet sequence numbers
+  OneWayDelay bleDelay; // how long each packet took over the link's base delay (see pipeline_timing.h)
+
+  // Single value characteristic updates received since the last loop() pass, sent as one realtime frame
+  SensorReadings pendingReadings;
+  unsigned long pendingSince = 0; // when the first of them arrived
+
+  // Running statistics of each sensor over the current 1 minute log interval (indexed by SensorId)
+  RunningStats<float> logStats[NUM_SENSORS];
+  unsigned long lastDataLogSent = 0;
+
+  // Realtime frames only carry the sensors that changed by more than their deadband (see sensor_registry.h),
+  // plus a heartbeat of each sensor every 5 minutes. The log frames still get every value.
+  ChangeReporter realtimeChanges;
+};
+MonitorDevice devices[NUM_DEVICES];
+
+// Scanning runs whenever a monitor isn't connected (see startScan() and matchDevice())
+bool scanning = false;
+int addressScanDevice = -1; // the monitor the scan is filtered to by its cached address, -1 for other scans
+unsigned long scanStartTime = 0;
+const unsigned long cachedAddressScanTimeout = 10000; // scan by name again if the cached address isn't seen in time
+
+// Profiles loop() latency, bytes per UART message and free RAM (see loop_profiler.h)
+LoopProfiler profiler("Nano Central Hub");
+
+// Builds the binary frames sent to the MKR board over Serial1 (see serial_frame.h)
+FrameWriter mkrFrameWriter;
+
+// Text commands from the MKR board, read without blocking or allocating (see line_reader.h)
+LineReader mkrCommand;
+
+// Built-in LED blink state, the blink runs as a scheduler task so sending a frame never waits on it
+const unsigned long ledBlinkInterval = 50; // ms between LED toggles
+int ledTogglesRemaining = 0;
+TaskHandle ledBlinkTask = NO_TASK;
 
 void setup() {
+    // Paint the free RAM first so the stack high-watermark covers everything (see memory_monitor.h)
+    memoryMonitor.begin();
+
     // initialize serial communication
     Serial.begin(115200);
     Serial.println("\nSerial port ready.");
@@ -61,6 +139,10 @@ void setup() {
 
     pinMode(LED_BUILTIN, OUTPUT);
 
+    if (PROFILE) {
+      scheduler.schedule(printMemoryReport, nullptr, PROFILE_REPORT_INTERVAL);
+    }
+
     Serial1.begin(115200);
     // perform handshake connection with MKR 1010 board
     establishSerialConnectionWithMKR();
@@ -69,7 +151,7 @@ void setup() {
     if (DEBUG)
     {
       Serial.println("Debug mode enabled. Skipping BLE initialization.");
-      delay(10000); // Delay for 10 seconds to allow the MKR board to bootup
+      scheduler.delay(10000); // Delay for 10 seconds to allow the MKR board to bootup
       return;
     }
     
@@ -80,97 +162,111 @@ void setup() {
     }
     Serial.println("Central BLE device started.");
 
-    // start scanning for peripherals
-    BLE.scanForName(peripheralName);
-    Serial.println("Scanning for peripheral...");
+    // start scanning for the monitors
+    startScan();
+
+    // From here on receiving and forwarding data shouldn't allocate
+    memoryMonitor.markSteadyState();
 }
 
 void loop() {
+  if (PROFILE) {
+    profiler.beginLoop();
+  }
+
+  // run any due background tasks (LED blinks)
+  scheduler.run();
+
+  memoryMonitor.update();
+
   if (DEBUG) {
-    // Simulate sensor data read and send it every few seconds
+    // Simulate sensor data read and send it every few seconds, for every monitor
     static unsigned long lastFakeDataTime = 0;
     if (millis() - lastFakeDataTime > 3000) {
-      generateAndAppendFakeSensorData();
       lastFakeDataTime = millis();
-      isPeripheralConnected = true;
-      lastConnectionTime = millis();
-      lastRssi = generateRandomValue(-100, -50);
+      for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+        devices[id].connected = true;
+        devices[id].lastConnectionTime = millis();
+        devices[id].lastRssi = generateRandomValue(-100, -50);
+        generateAndAppendFakeSensorData(id);
+      }
     }
   }
   else {
-    BLEDevice peripheral = BLE.available();
+    // deliver BLE events, the sensor notifications arrive in onSensorPacketUpdated() and onSensorValueUpdated()
+    BLE.poll();
 
-    if (peripheral) {
-      if (peripheral.localName() == peripheralName) {
-        // stop scanning
+    if (scanning) {
+      BLEDevice peripheral = BLE.available();
+      int id = peripheral ? matchDevice(peripheral) : -1;
+      if (id >= 0) {
         BLE.stopScan();
-        Serial.print("Found: ");
-        Serial.print(peripheral.address());
-        Serial.print(" '");
-        Serial.print(peripheral.localName());
-        Serial.print("' ");
-        Serial.print(peripheral.advertisedServiceUuid());
-        Serial.println();
-
-        // Update connection status
-        isPeripheralConnected = true;
-        lastConnectionTime = millis();
-
-        // Update the RSSI value
-        lastRssi = peripheral.rssi();
-        Serial.print("RSSI: ");
-        Serial.println(lastRssi);
-
-        // read peripheral data and send it to the main board
-        streamPeripheralData(peripheral);
-        
-        // resume scanning
-        BLE.scanForName(peripheralName);
+        scanning = false;
+        connectToMonitor(id, peripheral);
+        // resume scanning for the rest
+        startScan();
+      } else if (addressScanDevice >= 0 && millis() - scanStartTime >= cachedAddressScanTimeout) {
+        MonitorDevice& device = devices[addressScanDevice];
+        Serial.println("Cached peripheral address not seen, scanning by name.");
+        device.cachedAddress[0] = '\0';
+        device.fullDiscoveries++;
+        startScan();
       }
-    } else {
-      // Check if the peripheral is still connected
-      if (isPeripheralConnected && millis() - lastConnectionTime >= peripheralTimeout) {
-        Serial.println("Peripheral disconnected.");
-        isPeripheralConnected = false;
+    }
+
+    for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+      MonitorDevice& device = devices[id];
+      if (!device.connected) {
+        continue;
+      }
+      if (!device.peripheral.connected()) {
+        monitorDisconnected(id);
+        continue;
       }
+      if (device.pendingReadings.present) {
+        reportRealtimeReadings(id, FRAME_REALTIME, device.pendingReadings, PipelineStamp(), device.pendingSince);
+        device.pendingReadings = SensorReadings();
+      }
+      checkLogUpdate(id);
     }
   }
 
   // Handle incoming commands from the MKR central hub
-  if (Serial1.available()) {
-    String command = Serial1.readStringUntil('\n');
-    command.trim(); // Remove any whitespace or newline characters
+  if (mkrCommand.poll(Serial1)) {
+    const char* command = mkrCommand.line();
 
     // Handling various commands
-    if (command == "READY_TO_CONNECT") {
+    if (strcmp(command, "READY_TO_CONNECT") == 0) {
+      // the MKR restarted, so it needs every sensor again
+      for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+        devices[id].realtimeChanges.reset();
+      }
       Serial1.println("NANO_CONNECTED");
       Serial.println("Connection with MKR established.");
-    } else if (command == "STATUS") {
+    } else if (strcmp(command, "STATUS") == 0) {
       sendStatus();
-    } else if (command == "RECONNECT") {
-      // Reconnect to the peripheral device
-      BLE.scanForName(peripheralName);
-      Serial.println("Scanning for peripheral...");
-    } else if (command.startsWith("CALIBRATE_PH")) {
-      // Parse calibration values from the command
-      int firstComma = command.indexOf(',');
-      int secondComma = command.indexOf(',', firstComma + 1);
-
-      if (firstComma != -1 && secondComma != -1) {
-        String lowCal = command.substring(13, firstComma); // start after "CALIBRATE_PH "
-        String midCal = command.substring(firstComma + 1, secondComma);
-        String highCal = command.substring(secondComma + 1);
-
-        // Now you can convert these String values to floats if needed:
-        float lowCalValue = lowCal.toFloat();
-        float midCalValue = midCal.toFloat();
-        float highCalValue = highCal.toFloat();
-
-        // Assuming you are connected to the peripheral
-        updatePhCalibrationCharacteristic(lowCalValue, midCalValue, highCalValue);
+    } else if (strcmp(command, "RECONNECT") == 0) {
+      // Scan for any monitor that isn't connected
+      startScan();
+    } else if (strncmp(command, "CALIBRATE_PH ", 13) == 0) {
+      // Parse calibration values from the command: "CALIBRATE_PH low,mid,high[,device]"
+      char* end;
+      float lowCalValue = strtod(command + 13, &end);
+      bool valid = *end == ',';
+      float midCalValue = valid ? strtod(end + 1, &end) : 0;
+      valid = valid && *end == ',';
+      float highCalValue = valid ? strtod(end + 1, &end) : 0;
+      long id = 0; // the original monitor if no device is given
+      if (valid && *end == ',') {
+        id = strtol(end + 1, &end, 10);
+      }
+      valid = valid && id >= 0 && id < NUM_DEVICES;
+
+      if (valid) {
+        updatePhCalibrationCharacteristic(id, lowCalValue, midCalValue, highCalValue);
       } else {
         Serial.println("Invalid calibration command format.");
-        Serial1.println("ERROR: Invalid calibration command format");
+        sendReplyToMkrBoard("ERROR: Invalid calibration command format");
       }
     }
     else {
@@ -178,70 +274,84 @@ void loop() {
       Serial.println(command);
       
       // Send an error message back to the MKR board
-      Serial1.println("ERROR: Unknown command");
+      sendReplyToMkrBoard("ERROR: Unknown command");
     }
   }
+
+  if (PROFILE) {
+    profiler.endLoop();
+  }
 }
 
 void establishSerialConnectionWithMKR() {
+  LineReader debugCommand;
   // wait for connection message from MKR
   while (true) {
     // Check if debug command is received
-    if (Serial.available()) {
-      String command = Serial.readStringUntil('\n');
-      command.trim();
-      if (command == "DEBUG") {
-        Serial.println("Debug mode enabled, skipping connection with MKR.");
-        return;
-      }
+    if (debugCommand.poll(Serial) && strcmp(debugCommand.line(), "DEBUG") == 0) {
+      Serial.println("Debug mode enabled, skipping connection with MKR.");
+      return;
     }
 
-    if (Serial1.available()) {
-      String received = Serial1.readStringUntil('\n');
-      received.trim(); // remove any leading/trailing white space or special characters
-      Serial.println("Received: " + received); // Print any received message
-      if (received == "READY_TO_CONNECT") {
+    if (mkrCommand.poll(Serial1)) {
+      Serial.print("Received: "); // Print any received message
+      Serial.println(mkrCommand.line());
+      if (strcmp(mkrCommand.line(), "READY_TO_CONNECT") == 0) {
         // send connection message to MKR
         Serial1.println("NANO_CONNECTED");
         Serial.println("Sent NANO_CONNECTED to MKR");
-        digitalWrite(LED_BUILTIN, HIGH);
-        delay(50);
-        digitalWrite(LED_BUILTIN, LOW);
-        delay(50);
-        digitalWrite(LED_BUILTIN, HIGH);
-        delay(50);
-        digitalWrite(LED_BUILTIN, LOW);
-        delay(50);
-        digitalWrite(LED_BUILTIN, HIGH);
-        delay(50);
-        digitalWrite(LED_BUILTIN, LOW);
+        blinkLed(3);
         break;
       }
     }
   }
 }
 
+// One status frame per monitor, each says how many there are so the MKR knows when it has them all
 void sendStatus() {
-  // Create the status JSON payload
-  StaticJsonDocument<256> jsonPayload;
-  jsonPayload["type"] = "status";  // type field so MKR can route properly
-  jsonPayload["connected"] = isPeripheralConnected;
-  if (isPeripheralConnected) {
-    jsonPayload["rssi"] = lastRssi;
-  } else {
-    // Calculate the time since the last connection in seconds
-    unsigned long timeSinceLastConnection = (millis() - lastConnectionTime) / 1000;
-    jsonPayload["timeSinceLastConnection"] = timeSinceLastConnection;
+  for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+    const MonitorDevice& device = devices[id];
+    NanoStatus status;
+    status.deviceCount = NUM_DEVICES;
+    status.connected = device.connected;
+    status.bleSamplesDropped = device.packetsDropped;
+    status.realtimeValuesReported = device.realtimeChanges.valuesReported;
+    status.realtimeValuesSuppressed = device.realtimeChanges.valuesSuppressed;
+    status.realtimeHeartbeats = device.realtimeChanges.heartbeats;
+    if (device.connected) {
+      status.rssi = device.lastRssi;
+    } else {
+      // Calculate the time since the last connection in seconds
+      status.timeSinceLastConnection = (millis() - device.lastConnectionTime) / 1000;
+    }
+    status.bleReconnects = device.reconnectLatency.count();
+    status.bleFullDiscoveries = device.fullDiscoveries;
+    status.bleReconnectP50 = min(device.reconnectLatency.percentile(50), 65535UL);
+    status.bleReconnectP90 = min(device.reconnectLatency.percentile(90), 65535UL);
+    status.bleReconnectP99 = min(device.reconnectLatency.percentile(99), 65535UL);
+
+    transmitFrameToMkrBoard(FRAME_STATUS, packNanoStatus(status, mkrFrameWriter.payload()), id);
   }
+}
 
-  serializeJson(jsonPayload, Serial1);
-  Serial1.println();
+// Reply to a command from the MKR. Replies are framed like the sensor data so the MKR can pick them
+// out of the stream without waiting on Serial1.
+void sendReplyToMkrBoard(const char* reply) {
+  size_t length = strlen(reply);
+  if (length > FRAME_MAX_PAYLOAD) {
+    length = FRAME_MAX_PAYLOAD;
+  }
+  memcpy(mkrFrameWriter.payload(), reply, length);
+  transmitFrameToMkrBoard(FRAME_REPLY, length, 0);
 }
 
-void updatePhCalibrationCharacteristic(float lowCal, float midCal, float highCal) {
-  // Assuming BLE peripheral is already connected and characteristic discovered
-  BLEDevice peripheral; // You should have this from your connection logic
-  BLECharacteristic pHCalibrationCharacteristic = peripheral.characteristic(pHCalibrationCharacteristicUuid);
+void updatePhCalibrationCharacteristic(uint8_t id, float lowCal, float midCal, float highCal) {
+  if (!devices[id].connected) {
+    Serial.println("Monitor not connected, can't calibrate pH.");
+    sendReplyToMkrBoard("ERROR: Monitor not connected");
+    return;
+  }
+  BLECharacteristic pHCalibrationCharacteristic = devices[id].peripheral.characteristic(pHCalibrationCharacteristicUuid);
 
   if (pHCalibrationCharacteristic) {
     Serial.println("Found pH Calibration Characteristic. Updating values...");
@@ -253,183 +363,386 @@ void updatePhCalibrationCharacteristic(float lowCal, float midCal, float highCal
     // Write new calibration data to the characteristic
     if (pHCalibrationCharacteristic.writeValue(calibData)) {
       Serial.println("Calibration values updated successfully.");
-      Serial1.println("CALIBRATION_SUCCESS");
+      sendReplyToMkrBoard("CALIBRATION_SUCCESS");
     } else {
       Serial.println("Failed to update calibration values.");
-      Serial1.println("ERROR: Calibration update failed");
+      sendReplyToMkrBoard("ERROR: Calibration update failed");
     }
   } else {
     Serial.println("pH Calibration Characteristic not found.");
-    Serial1.println("ERROR: pH Characteristic not found");
+    sendReplyToMkrBoard("ERROR: pH Characteristic not found");
   }
 }
 
-template <typename T>
-void appendSensorValue(int sensorIndex, T value) {
-  switch (sensorIndex) {
-    case 0: temperatureValues[currentIndex[sensorIndex]] = value; break;
-    case 1: waterLevelValues[currentIndex[sensorIndex]] = value; break;
-    case 2: turbidityValues[currentIndex[sensorIndex]] = value; break;
-    case 3: turbidityVoltageValues[currentIndex[sensorIndex]] = value; break;
-    case 4: totalDissolvedSolidsValues[currentIndex[sensorIndex]] = value; break;
-    case 5: pHValues[currentIndex[sensorIndex]] = value; break;
-  }
-  numValues[sensorIndex]++;
-  currentIndex[sensorIndex] = (currentIndex[sensorIndex] + 1) % MAX_SENSOR_VALUES;
+// Print heap/stack usage along with the profile report, and flag allocations in the steady state
+long printMemoryReport(void* context) {
+  memoryMonitor.printTo(Serial);
+  if (memoryMonitor.steadyStateAllocations() > 0) {
+    Serial.println(F("[memory] WARNING: heap allocations after setup, the receive/forward path should not allocate"));
+  }
+  return PROFILE_REPORT_INTERVAL;
 }
 
-void transmitDataToMkrBoard(StaticJsonDocument<256>& jsonPayload) {
-  digitalWrite(LED_BUILTIN, HIGH);
-  delay(50);
-  digitalWrite(LED_BUILTIN, LOW);
-  delay(50);
+// Blink the built-in LED `times` times in the background. Restarts the blink if one is already running.
+void blinkLed(int times) {
+  scheduler.cancel(ledBlinkTask);
   digitalWrite(LED_BUILTIN, HIGH);
-  delay(50);
-  digitalWrite(LED_BUILTIN, LOW);
+  ledTogglesRemaining = times * 2 - 1;
+  ledBlinkTask = scheduler.schedule(ledBlinkStep, nullptr, ledBlinkInterval);
+}
 
-  // Print the JSON object in a human-readable format
-  Serial.println("JSON payload to send:");
-  serializeJsonPretty(jsonPayload, Serial);
-  Serial.println();
+long ledBlinkStep(void* context) {
+  digitalWrite(LED_BUILTIN, ledTogglesRemaining % 2 == 0 ? HIGH : LOW);
+  ledTogglesRemaining--;
+  if (ledTogglesRemaining <= 0) {
+    ledBlinkTask = NO_TASK;
+    return TASK_DONE;
+  }
+  return ledBlinkInterval;
+}
 
-  serializeJson(jsonPayload, Serial1);
-  Serial1.println();
+// Send the sensors that changed (or are due a heartbeat) as a realtime frame, nothing if none did.
+// `stamp` has the sample's timing up to the Nano, `receivedAt` is when it arrived here (see pipeline_timing.h).
+void reportRealtimeReadings(uint8_t id, FrameType type, SensorReadings readings, PipelineStamp stamp, unsigned long receivedAt) {
+  if (!devices[id].realtimeChanges.filter(readings)) {
+    return;
+  }
+  Serial.print(type == FRAME_REALTIME_DEBUG ? "Transmitting REALTIME DEBUG data to main board for device " : "Transmitting REALTIME data to main board for device ");
+  Serial.println(id);
+  transmitReadingsToMkrBoard(id, type, readings, stamp, receivedAt);
 }
 
-template <typename T>
-float average(const T arr[], int n) {
-  float sum = 0;
-  for (int i = 0; i < n; i++) {
-    sum += arr[i];
+void transmitReadingsToMkrBoard(uint8_t id, FrameType type, const SensorReadings& readings, PipelineStamp stamp, unsigned long receivedAt) {
+  blinkLed(2);
+
+  // Print the readings in a human-readable format
+  Serial.print("Readings to send: ");
+  printSensorReadings(Serial, readings);
+
+  // The readings followed by how long the sample has taken so far, the MKR adds the rest of the way
+  uint8_t* payload = mkrFrameWriter.payload();
+  size_t payloadLength = packSensorReadings(readings, payload);
+  stamp.nanoHold = pipelineTime(millis() - receivedAt);
+  stamp.sentAt = millis();
+  payloadLength += packPipelineStamp(stamp, payload + payloadLength);
+  transmitFrameToMkrBoard(type, payloadLength, id);
+}
+
+// Finish the frame whose payload has been written to mkrFrameWriter.payload() and send it over Serial1,
+// `device` is the monitor it is about (0 for replies)
+void transmitFrameToMkrBoard(FrameType type, size_t payloadLength, uint8_t device) {
+  size_t frameLength = mkrFrameWriter.finish(type, payloadLength, device);
+  size_t bytesSent = Serial1.write(mkrFrameWriter.data(), frameLength);
+
+  if (PROFILE) {
+    profiler.recordMessage(bytesSent);
   }
-  return sum / n;
 }
 
-void sendLogUpdate() {
-  // Create the log update JSON payload
-  StaticJsonDocument<256> jsonPayload;
-
-  // Set the log type
-  jsonPayload["type"] = DEBUG ? "log-debug" : "log";
-
-  // Calculate the averages
-  jsonPayload["temperature"] = average(temperatureValues, numValues[0]);
-  jsonPayload["waterLevel"] = average(waterLevelValues, numValues[1]);
-  jsonPayload["turbidity"] = average(turbidityValues, numValues[2]);
-  jsonPayload["turbidityVoltage"] = average(turbidityVoltageValues, numValues[3]);
-  jsonPayload["totalDissolvedSolids"] = average(totalDissolvedSolidsValues, numValues[4]);
-  jsonPayload["pH"] = average(pHValues, numValues[5]);
-
-  // Transmit the JSON payload to the MKR board
-  Serial.println("Transmitting LOG data to main board...");
-  transmitDataToMkrBoard(jsonPayload);
-
-  // Reset the sensor value arrays and counters
-  memset(temperatureValues, 0, sizeof(temperatureValues));
-  memset(waterLevelValues, 0, sizeof(waterLevelValues));
-  memset(turbidityValues, 0, sizeof(turbidityValues));
-  memset(turbidityVoltageValues, 0, sizeof(turbidityVoltageValues));
-  memset(totalDissolvedSolidsValues, 0, sizeof(totalDissolvedSolidsValues));
-  memset(pHValues, 0, sizeof(pHValues));
-  memset(numValues, 0, sizeof(numValues));
-  memset(currentIndex, 0, sizeof(currentIndex));
+void sendLogUpdate(uint8_t id) {
+  // Take the mean and spread of each sensor that reported during the interval
+  RunningStats<float>* logStats = devices[id].logStats;
+  SensorReadings readings;
+  SensorSpreads spreads;
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    if (logStats[i].count() == 0) {
+      continue; // no values this interval, leave the sensor out instead of logging a 0
+    }
+    StatsSnapshot stats = logStats[i].snapshot();
+    readings.set((SensorId)i, stats.mean);
+    SensorSpread spread;
+    spread.minimum = stats.minimum;
+    spread.maximum = stats.maximum;
+    spread.stddev = stats.stddev;
+    spread.count = stats.count;
+    spreads.set((SensorId)i, spread);
+    logStats[i].reset();
+  }
+
+  if (!readings.present) {
+    return;
+  }
+
+  // Transmit the log frame to the MKR board (means followed by the spreads)
+  Serial.print("Transmitting LOG data to main board for device ");
+  Serial.println(id);
+  printSensorReadings(Serial, readings);
+  blinkLed(2);
+  uint8_t* payload = mkrFrameWriter.payload();
+  size_t payloadLength = packSensorReadings(readings, payload);
+  payloadLength += packSensorSpreads(spreads, payload + payloadLength);
+  transmitFrameToMkrBoard(DEBUG ? FRAME_LOG_DEBUG : FRAME_LOG, payloadLength, id);
 }
 
-bool streamPeripheralData(BLEDevice peripheral) {
+// Scan for the monitors that aren't connected, restarting any scan already running. With just one missing
+// the scan is filtered to it: by its cached address, or by name until it has one. Several missing monitors
+// share one scan matched by name (see matchDevice()), and their cached addresses are checked when they
+// connect instead of timing out, since a shared scan doesn't say which of them wasn't seen.
+void startScan() {
+  if (scanning) {
+    BLE.stopScan();
+    scanning = false;
+  }
+  addressScanDevice = -1;
+  int missing = -1;
+  uint8_t missingCount = 0;
+  for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+    if (!devices[id].connected) {
+      missing = id;
+      missingCount++;
+    }
+  }
+  if (missingCount == 0) {
+    return;
+  }
+  if (missingCount == 1 && devices[missing].cachedAddress[0] != '\0') {
+    BLE.scanForAddress(devices[missing].cachedAddress);
+    addressScanDevice = missing;
+  } else if (missingCount == 1) {
+    BLE.scanForName(peripheralNames[missing]);
+  } else {
+    BLE.scan();
+  }
+  scanning = true;
+  scanStartTime = millis();
+  Serial.println("Scanning for monitors...");
+}
+
+// Copy the local name a scanned peripheral advertises into name, read from the advertisement data so no
+// String is built for every board in range. False if it doesn't advertise a name.
+bool advertisedName(BLEDevice& peripheral, char* name, size_t size) {
+  uint8_t data[62]; // the advertisement and the scan response
+  int length = peripheral.advertisementData(data, sizeof(data));
+  for (int i = 0; i + 1 < length && data[i] != 0; i += data[i] + 1) {
+    uint8_t type = data[i + 1];
+    if (type == 0x08 || type == 0x09) { // shortened or complete local name
+      size_t nameLength = min((size_t)data[i] - 1, size - 1);
+      nameLength = min(nameLength, (size_t)(length - i - 2));
+      memcpy(name, data + i + 2, nameLength);
+      name[nameLength] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+// The device ID of a scanned peripheral, -1 if it isn't a monitor or that monitor is already connected.
+// A scan for a cached address only reports that peripheral, other scans are matched by advertised name.
+int matchDevice(BLEDevice& peripheral) {
+  if (addressScanDevice >= 0) {
+    return addressScanDevice;
+  }
+  char name[32];
+  if (!advertisedName(peripheral, name, sizeof(name))) {
+    return -1;
+  }
+  for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+    if (!devices[id].connected && strcmp(name, peripheralNames[id]) == 0) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// The connected monitor a BLE event came from, -1 if none (e.g. a notification racing a disconnect)
+int connectedDevice(const BLEDevice& peripheral) {
+  for (uint8_t id = 0; id < NUM_DEVICES; id++) {
+    if (devices[id].connected && devices[id].peripheral == peripheral) {
+      return id;
+    }
+  }
+  return -1;
+}
+
+// Discover what streaming needs: only the data service for the cached peripheral, every attribute otherwise
+// or when the cached layout isn't found in the service
+bool discoverPeripheralAttributes(MonitorDevice& device, BLEDevice& peripheral) {
+  if (device.cachedAddress[0] != '\0') {
+    bool found = peripheral.discoverService(sensorDataServiceUuid);
+    if (device.cachedPacketLayout) {
+      found = found && peripheral.characteristic(sensorPacketCharacteristicUuid);
+    } else {
+      for (int i = 0; i < NUM_SENSORS && found; i++) {
+        found = peripheral.characteristic(sensorCharacteristicUuids[i]);
+      }
+    }
+    if (found) {
+      return true;
+    }
+    Serial.println("Cached peripheral attributes are stale, discovering all attributes.");
+    device.cachedAddress[0] = '\0';
+    device.fullDiscoveries++;
+  }
+  return peripheral.discoverAttributes();
+}
+
+// Connect to a monitor and subscribe to its sensor data, from then on its notifications are handled
+// by the event handlers. Discovery still blocks the loop while the connection is set up.
+bool connectToMonitor(uint8_t id, BLEDevice& peripheral) {
+  MonitorDevice& device = devices[id];
+  // The address is only read once per connection, not for every advertisement scanned
+  char address[sizeof(device.cachedAddress)];
+  strncpy(address, peripheral.address().c_str(), sizeof(address) - 1);
+  address[sizeof(address) - 1] = '\0';
+  Serial.print("Found device ");
+  Serial.print(id);
+  Serial.print(": ");
+  Serial.print(address);
+  Serial.print(" '");
+  Serial.print(peripheralNames[id]);
+  Serial.println("'");
+
+  // A different board has the monitor's name, the cached layout is for the old one
+  if (device.cachedAddress[0] != '\0' && strcasecmp(address, device.cachedAddress) != 0) {
+    Serial.println("Monitor has a new address, discovering all attributes.");
+    device.cachedAddress[0] = '\0';
+    device.fullDiscoveries++;
+  }
+
   if (!peripheral.connect()) {
     return false;
   }
   Serial.println("Connected to peripheral!");
 
-  if (!peripheral.discoverAttributes()){
+  if (!discoverPeripheralAttributes(device, peripheral)) {
     Serial.println("Failed to discover peripheral attributes.");
     peripheral.disconnect();
     return false;
   }
   Serial.println("Discovered peripheral attributes!");
 
-  BLECharacteristic temperatureCharacteristic = peripheral.characteristic(temperatureCharacteristicUuid);
-  BLECharacteristic waterLevelCharacteristic = peripheral.characteristic(waterLevelCharacteristicUuid);
-  BLECharacteristic totalDissolvedSolidsCharacteristic = peripheral.characteristic(totalDissolvedSolidsCharacteristicUuid);
-  BLECharacteristic turbidityValueCharacteristic = peripheral.characteristic(turbidityValueCharacteristicUuid);
-  BLECharacteristic turbidityVoltageCharacteristic = peripheral.characteristic(turbidityVoltageCharacteristicUuid);
-  BLECharacteristic pHCharacteristic = peripheral.characteristic(pHCharacteristicUuid);
-
-  if (!temperatureCharacteristic || !totalDissolvedSolidsCharacteristic || !turbidityValueCharacteristic || !turbidityVoltageCharacteristic || !waterLevelCharacteristic || !pHCharacteristic) {
-    Serial.println("Failed to find characteristics.");
-    peripheral.disconnect();
-    return false;
+  // Prefer the packed characteristic: one notification per snapshot with a sequence number to spot drops
+  bool packetLayout = false;
+  BLECharacteristic sensorPacketCharacteristic = peripheral.characteristic(sensorPacketCharacteristicUuid);
+  if (sensorPacketCharacteristic && sensorPacketCharacteristic.canSubscribe()) {
+    sensorPacketCharacteristic.setEventHandler(BLEUpdated, onSensorPacketUpdated);
+    packetLayout = sensorPacketCharacteristic.subscribe();
   }
-
-  if (!temperatureCharacteristic.canSubscribe() || !totalDissolvedSolidsCharacteristic.canSubscribe() || !turbidityValueCharacteristic.canSubscribe() || !turbidityVoltageCharacteristic.canSubscribe() || !waterLevelCharacteristic.canSubscribe() || !pHCharacteristic.canSubscribe()) {
-    Serial.println("Failed to subscribe to characteristics.");
-    peripheral.disconnect();
-    return false;
+  if (packetLayout) {
+    Serial.println("Subscribed to the packed sensor characteristic.");
+  } else {
+    Serial.println("Packed sensor characteristic not available, using the single value characteristics.");
+    for (int i = 0; i < NUM_SENSORS; i++) {
+      BLECharacteristic sensorCharacteristic = peripheral.characteristic(sensorCharacteristicUuids[i]);
+      if (!sensorCharacteristic) {
+        Serial.print("Failed to find the ");
+        Serial.print(sensorRegistry[i].jsonKey);
+        Serial.println(" characteristic.");
+        peripheral.disconnect();
+        return false;
+      }
+      sensorCharacteristic.setEventHandler(BLEUpdated, sensorValueHandlers[i]);
+      if (!sensorCharacteristic.canSubscribe() || !sensorCharacteristic.subscribe()) {
+        Serial.print("Failed to subscribe to the ");
+        Serial.print(sensorRegistry[i].jsonKey);
+        Serial.println(" characteristic.");
+        peripheral.disconnect();
+        return false;
+      }
+    }
   }
 
-  if (!temperatureCharacteristic.subscribe() || !totalDissolvedSolidsCharacteristic.subscribe() || !turbidityValueCharacteristic.subscribe() || !turbidityVoltageCharacteristic.subscribe() || !waterLevelCharacteristic.subscribe() || !pHCharacteristic.subscribe()) {
-    Serial.println("Failed to subscribe to characteristics.");
-    peripheral.disconnect();
-    return false;
+  // Update connection status, and send every sensor's first value from the new connection
+  device.peripheral = peripheral;
+  device.connected = true;
+  device.haveSequence = false;
+  device.bleDelay.reset(); // the monitor may have restarted with a new clock
+  device.pendingReadings = SensorReadings();
+  device.realtimeChanges.reset();
+  device.lastConnectionTime = millis();
+  device.lastRssi = peripheral.rssi();
+  Serial.print("RSSI: ");
+  Serial.println(device.lastRssi);
+
+  // Remember the peripheral for the next reconnect and time this one
+  memcpy(device.cachedAddress, address, sizeof(device.cachedAddress));
+  device.cachedPacketLayout = packetLayout;
+  if (device.disconnectTime != 0) {
+    unsigned long reconnectTime = millis() - device.disconnectTime;
+    device.reconnectLatency.record(reconnectTime);
+    Serial.print("Reconnected in ");
+    Serial.print(reconnectTime);
+    Serial.println("ms.");
   }
+  return true;
+}
 
-  BLECharacteristic* sensorCharacteristics[NUM_SENSORS] = {&temperatureCharacteristic, &waterLevelCharacteristic, &turbidityValueCharacteristic, &turbidityVoltageCharacteristic, &totalDissolvedSolidsCharacteristic, &pHCharacteristic};
+void monitorDisconnected(uint8_t id) {
+  MonitorDevice& device = devices[id];
+  device.connected = false;
+  device.disconnectTime = millis();
+  device.lastConnectionTime = device.disconnectTime;
+  Serial.print("Device ");
+  Serial.print(id);
+  Serial.println(" disconnected.");
+  startScan();
+}
 
-  Serial.println("Reading data from peripheral...");
-  while (peripheral.connected()) {
-    StaticJsonDocument<256> jsonPayload;
-    bool dataUpdated = false;
+// A snapshot from a monitor's packed sensor characteristic. Each notification carries every sensor,
+// so it becomes at most one realtime frame (with just the sensors that changed).
+void onSensorPacketUpdated(BLEDevice peripheral, BLECharacteristic characteristic) {
+  int id = connectedDevice(peripheral);
+  if (id < 0) {
+    return;
+  }
+  MonitorDevice& device = devices[id];
+  unsigned long receivedAt = millis();
 
-    for (int i = 0; i < NUM_SENSORS; i++) {
-      if (!dataUpdated) {
-        // add data type to JSON payload for MKR to parse
-        jsonPayload["type"] = "realtime";
-      }
+  SensorPacket packet;
+  if (!unpackSensorPacket(characteristic.value(), characteristic.valueLength(), packet)) {
+    Serial.println("Malformed sensor packet. Ignoring data.");
+    return;
+  }
+  device.packetsReceived++;
+  // A sequence number of 0 means the peripheral restarted, so it does not count as a gap
+  if (device.haveSequence && packet.sequence != device.expectedSequence && packet.sequence != 0) {
+    uint16_t missed = packet.sequence - device.expectedSequence;
+    device.packetsDropped += missed;
+    Serial.print("Missed sensor packets: ");
+    Serial.println(missed);
+  }
+  device.expectedSequence = packet.sequence + 1;
+  device.haveSequence = true;
 
-      if (sensorCharacteristics[i]->valueUpdated()) {
-        dataUpdated = true;
-        const char* sensorKey;
-        switch (i) {
-          case 0: sensorKey = "temperature"; break;
-          case 1: sensorKey = "waterLevel"; break;
-          case 2: sensorKey = "turbidity"; break;
-          case 3: sensorKey = "turbidityVoltage"; break;
-          case 4: sensorKey = "totalDissolvedSolids"; break;
-          case 5: sensorKey = "pH"; break;
-        }
-
-        if (i == 0 || i == 1 || i == 3 || i == 5) { // for sensor 1, 2, 4, and 6
-          float sensorValue;
-          sensorCharacteristics[i]->readValue(&sensorValue, sizeof(sensorValue));
-          jsonPayload[sensorKey] = sensorValue;
-          appendSensorValue(i, sensorValue);
-        } else { // for sensor 3 and 5
-          int sensorValue;
-          sensorCharacteristics[i]->readValue(&sensorValue, sizeof(sensorValue));
-          jsonPayload[sensorKey] = sensorValue;
-          appendSensorValue(i, sensorValue);
-        }
-      }
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    if (packet.readings.has((SensorId)i)) {
+      device.logStats[i].add(packet.readings.values[i]);
     }
+  }
 
-    if (dataUpdated) {
-      // Transmit the JSON payload to the MKR board
-      Serial.println("Transmitting REALTIME data to main board...");
-      transmitDataToMkrBoard(jsonPayload);
-    }
+  PipelineStamp stamp;
+  stamp.sampleSequence = packet.sequence;
+  stamp.readAge = packet.readAge;
+  stamp.bleDelay = pipelineTime(device.bleDelay.add(packet.timestamp, receivedAt));
+  reportRealtimeReadings(id, FRAME_REALTIME, packet.readings, stamp, receivedAt);
+}
 
-    // Check if it's time to send a data log update to the main board
-    unsigned long currentTime = millis();
-    if (currentTime - lastDataLogSent >= dataLogInterval) {
-      sendLogUpdate();
-      // Update the lastDataLogSent variable
-      lastDataLogSent = currentTime;
-    }
+// A monitor's single value characteristic updated, collected in pendingReadings until the next loop() pass.
+// Each sensor's characteristic gets its own instance (see sensorValueHandlers), so a notification doesn't
+// have to be matched to its sensor by UUID.
+template <SensorId id>
+void onSensorValueUpdated(BLEDevice peripheral, BLECharacteristic characteristic) {
+  int device = connectedDevice(peripheral);
+  // each characteristic holds the sensor's value type from sensor_registry.h (float or int)
+  if (device < 0 || characteristic.valueLength() != sensorRegistry[id].valueSize) {
+    return;
+  }
+  MonitorDevice& monitor = devices[device];
+  float sensorValue = sensorRegistry[id].decode(characteristic.value());
+  if (!monitor.pendingReadings.present) {
+    monitor.pendingSince = millis();
   }
+  monitor.pendingReadings.set(id, sensorValue);
+  monitor.logStats[id].add(sensorValue);
+}
 
-  peripheral.disconnect();
-  Serial.println("Peripheral disconnected.");
-  return true;
+// Send a device's data log update to the main board once the log interval has passed
+void checkLogUpdate(uint8_t id) {
+  unsigned long currentTime = millis();
+  if (currentTime - devices[id].lastDataLogSent >= dataLogInterval) {
+    sendLogUpdate(id);
+    devices[id].lastDataLogSent = currentTime;
+  }
 }
 
 template <typename T>
@@ -439,50 +752,17 @@ T generateRandomValue(T lowerBound, T upperBound) {
     return lowerBound + randomValue * range;
 }
 
-void generateAndAppendFakeSensorData() {
-    StaticJsonDocument<256> jsonPayload;
-    jsonPayload["type"] = "realtime-debug";
+void generateAndAppendFakeSensorData(uint8_t id) {
+    SensorReadings readings;
 
     for (int i = 0; i < NUM_SENSORS; i++) {
-      switch (i) {
-        case 0: // Temperature
-            temperatureValues[currentIndex[i]] = generateRandomValue<float>(45.0, 55.0);
-            jsonPayload["temperature"] = temperatureValues[currentIndex[i]];
-            break;
-        case 1: // Water Level
-            waterLevelValues[currentIndex[i]] = generateRandomValue<float>(0.0, 12.0);
-            jsonPayload["waterLevel"] = waterLevelValues[currentIndex[i]];
-            break;
-        case 2: // Turbidity
-            turbidityValues[currentIndex[i]] = generateRandomValue<int>(0, 3000);
-            jsonPayload["turbidity"] = turbidityValues[currentIndex[i]];
-            break;
-        case 3: // Turbidity Voltage
-            turbidityVoltageValues[currentIndex[i]] = generateRandomValue<float>(0.0, 3.3);
-            jsonPayload["turbidityVoltage"] = turbidityVoltageValues[currentIndex[i]];
-            break;
-        case 4: // Total Dissolved Solids
-            totalDissolvedSolidsValues[currentIndex[i]] = generateRandomValue<int>(50, 300);
-            jsonPayload["totalDissolvedSolids"] = totalDissolvedSolidsValues[currentIndex[i]];
-            break;
-        case 5: // pH
-            pHValues[currentIndex[i]] = generateRandomValue<float>(6.0, 8.0);
-            jsonPayload["pH"] = pHValues[currentIndex[i]];
-            break;
-      }
-      numValues[i]++;  // Ensure we increment the count of values collected for averaging
-      currentIndex[i] = (currentIndex[i] + 1) % MAX_SENSOR_VALUES;
+      const SensorDescriptor& sensor = sensorRegistry[i];
+      float value = generateRandomValue<float>(sensor.simulatedMin, sensor.simulatedMax);
+      readings.set((SensorId)i, sensor.wholeNumber ? round(value) : value);
+      devices[id].logStats[i].add(readings.values[i]);
     }
 
-    // Transmit the JSON payload to the MKR board
-    Serial.println("Transmitting REALTIME DEBUG data to main board...");
-    transmitDataToMkrBoard(jsonPayload);
+    reportRealtimeReadings(id, FRAME_REALTIME_DEBUG, readings, PipelineStamp(), millis());
 
-    // Check if it's time to send a data log update to the main board
-    unsigned long currentTime = millis();
-    if (currentTime - lastDataLogSent >= dataLogInterval) {
-      sendLogUpdate();
-      // Update the lastDataLogSent variable
-      lastDataLogSent = currentTime;
-    }
+    checkLogUpdate(id);
 }
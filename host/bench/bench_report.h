@@ -0,0 +1,48 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <stdio.h>
+#include "host_sim.h"
+#include "loop_profiler.h"
+#include "memory_monitor.h"
+
+/*
+  Shared by the loop benchmarks: how long to run, and the summary each one prints at the end.
+
+  Every bench runs a sketch built with PROFILE on for --minutes of simulated time (default 10) and reports
+  what its LoopProfiler measured over the whole run: loop() latency on the host, the average bytes per
+  message and the peak RAM in use (the board's RAM less the lowest free RAM seen). Sketches that use the
+  memory monitor also report the deepest the stack went, which the profiler's samples at the end of
+  loop() can't see.
+
+  loop() is called every BENCH_LOOP_STEP_MICROS of simulated time, roughly an idle pass on the board,
+  unless the sketch's loop() waits for its own time (the ESP32's vTaskDelay()).
+*/
+
+#define BENCH_DEFAULT_MINUTES 10
+#define BENCH_LOOP_STEP_MICROS 250
+
+inline unsigned long benchBegin(int argc, char** argv, unsigned long loopStepMicros = BENCH_LOOP_STEP_MICROS) {
+  hostSetLoopStep(loopStepMicros);
+  return (unsigned long)hostArgLong(argc, argv, "--minutes", BENCH_DEFAULT_MINUTES) * 60000UL;
+}
+
+inline void printBenchReport(const char* bench, const LoopProfiler& profiler) {
+  unsigned long messages = profiler.messageCount();
+  printf("\n== %s ==\n", bench);
+  printf("loops:             %lu\n", profiler.loopCount());
+  printf("loop latency (us): min %lu, avg %lu, max %lu\n",
+         profiler.minLoopMicros(), profiler.averageLoopMicros(), profiler.maxLoopMicros());
+  printf("messages:          %lu, %lu bytes/message\n", messages, messages > 0 ? profiler.messageBytes() / messages : 0);
+  printf("peak RAM (bytes):  %d of %d (lowest free %d)\n",
+         HOST_RAM_SIZE - profiler.minFreeRam(), HOST_RAM_SIZE, profiler.minFreeRam());
+}
+
+inline void printBenchMemory(const MemoryMonitor& monitor) {
+  MemoryStats stats = monitor.stats();
+  printf("memory monitor:    lowest free %d, stack high water %u, heap %u, steady state allocations %lu\n",
+         stats.minFreeRam, (unsigned)stats.stackHighWater, (unsigned)stats.heapInUse,
+         (unsigned long)monitor.steadyStateAllocations());
+}
+
+#endif // BENCH_REPORT_H
@@ -0,0 +1,71 @@
+/*
+  ESP32 RF Transmitter: the stream task's readStream() with the app changing the LEDs.
+
+  The database sends the node's snapshot, then a colour change every 1.5s, a brightness step after every
+  4th colour and a power state toggle every 20th. Every change must end up as an RF transmission, or be
+  merged into a newer colour that does.
+
+  For TOKEN_REFRESH_MS from the middle of every minute Firebase isn't ready (as while its token is
+  refreshed). readStream() returns early then, and those passes must still be profiled.
+*/
+#include <Arduino.h>
+#include <FirebaseESP32.h>
+#include "bench_report.h"
+#include "rf_command_queue.h"
+#include "rf_transmitter.h"
+
+extern LoopProfiler profiler;
+extern RfTransmitter rfTransmitter;
+extern RfCommandQueue rfCommands;
+
+#define CHANGE_INTERVAL_MS 1500
+#define FIRST_COLOR_CODE 334856 // White, the colours run to Magenta (see config.h)
+#define NUM_COLORS 14
+#define TOKEN_REFRESH_MS 5000
+#define STARTUP_MS 10000 // Wi-Fi, the stream path configuration and the stream take less than this
+
+static unsigned long duration;
+static unsigned long nextChange;
+static unsigned long changes = 0;
+static unsigned long changesSent = 0; // changes the sketch should transmit
+
+void hostScenarioBegin(int argc, char** argv) {
+  duration = benchBegin(argc, argv, 0); // loop() waits in vTaskDelay()
+  hostRtdbStreamEvent("put", "/", "json",
+                      "{\"decimalCode\":334858,\"brightnessLevel\":3,\"powerState\":\"000001010001110000000011\"}");
+  nextChange = STARTUP_MS;
+}
+
+void hostScenarioPoll() {
+  unsigned long minute = millis() % 60000;
+  hostRtdbSetReady(minute < 30000 || minute >= 30000 + TOKEN_REFRESH_MS);
+  if (millis() < nextChange) {
+    return;
+  }
+  nextChange += CHANGE_INTERVAL_MS;
+  changes++;
+  char value[16];
+  if (changes % 20 == 0) {
+    hostRtdbStreamEvent("put", "/powerState", "string", "000001010001110000000011");
+  } else if (changes % 5 == 0) {
+    snprintf(value, sizeof(value), "%lu", changes % 5 + 1);
+    hostRtdbStreamEvent("put", "/brightnessLevel", "int", value);
+  } else {
+    snprintf(value, sizeof(value), "%lu", FIRST_COLOR_CODE + changes % NUM_COLORS);
+    hostRtdbStreamEvent("put", "/decimalCode", "int", value);
+  }
+  changesSent++;
+}
+
+bool hostScenarioStep() {
+  return millis() < duration;
+}
+
+int hostScenarioEnd() {
+  printBenchReport("ESP32 RF Transmitter: readStream()", profiler);
+  printf("stream events:     %lu read, %lu changes sent\n", hostRtdbEventsRead(), changesSent);
+  printf("RF transmissions:  %lu, %lu commands merged\n", rfTransmitter.transmissions, rfCommands.commandsCoalesced);
+  // The stream task makes a pass every millisecond, ready or not. The last change can still be waiting for the transmitter
+  bool everyPassProfiled = profiler.loopCount() >= duration - STARTUP_MS;
+  return everyPassProfiled && rfTransmitter.transmissions + rfCommands.commandsCoalesced + 1 >= changesSent ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/*
+  MKR Central Hub: loop() and processSensorDataFromNano() with the Nano forwarding three monitors.
+
+  Once the hub is up (STARTUP_MS after the handshake, as the Nano is still connecting to the monitors then),
+  each device sends a realtime frame every second and a log frame every minute, as the Nano does; the hub
+  uploads them to the simulated Firebase host.
+*/
+#include <Arduino.h>
+#include <SSLClient.h>
+#include "bench_report.h"
+#include "nano_link.h"
+
+extern LoopProfiler profiler;
+extern FrameReader nanoFrameReader;
+
+#define REALTIME_INTERVAL_MS 1000
+#define LOG_INTERVAL_MS 60000
+#define STARTUP_MS 10000
+#define NUM_DEVICES FRAME_MAX_DEVICES
+
+static NanoLink nano;
+static unsigned long duration;
+static unsigned long nextRealtime = 0;
+static unsigned long nextLog = 0;
+static unsigned long step = 0;
+
+void hostScenarioBegin(int argc, char** argv) {
+  duration = benchBegin(argc, argv);
+}
+
+void hostScenarioPoll() {
+  nano.poll();
+  if (!nano.connected) {
+    return;
+  }
+  if (nextRealtime == 0) {
+    nextRealtime = millis() + STARTUP_MS;
+    nextLog = nextRealtime + LOG_INTERVAL_MS;
+  }
+  if (millis() >= nextRealtime) {
+    nextRealtime += REALTIME_INTERVAL_MS;
+    step++;
+    for (uint8_t device = 0; device < NUM_DEVICES; device++) {
+      nano.sendReadings(FRAME_REALTIME, device, driftingReadings(device, step));
+    }
+  }
+  if (millis() >= nextLog) {
+    nextLog += LOG_INTERVAL_MS;
+    for (uint8_t device = 0; device < NUM_DEVICES; device++) {
+      nano.sendReadings(FRAME_LOG, device, driftingReadings(device, step));
+    }
+  }
+}
+
+bool hostScenarioStep() {
+  return millis() < duration;
+}
+
+int hostScenarioEnd() {
+  printBenchReport("MKR Central Hub: loop() / processSensorDataFromNano()", profiler);
+  printf("frames:            %lu sent, %lu received, %lu CRC errors, %lu dropped, %lu UART overruns\n",
+         nano.framesSent, nanoFrameReader.framesReceived, nanoFrameReader.crcErrors, nanoFrameReader.droppedFrames,
+         Serial1.rxOverruns);
+  printf("Firebase:          %lu requests, %llu bytes, %lu full / %lu resumed handshakes\n",
+         hostFirebase.requests, hostFirebase.requestBytes, hostFirebase.fullHandshakes, hostFirebase.resumedHandshakes);
+  printBenchMemory(memoryMonitor);
+  return nanoFrameReader.framesReceived > 0 && hostFirebase.writes > 0 ? 0 : 1;
+}
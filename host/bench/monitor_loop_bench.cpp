@@ -0,0 +1,76 @@
+/*
+  Water Quality Monitor: loop(), sampleDueSensors() and updateBLECharacteristics() with a central connected.
+
+  The pond alternates between CHANGE_PERIOD_MS of moving readings and as long of steady ones, so the
+  adaptive sampling runs at both ends of its range, and the LCD button is pressed every 5 minutes.
+  A central connects STARTUP_MS after boot and stays connected.
+*/
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+#include <DallasTemperature.h>
+#include <LiquidCrystal_I2C.h>
+#include <NewPing.h>
+#include "bench_report.h"
+#include "low_power.h"
+#include "monitor_ids.h"
+
+extern LoopProfiler profiler;
+extern LiquidCrystal_I2C lcd;
+extern IdleSleep idleSleep;
+
+#define STARTUP_MS 5000
+#define CHANGE_PERIOD_MS 180000
+#define UPDATE_INTERVAL_MS 1000
+#define BUTTON_INTERVAL_MS 300000
+#define BUTTON_PRESS_MS 200
+#define LCD_BUTTON_PIN 4
+
+static unsigned long duration;
+static unsigned long nextUpdate = 0;
+static unsigned long step = 0;
+static bool centralConnected = false;
+
+// Pond readings as the sensors' raw outputs: the turbidity, TDS and pH boards' counts, degrees and cm
+static void setPond(float phase) {
+  hostSetAnalog(A1, 2800 + 150 * sinf(phase), 3);     // turbidity, ~2.7V
+  hostSetAnalog(A2, 400 + 60 * cosf(phase * 0.5f), 3); // TDS, ~135ppm
+  hostSetAnalog(A3, 1860 + 40 * sinf(phase * 0.3f), 3); // pH, ~1.5V
+  hostDs18b20TempC = 18 + 2 * sinf(phase * 0.2f);
+  hostSonarDistanceCm = 30 + 3 * cosf(phase * 0.1f);
+}
+
+void hostScenarioBegin(int argc, char** argv) {
+  duration = benchBegin(argc, argv);
+  hostSetDigitalInput(LCD_BUTTON_PIN, HIGH);
+  setPond(0);
+}
+
+void hostScenarioPoll() {
+  unsigned long now = millis();
+  if (!centralConnected && now >= STARTUP_MS) {
+    centralConnected = hostBleConnectCentral("a4:cf:12:aa:bb:cc");
+  }
+  hostSetDigitalInput(LCD_BUTTON_PIN, now % BUTTON_INTERVAL_MS < BUTTON_PRESS_MS && now > BUTTON_INTERVAL_MS ? LOW : HIGH);
+  if (now < nextUpdate) {
+    return;
+  }
+  nextUpdate = now + UPDATE_INTERVAL_MS;
+  if ((now / CHANGE_PERIOD_MS) % 2 == 0) {
+    step++; // the readings only move in the changing half of each period
+  }
+  setPond(step * 0.05f);
+}
+
+bool hostScenarioStep() {
+  return millis() < duration;
+}
+
+int hostScenarioEnd() {
+  HostBleAttribute* packet = hostBleLocal(HOST_SENSOR_PACKET_UUID);
+  printBenchReport("Water Quality Monitor: loop() / sampleDueSensors() / updateBLECharacteristics()", profiler);
+  printf("sensor packets:    %lu notified\n", packet != nullptr ? packet->notifications : 0);
+  printf("CPU duty cycle:    %.1f%% since the last power report\n", idleSleep.dutyCycle() * 100);
+  printf("LCD transfers:     %lu, DS18B20 conversions %lu, sonar pings %lu\n",
+         lcd.hostTransfers, hostDs18b20Conversions, hostSonarPings);
+  return centralConnected && packet != nullptr && packet->notifications > 0 ? 0 : 1;
+}
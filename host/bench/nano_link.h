@@ -0,0 +1,80 @@
+#ifndef NANO_LINK_H
+#define NANO_LINK_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "serial_frame.h"
+#include "sensor_readings.h"
+
+/*
+  The Nano's end of the Serial1 link, for the scenarios that run the MKR hub: answers the hub's
+  READY_TO_CONNECT handshake and sends it frames the way the Nano sketch builds them.
+*/
+
+class NanoLink {
+  public:
+    // Answer the handshake once the hub asks for it, and collect the hub's other lines. Call from hostScenarioPoll()
+    void poll() {
+      uint8_t byte;
+      while (Serial1.hostDrain(&byte, 1) == 1) {
+        if (byte == '\r') {
+          continue;
+        }
+        if (byte != '\n') {
+          if (lineLength < sizeof(line) - 1) {
+            line[lineLength++] = byte;
+          }
+          continue;
+        }
+        line[lineLength] = '\0';
+        lineLength = 0;
+        if (strcmp(line, "READY_TO_CONNECT") == 0) {
+          Serial1.hostFeed("NANO_CONNECTED\n");
+          connected = true;
+        } else {
+          linesReceived++;
+        }
+      }
+    }
+
+    void sendReadings(uint8_t type, uint8_t device, const SensorReadings& readings) {
+      send(writer.finish(type, packSensorReadings(readings, writer.payload()), device));
+    }
+
+    // A frame with a payload packed elsewhere, e.g. replayed from a trace (at most FRAME_MAX_PAYLOAD bytes)
+    void sendPayload(uint8_t type, uint8_t device, const uint8_t* payload, size_t payloadLength) {
+      memcpy(writer.payload(), payload, payloadLength);
+      send(writer.finish(type, payloadLength, device));
+    }
+
+    bool connected = false;
+    unsigned long framesSent = 0;
+    unsigned long bytesSent = 0;
+    unsigned long linesReceived = 0; // commands from the hub other than the handshake
+
+  private:
+    void send(size_t length) {
+      Serial1.hostFeed(writer.data(), length);
+      framesSent++;
+      bytesSent += length;
+    }
+
+    FrameWriter writer;
+    char line[64];
+    size_t lineLength = 0;
+};
+
+// Readings that drift the way a pond's do, different for each device
+inline SensorReadings driftingReadings(uint8_t device, unsigned long step) {
+  SensorReadings readings;
+  float phase = step * 0.05f + device;
+  readings.set(SENSOR_TEMPERATURE, 50 + 3 * sinf(phase));
+  readings.set(SENSOR_WATER_LEVEL, 8 + 0.5f * cosf(phase));
+  readings.set(SENSOR_TURBIDITY, 1200 + 400 * sinf(phase * 0.7f));
+  readings.set(SENSOR_TURBIDITY_VOLTAGE, 2.1f + 0.2f * sinf(phase * 0.7f));
+  readings.set(SENSOR_TOTAL_DISSOLVED_SOLIDS, 180 + 40 * cosf(phase * 0.3f));
+  readings.set(SENSOR_PH, 7 + 0.4f * sinf(phase * 0.2f));
+  return readings;
+}
+
+#endif // NANO_LINK_H
@@ -0,0 +1,105 @@
+/*
+  Nano 33 IoT Central Hub: loop() with three monitors notifying their sensor packets.
+
+  Each simulated monitor has the packed sensor characteristic (and the single value ones, for the full
+  discovery) and notifies a snapshot every second once the Nano subscribes. The MKR end of Serial1
+  starts the handshake and asks for the status every 30 seconds; everything the Nano forwards is read
+  back off the UART.
+*/
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+#include "bench_report.h"
+#include "nano_link.h"
+#include "sensor_packet.h"
+#include "monitor_ids.h"
+
+extern LoopProfiler profiler;
+
+#define NOTIFY_INTERVAL_MS 1000
+#define STATUS_INTERVAL_MS 30000
+#define NUM_MONITORS 3
+
+static const char* const monitorNames[NUM_MONITORS] = HOST_MONITOR_NAMES;
+static const char* const monitorAddresses[NUM_MONITORS] = { "a4:cf:12:00:00:01", "a4:cf:12:00:00:02", "a4:cf:12:00:00:03" };
+static const char* const characteristicUuids[] = {
+  HOST_TEMPERATURE_UUID, HOST_TOTAL_DISSOLVED_SOLIDS_UUID, HOST_TURBIDITY_VALUE_UUID,
+  HOST_TURBIDITY_VOLTAGE_UUID, HOST_WATER_LEVEL_UUID, HOST_PH_UUID
+};
+
+static int monitors[NUM_MONITORS];
+static uint16_t sequences[NUM_MONITORS];
+static unsigned long duration;
+static unsigned long nextNotify = 0;
+static unsigned long nextStatus = 0;
+static unsigned long step = 0;
+static unsigned long notificationsSent = 0;
+static unsigned long framesReceived = 0;
+static FrameReader mkrReader;
+static bool handshakeDone = false; // the Nano's NANO_CONNECTED line has been read, frames follow
+
+void hostScenarioBegin(int argc, char** argv) {
+  duration = benchBegin(argc, argv);
+  for (size_t i = 0; i < NUM_MONITORS; i++) {
+    monitors[i] = hostBleAddPeripheral(monitorAddresses[i], monitorNames[i], HOST_SENSOR_DATA_SERVICE_UUID, -55 - 5 * (int)i);
+    hostBleAddCharacteristic(monitors[i], HOST_SENSOR_PACKET_UUID, BLERead | BLENotify);
+    for (const char* uuid : characteristicUuids) {
+      hostBleAddCharacteristic(monitors[i], uuid, BLERead | BLENotify);
+    }
+    hostBleAddCharacteristic(monitors[i], HOST_PH_CALIBRATION_UUID, BLERead | BLEWrite);
+    hostBleSetAdvertising(monitors[i], true);
+  }
+  Serial1.hostFeed("READY_TO_CONNECT\n");
+}
+
+void hostScenarioPoll() {
+  // The MKR's end: read the frames the Nano forwards
+  uint8_t byte;
+  while (Serial1.hostDrain(&byte, 1) == 1) {
+    if (!handshakeDone) {
+      handshakeDone = byte == '\n';
+    } else if (mkrReader.feed(byte)) {
+      framesReceived++;
+    }
+  }
+
+  unsigned long now = millis();
+  if (now >= nextStatus) {
+    nextStatus = now + STATUS_INTERVAL_MS;
+    if (now > 0) {
+      Serial1.hostFeed("STATUS\n");
+    }
+  }
+  if (now < nextNotify) {
+    return;
+  }
+  nextNotify = now + NOTIFY_INTERVAL_MS;
+  step++;
+  for (size_t i = 0; i < NUM_MONITORS; i++) {
+    SensorPacket packet;
+    packet.sequence = sequences[i];
+    packet.timestamp = now;
+    packet.readAge = 120;
+    packet.readings = driftingReadings(i, step);
+    uint8_t packed[SENSOR_PACKET_SIZE];
+    if (hostBleNotify(monitors[i], HOST_SENSOR_PACKET_UUID, packed, packSensorPacket(packet, packed))) {
+      sequences[i]++;
+      notificationsSent++;
+    }
+  }
+}
+
+bool hostScenarioStep() {
+  return millis() < duration;
+}
+
+int hostScenarioEnd() {
+  printBenchReport("Nano 33 IoT Central Hub: loop()", profiler);
+  printBenchMemory(memoryMonitor);
+  unsigned long lost = 0;
+  for (size_t i = 0; i < NUM_MONITORS; i++) {
+    lost += hostBleFindCharacteristic(monitors[i], HOST_SENSOR_PACKET_UUID)->notificationsLost;
+  }
+  printf("BLE notifications: %lu sent, %lu lost\n", notificationsSent, lost);
+  printf("frames to the MKR: %lu, %lu CRC errors, %lu UART bytes\n", framesReceived, mkrReader.crcErrors, Serial1.bytesWritten);
+  return notificationsSent > 0 && framesReceived > 0 && lost == 0 ? 0 : 1;
+}
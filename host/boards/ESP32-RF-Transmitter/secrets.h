@@ -0,0 +1,12 @@
+#ifndef SECRETS_H
+#define SECRETS_H
+
+/* secrets.h for the host build: the simulated database and Wi-Fi network (see host/hal/FirebaseESP32.h) */
+
+#define SECRET_DATABASE_URL "pond-host.firebaseio.com"
+#define SECRET_DATABASE_SECRET "host-database-secret"
+
+#define SECRET_SSID "host"
+#define SECRET_PASS "host"
+
+#endif // SECRETS_H
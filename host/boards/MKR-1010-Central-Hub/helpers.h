@@ -0,0 +1,6 @@
+#ifndef HELPERS_H
+#define HELPERS_H
+
+/* helpers.h is kept out of the repository with the secrets; the host build needs nothing from it */
+
+#endif // HELPERS_H
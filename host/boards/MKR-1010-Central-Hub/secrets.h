@@ -0,0 +1,17 @@
+#ifndef SECRETS_H
+#define SECRETS_H
+
+/* secrets.h for the host build: the simulated database host and network (see host/hal/SSLClient.h) */
+
+#define SECRET_DATABASE_URL "pond-host.firebaseio.com"
+#define SECRET_DATABASE_SECRET "host-database-secret"
+
+#define SECRET_SSID "host"
+#define SECRET_PASS "host"
+
+#define SECRET_ETH_SHIELD_MAC {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED}
+#define SECRET_MKR_1010_IP 192, 168, 1, 177
+#define SECRET_DNS_GATEWAY 192, 168, 1, 1
+#define SECRET_LOCAL_PORT 2390
+
+#endif // SECRETS_H
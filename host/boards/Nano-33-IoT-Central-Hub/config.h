@@ -0,0 +1,21 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/* config.h for the host build: the names and UUIDs the simulated monitors use (see ../monitor_ids.h) */
+
+#include "../monitor_ids.h"
+
+const char* peripheralName = HOST_MONITOR_NAME;
+const char* const peripheralNames[] = HOST_MONITOR_NAMES;
+const char* sensorDataServiceUuid = HOST_SENSOR_DATA_SERVICE_UUID;
+const char* temperatureCharacteristicUuid = HOST_TEMPERATURE_UUID;
+const char* totalDissolvedSolidsCharacteristicUuid = HOST_TOTAL_DISSOLVED_SOLIDS_UUID;
+const char* turbidityValueCharacteristicUuid = HOST_TURBIDITY_VALUE_UUID;
+const char* turbidityVoltageCharacteristicUuid = HOST_TURBIDITY_VOLTAGE_UUID;
+const char* waterLevelCharacteristicUuid = HOST_WATER_LEVEL_UUID;
+const char* pHCharacteristicUuid = HOST_PH_UUID;
+const char* sensorPacketCharacteristicUuid = HOST_SENSOR_PACKET_UUID;
+const char* powerReportCharacteristicUuid = HOST_POWER_REPORT_UUID;
+const char* pHCalibrationCharacteristicUuid = HOST_PH_CALIBRATION_UUID;
+
+#endif // CONFIG_H
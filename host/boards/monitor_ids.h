@@ -0,0 +1,23 @@
+#ifndef MONITOR_IDS_H
+#define MONITOR_IDS_H
+
+/*
+  The names and UUIDs of the monitors in the host build, shared by the Nano's and the monitor's config.h
+  and the scenarios that simulate either end of the BLE link. Every UUID is in the sensor data service.
+*/
+
+#define HOST_MONITOR_NAME "PondMonitor"
+#define HOST_MONITOR_NAMES { "PondMonitor", "PondMonitor2", "PondMonitor3" }
+
+#define HOST_SENSOR_DATA_SERVICE_UUID       "a0e1b2c3-0000-4a5b-8c9d-000000000000"
+#define HOST_TEMPERATURE_UUID               "a0e1b2c3-0001-4a5b-8c9d-000000000000"
+#define HOST_TOTAL_DISSOLVED_SOLIDS_UUID    "a0e1b2c3-0002-4a5b-8c9d-000000000000"
+#define HOST_TURBIDITY_VALUE_UUID           "a0e1b2c3-0003-4a5b-8c9d-000000000000"
+#define HOST_TURBIDITY_VOLTAGE_UUID         "a0e1b2c3-0004-4a5b-8c9d-000000000000"
+#define HOST_WATER_LEVEL_UUID               "a0e1b2c3-0005-4a5b-8c9d-000000000000"
+#define HOST_PH_UUID                        "a0e1b2c3-0006-4a5b-8c9d-000000000000"
+#define HOST_SENSOR_PACKET_UUID             "a0e1b2c3-0007-4a5b-8c9d-000000000000"
+#define HOST_POWER_REPORT_UUID              "a0e1b2c3-0008-4a5b-8c9d-000000000000"
+#define HOST_PH_CALIBRATION_UUID            "a0e1b2c3-0009-4a5b-8c9d-000000000000"
+
+#endif // MONITOR_IDS_H
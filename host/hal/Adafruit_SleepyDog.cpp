@@ -0,0 +1,42 @@
+#include <Adafruit_SleepyDog.h>
+#include "host_sim.h"
+
+WatchdogHost Watchdog;
+
+int WatchdogHost::enable(int maxPeriodMS, bool isForSleep) {
+  period = maxPeriodMS > 0 ? maxPeriodMS : 16000;
+  lastReset = millis();
+  return period;
+}
+
+void WatchdogHost::reset() {
+  if (period == 0) {
+    return;
+  }
+  unsigned long now = millis();
+  unsigned long gap = now - lastReset;
+  if (gap > longestGap) {
+    longestGap = gap;
+  }
+  if (gap > period) {
+    expiries++;
+  }
+  lastReset = now;
+}
+
+void WatchdogHost::disable() {
+  period = 0;
+}
+
+int WatchdogHost::sleep(int maxPeriodMS) {
+  delay(maxPeriodMS);
+  return maxPeriodMS;
+}
+
+unsigned long hostWatchdogLongestGap() {
+  return Watchdog.longestGap;
+}
+
+unsigned long hostWatchdogExpiries() {
+  return Watchdog.expiries;
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_ADAFRUIT_SLEEPY_DOG_H
+#define HOST_ADAFRUIT_SLEEPY_DOG_H
+
+#include <Arduino.h>
+
+/**
+ * The watchdog doesn't reset the simulated board; it records the longest gap between resets and
+ * how many times that gap was longer than the timeout, i.e. when the board would have restarted
+ * (hostWatchdogLongestGap()/hostWatchdogExpiries() in host_sim.h).
+ */
+class WatchdogHost {
+  public:
+    int enable(int maxPeriodMS = 0, bool isForSleep = false);
+    void reset();
+    void disable();
+    int sleep(int maxPeriodMS = 0);
+
+    unsigned long longestGap = 0;
+    unsigned long expiries = 0;
+
+  private:
+    unsigned long period = 0;
+    unsigned long lastReset = 0;
+};
+
+extern WatchdogHost Watchdog;
+
+#endif // HOST_ADAFRUIT_SLEEPY_DOG_H
@@ -0,0 +1,334 @@
+#include <Arduino.h>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <malloc.h>
+#include "host_sim.h"
+
+void setup();
+void loop();
+
+static std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+static std::atomic<unsigned long long> skippedMicros(0);
+static unsigned long loopStepMicros = 0;
+
+#define HOST_MAX_PUMP_HANDLERS 16
+static HostPumpHandler pumpHandlers[HOST_MAX_PUMP_HANDLERS];
+static int numPumpHandlers = 0;
+static std::recursive_mutex pumpMutex;
+static thread_local bool pumping = false;
+
+struct HostPin {
+  uint8_t mode = INPUT;
+  int output = LOW;
+  int input = HIGH;
+  uint16_t analog = 0;
+  uint16_t noise = 0;
+};
+static HostPin pins[NUM_HOST_PINS];
+static int analogResolution = 10;
+static unsigned long analogReads = 0;
+
+static size_t baselineHeap = 0;
+static char* stackTop = nullptr;
+
+__attribute__((weak)) void hostScenarioPoll() {
+}
+
+__attribute__((weak)) void hostStopTasks() {
+}
+
+// ---- Clock ----
+
+unsigned long long hostNowMicros() {
+  auto elapsed = std::chrono::steady_clock::now() - clockStart;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + skippedMicros.load();
+}
+
+void hostAdvanceMicros(unsigned long long us) {
+  skippedMicros += us;
+}
+
+void hostAdvanceMillis(unsigned long ms) {
+  skippedMicros += (unsigned long long)ms * 1000;
+}
+
+unsigned long long hostSkippedMicros() {
+  return skippedMicros.load();
+}
+
+void hostSetLoopStep(unsigned long us) {
+  loopStepMicros = us;
+}
+
+unsigned long hostLoopStep() {
+  return loopStepMicros;
+}
+
+// Not masked to 32 bits: unsigned long is 64 bits on the host, and a wrap would look like a huge interval
+unsigned long millis() {
+  return hostNowMicros() / 1000;
+}
+
+unsigned long micros() {
+  return hostNowMicros();
+}
+
+/**
+ * Skip `ms` of simulated time, a millisecond at a time so the events due in between are delivered in order.
+ */
+void delay(unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    hostAdvanceMicros(1000);
+    hostPump();
+  }
+  hostPump();
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvanceMicros(us);
+}
+
+/**
+ * Called by busy-wait loops: skips a millisecond so they finish without spinning in real time.
+ */
+void yield() {
+  hostAdvanceMicros(1000);
+  hostPump();
+}
+
+// ---- Pump ----
+
+void hostAddPumpHandler(HostPumpHandler handler) {
+  if (numPumpHandlers < HOST_MAX_PUMP_HANDLERS) {
+    pumpHandlers[numPumpHandlers++] = handler;
+  }
+}
+
+void hostPump() {
+  if (pumping) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> lock(pumpMutex);
+  pumping = true;
+  Serial.hostDeliver();
+  Serial1.hostDeliver();
+  for (int i = 0; i < numPumpHandlers; i++) {
+    pumpHandlers[i]();
+  }
+  hostScenarioPoll();
+  pumping = false;
+}
+
+// ---- Pins ----
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NUM_HOST_PINS) {
+    pins[pin].mode = mode;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < NUM_HOST_PINS) {
+    pins[pin].output = value;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < NUM_HOST_PINS ? pins[pin].input : LOW;
+}
+
+/**
+ * The pin's simulated level (hostSetAnalog()) at the current resolution. Costs the time the SAMD21's ADC takes.
+ */
+int analogRead(uint8_t pin) {
+  hostAdvanceMicros(HOST_ANALOG_READ_MICROS);
+  analogReads++;
+  long counts = hostAnalogSample(pin);
+  return analogResolution >= 12 ? counts << (analogResolution - 12) : counts >> (12 - analogResolution);
+}
+
+uint16_t hostAnalogSample(uint8_t pin) {
+  if (pin >= NUM_HOST_PINS) {
+    return 0;
+  }
+  long counts = pins[pin].analog;
+  if (pins[pin].noise > 0) {
+    counts += random(-(long)pins[pin].noise, (long)pins[pin].noise + 1);
+  }
+  return constrain(counts, 0L, 4095L);
+}
+
+void analogWrite(uint8_t pin, int value) {
+  digitalWrite(pin, value);
+}
+
+void analogReadResolution(int bits) {
+  analogResolution = bits;
+}
+
+void hostSetAnalog(uint8_t pin, uint16_t counts12, uint16_t noise) {
+  if (pin < NUM_HOST_PINS) {
+    pins[pin].analog = counts12;
+    pins[pin].noise = noise;
+  }
+}
+
+void hostSetDigitalInput(uint8_t pin, int level) {
+  if (pin < NUM_HOST_PINS) {
+    pins[pin].input = level;
+  }
+}
+
+int hostDigitalOutput(uint8_t pin) {
+  return pin < NUM_HOST_PINS ? pins[pin].output : LOW;
+}
+
+unsigned long hostAnalogReads() {
+  return analogReads;
+}
+
+// ---- Maths ----
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh) {
+  return (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow) + toLow;
+}
+
+uint16_t makeWord(uint16_t w) {
+  return w;
+}
+
+uint16_t makeWord(uint8_t h, uint8_t l) {
+  return (h << 8) | l;
+}
+
+char* dtostrf(double value, signed char width, unsigned char precision, char* out) {
+  sprintf(out, "%*.*f", width, precision, value);
+  return out;
+}
+
+long random(long max) {
+  return max <= 0 ? 0 : rand() % max;
+}
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    srand(seed);
+  }
+}
+
+// ---- Memory ----
+
+size_t hostHeapInUse() {
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks > baselineHeap ? info.uordblks - baselineHeap : 0;
+}
+
+size_t hostHeapFree() {
+  return mallinfo2().fordblks;
+}
+
+size_t hostHeapFreeBlocks() {
+  return mallinfo2().ordblks;
+}
+
+char* hostStackTop() {
+  return stackTop;
+}
+
+int hostFreeRam() {
+  char marker;
+  long stackDepth = stackTop != nullptr ? stackTop - &marker : 0;
+  return HOST_RAM_SIZE - (long)hostHeapInUse() - stackDepth;
+}
+
+// The board cores route new/delete to malloc/free; doing the same here lets the wrapped malloc count them
+void* operator new(size_t size) {
+  void* p = malloc(size);
+  if (p == nullptr) {
+    abort();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+// ---- Board ----
+
+void hostSystemReset() {
+  fflush(stdout);
+  fprintf(stderr, "[host] board reset at %lu ms\n", millis());
+  exit(HOST_EXIT_RESET);
+}
+
+void NVIC_SystemReset() {
+  hostSystemReset();
+}
+
+// ---- Command line ----
+
+const char* hostArg(int argc, char** argv, const char* name, const char* fallback) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) {
+      return argv[i + 1];
+    }
+  }
+  return fallback;
+}
+
+long hostArgLong(int argc, char** argv, const char* name, long fallback) {
+  const char* value = hostArg(argc, argv, name, nullptr);
+  return value != nullptr ? strtol(value, nullptr, 0) : fallback;
+}
+
+bool hostArgFlag(int argc, char** argv, const char* name) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  char marker;
+  stackTop = &marker;
+  if (getenv("HOST_SERIAL_ECHO") != nullptr) {
+    Serial.hostEcho(stdout);
+  }
+  hostScenarioBegin(argc, argv);
+  baselineHeap = mallinfo2().uordblks;
+
+  setup();
+  do {
+    loop();
+    hostAdvanceMicros(loopStepMicros);
+    hostPump();
+  } while (hostScenarioStep());
+
+  hostStopTasks();
+  fflush(stdout);
+  return hostScenarioEnd();
+}
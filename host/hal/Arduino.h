@@ -0,0 +1,137 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+  Simulated Arduino core for building the sketches and PondLibrary on a PC (see host/README.md).
+
+  Only what the sketches use is here, with the same signatures as the board cores. Time is simulated:
+  millis()/micros() are the real time since start plus every delay()/yield() skipped over, so a sketch
+  can run hours of traffic in seconds while its loop() passes are still timed with the real CPU time
+  they take on the host. Hardware the sketches talk to (the UARTs, analog pins, BLE, Ethernet, the
+  Firebase server) is modelled in host_sim.h, which benches and tests use to drive a sketch.
+
+  Nothing here allocates after setup() unless the sketch does (String), so the malloc counters of the
+  memory monitor mean the same as on the board.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+#ifndef ARDUINO_ARCH_HOST
+#define ARDUINO_ARCH_HOST
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef unsigned int word;
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define INPUT_PULLDOWN 0x3
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LED_BUILTIN 13
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define NUM_HOST_PINS 32
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+// Same mixed type min()/max() as ArduinoCore-API, e.g. min(unsigned long, int)
+template<class T, class L>
+auto min(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (b < a) ? b : a;
+}
+
+template<class T, class L>
+auto max(const T& a, const L& b) -> decltype((b < a) ? b : a) {
+  return (a < b) ? b : a;
+}
+
+template<class T, class L, class H>
+T constrain(const T& value, const L& low, const H& high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+#define sq(x) ((x) * (x))
+
+long map(long value, long fromLow, long fromHigh, long toLow, long toHigh);
+
+uint16_t makeWord(uint16_t w);
+uint16_t makeWord(uint8_t h, uint8_t l);
+#define word(...) makeWord(__VA_ARGS__)
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+// Timing (simulated clock, see host_sim.h)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// Interrupts are delivered from the simulation's pump on the sketch's own thread, so there is nothing to mask
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+// Pins (simulated, see host_sim.h)
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void analogReadResolution(int bits);
+
+// avr/dtostrf.h, which the SAMD core includes from Arduino.h
+char* dtostrf(double value, signed char width, unsigned char precision, char* out);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Resets the simulated board, which ends the run (see hostSystemReset() in host_sim.h)
+void NVIC_SystemReset();
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+#include "Client.h"
+#include "Server.h"
+
+#if defined(ESP32)
+#include "esp32_host.h"
+#endif
+
+#endif // HOST_ARDUINO_H
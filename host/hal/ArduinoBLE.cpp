@@ -0,0 +1,431 @@
+#include <ArduinoBLE.h>
+#include "host_sim.h"
+
+#define HOST_BLE_CENTRAL 1000 // BLEDevice index of the central connected to a peripheral sketch
+
+BLELocalDevice BLE;
+
+struct HostBlePeripheral {
+  char address[18];
+  char localName[32];
+  char serviceUuid[HOST_BLE_UUID_SIZE];
+  int rssi;
+  bool advertising;
+  unsigned long advertisingSince;
+  bool connected;
+  bool discovered; // attributes discovered on the current connection
+  bool reported;   // returned by BLE.available() in the current scan
+  unsigned long connections;
+  HostBleAttribute characteristics[HOST_BLE_MAX_CHARACTERISTICS];
+  int characteristicCount;
+};
+
+static HostBlePeripheral peripherals[HOST_BLE_MAX_PERIPHERALS];
+static int peripheralCount = 0;
+static bool scanning = false;
+static unsigned long scanStart = 0;
+static char scanName[32] = "";    // scanForName() filter, empty for none
+static char scanAddress[18] = ""; // scanForAddress() filter, empty for none
+
+static HostBleAttribute localAttributes[HOST_BLE_MAX_CHARACTERISTICS];
+static int localCount = 0;
+static char localName[32] = "";
+static bool localAdvertising = false;
+static bool centralConnected = false;
+static char centralAddress[18] = "";
+
+static void copyUuid(char* destination, const char* uuid) {
+  strncpy(destination, uuid != nullptr ? uuid : "", HOST_BLE_UUID_SIZE - 1);
+  destination[HOST_BLE_UUID_SIZE - 1] = '\0';
+}
+
+static HostBlePeripheral* peripheralAt(int index) {
+  return index >= 0 && index < peripheralCount ? &peripherals[index] : nullptr;
+}
+
+// ---- Device ----
+
+String BLEDevice::address() const {
+  if (index == HOST_BLE_CENTRAL) {
+    return String(centralAddress);
+  }
+  HostBlePeripheral* p = peripheralAt(index);
+  return String(p != nullptr ? p->address : "00:00:00:00:00:00");
+}
+
+bool BLEDevice::hasLocalName() const {
+  HostBlePeripheral* p = peripheralAt(index);
+  return p != nullptr && p->localName[0] != '\0';
+}
+
+String BLEDevice::localName() const {
+  HostBlePeripheral* p = peripheralAt(index);
+  return String(p != nullptr ? p->localName : "");
+}
+
+String BLEDevice::advertisedServiceUuid() const {
+  HostBlePeripheral* p = peripheralAt(index);
+  return String(p != nullptr ? p->serviceUuid : "");
+}
+
+int BLEDevice::advertisementDataLength() const {
+  HostBlePeripheral* p = peripheralAt(index);
+  return p != nullptr && p->localName[0] != '\0' ? 2 + strlen(p->localName) : 0;
+}
+
+int BLEDevice::advertisementData(uint8_t value[], int length) const {
+  HostBlePeripheral* p = peripheralAt(index);
+  int dataLength = min(advertisementDataLength(), length);
+  if (dataLength < 2) {
+    return 0;
+  }
+  value[0] = strlen(p->localName) + 1;
+  value[1] = 0x09; // complete local name
+  memcpy(value + 2, p->localName, dataLength - 2);
+  return dataLength;
+}
+
+int BLEDevice::rssi() {
+  HostBlePeripheral* p = peripheralAt(index);
+  return p != nullptr ? p->rssi : 0;
+}
+
+bool BLEDevice::connect() {
+  HostBlePeripheral* p = peripheralAt(index);
+  delay(HOST_BLE_CONNECT_MS);
+  if (p == nullptr || !p->advertising || p->connected) {
+    return false;
+  }
+  p->connected = true;
+  p->advertising = false;
+  p->discovered = false;
+  p->connections++;
+  for (int i = 0; i < p->characteristicCount; i++) {
+    p->characteristics[i].subscribed = false;
+    p->characteristics[i].updatePending = false;
+  }
+  return true;
+}
+
+bool BLEDevice::disconnect() {
+  if (index == HOST_BLE_CENTRAL) {
+    hostBleDisconnectCentral();
+    return true;
+  }
+  hostBleDropConnection(index);
+  return true;
+}
+
+bool BLEDevice::connected() const {
+  if (index == HOST_BLE_CENTRAL) {
+    return centralConnected;
+  }
+  HostBlePeripheral* p = peripheralAt(index);
+  return p != nullptr && p->connected;
+}
+
+bool BLEDevice::discoverAttributes() {
+  HostBlePeripheral* p = peripheralAt(index);
+  delay(HOST_BLE_DISCOVER_ATTRIBUTES_MS);
+  if (p == nullptr || !p->connected) {
+    return false;
+  }
+  p->discovered = true;
+  return true;
+}
+
+bool BLEDevice::discoverService(const char* uuid) {
+  HostBlePeripheral* p = peripheralAt(index);
+  delay(HOST_BLE_DISCOVER_SERVICE_MS);
+  if (p == nullptr || !p->connected || strcasecmp(p->serviceUuid, uuid) != 0) {
+    return false;
+  }
+  p->discovered = true;
+  return true;
+}
+
+BLECharacteristic BLEDevice::characteristic(const char* uuid) const {
+  HostBlePeripheral* p = peripheralAt(index);
+  if (p == nullptr || !p->discovered) {
+    return BLECharacteristic();
+  }
+  return BLECharacteristic(hostBleFindCharacteristic(index, uuid), index);
+}
+
+// ---- Characteristic ----
+
+BLECharacteristic::BLECharacteristic(const char* uuid, uint8_t properties, int valueSize, bool fixedLength)
+  : attribute(nullptr), device(-1) {
+  if (localCount < HOST_BLE_MAX_CHARACTERISTICS) {
+    attribute = &localAttributes[localCount++];
+    copyUuid(attribute->uuid, uuid);
+    attribute->properties = properties;
+    attribute->valueSize = min(valueSize, HOST_BLE_VALUE_SIZE);
+  }
+}
+
+/**
+ * A local characteristic: set the value, notified if a central is connected. A remote one: write it to the peripheral.
+ */
+int BLECharacteristic::writeValue(const uint8_t* value, int length) {
+  if (attribute == nullptr || length > HOST_BLE_VALUE_SIZE) {
+    return 0;
+  }
+  if (device >= 0) {
+    HostBlePeripheral* p = peripheralAt(device);
+    if ((attribute->properties & (BLEWrite | BLEWriteWithoutResponse)) == 0) {
+      return 0;
+    }
+    if (attribute->properties & BLEWrite) {
+      delay(HOST_BLE_WRITE_MS); // waits for the write response
+    }
+    if (p == nullptr || !p->connected) {
+      return 0;
+    }
+    attribute->writes++;
+  } else if (centralConnected && (attribute->properties & (BLENotify | BLEIndicate))) {
+    attribute->notifications++;
+  }
+  memcpy(attribute->value, value, length);
+  attribute->valueLength = length;
+  return 1;
+}
+
+bool BLECharacteristic::subscribe() {
+  HostBlePeripheral* p = peripheralAt(device);
+  if (attribute == nullptr || p == nullptr || !p->connected || !canSubscribe()) {
+    return false;
+  }
+  delay(HOST_BLE_WRITE_MS); // writing the CCCD
+  attribute->subscribed = true;
+  return true;
+}
+
+void BLECharacteristic::setEventHandler(int event, BLECharacteristicEventHandler handler) {
+  if (attribute != nullptr && event == BLEUpdated) {
+    attribute->updatedHandler = handler;
+  }
+}
+
+// ---- Local device ----
+
+int BLELocalDevice::begin() {
+  return 1;
+}
+
+/**
+ * Deliver the notifications that arrived since the last poll to the subscribed characteristics' handlers.
+ */
+void BLELocalDevice::poll(unsigned long timeout) {
+  hostPump();
+  for (int i = 0; i < peripheralCount; i++) {
+    HostBlePeripheral& p = peripherals[i];
+    for (int j = 0; j < p.characteristicCount && p.connected; j++) {
+      HostBleAttribute& attribute = p.characteristics[j];
+      if (!attribute.updatePending) {
+        continue;
+      }
+      attribute.updatePending = false;
+      attribute.notifications++;
+      if (attribute.updatedHandler != nullptr) {
+        attribute.updatedHandler(BLEDevice(i), BLECharacteristic(&attribute, i));
+      }
+    }
+  }
+}
+
+int BLELocalDevice::scan(bool withDuplicates) {
+  scanName[0] = '\0';
+  scanAddress[0] = '\0';
+  scanning = true;
+  scanStart = millis();
+  for (int i = 0; i < peripheralCount; i++) {
+    peripherals[i].reported = false;
+  }
+  return 1;
+}
+
+int BLELocalDevice::scanForName(const char* name, bool withDuplicates) {
+  scan(withDuplicates);
+  strncpy(scanName, name, sizeof(scanName) - 1);
+  return 1;
+}
+
+int BLELocalDevice::scanForAddress(const char* address, bool withDuplicates) {
+  scan(withDuplicates);
+  strncpy(scanAddress, address, sizeof(scanAddress) - 1);
+  return 1;
+}
+
+void BLELocalDevice::stopScan() {
+  scanning = false;
+}
+
+/**
+ * The next advertising peripheral heard since scan(), each one once per scan, that matches the
+ * scanForName()/scanForAddress() filter if there is one.
+ */
+BLEDevice BLELocalDevice::available() {
+  hostPump();
+  if (!scanning) {
+    return BLEDevice();
+  }
+  unsigned long now = millis();
+  for (int i = 0; i < peripheralCount; i++) {
+    HostBlePeripheral& p = peripherals[i];
+    unsigned long heardFrom = max(scanStart, p.advertisingSince);
+    bool filtered = (scanName[0] != '\0' && strcmp(p.localName, scanName) != 0) ||
+                    (scanAddress[0] != '\0' && strcasecmp(p.address, scanAddress) != 0);
+    if (p.advertising && !p.connected && !p.reported && !filtered &&
+        now - heardFrom >= HOST_BLE_ADVERTISING_INTERVAL_MS) {
+      p.reported = true;
+      return BLEDevice(i);
+    }
+  }
+  return BLEDevice();
+}
+
+bool BLELocalDevice::setLocalName(const char* name) {
+  strncpy(localName, name, sizeof(localName) - 1);
+  return true;
+}
+
+bool BLELocalDevice::setAdvertisedService(const BLEService& service) {
+  return true;
+}
+
+int BLELocalDevice::advertise() {
+  localAdvertising = true;
+  return 1;
+}
+
+void BLELocalDevice::stopAdvertise() {
+  localAdvertising = false;
+}
+
+bool BLELocalDevice::advertising() {
+  return localAdvertising;
+}
+
+BLEDevice BLELocalDevice::central() {
+  hostPump();
+  return centralConnected ? BLEDevice(HOST_BLE_CENTRAL) : BLEDevice();
+}
+
+void BLELocalDevice::setConnectionInterval(uint16_t minimum, uint16_t maximum) {
+  connectionIntervalMin = minimum;
+  connectionIntervalMax = maximum;
+}
+
+// ---- Simulation side ----
+
+int hostBleAddPeripheral(const char* address, const char* name, const char* serviceUuid, int rssi) {
+  if (peripheralCount == HOST_BLE_MAX_PERIPHERALS) {
+    return -1;
+  }
+  HostBlePeripheral& p = peripherals[peripheralCount];
+  memset(&p, 0, sizeof(p));
+  strncpy(p.address, address, sizeof(p.address) - 1);
+  strncpy(p.localName, name, sizeof(p.localName) - 1);
+  copyUuid(p.serviceUuid, serviceUuid);
+  p.rssi = rssi;
+  p.advertising = true;
+  p.advertisingSince = millis();
+  return peripheralCount++;
+}
+
+HostBleAttribute* hostBleAddCharacteristic(int peripheral, const char* uuid, uint8_t properties) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  if (p == nullptr || p->characteristicCount == HOST_BLE_MAX_CHARACTERISTICS) {
+    return nullptr;
+  }
+  HostBleAttribute& attribute = p->characteristics[p->characteristicCount++];
+  copyUuid(attribute.uuid, uuid);
+  attribute.properties = properties;
+  attribute.valueSize = HOST_BLE_VALUE_SIZE;
+  return &attribute;
+}
+
+HostBleAttribute* hostBleFindCharacteristic(int peripheral, const char* uuid) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  for (int i = 0; p != nullptr && i < p->characteristicCount; i++) {
+    if (strcasecmp(p->characteristics[i].uuid, uuid) == 0) {
+      return &p->characteristics[i];
+    }
+  }
+  return nullptr;
+}
+
+bool hostBleNotify(int peripheral, const char* uuid, const uint8_t* value, size_t length) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  HostBleAttribute* attribute = hostBleFindCharacteristic(peripheral, uuid);
+  if (attribute == nullptr || length > HOST_BLE_VALUE_SIZE) {
+    return false;
+  }
+  memcpy(attribute->value, value, length);
+  attribute->valueLength = length;
+  if (!p->connected || !attribute->subscribed) {
+    return false;
+  }
+  if (attribute->updatePending) {
+    attribute->notificationsLost++;
+  }
+  attribute->updatePending = true;
+  return true;
+}
+
+void hostBleSetAdvertising(int peripheral, bool advertising) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  if (p != nullptr && p->advertising != advertising) {
+    p->advertising = advertising;
+    p->advertisingSince = millis();
+    p->reported = false;
+  }
+}
+
+void hostBleDropConnection(int peripheral) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  if (p != nullptr && p->connected) {
+    p->connected = false;
+    p->discovered = false;
+    // a monitor advertises again as soon as its central is gone
+    hostBleSetAdvertising(peripheral, true);
+  }
+}
+
+bool hostBlePeripheralConnected(int peripheral) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  return p != nullptr && p->connected;
+}
+
+unsigned long hostBleConnections(int peripheral) {
+  HostBlePeripheral* p = peripheralAt(peripheral);
+  return p != nullptr ? p->connections : 0;
+}
+
+bool hostBleConnectCentral(const char* address) {
+  if (!localAdvertising || centralConnected) {
+    return false;
+  }
+  strncpy(centralAddress, address, sizeof(centralAddress) - 1);
+  centralConnected = true;
+  localAdvertising = false; // ArduinoBLE stops advertising once connected
+  return true;
+}
+
+void hostBleDisconnectCentral() {
+  centralConnected = false;
+}
+
+HostBleAttribute* hostBleLocal(const char* uuid) {
+  for (int i = 0; i < localCount; i++) {
+    if (strcasecmp(localAttributes[i].uuid, uuid) == 0) {
+      return &localAttributes[i];
+    }
+  }
+  return nullptr;
+}
+
+const char* hostBleLocalName() {
+  return localName;
+}
@@ -0,0 +1,197 @@
+#ifndef HOST_ARDUINO_BLE_H
+#define HOST_ARDUINO_BLE_H
+
+#include <Arduino.h>
+
+/*
+  ArduinoBLE for both roles the sketches take, with the other end of the radio simulated.
+
+  Central (the Nano): the monitors it talks to are simulated peripherals the test side adds with
+  hostBleAddPeripheral()/hostBleAddCharacteristic(). They show up in a scan once they have been
+  advertising for HOST_BLE_ADVERTISING_INTERVAL_MS, connecting and discovery take the simulated time
+  the real stack does, and hostBleNotify() changes a characteristic's value; the notification reaches
+  the subscribed event handler on the sketch's next BLE.poll(). A notification not delivered before
+  the next one overwrites it and is counted as lost, like a full HCI buffer on the board.
+
+  Peripheral (the monitor): the sketch's characteristics live in a fixed table the test side reads
+  back with hostBleLocal*(), and a simulated central connects with hostBleConnectCentral(). While it
+  is connected every write to a notifying characteristic counts as a notification sent.
+
+  Nothing here allocates.
+*/
+
+#define HOST_BLE_MAX_PERIPHERALS 4
+#define HOST_BLE_MAX_CHARACTERISTICS 24 // per simulated peripheral, and local ones
+#define HOST_BLE_VALUE_SIZE 64
+#define HOST_BLE_UUID_SIZE 40
+#define HOST_BLE_ADVERTISING_INTERVAL_MS 100
+#define HOST_BLE_CONNECT_MS 40
+#define HOST_BLE_DISCOVER_ATTRIBUTES_MS 700
+#define HOST_BLE_DISCOVER_SERVICE_MS 150
+#define HOST_BLE_WRITE_MS 15
+
+enum BLEProperty {
+  BLEBroadcast = 0x01,
+  BLERead = 0x02,
+  BLEWriteWithoutResponse = 0x04,
+  BLEWrite = 0x08,
+  BLENotify = 0x10,
+  BLEIndicate = 0x20
+};
+
+// (BLERead is a property above, as in ArduinoBLE where the event of that name is unused)
+enum BLECharacteristicEvent {
+  BLESubscribed = 0,
+  BLEUnsubscribed = 1,
+  BLEWritten = 3,
+  BLEUpdated = 4
+};
+
+class BLEDevice;
+class BLECharacteristic;
+typedef void (*BLECharacteristicEventHandler)(BLEDevice device, BLECharacteristic characteristic);
+
+// One characteristic's state, on a simulated peripheral or on the sketch's own service
+struct HostBleAttribute {
+  char uuid[HOST_BLE_UUID_SIZE];
+  uint8_t properties;
+  uint8_t value[HOST_BLE_VALUE_SIZE];
+  uint8_t valueLength;
+  uint8_t valueSize;
+  bool subscribed;
+  bool updatePending; // a notification waiting for BLE.poll()
+  BLECharacteristicEventHandler updatedHandler;
+  unsigned long notifications; // notifications sent (local) or delivered to the sketch (remote)
+  unsigned long notificationsLost;
+  unsigned long writes;        // writes by the other end
+};
+
+class BLEDevice {
+  public:
+    BLEDevice() : index(-1) {}
+    explicit BLEDevice(int index) : index(index) {}
+
+    String address() const;
+    bool hasLocalName() const;
+    String localName() const;
+    String advertisedServiceUuid() const;
+    int advertisementDataLength() const;
+    int advertisementData(uint8_t value[], int length) const; // the local name record, as the monitors send it
+    int rssi();
+
+    bool connect();
+    bool disconnect();
+    bool connected() const;
+    bool discoverAttributes();
+    bool discoverService(const char* uuid);
+    BLECharacteristic characteristic(const char* uuid) const;
+
+    bool operator==(const BLEDevice& other) const { return index == other.index; }
+    bool operator!=(const BLEDevice& other) const { return index != other.index; }
+    operator bool() const { return index >= 0; }
+
+  private:
+    int index; // simulated peripheral, or HOST_BLE_CENTRAL
+};
+
+class BLECharacteristic {
+  public:
+    BLECharacteristic() : attribute(nullptr), device(-1) {}
+    BLECharacteristic(HostBleAttribute* attribute, int device) : attribute(attribute), device(device) {}
+    // A characteristic of the sketch's own service
+    BLECharacteristic(const char* uuid, uint8_t properties, int valueSize, bool fixedLength = false);
+
+    const char* uuid() const { return attribute != nullptr ? attribute->uuid : ""; }
+    uint8_t properties() const { return attribute != nullptr ? attribute->properties : 0; }
+    const uint8_t* value() const { return attribute != nullptr ? attribute->value : nullptr; }
+    int valueLength() const { return attribute != nullptr ? attribute->valueLength : 0; }
+
+    int writeValue(const uint8_t* value, int length);
+    int writeValue(const char* value) { return writeValue((const uint8_t*)value, strlen(value)); }
+
+    bool canSubscribe() const { return (properties() & (BLENotify | BLEIndicate)) != 0; }
+    bool subscribe();
+    bool subscribed() const { return attribute != nullptr && attribute->subscribed; }
+    void setEventHandler(int event, BLECharacteristicEventHandler handler);
+
+    operator bool() const { return attribute != nullptr; }
+
+    HostBleAttribute* hostAttribute() const { return attribute; }
+
+  protected:
+    HostBleAttribute* attribute;
+    int device; // the simulated peripheral of a remote characteristic, -1 for a local one
+};
+
+template<typename T>
+class BLETypedCharacteristic : public BLECharacteristic {
+  public:
+    BLETypedCharacteristic(const char* uuid, uint8_t properties)
+      : BLECharacteristic(uuid, properties, sizeof(T), true) {}
+
+    int writeValue(T value) { return BLECharacteristic::writeValue((const uint8_t*)&value, sizeof(T)); }
+    T value() const {
+      T v;
+      memcpy(&v, BLECharacteristic::value(), sizeof(T));
+      return v;
+    }
+};
+
+class BLEService {
+  public:
+    explicit BLEService(const char* uuid) : serviceUuid(uuid) {}
+
+    void addCharacteristic(BLECharacteristic& characteristic) { characteristicCount++; }
+    const char* uuid() const { return serviceUuid; }
+
+  private:
+    const char* serviceUuid;
+    int characteristicCount = 0;
+};
+
+class BLELocalDevice {
+  public:
+    int begin();
+    void end() {}
+    void poll(unsigned long timeout = 0);
+
+    // Central role
+    int scan(bool withDuplicates = false);
+    int scanForName(const char* name, bool withDuplicates = false);
+    int scanForAddress(const char* address, bool withDuplicates = false);
+    void stopScan();
+    BLEDevice available();
+
+    // Peripheral role
+    bool setLocalName(const char* name);
+    bool setAdvertisedService(const BLEService& service);
+    void addService(BLEService& service) {}
+    int advertise();
+    void stopAdvertise();
+    bool advertising();
+    BLEDevice central();
+    void setConnectionInterval(uint16_t minimum, uint16_t maximum);
+
+    uint16_t connectionIntervalMin = 0;
+    uint16_t connectionIntervalMax = 0;
+};
+
+extern BLELocalDevice BLE;
+
+// ---- Simulation side: peripherals for a central sketch ----
+int hostBleAddPeripheral(const char* address, const char* localName, const char* serviceUuid, int rssi = -60);
+HostBleAttribute* hostBleAddCharacteristic(int peripheral, const char* uuid, uint8_t properties);
+HostBleAttribute* hostBleFindCharacteristic(int peripheral, const char* uuid);
+bool hostBleNotify(int peripheral, const char* uuid, const uint8_t* value, size_t length); // false unless subscribed
+void hostBleSetAdvertising(int peripheral, bool advertising);  // in range and waiting for a connection
+void hostBleDropConnection(int peripheral);                     // link loss
+bool hostBlePeripheralConnected(int peripheral);
+unsigned long hostBleConnections(int peripheral);
+
+// ---- Simulation side: a central for a peripheral sketch ----
+bool hostBleConnectCentral(const char* address); // false unless the sketch is advertising
+void hostBleDisconnectCentral();
+HostBleAttribute* hostBleLocal(const char* uuid);
+const char* hostBleLocalName();
+
+#endif // HOST_ARDUINO_BLE_H
@@ -0,0 +1,814 @@
+#include "ArduinoJson.h"
+
+#define JSON_MAX_NESTING 10
+
+// ---- Document ----
+
+JsonDocument::JsonDocument(uint8_t* pool, size_t size) : pool(pool), poolSize(size) {
+  clear();
+}
+
+void JsonDocument::clear() {
+  slotsUsed = 0;
+  stringsUsed = 0;
+  overflow = false;
+  memset(&rootSlot, 0, sizeof(rootSlot));
+  rootSlot.type = JSON_NULL;
+}
+
+JsonSlot* JsonDocument::allocateSlot() {
+  if ((slotsUsed + 1) * sizeof(JsonSlot) + stringsUsed > poolSize) {
+    overflow = true;
+    return nullptr;
+  }
+  JsonSlot* slot = reinterpret_cast<JsonSlot*>(pool) + slotsUsed++;
+  memset(slot, 0, sizeof(JsonSlot));
+  slot->type = JSON_NULL;
+  return slot;
+}
+
+const char* JsonDocument::copyString(const char* str, size_t length) {
+  if (slotsUsed * sizeof(JsonSlot) + stringsUsed + length + 1 > poolSize) {
+    overflow = true;
+    return nullptr;
+  }
+  stringsUsed += length + 1;
+  char* copy = reinterpret_cast<char*>(pool + poolSize - stringsUsed);
+  memcpy(copy, str, length);
+  copy[length] = '\0';
+  return copy;
+}
+
+void JsonDocument::makeCollection(JsonSlot* slot, JsonType type) {
+  if (slot != nullptr && slot->type != type) {
+    slot->type = type;
+    slot->child = nullptr;
+  }
+}
+
+/**
+ * The member `key` of an object slot, added (as null) if it isn't there. A null slot becomes an object.
+ */
+JsonSlot* JsonDocument::member(JsonSlot* object, const char* key, bool copyKey) {
+  if (object == nullptr || key == nullptr) {
+    return nullptr;
+  }
+  if (object->type == JSON_NULL) {
+    makeCollection(object, JSON_OBJECT);
+  }
+  if (object->type != JSON_OBJECT) {
+    return nullptr;
+  }
+  JsonSlot* last = nullptr;
+  for (JsonSlot* p = object->child; p != nullptr; p = p->next) {
+    if (strcmp(p->key, key) == 0) {
+      return p;
+    }
+    last = p;
+  }
+  JsonSlot* slot = allocateSlot();
+  if (slot == nullptr) {
+    return nullptr;
+  }
+  slot->key = copyKey ? copyString(key, strlen(key)) : key;
+  if (slot->key == nullptr) {
+    slotsUsed--;
+    return nullptr;
+  }
+  if (last == nullptr) {
+    object->child = slot;
+  } else {
+    last->next = slot;
+  }
+  return slot;
+}
+
+JsonSlot* JsonDocument::append(JsonSlot* collection) {
+  if (collection == nullptr) {
+    return nullptr;
+  }
+  if (collection->type == JSON_NULL) {
+    makeCollection(collection, JSON_ARRAY);
+  }
+  if (collection->type != JSON_ARRAY) {
+    return nullptr;
+  }
+  JsonSlot* slot = allocateSlot();
+  if (slot == nullptr) {
+    return nullptr;
+  }
+  if (collection->child == nullptr) {
+    collection->child = slot;
+  } else {
+    JsonSlot* last = collection->child;
+    while (last->next != nullptr) {
+      last = last->next;
+    }
+    last->next = slot;
+  }
+  return slot;
+}
+
+template<>
+JsonObject JsonDocument::to<JsonObject>() {
+  clear();
+  makeCollection(&rootSlot, JSON_OBJECT);
+  return JsonObject(this, &rootSlot);
+}
+
+template<>
+JsonArray JsonDocument::to<JsonArray>() {
+  clear();
+  makeCollection(&rootSlot, JSON_ARRAY);
+  return JsonArray(this, &rootSlot);
+}
+
+JsonVariant JsonDocument::operator[](const char* key) {
+  return JsonVariant(this, member(&rootSlot, key, false));
+}
+
+JsonVariant JsonDocument::operator[](char* key) {
+  return JsonVariant(this, member(&rootSlot, key, true));
+}
+
+JsonVariant JsonDocument::operator[](const char* key) const {
+  return JsonVariant(const_cast<JsonDocument*>(this), const_cast<JsonSlot*>(&rootSlot))[key];
+}
+
+JsonObject JsonDocument::createNestedObject(const char* key) {
+  return JsonObject(this, &rootSlot).createNestedObject(key);
+}
+
+JsonObject JsonDocument::createNestedObject(char* key) {
+  return JsonObject(this, &rootSlot).createNestedObject(key);
+}
+
+JsonArray JsonDocument::createNestedArray(const char* key) {
+  return JsonObject(this, &rootSlot).createNestedArray(key);
+}
+
+JsonArray JsonDocument::createNestedArray(char* key) {
+  return JsonObject(this, &rootSlot).createNestedArray(key);
+}
+
+// ---- Variant ----
+
+JsonVariant& JsonVariant::operator=(bool value) {
+  if (slot != nullptr) {
+    slot->type = JSON_BOOL;
+    slot->value.boolean = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(float value) {
+  if (slot != nullptr) {
+    slot->type = JSON_FLOAT;
+    slot->value.number = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(double value) {
+  if (slot != nullptr) {
+    slot->type = JSON_DOUBLE;
+    slot->value.number = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(const char* value) {
+  if (slot != nullptr) {
+    slot->type = value != nullptr ? JSON_STRING : JSON_NULL;
+    slot->value.string = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(char* value) {
+  if (slot != nullptr) {
+    const char* copy = value != nullptr ? doc->copyString(value, strlen(value)) : nullptr;
+    slot->type = copy != nullptr ? JSON_STRING : JSON_NULL;
+    slot->value.string = copy;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(const String& value) {
+  return *this = const_cast<char*>(value.c_str());
+}
+
+void JsonVariant::setInteger(int64_t value) {
+  if (slot != nullptr) {
+    slot->type = JSON_INT;
+    slot->value.integer = value;
+  }
+}
+
+void JsonVariant::setUnsigned(uint64_t value) {
+  if (slot != nullptr) {
+    slot->type = JSON_UINT;
+    slot->value.uinteger = value;
+  }
+}
+
+JsonVariant JsonVariant::operator[](const char* key) {
+  return JsonVariant(doc, doc != nullptr ? doc->member(slot, key, false) : nullptr);
+}
+
+JsonVariant JsonVariant::operator[](char* key) {
+  return JsonVariant(doc, doc != nullptr ? doc->member(slot, key, true) : nullptr);
+}
+
+JsonVariant JsonVariant::operator[](const char* key) const {
+  if (slot == nullptr || slot->type != JSON_OBJECT || key == nullptr) {
+    return JsonVariant();
+  }
+  for (JsonSlot* p = slot->child; p != nullptr; p = p->next) {
+    if (strcmp(p->key, key) == 0) {
+      return JsonVariant(doc, p);
+    }
+  }
+  return JsonVariant();
+}
+
+template<>
+long long JsonVariant::as<long long>() const {
+  if (slot == nullptr) {
+    return 0;
+  }
+  switch (slot->type) {
+    case JSON_BOOL:
+      return slot->value.boolean;
+    case JSON_INT:
+      return slot->value.integer;
+    case JSON_UINT:
+      return (int64_t)slot->value.uinteger;
+    case JSON_FLOAT:
+    case JSON_DOUBLE:
+      return (int64_t)slot->value.number;
+    case JSON_STRING:
+      return strtoll(slot->value.string, nullptr, 10);
+    default:
+      return 0;
+  }
+}
+
+template<>
+unsigned long long JsonVariant::as<unsigned long long>() const {
+  if (slot != nullptr && slot->type == JSON_UINT) {
+    return slot->value.uinteger;
+  }
+  if (slot != nullptr && (slot->type == JSON_FLOAT || slot->type == JSON_DOUBLE)) {
+    return slot->value.number < 0 ? 0 : (uint64_t)slot->value.number;
+  }
+  return (uint64_t)as<long long>();
+}
+
+template<>
+long JsonVariant::as<long>() const {
+  return (long)as<long long>();
+}
+
+template<>
+unsigned long JsonVariant::as<unsigned long>() const {
+  return (unsigned long)as<unsigned long long>();
+}
+
+template<>
+int JsonVariant::as<int>() const {
+  return (int)as<long long>();
+}
+
+template<>
+unsigned int JsonVariant::as<unsigned int>() const {
+  return (unsigned int)as<unsigned long long>();
+}
+
+template<>
+double JsonVariant::as<double>() const {
+  if (slot == nullptr) {
+    return 0;
+  }
+  switch (slot->type) {
+    case JSON_FLOAT:
+    case JSON_DOUBLE:
+      return slot->value.number;
+    case JSON_UINT:
+      return (double)slot->value.uinteger;
+    case JSON_STRING:
+      return strtod(slot->value.string, nullptr);
+    default:
+      return (double)as<long long>();
+  }
+}
+
+template<>
+float JsonVariant::as<float>() const {
+  return (float)as<double>();
+}
+
+template<>
+bool JsonVariant::as<bool>() const {
+  if (slot == nullptr) {
+    return false;
+  }
+  return slot->type == JSON_BOOL ? slot->value.boolean : as<long long>() != 0;
+}
+
+template<>
+const char* JsonVariant::as<const char*>() const {
+  return slot != nullptr && slot->type == JSON_STRING ? slot->value.string : nullptr;
+}
+
+// ---- Object and array ----
+
+JsonVariant JsonObject::operator[](const char* key) {
+  return JsonVariant(doc, doc != nullptr ? doc->member(slot, key, false) : nullptr);
+}
+
+JsonVariant JsonObject::operator[](char* key) {
+  return JsonVariant(doc, doc != nullptr ? doc->member(slot, key, true) : nullptr);
+}
+
+JsonObject JsonObject::createNestedObject(const char* key) {
+  JsonSlot* child = doc != nullptr ? doc->member(slot, key, false) : nullptr;
+  if (child == nullptr) {
+    return JsonObject();
+  }
+  doc->makeCollection(child, JSON_OBJECT);
+  return JsonObject(doc, child);
+}
+
+JsonObject JsonObject::createNestedObject(char* key) {
+  JsonSlot* child = doc != nullptr ? doc->member(slot, key, true) : nullptr;
+  if (child == nullptr) {
+    return JsonObject();
+  }
+  doc->makeCollection(child, JSON_OBJECT);
+  return JsonObject(doc, child);
+}
+
+JsonArray JsonObject::createNestedArray(const char* key) {
+  JsonSlot* child = doc != nullptr ? doc->member(slot, key, false) : nullptr;
+  if (child == nullptr) {
+    return JsonArray();
+  }
+  doc->makeCollection(child, JSON_ARRAY);
+  return JsonArray(doc, child);
+}
+
+JsonArray JsonObject::createNestedArray(char* key) {
+  JsonSlot* child = doc != nullptr ? doc->member(slot, key, true) : nullptr;
+  if (child == nullptr) {
+    return JsonArray();
+  }
+  doc->makeCollection(child, JSON_ARRAY);
+  return JsonArray(doc, child);
+}
+
+size_t JsonObject::size() const {
+  size_t count = 0;
+  for (JsonSlot* p = slot != nullptr ? slot->child : nullptr; p != nullptr; p = p->next) {
+    count++;
+  }
+  return count;
+}
+
+JsonVariant JsonArray::addElement() {
+  return JsonVariant(doc, doc != nullptr ? doc->append(slot) : nullptr);
+}
+
+JsonObject JsonArray::createNestedObject() {
+  JsonSlot* child = doc != nullptr ? doc->append(slot) : nullptr;
+  if (child == nullptr) {
+    return JsonObject();
+  }
+  doc->makeCollection(child, JSON_OBJECT);
+  return JsonObject(doc, child);
+}
+
+JsonArray JsonArray::createNestedArray() {
+  JsonSlot* child = doc != nullptr ? doc->append(slot) : nullptr;
+  if (child == nullptr) {
+    return JsonArray();
+  }
+  doc->makeCollection(child, JSON_ARRAY);
+  return JsonArray(doc, child);
+}
+
+JsonVariant JsonArray::operator[](size_t index) const {
+  JsonSlot* p = slot != nullptr ? slot->child : nullptr;
+  while (p != nullptr && index-- > 0) {
+    p = p->next;
+  }
+  return JsonVariant(doc, p);
+}
+
+size_t JsonArray::size() const {
+  size_t count = 0;
+  for (JsonSlot* p = slot != nullptr ? slot->child : nullptr; p != nullptr; p = p->next) {
+    count++;
+  }
+  return count;
+}
+
+// ---- Serialization ----
+
+namespace {
+
+// Counts the bytes when out is null (measureJson())
+class JsonWriter {
+  public:
+    JsonWriter(Print* out, bool pretty) : out(out), pretty(pretty), count(0) {}
+
+    size_t write(const JsonSlot* slot) {
+      writeValue(slot, 0);
+      return count;
+    }
+
+  private:
+    void raw(const char* text, size_t length) {
+      count += out != nullptr ? out->write((const uint8_t*)text, length) : length;
+    }
+
+    void raw(const char* text) {
+      raw(text, strlen(text));
+    }
+
+    void newline(int depth) {
+      if (!pretty) {
+        return;
+      }
+      raw("\r\n");
+      for (int i = 0; i < depth; i++) {
+        raw("  ");
+      }
+    }
+
+    void writeString(const char* str) {
+      raw("\"");
+      for (const char* p = str; *p != '\0'; p++) {
+        char escaped[8];
+        switch (*p) {
+          case '"': raw("\\\""); break;
+          case '\\': raw("\\\\"); break;
+          case '\b': raw("\\b"); break;
+          case '\f': raw("\\f"); break;
+          case '\n': raw("\\n"); break;
+          case '\r': raw("\\r"); break;
+          case '\t': raw("\\t"); break;
+          default:
+            if ((unsigned char)*p < 0x20) {
+              snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*p);
+              raw(escaped);
+            } else {
+              raw(p, 1);
+            }
+        }
+      }
+      raw("\"");
+    }
+
+    // NaN and infinity aren't JSON, ArduinoJson writes them as null
+    void writeNumber(double value, int significantDigits) {
+      if (isnan(value) || isinf(value)) {
+        raw("null");
+        return;
+      }
+      char text[32];
+      snprintf(text, sizeof(text), "%.*g", significantDigits, value);
+      raw(text);
+    }
+
+    void writeValue(const JsonSlot* slot, int depth) {
+      char text[24];
+      switch (slot->type) {
+        case JSON_NULL:
+          raw("null");
+          break;
+        case JSON_BOOL:
+          raw(slot->value.boolean ? "true" : "false");
+          break;
+        case JSON_INT:
+          snprintf(text, sizeof(text), "%lld", (long long)slot->value.integer);
+          raw(text);
+          break;
+        case JSON_UINT:
+          snprintf(text, sizeof(text), "%llu", (unsigned long long)slot->value.uinteger);
+          raw(text);
+          break;
+        case JSON_FLOAT:
+          writeNumber(slot->value.number, 7);
+          break;
+        case JSON_DOUBLE:
+          writeNumber(slot->value.number, 15);
+          break;
+        case JSON_STRING:
+          writeString(slot->value.string);
+          break;
+        case JSON_OBJECT:
+        case JSON_ARRAY: {
+          bool object = slot->type == JSON_OBJECT;
+          raw(object ? "{" : "[");
+          for (const JsonSlot* p = slot->child; p != nullptr; p = p->next) {
+            newline(depth + 1);
+            if (object) {
+              writeString(p->key);
+              raw(pretty ? ": " : ":");
+            }
+            writeValue(p, depth + 1);
+            if (p->next != nullptr) {
+              raw(",");
+            }
+          }
+          if (slot->child != nullptr) {
+            newline(depth);
+          }
+          raw(object ? "}" : "]");
+          break;
+        }
+      }
+    }
+
+    Print* out;
+    bool pretty;
+    size_t count;
+};
+
+class BufferPrint : public Print {
+  public:
+    BufferPrint(char* buffer, size_t size) : buffer(buffer), size(size), length(0) {}
+
+    size_t write(uint8_t c) override {
+      if (length + 1 >= size) {
+        return 0;
+      }
+      buffer[length++] = c;
+      buffer[length] = '\0';
+      return 1;
+    }
+
+  private:
+    char* buffer;
+    size_t size;
+    size_t length;
+};
+
+class JsonParser {
+  public:
+    JsonParser(JsonDocument& doc, const char* input, size_t length)
+      : doc(doc), p(input), end(input + length) {}
+
+    DeserializationError parse(JsonSlot* slot) {
+      skipSpace();
+      if (p == end || *p == '\0') {
+        return DeserializationError::EmptyInput;
+      }
+      return parseValue(slot, 0);
+    }
+
+  private:
+    void skipSpace() {
+      while (p < end && isspace((unsigned char)*p)) {
+        p++;
+      }
+    }
+
+    DeserializationError parseValue(JsonSlot* slot, int depth) {
+      skipSpace();
+      if (p == end) {
+        return DeserializationError::IncompleteInput;
+      }
+      if (depth > JSON_MAX_NESTING) {
+        return DeserializationError::TooDeep;
+      }
+      switch (*p) {
+        case '{':
+          return parseObject(slot, depth);
+        case '[':
+          return parseArray(slot, depth);
+        case '"': {
+          const char* str;
+          DeserializationError error = parseString(str);
+          if (!error) {
+            slot->type = JSON_STRING;
+            slot->value.string = str;
+          }
+          return error;
+        }
+        default:
+          return parseLiteral(slot);
+      }
+    }
+
+    DeserializationError parseObject(JsonSlot* slot, int depth) {
+      doc.makeCollection(slot, JSON_OBJECT);
+      p++;
+      skipSpace();
+      if (p < end && *p == '}') {
+        p++;
+        return DeserializationError::Ok;
+      }
+      while (true) {
+        skipSpace();
+        if (p == end) {
+          return DeserializationError::IncompleteInput;
+        }
+        if (*p != '"') {
+          return DeserializationError::InvalidInput;
+        }
+        const char* key;
+        DeserializationError error = parseString(key);
+        if (error) {
+          return error;
+        }
+        skipSpace();
+        if (p == end) {
+          return DeserializationError::IncompleteInput;
+        }
+        if (*p++ != ':') {
+          return DeserializationError::InvalidInput;
+        }
+        JsonSlot* child = doc.member(slot, key, false);
+        if (child == nullptr) {
+          return DeserializationError::NoMemory;
+        }
+        error = parseValue(child, depth + 1);
+        if (error) {
+          return error;
+        }
+        skipSpace();
+        if (p == end) {
+          return DeserializationError::IncompleteInput;
+        }
+        if (*p == '}') {
+          p++;
+          return DeserializationError::Ok;
+        }
+        if (*p++ != ',') {
+          return DeserializationError::InvalidInput;
+        }
+      }
+    }
+
+    DeserializationError parseArray(JsonSlot* slot, int depth) {
+      doc.makeCollection(slot, JSON_ARRAY);
+      p++;
+      skipSpace();
+      if (p < end && *p == ']') {
+        p++;
+        return DeserializationError::Ok;
+      }
+      while (true) {
+        JsonSlot* child = doc.append(slot);
+        if (child == nullptr) {
+          return DeserializationError::NoMemory;
+        }
+        DeserializationError error = parseValue(child, depth + 1);
+        if (error) {
+          return error;
+        }
+        skipSpace();
+        if (p == end) {
+          return DeserializationError::IncompleteInput;
+        }
+        if (*p == ']') {
+          p++;
+          return DeserializationError::Ok;
+        }
+        if (*p++ != ',') {
+          return DeserializationError::InvalidInput;
+        }
+      }
+    }
+
+    // Strings from the input are copied into the pool, as ArduinoJson does for a const input
+    DeserializationError parseString(const char*& str) {
+      p++;
+      char text[256];
+      size_t length = 0;
+      while (true) {
+        if (p == end) {
+          return DeserializationError::IncompleteInput;
+        }
+        char c = *p++;
+        if (c == '"') {
+          break;
+        }
+        if (c == '\\') {
+          if (p == end) {
+            return DeserializationError::IncompleteInput;
+          }
+          c = *p++;
+          switch (c) {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u': {
+              if (end - p < 4) {
+                return DeserializationError::IncompleteInput;
+              }
+              char hex[5] = {p[0], p[1], p[2], p[3], '\0'};
+              c = (char)strtol(hex, nullptr, 16);
+              p += 4;
+              break;
+            }
+            default:
+              break;
+          }
+        }
+        if (length + 1 >= sizeof(text)) {
+          return DeserializationError::NoMemory;
+        }
+        text[length++] = c;
+      }
+      str = doc.copyString(text, length);
+      return str != nullptr ? DeserializationError::Ok : DeserializationError::NoMemory;
+    }
+
+    DeserializationError parseLiteral(JsonSlot* slot) {
+      const char* start = p;
+      while (p < end && (isalnum((unsigned char)*p) || *p == '-' || *p == '+' || *p == '.')) {
+        p++;
+      }
+      size_t length = p - start;
+      if (length == 0) {
+        return DeserializationError::InvalidInput;
+      }
+      char text[32];
+      if (length >= sizeof(text)) {
+        return DeserializationError::InvalidInput;
+      }
+      memcpy(text, start, length);
+      text[length] = '\0';
+      if (strcmp(text, "true") == 0 || strcmp(text, "false") == 0) {
+        slot->type = JSON_BOOL;
+        slot->value.boolean = text[0] == 't';
+        return DeserializationError::Ok;
+      }
+      if (strcmp(text, "null") == 0) {
+        slot->type = JSON_NULL;
+        return DeserializationError::Ok;
+      }
+      char* numberEnd;
+      if (strpbrk(text, ".eE") == nullptr) {
+        if (text[0] == '-') {
+          slot->type = JSON_INT;
+          slot->value.integer = strtoll(text, &numberEnd, 10);
+        } else {
+          slot->type = JSON_UINT;
+          slot->value.uinteger = strtoull(text, &numberEnd, 10);
+        }
+      } else {
+        slot->type = JSON_DOUBLE;
+        slot->value.number = strtod(text, &numberEnd);
+      }
+      return *numberEnd == '\0' ? DeserializationError::Ok : DeserializationError::InvalidInput;
+    }
+
+    JsonDocument& doc;
+    const char* p;
+    const char* end;
+};
+
+} // namespace
+
+const char* DeserializationError::c_str() const {
+  static const char* const names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+  return names[errorCode];
+}
+
+size_t serializeJson(const JsonDocument& doc, Print& output) {
+  return JsonWriter(&output, false).write(doc.root());
+}
+
+size_t serializeJson(const JsonDocument& doc, char* output, size_t size) {
+  if (size > 0) {
+    output[0] = '\0';
+  }
+  BufferPrint buffer(output, size);
+  return JsonWriter(&buffer, false).write(doc.root());
+}
+
+size_t serializeJsonPretty(const JsonDocument& doc, Print& output) {
+  return JsonWriter(&output, true).write(doc.root());
+}
+
+size_t measureJson(const JsonDocument& doc) {
+  return JsonWriter(nullptr, false).write(doc.root());
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+  doc.clear();
+  if (input == nullptr) {
+    return DeserializationError::EmptyInput;
+  }
+  return JsonParser(doc, input, length).parse(const_cast<JsonSlot*>(doc.root()));
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+  return deserializeJson(doc, input, input != nullptr ? strlen(input) : 0);
+}
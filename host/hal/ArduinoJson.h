@@ -0,0 +1,246 @@
+#ifndef HOST_ARDUINO_JSON_H
+#define HOST_ARDUINO_JSON_H
+
+#include <Arduino.h>
+#include <type_traits>
+
+/*
+  The part of ArduinoJson 6 the hub uses, with the same memory model: a StaticJsonDocument is a fixed pool
+  that holds the nodes (one slot per value or member) and the copied strings, nothing is allocated.
+  As in ArduinoJson, `const char*` keys and values are stored as pointers and `char*` ones are copied into the
+  pool; when the pool is full the value is dropped and overflowed() is set. JSON_OBJECT_SIZE()/JSON_ARRAY_SIZE()
+  count slots of this implementation, so capacities computed with them mean the same as on the board.
+*/
+
+enum JsonType : uint8_t {
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_INT,
+  JSON_UINT,
+  JSON_FLOAT,  // from a float: printed with float precision
+  JSON_DOUBLE,
+  JSON_STRING,
+  JSON_OBJECT,
+  JSON_ARRAY
+};
+
+struct JsonSlot {
+  const char* key;
+  JsonSlot* next;
+  JsonSlot* child; // first member or element of an object or array
+  union {
+    bool boolean;
+    int64_t integer;
+    uint64_t uinteger;
+    double number;
+    const char* string;
+  } value;
+  JsonType type;
+};
+
+#define JSON_OBJECT_SIZE(n) ((n) * sizeof(JsonSlot))
+#define JSON_ARRAY_SIZE(n) ((n) * sizeof(JsonSlot))
+
+class JsonDocument;
+class JsonObject;
+class JsonArray;
+
+/**
+ * A value in a document. Assigning to it sets the value, reading it converts as ArduinoJson does.
+ */
+class JsonVariant {
+  public:
+    JsonVariant() : doc(nullptr), slot(nullptr) {}
+    JsonVariant(JsonDocument* doc, JsonSlot* slot) : doc(doc), slot(slot) {}
+
+    JsonVariant& operator=(bool value);
+    JsonVariant& operator=(float value);
+    JsonVariant& operator=(double value);
+    JsonVariant& operator=(const char* value);
+    JsonVariant& operator=(char* value);
+    JsonVariant& operator=(const String& value);
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, JsonVariant&>::type
+    operator=(T value) {
+      if (std::is_signed<T>::value) {
+        setInteger((int64_t)value);
+      } else {
+        setUnsigned((uint64_t)value);
+      }
+      return *this;
+    }
+
+    // Members of an object value; a null value becomes an object
+    JsonVariant operator[](const char* key);
+    JsonVariant operator[](char* key);
+    JsonVariant operator[](const char* key) const;
+
+    template<typename T>
+    T as() const;
+
+    bool isNull() const { return slot == nullptr || slot->type == JSON_NULL; }
+
+    JsonSlot* getSlot() const { return slot; }
+
+  protected:
+    void setInteger(int64_t value);
+    void setUnsigned(uint64_t value);
+
+    JsonDocument* doc;
+    JsonSlot* slot;
+};
+
+class JsonObject {
+  public:
+    JsonObject() : doc(nullptr), slot(nullptr) {}
+    JsonObject(JsonDocument* doc, JsonSlot* slot) : doc(doc), slot(slot) {}
+
+    JsonVariant operator[](const char* key);
+    JsonVariant operator[](char* key);
+    JsonObject createNestedObject(const char* key);
+    JsonObject createNestedObject(char* key);
+    JsonArray createNestedArray(const char* key);
+    JsonArray createNestedArray(char* key);
+    size_t size() const;
+    bool isNull() const { return slot == nullptr; }
+
+  private:
+    JsonDocument* doc;
+    JsonSlot* slot;
+};
+
+class JsonArray {
+  public:
+    JsonArray() : doc(nullptr), slot(nullptr) {}
+    JsonArray(JsonDocument* doc, JsonSlot* slot) : doc(doc), slot(slot) {}
+
+    JsonObject createNestedObject();
+    JsonArray createNestedArray();
+    JsonVariant addElement();
+    template<typename T>
+    bool add(T value) {
+      JsonVariant element = addElement();
+      if (element.getSlot() == nullptr) {
+        return false;
+      }
+      element = value;
+      return true;
+    }
+    JsonVariant operator[](size_t index) const;
+    size_t size() const;
+    bool isNull() const { return slot == nullptr; }
+
+  private:
+    JsonDocument* doc;
+    JsonSlot* slot;
+};
+
+class JsonDocument {
+  public:
+    JsonDocument(const JsonDocument&) = delete;
+    JsonDocument& operator=(const JsonDocument&) = delete;
+
+    void clear();
+    size_t capacity() const { return poolSize; }
+    size_t memoryUsage() const { return slotsUsed * sizeof(JsonSlot) + stringsUsed; }
+    bool overflowed() const { return overflow; }
+
+    template<typename T>
+    T to();
+
+    JsonVariant operator[](const char* key);
+    JsonVariant operator[](char* key);
+    JsonVariant operator[](const char* key) const;
+    JsonObject createNestedObject(const char* key);
+    JsonObject createNestedObject(char* key);
+    JsonArray createNestedArray(const char* key);
+    JsonArray createNestedArray(char* key);
+
+    const JsonSlot* root() const { return &rootSlot; }
+
+    // Used by the variants, objects and arrays
+    JsonSlot* allocateSlot();
+    const char* copyString(const char* str, size_t length);
+    JsonSlot* member(JsonSlot* object, const char* key, bool copyKey);
+    JsonSlot* append(JsonSlot* collection);
+    void makeCollection(JsonSlot* slot, JsonType type);
+
+  protected:
+    JsonDocument(uint8_t* pool, size_t size);
+
+  private:
+    uint8_t* pool;
+    size_t poolSize;
+    size_t slotsUsed;
+    size_t stringsUsed; // copied strings, from the end of the pool
+    bool overflow;
+    JsonSlot rootSlot;
+};
+
+template<size_t CAPACITY>
+class StaticJsonDocument : public JsonDocument {
+  public:
+    StaticJsonDocument() : JsonDocument(storage, CAPACITY) {}
+
+  private:
+    alignas(JsonSlot) uint8_t storage[CAPACITY];
+};
+
+template<>
+JsonObject JsonDocument::to<JsonObject>();
+template<>
+JsonArray JsonDocument::to<JsonArray>();
+
+template<>
+long long JsonVariant::as<long long>() const;
+template<>
+unsigned long long JsonVariant::as<unsigned long long>() const;
+template<>
+long JsonVariant::as<long>() const;
+template<>
+unsigned long JsonVariant::as<unsigned long>() const;
+template<>
+int JsonVariant::as<int>() const;
+template<>
+unsigned int JsonVariant::as<unsigned int>() const;
+template<>
+double JsonVariant::as<double>() const;
+template<>
+float JsonVariant::as<float>() const;
+template<>
+bool JsonVariant::as<bool>() const;
+template<>
+const char* JsonVariant::as<const char*>() const;
+
+class DeserializationError {
+  public:
+    enum Code {
+      Ok,
+      EmptyInput,
+      IncompleteInput,
+      InvalidInput,
+      NoMemory,
+      TooDeep
+    };
+
+    DeserializationError(Code code = Ok) : errorCode(code) {}
+
+    explicit operator bool() const { return errorCode != Ok; }
+    bool operator==(Code code) const { return errorCode == code; }
+    bool operator!=(Code code) const { return errorCode != code; }
+    Code code() const { return errorCode; }
+    const char* c_str() const;
+
+  private:
+    Code errorCode;
+};
+
+size_t serializeJson(const JsonDocument& doc, Print& output);
+size_t serializeJson(const JsonDocument& doc, char* output, size_t size);
+size_t serializeJsonPretty(const JsonDocument& doc, Print& output);
+size_t measureJson(const JsonDocument& doc);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length);
+DeserializationError deserializeJson(JsonDocument& doc, const char* input);
+
+#endif // HOST_ARDUINO_JSON_H
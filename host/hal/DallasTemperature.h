@@ -0,0 +1,75 @@
+#ifndef HOST_DALLAS_TEMPERATURE_H
+#define HOST_DALLAS_TEMPERATURE_H
+
+#include <Arduino.h>
+#include <OneWire.h>
+#include "host_sim.h"
+
+/*
+  A DS18B20 on the bus, reading hostDs18b20TempC. A conversion takes the datasheet's time for the
+  resolution, which requestTemperatures*() blocks for unless setWaitForConversion(false); reading the
+  scratchpad back costs the 1-Wire transfer time.
+*/
+
+#define DEVICE_DISCONNECTED_C -127
+#define HOST_ONE_WIRE_READ_MICROS 6000 // reset, match ROM and 9 scratchpad bytes at standard speed
+
+typedef uint8_t DeviceAddress[8];
+
+inline float hostDs18b20TempC = 20.0;
+inline bool hostDs18b20Present = true;
+inline unsigned long hostDs18b20Conversions = 0;
+
+class DallasTemperature {
+  public:
+    explicit DallasTemperature(OneWire* bus) : bus(bus) {}
+
+    void begin() {}
+
+    bool getAddress(uint8_t* address, uint8_t index) {
+      static const DeviceAddress rom = {0x28, 0xFF, 0x64, 0x1E, 0x0F, 0x3C, 0x2A, 0x51};
+      if (!hostDs18b20Present || index != 0) {
+        return false;
+      }
+      memcpy(address, rom, sizeof(rom));
+      return true;
+    }
+
+    uint8_t getResolution(const uint8_t* address) { return resolution; }
+
+    static uint16_t millisToWaitForConversion(uint8_t bitResolution) {
+      switch (bitResolution) {
+        case 9: return 94;
+        case 10: return 188;
+        case 11: return 375;
+        default: return 750;
+      }
+    }
+
+    void setWaitForConversion(bool wait) { waitForConversion = wait; }
+
+    bool requestTemperaturesByAddress(const uint8_t* address) {
+      hostAdvanceMicros(HOST_ONE_WIRE_READ_MICROS / 3);
+      hostDs18b20Conversions++;
+      if (waitForConversion) {
+        delay(millisToWaitForConversion(resolution));
+      }
+      return hostDs18b20Present;
+    }
+
+    void requestTemperatures() { requestTemperaturesByAddress(nullptr); }
+
+    float getTempC(const uint8_t* address) {
+      hostAdvanceMicros(HOST_ONE_WIRE_READ_MICROS);
+      return hostDs18b20Present ? roundf(hostDs18b20TempC * 16) / 16 : DEVICE_DISCONNECTED_C;
+    }
+
+    static float toFahrenheit(float celsius) { return celsius * 1.8f + 32.0f; }
+
+  private:
+    OneWire* bus;
+    uint8_t resolution = 12;
+    bool waitForConversion = true;
+};
+
+#endif // HOST_DALLAS_TEMPERATURE_H
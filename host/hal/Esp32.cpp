@@ -0,0 +1,279 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_heap_caps.h>
+#include <soc/gpio_reg.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <climits>
+#include "host_sim.h"
+
+EspClass ESP;
+WiFiClass WiFi;
+
+static const std::thread::id loopTask = std::this_thread::get_id(); // static init runs on the main thread
+static std::atomic<bool> tasksStopping(false);
+static std::mutex parkMutex;
+static std::condition_variable parked;
+
+// When each task other than the loop next runs (micros): 0 while it is running, ULLONG_MAX once parked.
+// The loop only moves the clock on once every task is blocked past the new time, so a task gets every
+// tick it would have had on the board however fast the loop runs on the host.
+#define HOST_MAX_TASKS 4
+static std::atomic<unsigned long long> taskWakeAt[HOST_MAX_TASKS];
+static std::atomic<int> taskCount(0);
+static thread_local int taskIndex = -1;
+
+// ---- FreeRTOS ----
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t core) {
+  int index = taskCount.load();
+  if (index >= HOST_MAX_TASKS) {
+    return pdFAIL;
+  }
+  taskWakeAt[index] = 0;
+  taskCount = index + 1;
+  std::thread thread([task, parameter, index]() {
+    taskIndex = index;
+    task(parameter);
+  });
+  if (createdTask != nullptr) {
+    *createdTask = nullptr;
+  }
+  thread.detach();
+  return pdPASS;
+}
+
+// A task that has ended (or is stopped at the end of the run) waits here for the process to exit
+[[noreturn]] static void parkTask() {
+  if (taskIndex >= 0) {
+    taskWakeAt[taskIndex] = ULLONG_MAX;
+  }
+  std::unique_lock<std::mutex> lock(parkMutex);
+  for (;;) {
+    parked.wait(lock);
+  }
+}
+
+// Wait until every other task has run up to the current time and is blocked again
+static void waitForTasks() {
+  for (int i = 0; i < taskCount; i++) {
+    while (taskWakeAt[i] <= hostNowMicros() && !tasksStopping) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/**
+ * On the loop task: skip the time a millisecond at a time, as delay() does, letting the other tasks catch
+ * up after each. On another task: wait for the loop to move the clock on.
+ */
+void vTaskDelay(TickType_t ticks) {
+  if (std::this_thread::get_id() == loopTask) {
+    for (unsigned long i = 0; i < ticks * portTICK_PERIOD_MS; i++) {
+      delay(1);
+      waitForTasks();
+    }
+    return;
+  }
+  unsigned long long until = hostNowMicros() + (unsigned long long)ticks * portTICK_PERIOD_MS * 1000;
+  if (taskIndex >= 0) {
+    taskWakeAt[taskIndex] = until;
+  }
+  while (hostNowMicros() < until) {
+    if (tasksStopping) {
+      parkTask();
+    }
+    std::this_thread::yield();
+  }
+  if (tasksStopping) {
+    parkTask();
+  }
+  if (taskIndex >= 0) {
+    taskWakeAt[taskIndex] = 0;
+  }
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr && std::this_thread::get_id() != loopTask) {
+    parkTask();
+  }
+}
+
+/**
+ * Called by main() once the scenario has ended: every other task stops at its next vTaskDelay().
+ */
+void hostStopTasks() {
+  tasksStopping = true;
+}
+
+// ---- Hardware timers ----
+
+#define HOST_MAX_TIMERS 4
+#define HOST_APB_CLOCK_MHZ 80
+
+struct hw_timer_t {
+  uint16_t divider;
+  uint64_t alarm; // in timer ticks
+  bool autoreload;
+  bool enabled;
+  void (*handler)();
+  unsigned long long nextFire; // micros
+};
+
+static hw_timer_t timers[HOST_MAX_TIMERS];
+static bool timersPumped = false;
+static unsigned long timerInterrupts = 0;
+
+static unsigned long long timerPeriodMicros(const hw_timer_t& timer) {
+  unsigned long long us = timer.alarm * timer.divider / HOST_APB_CLOCK_MHZ;
+  return us > 0 ? us : 1;
+}
+
+// Fire every alarm that has come due, on the loop task (the interrupts are attached from setup())
+static void fireTimers() {
+  if (std::this_thread::get_id() != loopTask) {
+    return;
+  }
+  unsigned long long now = hostNowMicros();
+  for (hw_timer_t& timer : timers) {
+    while (timer.enabled && timer.handler != nullptr && timer.nextFire <= now) {
+      timer.nextFire += timerPeriodMicros(timer);
+      if (!timer.autoreload) {
+        timer.enabled = false;
+      }
+      timerInterrupts++;
+      timer.handler();
+    }
+  }
+}
+
+hw_timer_t* timerBegin(uint8_t number, uint16_t divider, bool countUp) {
+  if (number >= HOST_MAX_TIMERS) {
+    return nullptr;
+  }
+  if (!timersPumped) {
+    hostAddPumpHandler(fireTimers);
+    timersPumped = true;
+  }
+  timers[number] = hw_timer_t{divider, 0, false, false, nullptr, 0};
+  return &timers[number];
+}
+
+void timerAttachInterrupt(hw_timer_t* timer, void (*handler)(), bool edge) {
+  timer->handler = handler;
+}
+
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoreload) {
+  timer->alarm = alarmValue;
+  timer->autoreload = autoreload;
+}
+
+void timerWrite(hw_timer_t* timer, uint64_t value) {
+  timer->nextFire = hostNowMicros() + timerPeriodMicros(*timer) - value * timer->divider / HOST_APB_CLOCK_MHZ;
+}
+
+void timerAlarmEnable(hw_timer_t* timer) {
+  timer->enabled = true;
+}
+
+void timerAlarmDisable(hw_timer_t* timer) {
+  timer->enabled = false;
+}
+
+unsigned long hostTimerInterrupts() {
+  return timerInterrupts;
+}
+
+// ---- Registers ----
+
+static unsigned long gpioWrites = 0;
+
+void hostRegWrite(uint32_t reg, uint32_t value) {
+  if (reg != GPIO_OUT_W1TS_REG && reg != GPIO_OUT_W1TC_REG) {
+    return;
+  }
+  gpioWrites++;
+  for (uint8_t pin = 0; pin < 32; pin++) {
+    if (value & (1UL << pin)) {
+      digitalWrite(pin, reg == GPIO_OUT_W1TS_REG ? HIGH : LOW);
+    }
+  }
+}
+
+unsigned long hostGpioWrites() {
+  return gpioWrites;
+}
+
+// ---- Heap ----
+
+static size_t minimumFreeHeap = HOST_RAM_SIZE;
+
+uint32_t EspClass::getFreeHeap() {
+  size_t used = hostHeapInUse();
+  size_t free = used < HOST_RAM_SIZE ? HOST_RAM_SIZE - used : 0;
+  if (free < minimumFreeHeap) {
+    minimumFreeHeap = free;
+  }
+  return free;
+}
+
+void EspClass::restart() {
+  hostSystemReset();
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  size_t free = ESP.getFreeHeap();
+  info->total_free_bytes = free;
+  info->total_allocated_bytes = hostHeapInUse();
+  info->largest_free_block = free;
+  info->minimum_free_bytes = minimumFreeHeap;
+  info->allocated_blocks = 0;
+  info->free_blocks = hostHeapFreeBlocks();
+  info->total_blocks = info->free_blocks;
+}
+
+// ---- Wi-Fi ----
+
+static bool wifiAvailable = true;
+static bool wifiStarted = false;
+static unsigned long wifiConnectAt = 0;
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+  wifiStarted = true;
+  wifiConnectAt = millis() + HOST_WIFI_CONNECT_MS;
+  return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  if (!wifiStarted) {
+    return WL_IDLE_STATUS;
+  }
+  if (!wifiAvailable) {
+    return WL_DISCONNECTED;
+  }
+  return millis() >= wifiConnectAt ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::reconnect() {
+  wifiConnectAt = millis() + HOST_WIFI_CONNECT_MS;
+  return true;
+}
+
+bool WiFiClass::disconnect() {
+  wifiStarted = false;
+  return true;
+}
+
+IPAddress WiFiClass::localIP() {
+  return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 60) : IPAddress(0, 0, 0, 0);
+}
+
+void hostWifiSetAvailable(bool available) {
+  if (available && !wifiAvailable) {
+    wifiConnectAt = millis() + HOST_WIFI_CONNECT_MS;
+  }
+  wifiAvailable = available;
+}
@@ -0,0 +1,183 @@
+#include <EthernetLarge.h>
+#include "host_sim.h"
+
+EthernetClass Ethernet;
+
+struct HostSocket {
+  bool open;        // connected and not stopped by the sketch
+  bool peerClosed;  // the client has closed its end
+  uint16_t port;
+  uint8_t rx[HOST_SOCKET_RX_SIZE];
+  size_t rxHead;
+  size_t rxLength;
+  uint8_t tx[HOST_SOCKET_TX_SIZE];
+  size_t txLength;
+};
+
+static HostSocket sockets[MAX_SOCK_NUM];
+static uint16_t listeningPort = 0;
+static bool linkUp = true;
+
+int EthernetClass::begin(uint8_t* mac, unsigned long timeout, unsigned long responseTimeout) {
+  delay(200); // DHCP
+  return linkUp ? 1 : 0;
+}
+
+void EthernetClass::begin(uint8_t* mac, IPAddress ip, IPAddress dns) {
+}
+
+EthernetHardwareStatus EthernetClass::hardwareStatus() {
+  return EthernetW5500;
+}
+
+EthernetLinkStatus EthernetClass::linkStatus() {
+  return linkUp ? LinkON : LinkOFF;
+}
+
+IPAddress EthernetClass::localIP() {
+  return IPAddress(192, 168, 1, 177);
+}
+
+// ---- Client ----
+
+size_t EthernetClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t EthernetClient::write(const uint8_t* buffer, size_t size) {
+  if (socket >= MAX_SOCK_NUM || !sockets[socket].open) {
+    setWriteError();
+    return 0;
+  }
+  HostSocket& s = sockets[socket];
+  size_t count = min(size, HOST_SOCKET_TX_SIZE - s.txLength);
+  memcpy(s.tx + s.txLength, buffer, count);
+  s.txLength += count;
+  return count;
+}
+
+int EthernetClient::available() {
+  hostPump();
+  return socket < MAX_SOCK_NUM && sockets[socket].open ? sockets[socket].rxLength : 0;
+}
+
+int EthernetClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int EthernetClient::read(uint8_t* buffer, size_t size) {
+  if (socket >= MAX_SOCK_NUM || !sockets[socket].open) {
+    return -1;
+  }
+  HostSocket& s = sockets[socket];
+  size_t count = min(size, s.rxLength);
+  for (size_t i = 0; i < count; i++) {
+    buffer[i] = s.rx[s.rxHead];
+    s.rxHead = (s.rxHead + 1) % HOST_SOCKET_RX_SIZE;
+  }
+  s.rxLength -= count;
+  return count;
+}
+
+int EthernetClient::peek() {
+  if (socket >= MAX_SOCK_NUM || sockets[socket].rxLength == 0) {
+    return -1;
+  }
+  return sockets[socket].rx[sockets[socket].rxHead];
+}
+
+void EthernetClient::stop() {
+  if (socket < MAX_SOCK_NUM) {
+    sockets[socket].open = false;
+    sockets[socket].rxLength = 0;
+  }
+}
+
+uint8_t EthernetClient::connected() {
+  if (socket >= MAX_SOCK_NUM || !sockets[socket].open) {
+    return 0;
+  }
+  // As with the W5500, a closed connection still reads as connected until its data has been read
+  return !sockets[socket].peerClosed || sockets[socket].rxLength > 0;
+}
+
+// ---- Server ----
+
+void EthernetServer::begin() {
+  listeningPort = port;
+}
+
+EthernetClient EthernetServer::available() {
+  hostPump();
+  for (uint8_t i = 0; i < MAX_SOCK_NUM; i++) {
+    if (sockets[i].open && sockets[i].port == port && sockets[i].rxLength > 0) {
+      return EthernetClient(i);
+    }
+  }
+  return EthernetClient();
+}
+
+// ---- Simulation side ----
+
+void hostEthernetSetLink(bool up) {
+  linkUp = up;
+}
+
+/**
+ * A client connects to `port`. A socket the sketch has stopped is reused once its output has been read.
+ */
+int hostEthernetConnect(uint16_t port) {
+  if (port != listeningPort) {
+    return -1;
+  }
+  for (int i = 0; i < MAX_SOCK_NUM; i++) {
+    HostSocket& s = sockets[i];
+    if (!s.open && s.txLength == 0) {
+      s.open = true;
+      s.peerClosed = false;
+      s.port = port;
+      s.rxHead = 0;
+      s.rxLength = 0;
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool hostEthernetSend(int socket, const char* data, size_t length) {
+  if (socket < 0 || socket >= MAX_SOCK_NUM || !sockets[socket].open) {
+    return false;
+  }
+  HostSocket& s = sockets[socket];
+  if (s.rxLength + length > HOST_SOCKET_RX_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    s.rx[(s.rxHead + s.rxLength + i) % HOST_SOCKET_RX_SIZE] = data[i];
+  }
+  s.rxLength += length;
+  return true;
+}
+
+size_t hostEthernetReceive(int socket, char* data, size_t size) {
+  if (socket < 0 || socket >= MAX_SOCK_NUM) {
+    return 0;
+  }
+  HostSocket& s = sockets[socket];
+  size_t count = min(size, s.txLength);
+  memcpy(data, s.tx, count);
+  memmove(s.tx, s.tx + count, s.txLength - count);
+  s.txLength -= count;
+  return count;
+}
+
+bool hostEthernetClosed(int socket) {
+  return socket < 0 || socket >= MAX_SOCK_NUM || !sockets[socket].open;
+}
+
+void hostEthernetClose(int socket) {
+  if (socket >= 0 && socket < MAX_SOCK_NUM) {
+    sockets[socket].peerClosed = true;
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef HOST_ETHERNET_LARGE_H
+#define HOST_ETHERNET_LARGE_H
+
+#include <Arduino.h>
+
+/*
+  The MKR ETH shield (W5500) as EthernetLarge sees it: MAX_SOCK_NUM sockets, each with its own receive
+  buffer. Local API clients are simulated at the socket level: the test side opens a socket on the server's
+  port (hostEthernetConnect()), sends the request and reads back what the sketch wrote until it stops the
+  client. The Firebase connection doesn't use these sockets, SSLClient.h simulates it.
+*/
+
+#define MAX_SOCK_NUM 8
+#define HOST_SOCKET_RX_SIZE 2048   // the W5500's receive buffer per socket with 8 sockets
+#define HOST_SOCKET_TX_SIZE 16384  // what the sketch can write before the test side reads it
+
+enum EthernetHardwareStatus {
+  EthernetNoHardware,
+  EthernetW5100,
+  EthernetW5200,
+  EthernetW5500
+};
+
+enum EthernetLinkStatus {
+  Unknown,
+  LinkON,
+  LinkOFF
+};
+
+class EthernetClass {
+  public:
+    void init(uint8_t sspin) {}
+    int begin(uint8_t* mac, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
+    void begin(uint8_t* mac, IPAddress ip, IPAddress dns);
+    EthernetHardwareStatus hardwareStatus();
+    EthernetLinkStatus linkStatus();
+    IPAddress localIP();
+};
+
+extern EthernetClass Ethernet;
+
+class EthernetClient : public Client {
+  public:
+    EthernetClient() : socket(MAX_SOCK_NUM) {}
+    explicit EthernetClient(uint8_t socket) : socket(socket) {}
+
+    // Outgoing connections aren't simulated (the sketches only use them through SSLClient)
+    int connect(IPAddress ip, uint16_t port) override { return 0; }
+    int connect(const char* host, uint16_t port) override { return 0; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return socket < MAX_SOCK_NUM; }
+    bool operator==(const EthernetClient& other) const { return socket == other.socket; }
+
+    uint8_t getSocketNumber() const { return socket; }
+
+    using Print::write;
+
+  private:
+    uint8_t socket;
+};
+
+class EthernetServer : public Server {
+  public:
+    explicit EthernetServer(uint16_t port) : port(port) {}
+
+    void begin() override;
+    EthernetClient available(); // a connected socket with data waiting
+    size_t write(uint8_t c) override { return 0; }
+
+    using Print::write;
+
+  private:
+    uint16_t port;
+};
+
+// Simulation side
+void hostEthernetSetLink(bool up);                                   // the cable (LinkOFF while down)
+int hostEthernetConnect(uint16_t port);                              // a client connects, -1 if no socket is free
+bool hostEthernetSend(int socket, const char* data, size_t length);  // false if the receive buffer is full
+size_t hostEthernetReceive(int socket, char* data, size_t size);     // what the sketch wrote, once
+bool hostEthernetClosed(int socket);                                 // the sketch has stopped the client
+void hostEthernetClose(int socket);                                  // the client closes its end
+
+#endif // HOST_ETHERNET_LARGE_H
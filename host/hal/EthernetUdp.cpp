@@ -0,0 +1,78 @@
+#include <EthernetUdp.h>
+#include "host_sim.h"
+
+#define NTP_PORT 123
+#define SECONDS_FROM_1900_TO_1970 2208988800UL
+
+static bool ntpReachable = true;
+static unsigned long ntpEpochBase = 1767225600; // 2026-01-01
+static unsigned long ntpEpochSetAt = 0;
+
+uint8_t EthernetUDP::begin(uint16_t port) {
+  this->port = port;
+  return 1;
+}
+
+void EthernetUDP::stop() {
+  port = 0;
+  replyAt = 0;
+  replyLength = 0;
+}
+
+int EthernetUDP::beginPacket(const char* host, uint16_t port) {
+  remotePort = port;
+  return 1;
+}
+
+int EthernetUDP::beginPacket(IPAddress ip, uint16_t port) {
+  remotePort = port;
+  return 1;
+}
+
+size_t EthernetUDP::write(const uint8_t* buffer, size_t size) {
+  return size;
+}
+
+int EthernetUDP::endPacket() {
+  if (remotePort == NTP_PORT && ntpReachable) {
+    replyAt = hostNowMicros() + HOST_NTP_REPLY_MS * 1000ULL;
+  }
+  return 1;
+}
+
+int EthernetUDP::parsePacket() {
+  if (replyAt == 0 || hostNowMicros() < replyAt) {
+    return 0;
+  }
+  replyAt = 0;
+  memset(reply, 0, sizeof(reply));
+  reply[0] = 0b00100100; // LI 0, version 4, server mode
+  unsigned long secondsSince1900 = hostNtpEpoch() + SECONDS_FROM_1900_TO_1970;
+  reply[40] = secondsSince1900 >> 24;
+  reply[41] = secondsSince1900 >> 16;
+  reply[42] = secondsSince1900 >> 8;
+  reply[43] = secondsSince1900;
+  replyLength = sizeof(reply);
+  replyRead = 0;
+  return replyLength;
+}
+
+int EthernetUDP::read(uint8_t* buffer, size_t length) {
+  int count = min((int)length, replyLength - replyRead);
+  memcpy(buffer, reply + replyRead, count);
+  replyRead += count;
+  return count;
+}
+
+void hostNtpSetReachable(bool reachable) {
+  ntpReachable = reachable;
+}
+
+void hostNtpSetEpoch(unsigned long epoch) {
+  ntpEpochBase = epoch;
+  ntpEpochSetAt = millis();
+}
+
+unsigned long hostNtpEpoch() {
+  return ntpEpochBase + (millis() - ntpEpochSetAt) / 1000;
+}
@@ -0,0 +1,43 @@
+#ifndef HOST_ETHERNET_UDP_H
+#define HOST_ETHERNET_UDP_H
+
+#include <Arduino.h>
+
+#define HOST_NTP_REPLY_MS 30 // round trip to the NTP pool
+#define HOST_UDP_PACKET_SIZE 48
+
+/**
+ * UDP as the hub uses it: one request to an NTP server at a time. A packet sent to port 123 is answered
+ * HOST_NTP_REPLY_MS later with a 48 byte NTP reply whose transmit timestamp is the simulated wall clock,
+ * unless the NTP server is unreachable (hostNtpSetReachable()).
+ */
+class EthernetUDP {
+  public:
+    uint8_t begin(uint16_t port);
+    void stop();
+    uint16_t localPort() const { return port; }
+
+    int beginPacket(const char* host, uint16_t port);
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t* buffer, size_t size);
+    int endPacket();
+
+    int parsePacket();
+    int read(uint8_t* buffer, size_t length);
+    int available() { return replyLength - replyRead; }
+
+  private:
+    uint16_t port = 0;
+    uint16_t remotePort = 0;
+    unsigned long long replyAt = 0; // micros, 0 if no reply is on its way
+    uint8_t reply[HOST_UDP_PACKET_SIZE];
+    int replyLength = 0;
+    int replyRead = 0;
+};
+
+// Simulation side
+void hostNtpSetReachable(bool reachable);
+void hostNtpSetEpoch(unsigned long epoch); // Unix time now, advancing with millis() from here
+unsigned long hostNtpEpoch();
+
+#endif // HOST_ETHERNET_UDP_H
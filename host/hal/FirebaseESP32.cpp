@@ -0,0 +1,215 @@
+#include <FirebaseESP32.h>
+#include <WiFi.h>
+#include "host_sim.h"
+
+FirebaseESP32 Firebase;
+
+struct HostStreamEvent {
+  char eventType[8];
+  char path[96];
+  char dataType[12];
+  char data[HOST_RTDB_VALUE_SIZE];
+};
+
+struct HostRtdbValue {
+  char path[96];
+  char value[HOST_RTDB_VALUE_SIZE];
+};
+
+static std::mutex streamMutex;
+static HostStreamEvent streamQueue[HOST_RTDB_STREAM_QUEUE];
+static size_t streamHead = 0;
+static size_t streamCount = 0;
+static unsigned long eventsRead = 0;
+static HostRtdbValue values[HOST_RTDB_MAX_VALUES];
+static size_t valueCount = 0;
+static bool rtdbReady = true;
+
+// ---- FirebaseJson ----
+
+bool FirebaseJson::setJsonData(const char* json) {
+  return !deserializeJson(doc, json);
+}
+
+/**
+ * Look up a value by its path below the root ("/a/b" or "a/b"), converted as the library does.
+ */
+bool FirebaseJson::get(FirebaseJsonData& result, const String& path) {
+  const JsonSlot* slot = doc.root();
+  const char* p = path.c_str();
+  while (*p != '\0' && slot != nullptr) {
+    if (*p == '/') {
+      p++;
+      continue;
+    }
+    const char* end = strchr(p, '/');
+    size_t length = end != nullptr ? (size_t)(end - p) : strlen(p);
+    const JsonSlot* member = slot->type == JSON_OBJECT ? slot->child : nullptr;
+    while (member != nullptr && !(strlen(member->key) == length && strncmp(member->key, p, length) == 0)) {
+      member = member->next;
+    }
+    slot = member;
+    p += length;
+  }
+
+  result.success = slot != nullptr;
+  result.intValue = 0;
+  result.floatValue = 0;
+  result.stringValue = "";
+  if (slot == nullptr) {
+    result.type = "";
+    return false;
+  }
+  char number[24];
+  switch (slot->type) {
+    case JSON_NULL:
+      result.type = "null";
+      break;
+    case JSON_BOOL:
+      result.type = "boolean";
+      result.intValue = slot->value.boolean;
+      result.stringValue = slot->value.boolean ? "true" : "false";
+      break;
+    case JSON_INT:
+    case JSON_UINT:
+      result.type = "int";
+      result.intValue = (int)slot->value.integer;
+      result.floatValue = (float)slot->value.integer;
+      snprintf(number, sizeof(number), "%lld", (long long)slot->value.integer);
+      result.stringValue = number;
+      break;
+    case JSON_FLOAT:
+    case JSON_DOUBLE:
+      result.type = "float";
+      result.intValue = (int)slot->value.number;
+      result.floatValue = (float)slot->value.number;
+      snprintf(number, sizeof(number), "%g", slot->value.number);
+      result.stringValue = number;
+      break;
+    case JSON_STRING:
+      result.type = "string";
+      result.stringValue = slot->value.string;
+      result.intValue = result.stringValue.toInt();
+      break;
+    default:
+      result.type = slot->type == JSON_OBJECT ? "object" : "array";
+      break;
+  }
+  return true;
+}
+
+// ---- FirebaseData ----
+
+bool FirebaseData::streamAvailable() {
+  return available;
+}
+
+FirebaseJson& FirebaseData::jsonObject() {
+  return json;
+}
+
+// ---- Firebase ----
+
+void FirebaseESP32::begin(FirebaseConfig* config, FirebaseAuth* auth) {
+}
+
+bool FirebaseESP32::ready() {
+  return rtdbReady && WiFi.status() == WL_CONNECTED;
+}
+
+bool FirebaseESP32::beginStream(FirebaseData& data, const String& path) {
+  data.stream = path;
+  data.connected = ready();
+  data.code = data.connected ? 200 : -1;
+  data.error = data.connected ? "" : "not connected";
+  return data.connected;
+}
+
+/**
+ * Take the next queued stream event, if any.
+ */
+bool FirebaseESP32::readStream(FirebaseData& data) {
+  data.available = false;
+  if (!ready()) {
+    data.connected = false;
+    data.error = "not connected";
+    return false;
+  }
+  data.connected = true;
+  HostStreamEvent event;
+  {
+    std::lock_guard<std::mutex> lock(streamMutex);
+    if (streamCount == 0) {
+      return true;
+    }
+    event = streamQueue[streamHead];
+    streamHead = (streamHead + 1) % HOST_RTDB_STREAM_QUEUE;
+    streamCount--;
+    eventsRead++;
+  }
+  data.event = event.eventType;
+  data.path = event.path;
+  data.type = event.dataType;
+  data.data = event.data;
+  if (data.data.length() > data.maxPayload) {
+    data.maxPayload = data.data.length();
+  }
+  if (data.type == "json") {
+    data.json.setJsonData(event.data);
+  }
+  data.available = true;
+  return true;
+}
+
+bool FirebaseESP32::getString(FirebaseData& data, const String& path) {
+  for (size_t i = 0; i < valueCount; i++) {
+    if (path == values[i].path) {
+      data.type = "string";
+      data.data = values[i].value;
+      data.code = 200;
+      return true;
+    }
+  }
+  data.code = 200;
+  data.error = "path not exist";
+  return false;
+}
+
+// ---- Simulation side ----
+
+bool hostRtdbStreamEvent(const char* eventType, const char* path, const char* dataType, const char* data) {
+  std::lock_guard<std::mutex> lock(streamMutex);
+  if (streamCount == HOST_RTDB_STREAM_QUEUE) {
+    return false;
+  }
+  HostStreamEvent& event = streamQueue[(streamHead + streamCount) % HOST_RTDB_STREAM_QUEUE];
+  snprintf(event.eventType, sizeof(event.eventType), "%s", eventType);
+  snprintf(event.path, sizeof(event.path), "%s", path);
+  snprintf(event.dataType, sizeof(event.dataType), "%s", dataType);
+  snprintf(event.data, sizeof(event.data), "%s", data);
+  streamCount++;
+  return true;
+}
+
+void hostRtdbSetString(const char* path, const char* value) {
+  for (size_t i = 0; i < valueCount; i++) {
+    if (strcmp(values[i].path, path) == 0) {
+      snprintf(values[i].value, sizeof(values[i].value), "%s", value);
+      return;
+    }
+  }
+  if (valueCount < HOST_RTDB_MAX_VALUES) {
+    snprintf(values[valueCount].path, sizeof(values[valueCount].path), "%s", path);
+    snprintf(values[valueCount].value, sizeof(values[valueCount].value), "%s", value);
+    valueCount++;
+  }
+}
+
+void hostRtdbSetReady(bool ready) {
+  rtdbReady = ready;
+}
+
+unsigned long hostRtdbEventsRead() {
+  std::lock_guard<std::mutex> lock(streamMutex);
+  return eventsRead;
+}
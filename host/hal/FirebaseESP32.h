@@ -0,0 +1,110 @@
+#ifndef HOST_FIREBASE_ESP32_H
+#define HOST_FIREBASE_ESP32_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <mutex>
+
+/*
+  Firebase-ESP32 against a simulated Realtime Database. The test side queues stream events with
+  hostRtdbStreamEvent() (from any thread); the sketch's next Firebase.readStream() takes one, the way
+  the library hands over one server-sent event per call. getString() answers from hostRtdbSetString()
+  values. The library's Strings are kept, so the allocations it makes on the board happen here too.
+*/
+
+#define FIREBASE_CLIENT_VERSION "4.3.12"
+#define HOST_RTDB_STREAM_QUEUE 32
+#define HOST_RTDB_VALUE_SIZE 512
+#define HOST_RTDB_MAX_VALUES 8
+
+struct FirebaseJsonData {
+  bool success = false;
+  String type;
+  int intValue = 0;
+  float floatValue = 0;
+  String stringValue;
+};
+
+class FirebaseJson {
+  public:
+    bool setJsonData(const char* json);
+    bool get(FirebaseJsonData& result, const String& path);
+
+  private:
+    StaticJsonDocument<2048> doc;
+};
+
+struct FirebaseAuth {
+  struct {
+    String email;
+    String password;
+  } user;
+};
+
+struct FirebaseConfig {
+  String api_key;
+  String database_url;
+  struct {
+    bool test_mode = false;
+    struct {
+      String legacy_token;
+    } tokens;
+  } signer;
+};
+
+class FirebaseData {
+  public:
+    String errorReason() const { return error; }
+    int httpCode() const { return code; }
+    bool httpConnected() const { return connected; }
+    bool streamTimeout() const { return timedOut; }
+    bool streamAvailable();
+
+    String streamPath() const { return stream; }
+    String dataPath() const { return path; }
+    String dataType() const { return type; }
+    String eventType() const { return event; }
+    String stringData() const { return data; }
+    int intData() const { return data.toInt(); }
+    float floatData() const { return data.toFloat(); }
+    FirebaseJson& jsonObject();
+
+    size_t payloadLength() const { return data.length(); }
+    size_t maxPayloadLength() const { return maxPayload; }
+
+  private:
+    friend class FirebaseESP32;
+
+    String stream;
+    String path;
+    String type;
+    String event;
+    String data;
+    String error;
+    int code = 0;
+    bool connected = false;
+    bool timedOut = false;
+    bool available = false;
+    size_t maxPayload = 0;
+    FirebaseJson json;
+};
+
+class FirebaseESP32 {
+  public:
+    void begin(FirebaseConfig* config, FirebaseAuth* auth);
+    void reconnectWiFi(bool reconnect) {}
+    bool ready();
+    bool beginStream(FirebaseData& data, const String& path);
+    bool readStream(FirebaseData& data);
+    bool getString(FirebaseData& data, const String& path);
+};
+
+extern FirebaseESP32 Firebase;
+
+// Simulation side
+bool hostRtdbStreamEvent(const char* eventType, const char* path, const char* dataType, const char* data); // false if the queue is full
+void hostRtdbSetString(const char* path, const char* value);
+void hostRtdbSetReady(bool ready);
+unsigned long hostRtdbEventsRead();
+
+#endif // HOST_FIREBASE_ESP32_H
@@ -0,0 +1,122 @@
+#include <Arduino.h>
+#include "host_sim.h"
+#include <mutex>
+
+// Tasks on the ESP32 write to Serial from two threads; its core locks the UART the same way
+static std::mutex writeMutex;
+
+HardwareSerial Serial("Serial", false);
+HardwareSerial Serial1("Serial1", true);
+
+HardwareSerial::HardwareSerial(const char* name, bool capture) : name(name), capture(capture) {
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+  this->baud = baud;
+}
+
+void HardwareSerial::end() {
+  baud = 0;
+  ringLength = 0;
+}
+
+/**
+ * Moves the bytes that have finished crossing the wire into the receive ring, dropping them when it is full
+ * as the UART would.
+ */
+void HardwareSerial::hostDeliver() {
+  if (wireLength == 0 || baud == 0) {
+    return;
+  }
+  unsigned long long characterMicros = 10000000ULL / baud;
+  if (characterMicros == 0) {
+    characterMicros = 1;
+  }
+  unsigned long long now = hostNowMicros();
+  if (nextArrival == 0) {
+    nextArrival = now;
+  }
+  while (wireLength > 0 && nextArrival <= now) {
+    uint8_t c = wire[wireHead];
+    wireHead = (wireHead + 1) % HOST_UART_WIRE_SIZE;
+    wireLength--;
+    if (ringLength < SERIAL_BUFFER_SIZE) {
+      ring[(ringHead + ringLength) % SERIAL_BUFFER_SIZE] = c;
+      ringLength++;
+      bytesReceived++;
+    } else {
+      rxOverruns++;
+    }
+    nextArrival += characterMicros;
+  }
+  if (wireLength == 0) {
+    nextArrival = 0;
+  }
+}
+
+int HardwareSerial::available() {
+  hostPump();
+  return ringLength;
+}
+
+int HardwareSerial::read() {
+  if (ringLength == 0) {
+    hostPump();
+  }
+  if (ringLength == 0) {
+    return -1;
+  }
+  uint8_t c = ring[ringHead];
+  ringHead = (ringHead + 1) % SERIAL_BUFFER_SIZE;
+  ringLength--;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  return ringLength > 0 ? ring[ringHead] : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  bytesWritten += size;
+  if (echo != nullptr) {
+    fwrite(buffer, 1, size, echo);
+  }
+  if (capture) {
+    for (size_t i = 0; i < size && capturedLength < HOST_UART_CAPTURE_SIZE; i++) {
+      captured[(capturedHead + capturedLength) % HOST_UART_CAPTURE_SIZE] = buffer[i];
+      capturedLength++;
+    }
+  }
+  return size;
+}
+
+bool HardwareSerial::hostFeed(const uint8_t* data, size_t length) {
+  if (wireLength + length > HOST_UART_WIRE_SIZE) {
+    wireOverflows++;
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    wire[(wireHead + wireLength) % HOST_UART_WIRE_SIZE] = data[i];
+    wireLength++;
+  }
+  return true;
+}
+
+bool HardwareSerial::hostFeed(const char* text) {
+  return hostFeed((const uint8_t*)text, strlen(text));
+}
+
+size_t HardwareSerial::hostDrain(uint8_t* data, size_t size) {
+  size_t count = 0;
+  while (count < size && capturedLength > 0) {
+    data[count++] = captured[capturedHead];
+    capturedHead = (capturedHead + 1) % HOST_UART_CAPTURE_SIZE;
+    capturedLength--;
+  }
+  return count;
+}
@@ -0,0 +1,70 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+#include <stdio.h>
+#include "Stream.h"
+
+#define SERIAL_BUFFER_SIZE 64      // receive ring of the SAMD core's UART
+#define HOST_UART_WIRE_SIZE 65536  // bytes the other end can have on the wire ahead of the receive ring
+#define HOST_UART_CAPTURE_SIZE 65536
+
+/**
+ * A UART of the simulated board. Bytes the other end sends (hostFeed()) arrive one character time
+ * (10 bits at the baud rate) apart into a SERIAL_BUFFER_SIZE receive ring, as the board's UART
+ * interrupt would put them there; bytes arriving while the ring is full are lost and counted in
+ * rxOverruns. Bytes the sketch writes are kept for the other end to read (hostDrain()) and/or echoed to a file.
+ */
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(const char* name, bool capture);
+
+    void begin(unsigned long baud);
+    void begin(unsigned long baud, uint16_t config) { begin(baud); }
+    void end();
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() override { return SERIAL_BUFFER_SIZE; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override {}
+    operator bool() { return true; }
+
+    using Print::write;
+
+    // Simulation side
+    bool hostFeed(const uint8_t* data, size_t length);
+    bool hostFeed(const char* text);
+    size_t hostDrain(uint8_t* data, size_t size);
+    void hostEcho(FILE* file) { echo = file; }
+    void hostDeliver(); // move the bytes whose time has come into the receive ring (called by the pump)
+    size_t hostWireBacklog() const { return wireLength; }
+
+    const char* name;
+    unsigned long baud = 0;
+    unsigned long bytesReceived = 0;
+    unsigned long bytesWritten = 0;
+    unsigned long rxOverruns = 0;
+    unsigned long wireOverflows = 0;
+
+  private:
+    uint8_t ring[SERIAL_BUFFER_SIZE];
+    size_t ringHead = 0;
+    size_t ringLength = 0;
+
+    uint8_t wire[HOST_UART_WIRE_SIZE];
+    size_t wireHead = 0;
+    size_t wireLength = 0;
+    unsigned long long nextArrival = 0; // micros the byte at the head of the wire arrives
+
+    bool capture;
+    uint8_t captured[HOST_UART_CAPTURE_SIZE];
+    size_t capturedHead = 0;
+    size_t capturedLength = 0;
+    FILE* echo = nullptr;
+};
+
+extern HardwareSerial Serial;  // USB, echoed to stdout when HOST_SERIAL_ECHO is set
+extern HardwareSerial Serial1; // UART between the boards
+
+#endif // HOST_HARDWARE_SERIAL_H
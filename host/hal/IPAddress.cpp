@@ -0,0 +1,16 @@
+#include <Arduino.h>
+
+bool IPAddress::operator==(const IPAddress& other) const {
+  return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+size_t IPAddress::printTo(Print& p) const {
+  size_t n = 0;
+  for (int i = 0; i < 4; i++) {
+    n += p.print(bytes[i], DEC);
+    if (i < 3) {
+      n += p.print('.');
+    }
+  }
+  return n;
+}
@@ -0,0 +1,21 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+#include "Print.h"
+
+class IPAddress : public Printable {
+  public:
+    IPAddress() : bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return bytes[index]; }
+    bool operator==(const IPAddress& other) const;
+
+    size_t printTo(Print& p) const override;
+
+  private:
+    uint8_t bytes[4];
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,81 @@
+#include <LiquidCrystal_I2C.h>
+#include "host_sim.h"
+
+static const uint8_t rowOffsets[HOST_LCD_MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows)
+  : cols(min(cols, (uint8_t)HOST_LCD_MAX_COLS)), rows(min(rows, (uint8_t)HOST_LCD_MAX_ROWS)) {
+  memset(ram, ' ', sizeof(ram));
+}
+
+void LiquidCrystal_I2C::command() {
+  hostTransfers++;
+  hostAdvanceMicros(HOST_LCD_TRANSFER_MICROS);
+}
+
+void LiquidCrystal_I2C::init() {
+  delay(50); // power on wait of the HD44780 initialisation sequence
+  clear();
+}
+
+void LiquidCrystal_I2C::clear() {
+  memset(ram, ' ', sizeof(ram));
+  address = 0;
+  command();
+  delayMicroseconds(2000); // the clear command takes about 1.5ms
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  if (row >= rows) {
+    row = rows - 1;
+  }
+  address = rowOffsets[row] + col;
+  command();
+}
+
+void LiquidCrystal_I2C::backlight() {
+  backlightOn = true;
+  command();
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+  backlightOn = false;
+  command();
+}
+
+void LiquidCrystal_I2C::createChar(uint8_t location, uint8_t charmap[]) {
+  for (int i = 0; i < 9; i++) {
+    command();
+  }
+}
+
+/**
+ * Write at the cursor and advance it through the display RAM as the controller does (0x27 -> 0x40 -> 0x67 -> 0x00).
+ */
+size_t LiquidCrystal_I2C::write(uint8_t c) {
+  ram[address & 0x7F] = c;
+  address++;
+  if (address == 0x28) {
+    address = 0x40;
+  } else if (address == 0x68) {
+    address = 0x00;
+  }
+  command();
+  return 1;
+}
+
+char LiquidCrystal_I2C::hostCharAt(uint8_t col, uint8_t row) const {
+  if (col >= cols || row >= rows) {
+    return '\0';
+  }
+  return ram[rowOffsets[row] + col];
+}
+
+const char* LiquidCrystal_I2C::hostRow(uint8_t row) {
+  for (uint8_t col = 0; col < cols; col++) {
+    char c = hostCharAt(col, row);
+    rowText[col] = (uint8_t)c < 0x20 ? '0' + c : c;
+  }
+  rowText[cols] = '\0';
+  return rowText;
+}
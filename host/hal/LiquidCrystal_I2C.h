@@ -0,0 +1,55 @@
+#ifndef HOST_LIQUID_CRYSTAL_I2C_H
+#define HOST_LIQUID_CRYSTAL_I2C_H
+
+#include <Arduino.h>
+
+#define HOST_LCD_MAX_COLS 20
+#define HOST_LCD_MAX_ROWS 4
+#define HOST_LCD_TRANSFER_MICROS 300 // one character or command through the PCF8574 backpack at 100kHz
+
+/**
+ * An HD44780 behind a PCF8574 I2C backpack. The display RAM is addressed as on the controller, so text
+ * running past the end of a row continues where the real display would put it (row 0 into row 2 on a
+ * 20x4). Every character and command costs HOST_LCD_TRANSFER_MICROS of simulated time, and is counted.
+ */
+class LiquidCrystal_I2C : public Print {
+  public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows);
+
+    void init();
+    void begin() { init(); }
+    void clear();
+    void home() { setCursor(0, 0); }
+    void setCursor(uint8_t col, uint8_t row);
+    void backlight();
+    void noBacklight();
+    void blink() { command(); }
+    void noBlink() { command(); }
+    void cursor() { command(); }
+    void noCursor() { command(); }
+    void display() { command(); }
+    void noDisplay() { command(); }
+    void createChar(uint8_t location, uint8_t charmap[]);
+
+    size_t write(uint8_t c) override;
+
+    using Print::write;
+
+    // Simulation side
+    char hostCharAt(uint8_t col, uint8_t row) const;
+    const char* hostRow(uint8_t row); // the row's text, custom characters shown as their code
+    bool hostBacklight() const { return backlightOn; }
+    unsigned long hostTransfers = 0;
+
+  private:
+    void command();
+
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t ram[128]; // DDRAM, 0x00-0x27 and 0x40-0x67 in use
+    uint8_t address = 0;
+    bool backlightOn = false;
+    char rowText[HOST_LCD_MAX_COLS + 1];
+};
+
+#endif // HOST_LIQUID_CRYSTAL_I2C_H
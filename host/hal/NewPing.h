@@ -0,0 +1,40 @@
+#ifndef HOST_NEW_PING_H
+#define HOST_NEW_PING_H
+
+#include <Arduino.h>
+#include "host_sim.h"
+
+/*
+  An HC-SR04 ultrasonic sensor measuring hostSonarDistanceCm. A ping blocks for the echo's round trip,
+  and returns 0 (no echo) beyond the maximum distance, as NewPing does.
+*/
+
+#define US_ROUNDTRIP_CM 57
+#define US_ROUNDTRIP_IN 146
+
+inline float hostSonarDistanceCm = 30.0;
+inline unsigned long hostSonarPings = 0;
+
+class NewPing {
+  public:
+    NewPing(uint8_t triggerPin, uint8_t echoPin, unsigned int maxDistanceCm = 500) : maxDistanceCm(maxDistanceCm) {}
+
+    unsigned long ping() {
+      hostSonarPings++;
+      if (hostSonarDistanceCm > maxDistanceCm) {
+        hostAdvanceMicros((unsigned long)maxDistanceCm * US_ROUNDTRIP_CM);
+        return 0;
+      }
+      unsigned long echo = (unsigned long)(hostSonarDistanceCm * US_ROUNDTRIP_CM);
+      hostAdvanceMicros(echo);
+      return echo;
+    }
+
+    unsigned long ping_cm() { return (ping() + US_ROUNDTRIP_CM / 2) / US_ROUNDTRIP_CM; }
+    unsigned long ping_in() { return (ping() + US_ROUNDTRIP_IN / 2) / US_ROUNDTRIP_IN; }
+
+  private:
+    unsigned int maxDistanceCm;
+};
+
+#endif // HOST_NEW_PING_H
@@ -0,0 +1,16 @@
+#ifndef HOST_ONE_WIRE_H
+#define HOST_ONE_WIRE_H
+
+#include <Arduino.h>
+
+/**
+ * The 1-Wire bus. DallasTemperature.h simulates the one device the monitor has on it, so this only holds the pin.
+ */
+class OneWire {
+  public:
+    explicit OneWire(uint8_t pin) : pin(pin) {}
+
+    uint8_t pin;
+};
+
+#endif // HOST_ONE_WIRE_H
@@ -0,0 +1,216 @@
+#include <Arduino.h>
+
+size_t Print::strlenOf(const char* str) {
+  return strlen(str);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (write(*buffer++)) {
+      n++;
+    } else {
+      break;
+    }
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper* str) {
+  return write(reinterpret_cast<const char*>(str));
+}
+
+size_t Print::print(const String& str) {
+  return write(str.c_str(), str.length());
+}
+
+size_t Print::print(const char str[]) {
+  return write(str);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base) {
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(long long value, int base) {
+  if (base == 0) {
+    return write((uint8_t)value);
+  }
+  if (base == 10 && value < 0) {
+    size_t n = print('-');
+    return n + printNumber(-(unsigned long long)value, 10);
+  }
+  return printNumber((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  if (base == 0) {
+    return write((uint8_t)value);
+  }
+  return printNumber(value, base);
+}
+
+size_t Print::print(double value, int digits) {
+  return printFloat(value, digits);
+}
+
+size_t Print::print(const Printable& printable) {
+  return printable.printTo(*this);
+}
+
+size_t Print::println() {
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper* str) {
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(const String& str) {
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(const char str[]) {
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(char c) {
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(unsigned char value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(int value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(long value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(long long value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long long value, int base) {
+  size_t n = print(value, base);
+  return n + println();
+}
+
+size_t Print::println(double value, int digits) {
+  size_t n = print(value, digits);
+  return n + println();
+}
+
+size_t Print::println(const Printable& printable) {
+  size_t n = print(printable);
+  return n + println();
+}
+
+size_t Print::printf(const char* format, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  return write(text, min((size_t)length, sizeof(text) - 1));
+}
+
+size_t Print::printNumber(unsigned long long value, uint8_t base) {
+  char text[8 * sizeof(unsigned long long) + 1];
+  char* p = &text[sizeof(text) - 1];
+  *p = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value != 0);
+  return write(p);
+}
+
+/**
+ * Same output as the board cores' Print::printFloat(), including "nan", "inf" and "ovf".
+ */
+size_t Print::printFloat(double value, uint8_t digits) {
+  if (isnan(value)) {
+    return print("nan");
+  }
+  if (isinf(value)) {
+    return print("inf");
+  }
+  if (value > 4294967040.0 || value < -4294967040.0) {
+    return print("ovf");
+  }
+
+  size_t n = 0;
+  if (value < 0.0) {
+    n += print('-');
+    value = -value;
+  }
+
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; i++) {
+    rounding /= 10.0;
+  }
+  value += rounding;
+
+  unsigned long integer = (unsigned long)value;
+  double remainder = value - (double)integer;
+  n += print(integer);
+  if (digits > 0) {
+    n += print('.');
+  }
+  while (digits-- > 0) {
+    remainder *= 10.0;
+    unsigned int digit = (unsigned int)remainder;
+    n += print(digit);
+    remainder -= digit;
+  }
+  return n;
+}
@@ -0,0 +1,76 @@
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+
+class Print;
+
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+/**
+ * Arduino's Print: number and float formatting as in the board cores, println() ends lines with "\r\n".
+ * printf() is the ESP32 core's.
+ */
+class Print {
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str == nullptr ? 0 : write((const uint8_t*)str, strlenOf(str)); }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    int getWriteError() { return writeError; }
+    void clearWriteError() { writeError = 0; }
+
+    size_t print(const __FlashStringHelper* str);
+    size_t print(const String& str);
+    size_t print(const char str[]);
+    size_t print(char c);
+    size_t print(unsigned char value, int base = 10);
+    size_t print(int value, int base = 10);
+    size_t print(unsigned int value, int base = 10);
+    size_t print(long value, int base = 10);
+    size_t print(unsigned long value, int base = 10);
+    size_t print(long long value, int base = 10);
+    size_t print(unsigned long long value, int base = 10);
+    size_t print(double value, int digits = 2);
+    size_t print(const Printable& printable);
+
+    size_t println(const __FlashStringHelper* str);
+    size_t println(const String& str);
+    size_t println(const char str[]);
+    size_t println(char c);
+    size_t println(unsigned char value, int base = 10);
+    size_t println(int value, int base = 10);
+    size_t println(unsigned int value, int base = 10);
+    size_t println(long value, int base = 10);
+    size_t println(unsigned long value, int base = 10);
+    size_t println(long long value, int base = 10);
+    size_t println(unsigned long long value, int base = 10);
+    size_t println(double value, int digits = 2);
+    size_t println(const Printable& printable);
+    size_t println();
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+  protected:
+    void setWriteError(int error = 1) { writeError = error; }
+
+  private:
+    static size_t strlenOf(const char* str);
+    size_t printNumber(unsigned long long value, uint8_t base);
+    size_t printFloat(double value, uint8_t digits);
+
+    int writeError = 0;
+};
+
+#endif // HOST_PRINT_H
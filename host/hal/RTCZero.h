@@ -0,0 +1,21 @@
+#ifndef HOST_RTC_ZERO_H
+#define HOST_RTC_ZERO_H
+
+#include <Arduino.h>
+
+// The SAMD21's RTC in clock mode: seconds since the epoch, counting with the simulated clock
+class RTCZero {
+  public:
+    void begin() {}
+    void setEpoch(uint32_t epoch) {
+      this->epoch = epoch;
+      setAt = millis();
+    }
+    uint32_t getEpoch() { return epoch + (millis() - setAt) / 1000; }
+
+  private:
+    uint32_t epoch = 0;
+    unsigned long setAt = 0;
+};
+
+#endif // HOST_RTC_ZERO_H
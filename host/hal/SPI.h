@@ -0,0 +1,15 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include <Arduino.h>
+
+// Nothing on the simulated board is wired to SPI itself, the Ethernet shield is simulated a level up (EthernetLarge.h)
+class SPIClass {
+  public:
+    void begin() {}
+    void end() {}
+};
+
+inline SPIClass SPI;
+
+#endif // HOST_SPI_H
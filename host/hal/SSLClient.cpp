@@ -0,0 +1,330 @@
+#include <SSLClient.h>
+#include "host_sim.h"
+
+#define HOST_TCP_CONNECT_TIMEOUT_MS 2000 // what a connection to an unreachable host blocks for
+
+HostFirebaseServer hostFirebase;
+
+static SSLClient* pumpedClient = nullptr;
+
+static void deliverResponses() {
+  if (pumpedClient != nullptr) {
+    pumpedClient->hostDeliver();
+  }
+}
+
+static const char* statusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Error";
+  }
+}
+
+void HostFirebaseServer::restart() {
+  sessionCount = 0;
+}
+
+// ---- Server side session cache ----
+
+static bool serverKnowsSession(const SSLSession& session) {
+  for (uint8_t i = 0; i < hostFirebase.sessionCount; i++) {
+    if (session.session_id_len == HOST_TLS_SESSION_ID_SIZE
+        && memcmp(hostFirebase.sessionIds[i], session.session_id, HOST_TLS_SESSION_ID_SIZE) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void issueSession(SSLSession& session) {
+  uint32_t id = hostFirebase.nextSessionId++;
+  for (int i = 0; i < HOST_TLS_SESSION_ID_SIZE; i++) {
+    session.session_id[i] = (uint8_t)((id * 2654435761UL) >> ((i % 4) * 8)) ^ (uint8_t)(i * 37);
+  }
+  session.session_id_len = HOST_TLS_SESSION_ID_SIZE;
+  // the oldest session is forgotten once the cache is full
+  if (hostFirebase.sessionCount == HOST_TLS_MAX_SESSIONS) {
+    memmove(hostFirebase.sessionIds[0], hostFirebase.sessionIds[1], (HOST_TLS_MAX_SESSIONS - 1) * HOST_TLS_SESSION_ID_SIZE);
+    hostFirebase.sessionCount--;
+  }
+  memcpy(hostFirebase.sessionIds[hostFirebase.sessionCount++], session.session_id, HOST_TLS_SESSION_ID_SIZE);
+}
+
+// ---- Client ----
+
+SSLClient::SSLClient(Client& client, const br_x509_trust_anchor* trustAnchors, size_t trustAnchorsNum, int analogPin,
+                     size_t maxSessions, DebugLevel debug)
+  : maxSessions(min(maxSessions, (size_t)HOST_TLS_MAX_SESSIONS)) {
+  memset(sessions, 0, sizeof(sessions));
+  pumpedClient = this;
+  hostAddPumpHandler(deliverResponses);
+}
+
+int SSLClient::connect(IPAddress ip, uint16_t port) {
+  return connect("", port);
+}
+
+/**
+ * Open the connection: a TCP connect, then a resumed handshake if the server accepts the cached session
+ * for `host`, else a full one. Blocks for the handshake's duration, as on the board.
+ */
+int SSLClient::connect(const char* host, uint16_t port) {
+  stop();
+  hostFirebase.connections++;
+  if (!hostFirebase.reachable) {
+    delay(HOST_TCP_CONNECT_TIMEOUT_MS);
+    hostFirebase.failedConnections++;
+    setWriteError(SSL_CLIENT_CONNECT_FAIL);
+    return 0;
+  }
+  if (hostFirebase.failHandshakes > 0) {
+    hostFirebase.failHandshakes--;
+    delay(hostFirebase.fullHandshakeMs);
+    hostFirebase.failedConnections++;
+    setWriteError(SSL_BR_CONNECT_FAIL);
+    return 0;
+  }
+
+  SSLSession* cached = getSession(host);
+  bool resumed = cached != nullptr && hostFirebase.resumeSessions && serverKnowsSession(*cached);
+  delay(resumed ? hostFirebase.resumedHandshakeMs : hostFirebase.fullHandshakeMs);
+  if (resumed) {
+    hostFirebase.resumedHandshakes++;
+  } else {
+    hostFirebase.fullHandshakes++;
+    // the new session replaces the host's, or takes a free slot, or the first slot
+    CachedSession* slot = nullptr;
+    for (size_t i = 0; i < maxSessions && slot == nullptr; i++) {
+      if (strcmp(sessions[i].host, host) == 0) {
+        slot = &sessions[i];
+      }
+    }
+    for (size_t i = 0; i < maxSessions && slot == nullptr; i++) {
+      if (sessions[i].session.session_id_len == 0) {
+        slot = &sessions[i];
+      }
+    }
+    if (slot == nullptr) {
+      slot = &sessions[0];
+    }
+    strncpy(slot->host, host, HOST_TLS_HOST_SIZE - 1);
+    slot->host[HOST_TLS_HOST_SIZE - 1] = '\0';
+    issueSession(slot->session);
+  }
+
+  clearWriteError();
+  open = true;
+  serverClosed = false;
+  return 1;
+}
+
+SSLSession* SSLClient::getSession(const char* host) {
+  for (size_t i = 0; i < maxSessions; i++) {
+    if (sessions[i].session.session_id_len > 0 && strcmp(sessions[i].host, host) == 0) {
+      return &sessions[i].session;
+    }
+  }
+  return nullptr;
+}
+
+void SSLClient::removeSession(const char* host) {
+  for (size_t i = 0; i < maxSessions; i++) {
+    if (strcmp(sessions[i].host, host) == 0) {
+      memset(&sessions[i], 0, sizeof(sessions[i]));
+    }
+  }
+}
+
+size_t SSLClient::write(const uint8_t* buffer, size_t size) {
+  if (!open || serverClosed) {
+    setWriteError(SSL_BR_WRITE_ERROR);
+    return 0;
+  }
+  hostFirebase.requestBytes += size;
+  for (size_t i = 0; i < size; i++) {
+    handleRequestByte(buffer[i]);
+  }
+  return size;
+}
+
+int SSLClient::available() {
+  hostPump();
+  return open ? rxDelivered : 0;
+}
+
+int SSLClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int SSLClient::read(uint8_t* buffer, size_t size) {
+  if (!open) {
+    return -1;
+  }
+  size_t count = min(size, rxDelivered);
+  for (size_t i = 0; i < count; i++) {
+    buffer[i] = rx[rxHead];
+    rxHead = (rxHead + 1) % HOST_TLS_RESPONSE_BUFFER;
+  }
+  rxDelivered -= count;
+  rxLength -= count;
+  return count;
+}
+
+int SSLClient::peek() {
+  return open && rxDelivered > 0 ? rx[rxHead] : -1;
+}
+
+void SSLClient::stop() {
+  open = false;
+  serverClosed = false;
+  rxHead = 0;
+  rxLength = 0;
+  rxDelivered = 0;
+  pendingCount = 0;
+  requestLineLength = 0;
+  headerLineLength = 0;
+  inBody = false;
+  contentLength = 0;
+  bodyReceived = 0;
+  requestClose = false;
+}
+
+uint8_t SSLClient::connected() {
+  return open && (!serverClosed || rxDelivered > 0);
+}
+
+// ---- Server side of the connection ----
+
+void SSLClient::hostDeliver() {
+  unsigned long long now = hostNowMicros();
+  while (pendingCount > 0 && pending[pendingHead].deliverAt <= now) {
+    rxDelivered += pending[pendingHead].length;
+    if (pending[pendingHead].close) {
+      serverClosed = true;
+    }
+    pendingHead = (pendingHead + 1) % HOST_TLS_MAX_PENDING;
+    pendingCount--;
+  }
+}
+
+void SSLClient::hostDrop() {
+  if (!open) {
+    return;
+  }
+  serverClosed = true;
+  rxLength = rxDelivered; // responses still on their way are lost
+  pendingCount = 0;
+}
+
+void SSLClient::handleRequestByte(uint8_t c) {
+  if (inBody) {
+    if (bodyReceived < HOST_TLS_REQUEST_BODY_SIZE) {
+      body[bodyReceived] = c;
+    }
+    bodyReceived++;
+    if (bodyReceived == contentLength) {
+      completeRequest();
+    }
+    return;
+  }
+
+  if (c != '\n') {
+    if (c != '\r' && headerLineLength < sizeof(headerLine) - 1) {
+      headerLine[headerLineLength++] = c;
+    }
+    return;
+  }
+  headerLine[headerLineLength] = '\0';
+  if (requestLineLength == 0) {
+    strcpy(requestLine, headerLine);
+    requestLineLength = headerLineLength;
+  } else if (headerLineLength == 0) {
+    // end of the headers
+    inBody = contentLength > 0;
+    bodyReceived = 0;
+    if (!inBody) {
+      completeRequest();
+    }
+  } else if (strncasecmp(headerLine, "Content-Length:", 15) == 0) {
+    contentLength = strtoul(headerLine + 15, nullptr, 10);
+  } else if (strncasecmp(headerLine, "Connection:", 11) == 0 && strstr(headerLine + 11, "close") != nullptr) {
+    requestClose = true;
+  }
+  headerLineLength = 0;
+}
+
+void SSLClient::completeRequest() {
+  // "<method> <path> HTTP/1.1"
+  char method[8] = "";
+  char path[96] = "";
+  sscanf(requestLine, "%7s %95s", method, path);
+  size_t bodyLength = min(bodyReceived, (size_t)HOST_TLS_REQUEST_BODY_SIZE);
+  body[bodyLength] = '\0';
+
+  hostFirebase.requests++;
+  strcpy(hostFirebase.lastPath, path);
+  memcpy(hostFirebase.lastBody, body, bodyLength + 1);
+  bool get = strcmp(method, "GET") == 0;
+  if (get) {
+    hostFirebase.gets++;
+  } else {
+    hostFirebase.writes++;
+  }
+
+  char reply[48];
+  if (hostFirebase.status != 200) {
+    snprintf(reply, sizeof(reply), "{\"error\":\"%s\"}", statusText(hostFirebase.status));
+    respond(hostFirebase.status, reply, strlen(reply));
+  } else if (get && strncmp(path, "/timestamp.json", 15) == 0) {
+    snprintf(reply, sizeof(reply), "{\"timestamp\":%llu}", hostFirebase.timestampMs + millis());
+    respond(200, reply, strlen(reply));
+  } else if (get || bodyReceived > HOST_TLS_REQUEST_BODY_SIZE) {
+    respond(200, "null", 4);
+  } else {
+    respond(200, body, bodyLength); // Firebase answers a write with the data written
+  }
+
+  requestLineLength = 0;
+  headerLineLength = 0;
+  inBody = false;
+  contentLength = 0;
+  bodyReceived = 0;
+  requestClose = false;
+}
+
+void SSLClient::respond(int status, const char* responseBody, size_t bodyLength) {
+  char headers[192];
+  int headerLength = snprintf(headers, sizeof(headers),
+    "HTTP/1.1 %d %s\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %u\r\n"
+    "Connection: keep-alive\r\nCache-Control: no-cache\r\n\r\n",
+    status, statusText(status), (unsigned)bodyLength);
+  size_t length = headerLength + bodyLength;
+  if (rxLength + length > HOST_TLS_RESPONSE_BUFFER || pendingCount == HOST_TLS_MAX_PENDING) {
+    // The client isn't reading its responses, the server gives up on the connection
+    hostFirebase.responseOverflows++;
+    hostDrop();
+    return;
+  }
+  size_t tail = (rxHead + rxLength) % HOST_TLS_RESPONSE_BUFFER;
+  for (int i = 0; i < headerLength; i++) {
+    rx[(tail + i) % HOST_TLS_RESPONSE_BUFFER] = headers[i];
+  }
+  for (size_t i = 0; i < bodyLength; i++) {
+    rx[(tail + headerLength + i) % HOST_TLS_RESPONSE_BUFFER] = responseBody[i];
+  }
+  rxLength += length;
+
+  PendingResponse& response = pending[(pendingHead + pendingCount) % HOST_TLS_MAX_PENDING];
+  response.deliverAt = hostNowMicros() + hostFirebase.latencyMs * 1000ULL;
+  response.length = length;
+  response.close = requestClose
+    || (hostFirebase.closeAfterRequests > 0 && hostFirebase.requests % hostFirebase.closeAfterRequests == 0);
+  pendingCount++;
+}
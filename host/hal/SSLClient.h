@@ -0,0 +1,200 @@
+#ifndef HOST_SSL_CLIENT_H
+#define HOST_SSL_CLIENT_H
+
+#include <Arduino.h>
+
+/*
+  SSLClient (OPEnSLab) against a simulated Firebase Realtime Database host.
+
+  The stand-in server keeps a TLS session cache like a real server: a client that offers a session
+  ID the server still knows gets an abbreviated handshake and keeps the ID, any other handshake is a
+  full one and issues a new ID. Handshakes take hostFirebase.fullHandshakeMs/resumedHandshakeMs of
+  simulated time, during which the pump keeps running (so UART bytes arriving meanwhile can overrun
+  as they would on the board). Requests are parsed by their Content-Length and each is answered
+  hostFirebase.latencyMs later, in order, with a keep-alive response: GET /timestamp.json returns the
+  server time, writes echo their body as Firebase does.
+
+  Outages, failing handshakes, error statuses and dropped connections are injected through
+  hostFirebase (see HostFirebaseServer below).
+*/
+
+// ---- The part of BearSSL the sketch's trust anchors (certificates.h) use ----
+extern "C" {
+
+typedef struct {
+  unsigned char* data;
+  size_t len;
+} br_x500_name;
+
+typedef struct {
+  unsigned char* n;
+  size_t nlen;
+  unsigned char* e;
+  size_t elen;
+} br_rsa_public_key;
+
+typedef struct {
+  int curve;
+  unsigned char* q;
+  size_t qlen;
+} br_ec_public_key;
+
+typedef struct {
+  unsigned char key_type;
+  union {
+    br_rsa_public_key rsa;
+    br_ec_public_key ec;
+  } key;
+} br_x509_pkey;
+
+typedef struct {
+  br_x500_name dn;
+  unsigned flags;
+  br_x509_pkey pkey;
+} br_x509_trust_anchor;
+
+#define BR_X509_TA_CA 0x0001
+#define BR_KEYTYPE_RSA 1
+#define BR_KEYTYPE_EC 2
+
+} // extern "C"
+
+#define HOST_TLS_SESSION_ID_SIZE 32
+#define HOST_TLS_HOST_SIZE 64
+#define HOST_TLS_MAX_SESSIONS 4
+#define HOST_TLS_REQUEST_BODY_SIZE 4096  // longest write body echoed back, longer ones are answered with null
+#define HOST_TLS_RESPONSE_BUFFER 16384   // responses on their way to the client
+#define HOST_TLS_MAX_PENDING 16          // responses waiting for their latency to pass
+
+struct SSLSession {
+  uint8_t session_id[HOST_TLS_SESSION_ID_SIZE];
+  uint8_t session_id_len = 0;
+};
+
+class SSLClient : public Client {
+  public:
+    enum Error {
+      SSL_OK = 0,
+      SSL_CLIENT_CONNECT_FAIL,
+      SSL_BR_CONNECT_FAIL,
+      SSL_CLIENT_WRTIE_ERROR,
+      SSL_BR_WRITE_ERROR,
+      SSL_INTERNAL_ERROR,
+      SSL_OUT_OF_MEMORY
+    };
+
+    enum DebugLevel {
+      SSL_NONE = 0,
+      SSL_ERROR = 1,
+      SSL_WARN = 2,
+      SSL_INFO = 3,
+      SSL_DUMP = 4
+    };
+
+    SSLClient(Client& client, const br_x509_trust_anchor* trustAnchors, size_t trustAnchorsNum, int analogPin,
+              size_t maxSessions = 1, DebugLevel debug = SSL_WARN);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected() > 0; }
+
+    SSLSession* getSession(const char* host);
+    void removeSession(const char* host);
+    bool m_soft_connected(const char* funcName) { return open && !serverClosed; }
+
+    using Print::write;
+
+    // Simulation side (the server's end of the connection)
+    void hostDeliver();      // responses whose latency has passed become readable (called by the pump)
+    void hostDrop();         // the server closes the connection
+    size_t hostUnread() const { return rxDelivered; }
+
+  private:
+    struct CachedSession {
+      char host[HOST_TLS_HOST_SIZE];
+      SSLSession session;
+    };
+    struct PendingResponse {
+      unsigned long long deliverAt;
+      size_t length;
+      bool close; // the server closes the connection after this response
+    };
+
+    void handleRequestByte(uint8_t c);
+    void completeRequest();
+    void respond(int status, const char* body, size_t bodyLength);
+
+    size_t maxSessions;
+    CachedSession sessions[HOST_TLS_MAX_SESSIONS];
+    bool open = false;
+    bool serverClosed = false;
+
+    // Request being parsed
+    char requestLine[128];
+    size_t requestLineLength = 0;
+    bool inBody = false;
+    size_t contentLength = 0;
+    size_t bodyReceived = 0;
+    char body[HOST_TLS_REQUEST_BODY_SIZE + 1];
+    char headerLine[128];
+    size_t headerLineLength = 0;
+    bool requestClose = false;
+
+    // Responses: bytes [rxHead, rxHead + rxDelivered) can be read, the rest of rxLength is still on its way
+    uint8_t rx[HOST_TLS_RESPONSE_BUFFER];
+    size_t rxHead = 0;
+    size_t rxLength = 0;
+    size_t rxDelivered = 0;
+    PendingResponse pending[HOST_TLS_MAX_PENDING];
+    uint8_t pendingHead = 0;
+    uint8_t pendingCount = 0;
+};
+
+/**
+ * The simulated Firebase host. Change the behaviour at any time from a test, the counters say what the sketch did.
+ */
+struct HostFirebaseServer {
+  // Behaviour
+  bool reachable = true;             // false: TCP connections fail (SSL_CLIENT_CONNECT_FAIL)
+  unsigned long failHandshakes = 0;  // the next n handshakes fail (SSL_BR_CONNECT_FAIL)
+  bool resumeSessions = true;        // false: every offered session is refused (full handshakes only)
+  unsigned long fullHandshakeMs = 1200;
+  unsigned long resumedHandshakeMs = 250;
+  unsigned long latencyMs = 150;     // request to response
+  int status = 200;                  // status of the responses
+  unsigned long closeAfterRequests = 0; // close the connection after answering every nth request (0: never)
+  unsigned long long timestampMs = 1767225600000ULL; // server time at start (GET /timestamp.json), advances with millis()
+
+  void restart(); // forget every session (as after a server restart or session ticket key rotation)
+
+  // Counters
+  unsigned long connections = 0;
+  unsigned long fullHandshakes = 0;
+  unsigned long resumedHandshakes = 0;
+  unsigned long failedConnections = 0;
+  unsigned long requests = 0;
+  unsigned long gets = 0;
+  unsigned long writes = 0; // PATCH/PUT/POST
+  unsigned long responseOverflows = 0; // responses dropped because the client didn't read them
+  unsigned long long requestBytes = 0;
+  char lastPath[96] = "";
+  char lastBody[HOST_TLS_REQUEST_BODY_SIZE + 1] = "";
+
+  // Session IDs the server can resume
+  uint8_t sessionIds[HOST_TLS_MAX_SESSIONS][HOST_TLS_SESSION_ID_SIZE];
+  uint8_t sessionCount = 0;
+  uint32_t nextSessionId = 1;
+};
+
+extern HostFirebaseServer hostFirebase;
+
+#endif // HOST_SSL_CLIENT_H
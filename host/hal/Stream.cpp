@@ -0,0 +1,20 @@
+#include <Arduino.h>
+
+/**
+ * Reads until `length` bytes arrived or nothing arrived for the timeout (simulated time).
+ */
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  unsigned long start = millis();
+  while (count < length) {
+    if (available() > 0) {
+      buffer[count++] = (char)read();
+      start = millis();
+    } else if (millis() - start >= timeout) {
+      break;
+    } else {
+      yield();
+    }
+  }
+  return count;
+}
@@ -0,0 +1,257 @@
+#include <Arduino.h>
+
+String::String(const char* cstr) : buffer(nullptr), capacity(0), len(0) {
+  if (cstr != nullptr) {
+    assign(cstr, strlen(cstr));
+  }
+}
+
+String::String(const char* cstr, size_t length) : buffer(nullptr), capacity(0), len(0) {
+  assign(cstr, length);
+}
+
+String::String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) {
+}
+
+String::String(const String& other) : buffer(nullptr), capacity(0), len(0) {
+  assign(other.c_str(), other.len);
+}
+
+String::String(String&& other) : buffer(other.buffer), capacity(other.capacity), len(other.len) {
+  other.buffer = nullptr;
+  other.capacity = 0;
+  other.len = 0;
+}
+
+String::String(char c) : buffer(nullptr), capacity(0), len(0) {
+  assign(&c, 1);
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {
+}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {
+}
+
+String::String(long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char text[66];
+  if (base == 10) {
+    snprintf(text, sizeof(text), "%ld", value);
+    assign(text, strlen(text));
+  } else {
+    *this = String((unsigned long)value, base);
+  }
+}
+
+String::String(unsigned long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+  char text[66];
+  char* p = &text[sizeof(text) - 1];
+  *p = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value != 0);
+  assign(p, strlen(p));
+}
+
+String::String(float value, unsigned char decimalPlaces) : String((double)value, decimalPlaces) {
+}
+
+String::String(double value, unsigned char decimalPlaces) : buffer(nullptr), capacity(0), len(0) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", decimalPlaces, value);
+  assign(text, strlen(text));
+}
+
+String::~String() {
+  free(buffer);
+}
+
+String& String::operator=(const String& other) {
+  if (this != &other) {
+    assign(other.c_str(), other.len);
+  }
+  return *this;
+}
+
+String& String::operator=(String&& other) {
+  if (this != &other) {
+    free(buffer);
+    buffer = other.buffer;
+    capacity = other.capacity;
+    len = other.len;
+    other.buffer = nullptr;
+    other.capacity = 0;
+    other.len = 0;
+  }
+  return *this;
+}
+
+String& String::operator=(const char* cstr) {
+  assign(cstr, cstr != nullptr ? strlen(cstr) : 0);
+  return *this;
+}
+
+String& String::operator+=(const String& other) {
+  append(other.c_str(), other.len);
+  return *this;
+}
+
+String& String::operator+=(const char* cstr) {
+  if (cstr != nullptr) {
+    append(cstr, strlen(cstr));
+  }
+  return *this;
+}
+
+String& String::operator+=(char c) {
+  append(&c, 1);
+  return *this;
+}
+
+bool String::equals(const String& other) const {
+  return len == other.len && memcmp(c_str(), other.c_str(), len) == 0;
+}
+
+bool String::equals(const char* cstr) const {
+  return strcmp(c_str(), cstr != nullptr ? cstr : "") == 0;
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+  return len == other.len && strncasecmp(c_str(), other.c_str(), len) == 0;
+}
+
+bool String::startsWith(const String& prefix) const {
+  return prefix.len <= len && memcmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return suffix.len <= len && memcmp(c_str() + len - suffix.len, suffix.c_str(), suffix.len) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  for (size_t i = from; i < len; i++) {
+    if (buffer[i] == c) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < len ? buffer[index] : '\0';
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, len);
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= len) {
+    return String();
+  }
+  if (to > len) {
+    to = len;
+  }
+  return String(buffer + from, to - from);
+}
+
+long String::toInt() const {
+  return atol(c_str());
+}
+
+float String::toFloat() const {
+  return atof(c_str());
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = tolower(buffer[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (size_t i = 0; i < len; i++) {
+    buffer[i] = toupper(buffer[i]);
+  }
+}
+
+void String::trim() {
+  if (len == 0) {
+    return;
+  }
+  size_t begin = 0;
+  while (begin < len && isspace((unsigned char)buffer[begin])) {
+    begin++;
+  }
+  size_t end = len;
+  while (end > begin && isspace((unsigned char)buffer[end - 1])) {
+    end--;
+  }
+  len = end - begin;
+  memmove(buffer, buffer + begin, len);
+  buffer[len] = '\0';
+}
+
+bool String::reserve(size_t size) {
+  if (buffer != nullptr && capacity >= size) {
+    return true;
+  }
+  char* grown = (char*)realloc(buffer, size + 1);
+  if (grown == nullptr) {
+    return false;
+  }
+  buffer = grown;
+  capacity = size;
+  return true;
+}
+
+bool String::assign(const char* cstr, size_t length) {
+  if (!reserve(length)) {
+    len = 0;
+    return false;
+  }
+  memmove(buffer, cstr != nullptr ? cstr : "", cstr != nullptr ? length : 0);
+  len = cstr != nullptr ? length : 0;
+  buffer[len] = '\0';
+  return true;
+}
+
+bool String::append(const char* cstr, size_t length) {
+  // cstr may point into this String's own buffer, which reserve() can move
+  size_t offset = buffer != nullptr && cstr >= buffer && cstr <= buffer + len ? cstr - buffer : (size_t)-1;
+  if (!reserve(len + length)) {
+    return false;
+  }
+  memmove(buffer + len, offset != (size_t)-1 ? buffer + offset : cstr, length);
+  len += length;
+  buffer[len] = '\0';
+  return true;
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String result(lhs);
+  result += rhs;
+  return result;
+}
@@ -0,0 +1,74 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+
+class __FlashStringHelper;
+
+/**
+ * The subset of Arduino's String the sketches use. Like the board's String it lives on the heap
+ * (malloc/realloc/free), so every String a sketch makes after setup() shows up in the allocation counters.
+ */
+class String {
+  public:
+    String(const char* cstr = "");
+    String(const char* cstr, size_t length);
+    String(const __FlashStringHelper* str);
+    String(const String& other);
+    String(String&& other);
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other);
+    String& operator=(const char* cstr);
+
+    String& operator+=(const String& other);
+    String& operator+=(const char* cstr);
+    String& operator+=(char c);
+
+    bool equals(const String& other) const;
+    bool equals(const char* cstr) const;
+    bool equalsIgnoreCase(const String& other) const;
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    char charAt(unsigned int index) const;
+    char operator[](unsigned int index) const { return charAt(index); }
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    long toInt() const;
+    float toFloat() const;
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    unsigned int length() const { return len; }
+    const char* c_str() const { return buffer != nullptr ? buffer : ""; }
+
+  private:
+    bool assign(const char* cstr, size_t length);
+    bool reserve(size_t size);
+    bool append(const char* cstr, size_t length);
+
+    char* buffer;
+    size_t capacity;
+    size_t len;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+
+#endif // HOST_WSTRING_H
@@ -0,0 +1,37 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+/*
+  The ESP32's Wi-Fi station. Associating takes HOST_WIFI_CONNECT_MS of simulated time; the test side can
+  take the network away with hostWifiSetAvailable(false).
+*/
+
+#define HOST_WIFI_CONNECT_MS 1500
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+  public:
+    wl_status_t begin(const char* ssid, const char* passphrase);
+    wl_status_t status();
+    bool reconnect();
+    bool disconnect();
+    IPAddress localIP();
+};
+
+extern WiFiClass WiFi;
+
+// Simulation side
+void hostWifiSetAvailable(bool available);
+
+#endif // HOST_WIFI_H
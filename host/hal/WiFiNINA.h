@@ -0,0 +1,7 @@
+#ifndef HOST_WIFI_NINA_H
+#define HOST_WIFI_NINA_H
+
+#include <Arduino.h>
+#include "utility/wifi_drv.h"
+
+#endif // HOST_WIFI_NINA_H
@@ -0,0 +1,15 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+// The I2C devices (the LCD backpack) are simulated a level up (LiquidCrystal_I2C.h)
+class TwoWire {
+  public:
+    void begin() {}
+    void setClock(uint32_t frequency) {}
+};
+
+inline TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,17 @@
+#ifndef HOST_RTDB_HELPER_H
+#define HOST_RTDB_HELPER_H
+
+#include <FirebaseESP32.h>
+
+// The library's helper that prints a result's value according to its type
+inline void printResult(FirebaseData& data) {
+  if (data.dataType() == "json") {
+    Serial.println(data.stringData());
+  } else {
+    Serial.print(data.dataType());
+    Serial.print(": ");
+    Serial.println(data.stringData());
+  }
+}
+
+#endif // HOST_RTDB_HELPER_H
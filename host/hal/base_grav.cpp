@@ -0,0 +1,19 @@
+#include "base_grav_no_eeprom.h"
+
+/*
+  Gravity_Base as the Atlas Scientific Gravity library defines it. The boards link it from the installed
+  library, only its header is kept in PondLibrary/atlas_gravity_no_eeprom; Gravity_pH overrides both.
+*/
+
+bool Gravity_Base::begin() {
+  return true;
+}
+
+float Gravity_Base::read_voltage() {
+  float voltage_mV = 0;
+  for (int i = 0; i < volt_avg_len; ++i) {
+    voltage_mV += analogRead(this->pin) / 1024.0 * 5000.0;
+  }
+  voltage_mV /= volt_avg_len;
+  return voltage_mV;
+}
@@ -0,0 +1,61 @@
+#ifndef HOST_ESP32_H
+#define HOST_ESP32_H
+
+/*
+  The parts of the ESP32 Arduino core and ESP-IDF the RF transmitter sketch uses, included by Arduino.h
+  when ESP32 is defined.
+
+  FreeRTOS tasks run on their own threads. The loop task (the program's main thread) drives the simulated
+  clock as on the other boards; vTaskDelay() on any other task waits for the clock to pass instead of
+  advancing it, so a task never runs ahead of the loop. Hardware timer alarms fire from the pump, late by
+  at most one pump interval and then as many times as their period has passed, which keeps the count of
+  interrupts exact even though their spacing isn't.
+*/
+
+#define IRAM_ATTR
+#define ARDUINO_RUNNING_CORE 1
+
+// ---- FreeRTOS ----
+typedef void (*TaskFunction_t)(void*);
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+
+// ---- Hardware timers (esp32-hal-timer.h, core 2.x) ----
+struct hw_timer_t;
+
+hw_timer_t* timerBegin(uint8_t timer, uint16_t divider, bool countUp);
+void timerAttachInterrupt(hw_timer_t* timer, void (*handler)(), bool edge);
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoreload);
+void timerWrite(hw_timer_t* timer, uint64_t value);
+void timerAlarmEnable(hw_timer_t* timer);
+void timerAlarmDisable(hw_timer_t* timer);
+
+// ---- Registers (the GPIO output set/clear registers, see soc/gpio_reg.h) ----
+void hostRegWrite(uint32_t reg, uint32_t value);
+#define REG_WRITE(reg, value) hostRegWrite((reg), (value))
+
+class EspClass {
+  public:
+    uint32_t getFreeHeap();
+    void restart();
+};
+
+extern EspClass ESP;
+
+// Simulation side
+unsigned long hostTimerInterrupts(); // timer interrupts delivered so far
+unsigned long hostGpioWrites();      // GPIO register writes so far
+
+#endif // HOST_ESP32_H
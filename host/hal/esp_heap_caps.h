@@ -0,0 +1,21 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <Arduino.h>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+// The simulated heap (HOST_RAM_SIZE, see host_sim.h) as heap_caps_get_info() reports the ESP32's
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+
+#endif // HOST_ESP_HEAP_CAPS_H
@@ -0,0 +1,76 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <Arduino.h>
+
+/*
+  Control side of the simulated board, used by the benches and tests to drive a sketch.
+
+  The HAL's main() calls hostScenarioBegin(), the sketch's setup(), then loop() until hostScenarioStep()
+  returns false, and exits with hostScenarioEnd(). Every bench/test defines those three. While the sketch
+  runs, the pump (hostPump()) delivers whatever hardware events are due: UART bytes, timer interrupts,
+  BLE notifications, server responses, and calls hostScenarioPoll() so the scenario can inject its own.
+  The pump runs from delay(), yield(), and the available()/poll() calls of the simulated peripherals.
+*/
+
+#define HOST_EXIT_RESET 3 // exit code when the sketch resets the board (NVIC_SystemReset())
+
+#ifndef HOST_RAM_SIZE
+#define HOST_RAM_SIZE 32768 // RAM of the simulated board, for freeRam()
+#endif
+
+#ifndef HOST_ANALOG_READ_MICROS
+#define HOST_ANALOG_READ_MICROS 430 // one analogRead() with the SAMD core's ADC settings
+#endif
+
+// Defined by each bench/test
+void hostScenarioBegin(int argc, char** argv);
+bool hostScenarioStep();
+int hostScenarioEnd();
+void hostScenarioPoll(); // optional (weak default does nothing)
+
+// Clock
+unsigned long long hostNowMicros();
+void hostAdvanceMicros(unsigned long long us);
+void hostAdvanceMillis(unsigned long ms);
+void hostSetLoopStep(unsigned long us); // simulated time between two loop() passes (the board's idle time)
+unsigned long hostLoopStep();
+unsigned long long hostSkippedMicros(); // all the simulated time skipped so far
+
+// Runs the due hardware events (reentrant calls return straight away)
+void hostPump();
+
+// Something the pump delivers (UART bytes, a server's responses, ...), registered once before setup()
+typedef void (*HostPumpHandler)();
+void hostAddPumpHandler(HostPumpHandler handler);
+
+// Pins
+void hostSetAnalog(uint8_t pin, uint16_t counts12, uint16_t noise = 0); // 12-bit counts, +-noise per read
+void hostSetDigitalInput(uint8_t pin, int level);
+int hostDigitalOutput(uint8_t pin);
+uint16_t hostAnalogSample(uint8_t pin); // one 12-bit conversion of the pin, without analogRead()'s time cost
+unsigned long hostAnalogReads();
+
+// Memory of the simulated board: heap growth since main() started, and stack depth below main()
+size_t hostHeapInUse();
+size_t hostHeapFree();
+size_t hostHeapFreeBlocks();
+char* hostStackTop();
+int hostFreeRam();
+
+// The watchdog's longest gap between resets (ms) and how often it would have reset the board
+unsigned long hostWatchdogLongestGap();
+unsigned long hostWatchdogExpiries();
+
+// Ends the run as the board would restart
+void hostSystemReset();
+
+// Stops the tasks other than the loop before main() returns (ESP32, see esp32_host.h)
+void hostStopTasks();
+
+// Command line helpers for scenarios: "--name value"
+const char* hostArg(int argc, char** argv, const char* name, const char* fallback);
+long hostArgLong(int argc, char** argv, const char* name, long fallback);
+bool hostArgFlag(int argc, char** argv, const char* name);
+
+#endif // HOST_SIM_H
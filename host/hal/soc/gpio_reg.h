@@ -0,0 +1,10 @@
+#ifndef HOST_SOC_GPIO_REG_H
+#define HOST_SOC_GPIO_REG_H
+
+// GPIO output registers of the ESP32 (GPIO 0-31); REG_WRITE() to them drives the simulated pins
+#define DR_REG_GPIO_BASE 0x3ff44000
+#define GPIO_OUT_REG (DR_REG_GPIO_BASE + 0x0004)
+#define GPIO_OUT_W1TS_REG (DR_REG_GPIO_BASE + 0x0008)
+#define GPIO_OUT_W1TC_REG (DR_REG_GPIO_BASE + 0x000c)
+
+#endif // HOST_SOC_GPIO_REG_H
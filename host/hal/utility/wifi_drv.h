@@ -0,0 +1,20 @@
+#ifndef HOST_WIFI_DRV_H
+#define HOST_WIFI_DRV_H
+
+#include <Arduino.h>
+
+// The NINA-W102's GPIOs (the RGB LED), kept so a test can read the LED's color back
+class WiFiDrv {
+  public:
+    static void pinMode(uint8_t pin, uint8_t mode) {}
+    static void digitalWrite(uint8_t pin, uint8_t value) { analogWrite(pin, value ? 255 : 0); }
+    static void analogWrite(uint8_t pin, uint8_t value) {
+      if (pin < sizeof(levels)) {
+        levels[pin] = value;
+      }
+    }
+
+    static inline uint8_t levels[32] = {};
+};
+
+#endif // HOST_WIFI_DRV_H
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Turn a sketch into a C++ file the way the Arduino builder does: include Arduino.h and declare every
+function the sketch defines ahead of the first definition, so functions can be called before the
+point they are defined. #line directives keep compiler errors pointing into the .ino.
+
+Usage: ino2cpp.py <sketch.ino> <output.cpp>
+"""
+
+import re
+import sys
+
+KEYWORDS = {"if", "for", "while", "switch", "return", "sizeof", "catch", "do", "else"}
+NON_FUNCTIONS = re.compile(r"^\s*(struct|class|enum|union|namespace|typedef|extern)\b")
+TEMPLATE = re.compile(r"^\s*template\s*<[^{};]*?>\s*")
+SIGNATURE = re.compile(r"^(?P<head>[\w:<>,\*&\s]+?[\s\*&])(?P<name>[A-Za-z_]\w*)\s*\((?P<params>[^()]*)\)\s*(const\s*)?$", re.S)
+
+
+def blank_comments_and_strings(source):
+    """The source with comments, string and character literals replaced by spaces (newlines kept)."""
+    out = []
+    i = 0
+    n = len(source)
+    while i < n:
+        c = source[i]
+        if source.startswith("//", i):
+            end = source.find("\n", i)
+            end = n if end < 0 else end
+            out.append(" " * (end - i))
+            i = end
+        elif source.startswith("/*", i):
+            end = source.find("*/", i + 2)
+            end = n if end < 0 else end + 2
+            out.append(re.sub(r"[^\n]", " ", source[i:end]))
+            i = end
+        elif c in "\"'":
+            j = i + 1
+            while j < n and source[j] != c:
+                j += 2 if source[j] == "\\" else 1
+            j = min(j + 1, n)
+            out.append(c + " " * (j - i - 2) + c if j - i >= 2 else c)
+            i = j
+        else:
+            out.append(c)
+            i += 1
+    return "".join(out)
+
+
+def find_functions(source):
+    """(offset of the first definition, [prototype]) for the top level function definitions."""
+    code = blank_comments_and_strings(source)
+    prototypes = []
+    first = None
+    depth = 0
+    start = 0  # where the current top level statement starts
+    i = 0
+    while i < len(code):
+        c = code[i]
+        if c == "#" and depth == 0 and code[start:i].strip() == "":
+            # a preprocessor line (with its continuations) ends the statement before it
+            while True:
+                end = code.find("\n", i)
+                if end < 0:
+                    end = len(code)
+                    break
+                if code[end - 1] != "\\":
+                    break
+                i = end + 1
+            i = end
+            start = i
+            continue
+        if c == "{":
+            if depth == 0:
+                head = code[start:i].strip()
+                match = SIGNATURE.match(TEMPLATE.sub("", head, count=1))
+                if (match and not NON_FUNCTIONS.match(head) and "=" not in head
+                        and match.group("name") not in KEYWORDS):
+                    signature = " ".join(source[start:i].strip().split())
+                    signature = " ".join(head.split()) if "//" in signature or "/*" in signature else signature
+                    prototypes.append(signature + ";")
+                    if first is None:
+                        first = start + (len(code[start:i]) - len(code[start:i].lstrip()))
+            depth += 1
+        elif c == "}":
+            depth -= 1
+            if depth == 0:
+                start = i + 1
+        elif c == ";" and depth == 0:
+            start = i + 1
+        i += 1
+    return first, prototypes
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    sketch, output = sys.argv[1], sys.argv[2]
+    with open(sketch) as f:
+        source = f.read()
+    first, prototypes = find_functions(source)
+    path = sketch.replace("\\", "/")
+    if first is None:
+        result = '#include <Arduino.h>\n#line 1 "%s"\n%s' % (path, source)
+    else:
+        line = source.count("\n", 0, first) + 1
+        result = '#include <Arduino.h>\n#line 1 "%s"\n%s\n%s\n#line %d "%s"\n%s' % (
+            path, source[:first], "\n".join(prototypes), line, path, source[first:])
+    with open(output, "w") as f:
+        f.write(result)
+
+
+if __name__ == "__main__":
+    main()
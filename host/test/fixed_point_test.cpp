@@ -0,0 +1,188 @@
+/*
+  The monitor's fixed point sensor conversions against the float code they replaced: accuracy over every
+  12-bit ADC count, and the time per sample of both.
+
+    TDS        FixedPolynomial (Horner) vs the temperature compensated cubic with pow(), 0-35 C
+    turbidity  FixedPolynomial vs the float quadratic, over the sensor's valid 2.5-4.21 V
+    pH         FixedInterpolation vs Gravity_pH::read_ph(), for the default calibration, a cleared one
+               and a recalibrated probe (the table rebuilt from get_cal_points() each time)
+
+  The conversions are set up as setupSensorConversions() in the monitor sketch does. Each must stay within
+  its bound below of the float result before rounding; the sketch rounds TDS and NTU to whole units and
+  shows pH with 2 decimals. The timings are the host's and aren't checked: with an FPU only TDS (pow())
+  comes out faster in fixed point, the gain that counts is against the SAMD21's software float.
+*/
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include "fixed_point.h"
+#include "ph_grav_no_eeprom.h"
+#include "test_check.h"
+
+// As the monitor sketch
+#define VREF 3.3
+const float ANALOG_TO_VOLTAGE = VREF / 4095.0;
+const float turbidityOffset = 0.46;
+
+#define ADC_COUNTS 4096
+#define TDS_MAX_ERROR 0.1f         // ppm, of up to 14000 at full scale in 0 C water
+#define TURBIDITY_MAX_ERROR 0.05f  // NTU
+#define PH_MAX_ERROR 0.0005f
+#define TIMING_ROUNDS 200          // passes over every count for the timings
+
+// ---- The float code ----
+
+static float tdsFloat(uint16_t counts, float tempC) {
+  float compensationCoefficient = 1.0 + 0.0191 * (tempC - 25.0);
+  float compensationVoltage = counts * ANALOG_TO_VOLTAGE / compensationCoefficient;
+  return (133.42 * pow(compensationVoltage, 3) - 255.86 * pow(compensationVoltage, 2) + 857.39 * compensationVoltage) * 0.5;
+}
+
+static float turbidityVoltageFloat(uint16_t counts) {
+  return counts * ANALOG_TO_VOLTAGE - turbidityOffset;
+}
+
+static float turbidityFloat(uint16_t counts) {
+  float turbidityVoltage = turbidityVoltageFloat(counts);
+  return -1120.4 * sq(turbidityVoltage) + 5742.3 * turbidityVoltage - 4352.9;
+}
+
+// ---- The fixed point conversions ----
+
+static FixedPolynomial tdsCurve;
+static FixedPolynomial turbidityCurve;
+static FixedInterpolation pHTable;
+
+static void setTdsTemperature(float tempC) {
+  float compensationCoefficient = 1.0 + 0.0191 * (tempC - 25.0);
+  tdsCurve.setInput(ANALOG_TO_VOLTAGE / compensationCoefficient);
+}
+
+static void setupConversions() {
+  const float tdsCoefficients[] = {133.42 * 0.5, -255.86 * 0.5, 857.39 * 0.5, 0};
+  tdsCurve.setCoefficients(tdsCoefficients, 3);
+  setTdsTemperature(25);
+  const float turbidityCoefficients[] = {-1120.4, 5742.3, -4352.9};
+  turbidityCurve.setCoefficients(turbidityCoefficients, 2);
+  turbidityCurve.setInput(ANALOG_TO_VOLTAGE, -turbidityOffset);
+}
+
+static void buildPHTable(Gravity_pH& pH) {
+  float voltages_mV[FIXED_INTERPOLATION_MAX_POINTS];
+  float phs[FIXED_INTERPOLATION_MAX_POINTS];
+  uint8_t count = pH.get_cal_points(voltages_mV, phs);
+  CHECK(pHTable.setPoints(voltages_mV, phs, count, ANALOG_TO_VOLTAGE * 1000));
+}
+
+// ---- Accuracy ----
+
+static float worstTds = 0;
+static float worstTurbidity = 0;
+static float worstTurbidityVoltage = 0;
+static float worstPH = 0;
+
+static void checkTds() {
+  for (int tempC = 0; tempC <= 35; tempC++) {
+    setTdsTemperature(tempC);
+    for (uint16_t counts = 0; counts < ADC_COUNTS; counts++) {
+      float error = fabsf(q16ToFloat(tdsCurve.convert(counts)) - tdsFloat(counts, tempC));
+      worstTds = max(worstTds, error);
+    }
+  }
+  CHECK(worstTds <= TDS_MAX_ERROR);
+}
+
+static void checkTurbidity() {
+  for (uint16_t counts = 0; counts < ADC_COUNTS; counts++) {
+    q16_t voltage = turbidityCurve.input(counts);
+    worstTurbidityVoltage = max(worstTurbidityVoltage, fabsf(q16ToFloat(voltage) - turbidityVoltageFloat(counts)));
+    if (voltage <= toQ16(2.5) || voltage > toQ16(4.21)) {
+      continue; // the sketch reports 3000 or 0 NTU there, whichever conversion says so
+    }
+    worstTurbidity = max(worstTurbidity, fabsf(q16ToFloat(turbidityCurve.evaluate(voltage)) - turbidityFloat(counts)));
+  }
+  CHECK(worstTurbidityVoltage <= 0.0001f);
+  CHECK(worstTurbidity <= TURBIDITY_MAX_ERROR);
+}
+
+static void checkPH(Gravity_pH& pH) {
+  buildPHTable(pH);
+  for (uint16_t counts = 0; counts < ADC_COUNTS; counts++) {
+    // read_ph() of the voltage read_voltage() returns for these counts on the MKR
+    float expected = pH.read_ph(counts * (3300.0 / 4095.0));
+    worstPH = max(worstPH, fabsf(q16ToFloat(pHTable.convert(counts)) - expected));
+  }
+  CHECK(worstPH <= PH_MAX_ERROR);
+}
+
+// ---- Time per sample ----
+
+static double nowNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static volatile float floatSink;
+static volatile q16_t fixedSink;
+
+template <typename Convert>
+static double nanosPerSample(Convert convert) {
+  double start = nowNanos();
+  for (int round = 0; round < TIMING_ROUNDS; round++) {
+    for (uint16_t counts = 0; counts < ADC_COUNTS; counts++) {
+      convert(counts);
+    }
+  }
+  return (nowNanos() - start) / ((double)TIMING_ROUNDS * ADC_COUNTS);
+}
+
+static void printTiming(const char* conversion, double floatNanos, double fixedNanos) {
+  printf("%-10s %8.1f ns float, %8.1f ns fixed, %5.1fx\n", conversion, floatNanos, fixedNanos, floatNanos / fixedNanos);
+}
+
+static void timeConversions(Gravity_pH& pH) {
+  setTdsTemperature(18);
+  buildPHTable(pH);
+  printf("\nper sample on this host:\n");
+  printTiming("TDS", nanosPerSample([](uint16_t counts) { floatSink = tdsFloat(counts, 18); }),
+              nanosPerSample([](uint16_t counts) { fixedSink = tdsCurve.convert(counts); }));
+  printTiming("turbidity", nanosPerSample([](uint16_t counts) { floatSink = turbidityFloat(counts); }),
+              nanosPerSample([](uint16_t counts) { fixedSink = turbidityCurve.convert(counts); }));
+  printTiming("pH", nanosPerSample([&pH](uint16_t counts) { floatSink = pH.read_ph(counts * (3300.0 / 4095.0)); }),
+              nanosPerSample([](uint16_t counts) { fixedSink = pHTable.convert(counts); }));
+}
+
+void hostScenarioBegin(int argc, char** argv) {
+}
+
+void setup() {
+  setupConversions();
+  checkTds();
+  checkTurbidity();
+
+  Gravity_pH pH(A3);
+  checkPH(pH);
+  pH.cal_clear();
+  checkPH(pH);
+  pH.cal_low(2010);
+  pH.cal_mid(1562);
+  pH.cal_high(1140);
+  checkPH(pH);
+
+  printf("worst error:       TDS %.4f ppm, turbidity %.4f NTU (%.6f V), pH %.6f\n",
+         worstTds, worstTurbidity, worstTurbidityVoltage, worstPH);
+  timeConversions(pH);
+}
+
+void loop() {
+}
+
+bool hostScenarioStep() {
+  return false;
+}
+
+int hostScenarioEnd() {
+  return testResult("fixed_point_test");
+}
@@ -0,0 +1,315 @@
+/*
+  FlashRingLog on a file backed flash (FileFlash): recovery in begin(), commit replay, wraparound, and
+  power cuts at every point of a write.
+
+  A "reboot" closes the file and opens it again with a new FileFlash and FlashRingLog, as a reset leaves
+  the board's flash. Each record's payload is made from its sequence number, so whatever is replayed can
+  be checked against what was appended.
+
+  The power cut sweep runs a workload of appends and commits across the ring's wraparound once to count
+  the bytes it programs, then again from the same start with the power cut after every 4th of those bytes.
+  After each cut the log must begin(), keep every record whose append() returned true and wasn't
+  committed, replay none that commit() confirmed, and take new records.
+*/
+#include <Arduino.h>
+#include <stdio.h>
+#include "flash_device.h"
+#include "flash_ring_log.h"
+#include "test_check.h"
+
+#define FLASH_FILE "flash_ring_log_test.bin"
+#define SECTOR_SIZE 1024
+#define NUM_SECTORS 4
+#define CUT_STEP 4 // bytes between two power cut points (flash writes are whole 4 byte words)
+
+// A board's flash and the log on it, as after a reset
+struct Board {
+  FileFlash flash;
+  FlashRingLog log;
+  bool began;
+
+  Board() : flash(FLASH_FILE, SECTOR_SIZE * NUM_SECTORS), log(flash, SECTOR_SIZE), began(log.begin()) {}
+};
+
+static size_t payloadFor(uint32_t seq, uint8_t* data) {
+  size_t length = 8 + seq % 37;
+  for (size_t i = 0; i < length; i++) {
+    data[i] = (uint8_t)(seq * 31 + i);
+  }
+  return length;
+}
+
+static bool append(FlashRingLog& log, uint32_t seq) {
+  uint8_t data[FLASH_LOG_MAX_RECORD];
+  return log.append(data, payloadFor(seq, data));
+}
+
+// Read every pending record, checking they run on from `firstSeq` with their payloads; returns the last seq read
+static uint32_t readAll(FlashRingLog& log, uint32_t firstSeq) {
+  uint8_t data[FLASH_LOG_MAX_RECORD];
+  uint8_t expected[FLASH_LOG_MAX_RECORD];
+  size_t length;
+  uint32_t seq;
+  uint32_t expectedSeq = firstSeq;
+  while (log.readNext(data, sizeof(data), length, seq)) {
+    if (!CHECK(seq == expectedSeq)) {
+      printf("  read seq %lu, expected %lu\n", (unsigned long)seq, (unsigned long)expectedSeq);
+      return seq;
+    }
+    size_t expectedLength = payloadFor(seq, expected);
+    CHECK(length == expectedLength && memcmp(data, expected, length) == 0);
+    expectedSeq++;
+  }
+  return expectedSeq - 1;
+}
+
+static void eraseFlashFile() {
+  remove(FLASH_FILE);
+}
+
+static void testBeginRecovery() {
+  eraseFlashFile();
+  {
+    Board board; // blank flash is formatted
+    CHECK(board.began);
+    CHECK(board.log.lastSequence() == 0 && board.log.pending() == 0);
+    CHECK(board.log.sectorsErased == 1);
+  }
+
+  // Flash that never held a log (another sketch's data) is formatted too
+  FILE* file = fopen(FLASH_FILE, "wb");
+  for (int i = 0; i < SECTOR_SIZE * NUM_SECTORS; i++) {
+    fputc((i * 7919) >> 3, file);
+  }
+  fclose(file);
+  {
+    Board board;
+    CHECK(board.began);
+    CHECK(board.log.lastSequence() == 0 && board.log.pending() == 0);
+    for (uint32_t seq = 1; seq <= 5; seq++) {
+      CHECK(append(board.log, seq));
+    }
+  }
+  {
+    Board board;
+    CHECK(board.began);
+    CHECK(board.log.pending() == 5);
+    CHECK(readAll(board.log, 1) == 5);
+  }
+
+  // A record torn by a reset is skipped, and the next one goes into a new sector
+  {
+    Board board;
+    board.flash.cutPowerAfter(10);
+    CHECK(!append(board.log, 6));
+  }
+  {
+    Board board;
+    CHECK(board.began);
+    CHECK(board.log.corruptRecords == 1);
+    CHECK(board.log.lastSequence() == 5);
+    CHECK(append(board.log, 6));
+    CHECK(board.log.sectorsErased == 1);
+  }
+  {
+    Board board;
+    CHECK(readAll(board.log, 1) == 6);
+  }
+}
+
+static void testCommitReplay() {
+  eraseFlashFile();
+  {
+    Board board;
+    for (uint32_t seq = 1; seq <= 30; seq++) {
+      CHECK(append(board.log, seq));
+    }
+  }
+  {
+    Board board; // everything is pending after a reset
+    CHECK(board.log.pending() == 30);
+    uint8_t data[FLASH_LOG_MAX_RECORD];
+    size_t length;
+    uint32_t seq = 0;
+    for (int i = 0; i < 12; i++) {
+      board.log.readNext(data, sizeof(data), length, seq);
+    }
+    CHECK(seq == 12);
+    CHECK(board.log.commit(seq));
+  }
+  {
+    Board board; // the committed records aren't replayed, the read but uncommitted ones are
+    CHECK(board.log.committedSequence() == 12);
+    CHECK(board.log.pending() == 18);
+    uint8_t data[FLASH_LOG_MAX_RECORD];
+    size_t length;
+    uint32_t seq = 0;
+    for (int i = 0; i < 8; i++) {
+      board.log.readNext(data, sizeof(data), length, seq);
+    }
+    CHECK(seq == 20);
+  }
+  {
+    Board board;
+    CHECK(readAll(board.log, 13) == 30);
+    CHECK(board.log.commit(30));
+  }
+  {
+    Board board;
+    CHECK(board.log.pending() == 0);
+    CHECK(board.log.lastSequence() == 30);
+    CHECK(readAll(board.log, 31) == 30);
+    CHECK(append(board.log, 31)); // numbering carries on
+    CHECK(board.log.lastSequence() == 31);
+  }
+}
+
+static void testWraparound() {
+  eraseFlashFile();
+  const uint32_t appended = 150; // about twice what the ring holds
+  unsigned long dropped;
+  {
+    Board board;
+    for (uint32_t seq = 1; seq <= appended; seq++) {
+      CHECK(append(board.log, seq));
+    }
+    dropped = board.log.recordsDropped;
+    CHECK(dropped > 0);
+    CHECK(board.log.pending() == appended - dropped);
+  }
+  {
+    Board board; // the newest records survive, in order
+    CHECK(board.began);
+    CHECK(board.log.lastSequence() == appended);
+    CHECK(board.log.pending() == appended - dropped);
+    CHECK(readAll(board.log, dropped + 1) == appended);
+    CHECK(board.log.commit(appended));
+  }
+
+  // Appends and commits going round the ring many times, with resets in between, lose nothing
+  uint32_t seq = appended;
+  for (int reset = 0; reset < 10; reset++) {
+    Board board;
+    CHECK(board.began);
+    CHECK(board.log.pending() == 0);
+    for (int i = 0; i < 60; i++) {
+      CHECK(append(board.log, ++seq));
+      if (seq % 10 == 0) {
+        CHECK(readAll(board.log, seq - 9) == seq);
+        CHECK(board.log.commit(seq));
+      }
+    }
+    CHECK(board.log.recordsDropped == 0);
+    CHECK(readAll(board.log, seq - seq % 10 + 1) == seq);
+    CHECK(board.log.commit(seq));
+  }
+}
+
+// What the workload has been told so far, and what it was doing when the power went
+struct Outcome {
+  uint32_t appended = 0;  // last seq whose append() returned true
+  uint32_t committed = 0; // last seq a commit() returned true for
+  uint32_t appending = 0; // the append() the power cut stopped (0: none)
+  uint32_t committing = 0;
+};
+
+// The log a few records short of wrapping round, with records pending
+static void prepareWorkload(Outcome& outcome) {
+  eraseFlashFile();
+  Board board;
+  for (uint32_t seq = 1; seq <= 65; seq++) {
+    append(board.log, seq);
+    if (seq % 8 == 0) {
+      board.log.commit(seq - 3);
+    }
+  }
+  outcome.appended = board.log.lastSequence();
+  outcome.committed = board.log.committedSequence();
+}
+
+// Appends with a commit of all but the newest few every 6 records, across the wraparound; stops when the power goes
+static void runWorkload(Board& board, Outcome& outcome) {
+  uint32_t end = outcome.appended + 40;
+  for (uint32_t seq = outcome.appended + 1; seq <= end; seq++) {
+    if (!append(board.log, seq)) {
+      outcome.appending = seq;
+      return;
+    }
+    outcome.appended = seq;
+    if (seq % 6 == 0) {
+      if (!board.log.commit(seq - 2)) {
+        outcome.committing = seq - 2;
+        return;
+      }
+      outcome.committed = seq - 2;
+    }
+  }
+}
+
+static void checkRecovery(const Outcome& outcome, unsigned long cutAfter) {
+  Board board;
+  uint32_t committed = board.log.committedSequence();
+  uint32_t last = board.log.lastSequence();
+  bool ok = CHECK(board.began);
+  ok = CHECK(committed == outcome.committed || (outcome.committing != 0 && committed == outcome.committing)) && ok;
+  ok = CHECK(last == outcome.appended || (outcome.appending != 0 && last == outcome.appending)) && ok;
+  ok = CHECK(readAll(board.log, committed + 1) == last) && ok;
+  ok = CHECK(append(board.log, last + 1)) && ok;
+  if (!ok) {
+    printf("  power cut after %lu bytes: committed %lu (told %lu), last %lu (told %lu)\n", cutAfter,
+           (unsigned long)committed, (unsigned long)outcome.committed, (unsigned long)last, (unsigned long)outcome.appended);
+  }
+}
+
+static void testPowerCuts() {
+  Outcome uncut;
+  prepareWorkload(uncut);
+  unsigned long workloadBytes;
+  {
+    Board board;
+    runWorkload(board, uncut);
+    workloadBytes = board.flash.bytesProgrammed;
+    CHECK(board.log.sectorsErased > 0); // the workload wraps round the ring
+  }
+
+  unsigned long failuresBefore = testFailures;
+  for (unsigned long cut = 0; cut < workloadBytes && testFailures == failuresBefore; cut += CUT_STEP) {
+    Outcome outcome;
+    prepareWorkload(outcome);
+    {
+      Board board;
+      board.flash.cutPowerAfter(cut);
+      runWorkload(board, outcome);
+      CHECK(board.flash.powerLost());
+    }
+    checkRecovery(outcome, cut);
+    {
+      Board board; // the record appended after the cut survives the next reset
+      CHECK(board.log.lastSequence() >= outcome.appended + 1);
+    }
+  }
+  printf("power cuts:        %lu points over %lu bytes of appends, commits and erases\n",
+         (workloadBytes + CUT_STEP - 1) / CUT_STEP, workloadBytes);
+}
+
+void hostScenarioBegin(int argc, char** argv) {
+}
+
+void setup() {
+  testBeginRecovery();
+  testCommitReplay();
+  testWraparound();
+  testPowerCuts();
+  eraseFlashFile();
+}
+
+void loop() {
+}
+
+bool hostScenarioStep() {
+  return false;
+}
+
+int hostScenarioEnd() {
+  return testResult("flash_ring_log_test");
+}
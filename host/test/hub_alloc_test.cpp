@@ -0,0 +1,160 @@
+/*
+  MKR Central Hub: after warm-up the ingest -> upload cycle allocates nothing.
+
+  Replays the Nano frames of a trace captured from the hub (TRACE on, see trace_recorder.h) over and over
+  for --minutes of simulated time (default 20, so the 15 minute rollup is uploaded too), with the trace's
+  own timing. The first pass through the trace is the warm-up; from then on any malloc/calloc/realloc
+  fails the test. Halfway through, the server drops the connection, so the reconnect is covered as well.
+
+  The trace in traces/ was captured with hub_loop_bench's load (3 monitors, realtime frames every second
+  and log frames every minute) from a hub built with TRACE=true, run with HOST_SERIAL_ECHO set.
+*/
+#include <Arduino.h>
+#include <SSLClient.h>
+#include <stdio.h>
+#include <vector>
+#include "memory_monitor.h"
+#include "nano_link.h"
+#include "test_check.h"
+
+extern SSLClient firebaseClient;
+extern FrameReader nanoFrameReader;
+
+#define DEFAULT_MINUTES 20
+#define STARTUP_MS 10000 // as hub_loop_bench: the Nano's still connecting to the monitors for this long
+#define PASS_GAP_MS 1000  // between the last frame of one pass and the first of the next, a realtime interval
+
+// A frame the hub received, as recorded: "@<ms> F <type> <device> <sequence> <payload hex>"
+struct TraceFrame {
+  unsigned long ms;
+  uint8_t type;
+  uint8_t device;
+  uint8_t payload[FRAME_MAX_PAYLOAD];
+  size_t payloadLength;
+};
+
+static std::vector<TraceFrame> frames;
+static unsigned long passLength;   // ms from the first frame of one pass to the first of the next
+static NanoLink nano;
+static unsigned long duration;
+static unsigned long replayStart = 0; // millis() of the first frame of the first pass
+static size_t nextFrame = 0;
+static unsigned long pass = 0;
+static bool warmedUp = false;
+static uint32_t allocationsAtWarmUp = 0;
+static bool dropped = false;
+
+static size_t parseHex(const char* hex, uint8_t* out, size_t capacity) {
+  size_t length = 0;
+  unsigned int byte;
+  while (length < capacity && sscanf(hex + 2 * length, "%2x", &byte) == 1) {
+    out[length++] = (uint8_t)byte;
+  }
+  return length;
+}
+
+// Loads the frames of the trace's first boot. The frames the Nano sends in answer to the hub's commands
+// are left out, as in tools/hub_load_test.py's replay.
+static bool loadTrace(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    printf("can't open the trace %s\n", path);
+    return false;
+  }
+  char line[256];
+  bool booted = false;
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    unsigned long ms;
+    char event;
+    int offset = 0;
+    if (sscanf(line, "@%lu %c %n", &ms, &event, &offset) < 2) {
+      continue;
+    }
+    if (event == 'B') {
+      if (booted) {
+        break; // the hub reset
+      }
+      booted = true;
+    }
+    unsigned int type, device, sequence;
+    char hex[2 * FRAME_MAX_PAYLOAD + 1] = "";
+    if (event != 'F' || sscanf(line + offset, "%u %u %u %s", &type, &device, &sequence, hex) < 3
+        || type == FRAME_STATUS || type == FRAME_REPLY) {
+      continue;
+    }
+    TraceFrame frame;
+    frame.ms = ms;
+    frame.type = type;
+    frame.device = device;
+    frame.payloadLength = parseHex(hex, frame.payload, sizeof(frame.payload));
+    frames.push_back(frame);
+  }
+  fclose(file);
+  if (frames.size() < 2) {
+    printf("no frames in the trace %s\n", path);
+    return false;
+  }
+  passLength = frames.back().ms - frames.front().ms + PASS_GAP_MS;
+  return true;
+}
+
+void hostScenarioBegin(int argc, char** argv) {
+  hostSetLoopStep(250);
+  duration = (unsigned long)hostArgLong(argc, argv, "--minutes", DEFAULT_MINUTES) * 60000UL;
+  const char* path = hostArg(argc, argv, "--trace", nullptr);
+  if (path == nullptr || !loadTrace(path)) {
+    printf("usage: hub_alloc_test --trace <trace> [--minutes <n>]\n");
+    exit(2);
+  }
+  frames.shrink_to_fit(); // nothing the test itself does allocates once the sketch runs
+}
+
+void hostScenarioPoll() {
+  nano.poll();
+  if (!nano.connected) {
+    return;
+  }
+  if (replayStart == 0) {
+    replayStart = millis() + STARTUP_MS;
+  }
+  while (millis() >= replayStart + pass * passLength + (frames[nextFrame].ms - frames.front().ms)) {
+    const TraceFrame& frame = frames[nextFrame];
+    nano.sendPayload(frame.type, frame.device, frame.payload, frame.payloadLength);
+    if (++nextFrame == frames.size()) {
+      nextFrame = 0;
+      pass++;
+    }
+  }
+}
+
+bool hostScenarioStep() {
+  if (!warmedUp && pass >= 1) {
+    warmedUp = true;
+    allocationsAtWarmUp = memoryAllocations;
+  }
+  if (warmedUp && !dropped && millis() >= duration / 2) {
+    dropped = true;
+    firebaseClient.hostDrop();
+  }
+  if (warmedUp && !CHECK(memoryAllocations == allocationsAtWarmUp)) {
+    return false; // stop at the first allocation, the sketch's Serial output up to here shows where it was
+  }
+  return millis() < duration;
+}
+
+int hostScenarioEnd() {
+  MemoryStats stats = memoryMonitor.stats();
+  printf("trace:             %zu frames, %lu passes, %lu frames received, %lu CRC errors, %lu dropped, %lu UART overruns\n",
+         frames.size(), pass, nanoFrameReader.framesReceived, nanoFrameReader.crcErrors, nanoFrameReader.droppedFrames,
+         Serial1.rxOverruns);
+  printf("Firebase:          %lu requests, %lu writes, %lu full / %lu resumed handshakes\n",
+         hostFirebase.requests, hostFirebase.writes, hostFirebase.fullHandshakes, hostFirebase.resumedHandshakes);
+  printf("allocations:       %lu after warm-up, %lu after setup, heap %u, lowest free RAM %d\n",
+         (unsigned long)(memoryAllocations - allocationsAtWarmUp), (unsigned long)memoryMonitor.steadyStateAllocations(),
+         (unsigned)stats.heapInUse, stats.minFreeRam);
+  CHECK(warmedUp);
+  CHECK(dropped && hostFirebase.fullHandshakes + hostFirebase.resumedHandshakes >= 2);
+  CHECK(nanoFrameReader.crcErrors <= Serial1.rxOverruns); // frames are only lost to overruns while the reconnect blocks
+  CHECK(hostFirebase.writes > 0);
+  return testResult("hub_alloc_test");
+}
@@ -0,0 +1,122 @@
+/*
+  MKR Central Hub: the Firebase connection resumes its TLS session on reconnects.
+
+  The stand-in server (hostFirebase) keeps a session cache, so a reconnect that offers the cached session
+  is an abbreviated handshake. Each stage drops the connection once the hub is connected, and the Nano's
+  frames make the hub reconnect disconnectDelay later. Both ends' counts are checked:
+    BOOT               setup()'s connection is a full handshake
+    RESUME             the reconnect resumes the session, and takes less time than a full handshake
+    SERVER_RESTART     the server has forgotten the session, so the reconnect is a full handshake
+    HANDSHAKE_FAILURE  a failed handshake drops the cached session, so the retry is a full handshake
+                       although the server would still resume it
+*/
+#include <Arduino.h>
+#include <SSLClient.h>
+#include "MKR-1010-Central-Hub/secrets.h"
+#include "nano_link.h"
+#include "test_check.h"
+#include "tls_stats.h"
+
+extern SSLClient firebaseClient;
+extern TlsConnectionStats tlsStats;
+
+#define REALTIME_INTERVAL_MS 1000
+#define STAGE_TIMEOUT_MS 60000 // disconnectDelay, the reconnect's retries and a handshake take far less
+
+enum Stage { BOOT, RESUME, SERVER_RESTART, HANDSHAKE_FAILURE, DONE };
+static const char* const stageNames[] = { "BOOT", "RESUME", "SERVER_RESTART", "HANDSHAKE_FAILURE" };
+
+static NanoLink nano;
+static Stage stage = BOOT;
+static unsigned long stageDeadline = STAGE_TIMEOUT_MS;
+static unsigned long nextRealtime = 0;
+static unsigned long step = 0;
+
+void hostScenarioBegin(int argc, char** argv) {
+  hostSetLoopStep(250);
+}
+
+void hostScenarioPoll() {
+  nano.poll();
+  if (nano.connected && millis() >= nextRealtime) {
+    nextRealtime = millis() + REALTIME_INTERVAL_MS;
+    step++;
+    nano.sendReadings(FRAME_REALTIME, 0, driftingReadings(0, step));
+  }
+}
+
+// Handshakes the server has completed by the end of each stage
+static unsigned long handshakesBy(Stage s) {
+  return (unsigned long)s + 1;
+}
+
+static void nextStage(Stage next) {
+  stage = next;
+  stageDeadline = millis() + STAGE_TIMEOUT_MS;
+  if (next != DONE) {
+    firebaseClient.hostDrop();
+  }
+}
+
+bool hostScenarioStep() {
+  if (stage == DONE) {
+    return false;
+  }
+  if (millis() > stageDeadline) {
+    CHECK(!"the hub reconnected in time");
+    printf("stuck in stage %s\n", stageNames[stage]);
+    return false;
+  }
+  if (!firebaseClient.connected() || hostFirebase.fullHandshakes + hostFirebase.resumedHandshakes < handshakesBy(stage)) {
+    return true;
+  }
+
+  switch (stage) {
+    case BOOT:
+      CHECK(hostFirebase.fullHandshakes == 1);
+      CHECK(tlsStats.fullHandshakes() == 1);
+      CHECK(!tlsStats.lastWasResumed());
+      CHECK(firebaseClient.getSession(SECRET_DATABASE_URL) != nullptr);
+      nextStage(RESUME);
+      break;
+    case RESUME:
+      CHECK(hostFirebase.resumedHandshakes == 1);
+      CHECK(hostFirebase.fullHandshakes == 1);
+      CHECK(tlsStats.resumedHandshakes() == 1);
+      CHECK(tlsStats.lastWasResumed());
+      CHECK(tlsStats.resumedHandshakeMs.mean() < tlsStats.fullHandshakeMs.mean());
+      hostFirebase.restart();
+      nextStage(SERVER_RESTART);
+      break;
+    case SERVER_RESTART:
+      CHECK(hostFirebase.fullHandshakes == 2);
+      CHECK(hostFirebase.resumedHandshakes == 1);
+      CHECK(tlsStats.fullHandshakes() == 2);
+      CHECK(!tlsStats.lastWasResumed());
+      hostFirebase.failHandshakes = 1;
+      nextStage(HANDSHAKE_FAILURE);
+      break;
+    case HANDSHAKE_FAILURE:
+      CHECK(tlsStats.failures(TLS_FAIL_HANDSHAKE) == 1);
+      CHECK(tlsStats.lastFailure() == TLS_FAIL_HANDSHAKE);
+      CHECK(hostFirebase.fullHandshakes == 3);
+      CHECK(hostFirebase.resumedHandshakes == 1);
+      CHECK(tlsStats.fullHandshakes() == 3);
+      CHECK(tlsStats.resumedHandshakes() == 1);
+      nextStage(DONE);
+      break;
+    case DONE:
+      break;
+  }
+  return true;
+}
+
+int hostScenarioEnd() {
+  printf("handshakes:        server %lu full / %lu resumed, hub %lu full (avg %.0f ms) / %lu resumed (avg %.0f ms), %lu failed\n",
+         hostFirebase.fullHandshakes, hostFirebase.resumedHandshakes,
+         (unsigned long)tlsStats.fullHandshakes(), tlsStats.fullHandshakeMs.mean(),
+         (unsigned long)tlsStats.resumedHandshakes(), tlsStats.resumedHandshakeMs.mean(),
+         (unsigned long)tlsStats.failures());
+  CHECK(stage == DONE);
+  return testResult("hub_tls_resume_test");
+}
@@ -0,0 +1,151 @@
+/*
+  SpscQueue with a producer and a consumer thread running flat out against each other, as the ESP32's
+  stream task and RF task do on their two cores.
+
+  Every item carries its sequence number and words derived from it, so the consumer sees a lost,
+  repeated, reordered or half written item. Two rounds:
+    retry  the producer retries a full push, so every item must arrive, in order
+    drop   the producer moves on, so the items must arrive in order with gaps, and the gaps must add
+           up to dropped()
+  The queue is small so it runs full and empty all the time. Needs no Arduino, only pthreads; it is built
+  with ThreadSanitizer when the compiler has it.
+
+  Usage: spsc_queue_stress_test [items per round, default 2000000]
+*/
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include "spsc_queue.h"
+
+#define QUEUE_SIZE 16
+#define DEFAULT_ITEMS 2000000UL
+
+struct Item {
+  uint32_t seq;
+  uint32_t words[5]; // enough that copying an item in or out isn't a single store
+};
+
+static Item makeItem(uint32_t seq) {
+  Item item;
+  item.seq = seq;
+  for (uint32_t i = 0; i < 5; i++) {
+    item.words[i] = seq * 2654435761U + i;
+  }
+  return item;
+}
+
+static bool itemIntact(const Item& item) {
+  for (uint32_t i = 0; i < 5; i++) {
+    if (item.words[i] != item.seq * 2654435761U + i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct Round {
+  SpscQueue<Item, QUEUE_SIZE> queue;
+  unsigned long items;
+  bool retry;
+  std::atomic<bool> produced{false}; // the producer has pushed (or dropped) its last item
+  unsigned long fullPushes = 0;  // producer: pushes that found the queue full
+  unsigned long received = 0;    // consumer
+  unsigned long gaps = 0;        // consumer: items missing between two received ones
+  unsigned long outOfOrder = 0;
+  unsigned long torn = 0;
+};
+
+static void* produce(void* arg) {
+  Round& round = *(Round*)arg;
+  for (uint32_t seq = 1; seq <= round.items; seq++) {
+    Item item = makeItem(seq);
+    while (!round.queue.push(item)) {
+      round.fullPushes++;
+      if (!round.retry) {
+        break;
+      }
+      sched_yield();
+    }
+    if (!round.retry && seq % (4 * QUEUE_SIZE) == 0) {
+      sched_yield(); // let the consumer in now and then, or it hardly ever gets an item
+    }
+  }
+  round.produced.store(true, std::memory_order_release);
+  return nullptr;
+}
+
+static void* consume(void* arg) {
+  Round& round = *(Round*)arg;
+  uint32_t last = 0;
+  while (true) {
+    // read before the pop: if the producer had finished, an empty queue means everything has been received
+    bool produced = round.produced.load(std::memory_order_acquire);
+    Item item;
+    if (!round.queue.pop(item)) {
+      if (produced) {
+        break;
+      }
+      sched_yield();
+      continue;
+    }
+    round.received++;
+    if (!itemIntact(item)) {
+      round.torn++;
+    }
+    if (item.seq <= last) {
+      round.outOfOrder++;
+    } else {
+      round.gaps += item.seq - last - 1;
+    }
+    last = item.seq;
+  }
+  round.gaps += round.items - last; // dropped after the last one received
+  return nullptr;
+}
+
+static unsigned long failures = 0;
+
+static void check(bool passed, const char* what, const char* round) {
+  if (!passed) {
+    printf("%s round: %s\n", round, what);
+    failures++;
+  }
+}
+
+static void runRound(unsigned long items, bool retry) {
+  Round* round = new Round();
+  round->items = items;
+  round->retry = retry;
+  pthread_t producer, consumer;
+  pthread_create(&consumer, nullptr, consume, round);
+  pthread_create(&producer, nullptr, produce, round);
+  pthread_join(producer, nullptr);
+  pthread_join(consumer, nullptr);
+
+  const char* name = retry ? "retry" : "drop";
+  printf("%-5s round: %lu pushed, %lu received, %lu full pushes, %lu dropped, high water %zu of %zu\n", name,
+         items, round->received, round->fullPushes, (unsigned long)round->queue.dropped(),
+         round->queue.highWater(), round->queue.capacity());
+  check(round->torn == 0, "items were torn", name);
+  check(round->outOfOrder == 0, "items arrived out of order or twice", name);
+  check(round->queue.dropped() == round->fullPushes, "dropped() doesn't count every full push", name);
+  check(round->queue.highWater() <= QUEUE_SIZE, "high water above the capacity", name);
+  check(round->queue.size() == 0, "items left in the queue", name);
+  if (retry) {
+    check(round->received == items && round->gaps == 0, "items were lost", name);
+  } else {
+    check(round->received + round->gaps == items, "received and missing items don't add up", name);
+    check(round->gaps == round->queue.dropped(), "missing items don't match dropped()", name);
+  }
+  delete round;
+}
+
+int main(int argc, char** argv) {
+  unsigned long items = argc > 1 ? strtoul(argv[1], nullptr, 0) : DEFAULT_ITEMS;
+  runRound(items, true);
+  runRound(items, false);
+  printf("spsc_queue_stress_test: %s (%lu failed checks)\n", failures == 0 ? "passed" : "FAILED", failures);
+  return failures == 0 ? 0 : 1;
+}
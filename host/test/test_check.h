@@ -0,0 +1,29 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+#include "host_sim.h"
+
+/*
+  Checks for the host tests: a failed CHECK() prints the condition and where it is and is counted, the
+  scenario carries on, and testResult() turns the count into the exit code.
+*/
+
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+
+inline unsigned long testFailures = 0;
+
+inline bool testCheck(bool passed, const char* condition, const char* file, int line) {
+  if (!passed) {
+    printf("%s:%d: CHECK(%s) failed at %lu ms\n", file, line, condition, millis());
+    testFailures++;
+  }
+  return passed;
+}
+
+inline int testResult(const char* test) {
+  printf("%s: %s (%lu failed checks)\n", test, testFailures == 0 ? "passed" : "FAILED", testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
+
+#endif // TEST_CHECK_H
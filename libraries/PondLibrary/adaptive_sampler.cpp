@@ -0,0 +1,68 @@
+#include "adaptive_sampler.h"
+
+AdaptiveSampler::AdaptiveSampler(unsigned long minInterval, unsigned long maxInterval, float deadband, float relativeDeadband)
+    : minInterval(minInterval), maxInterval(max(minInterval, maxInterval)), deadband(deadband), relativeDeadband(relativeDeadband),
+      currentInterval(minInterval), lastSample(0), sampled(false), reference(0), haveReference(false) {
+}
+
+bool AdaptiveSampler::isDue(unsigned long now) const {
+  return !sampled || now - lastSample >= currentInterval;
+}
+
+/**
+ * @return ms until the next sample is due, 0 if it already is
+ */
+unsigned long AdaptiveSampler::timeUntilDue(unsigned long now) const {
+  if (isDue(now)) {
+    return 0;
+  }
+  return currentInterval - (now - lastSample);
+}
+
+/**
+ * Record a sample taken at `now` and adjust the interval to the next one.
+ */
+void AdaptiveSampler::add(float value, unsigned long now) {
+  samples++;
+  lastSample = now;
+  sampled = true;
+
+  // Compare with the current window, or the last one's mean at the start of a window
+  bool haveCenter = window.count() > 0 || haveReference;
+  float center = window.count() > 0 ? window.mean() : reference;
+  if (haveCenter && fabs(value - center) > band(center)) {
+    // Changing: back to the full rate and start a new window from this value
+    if (currentInterval != minInterval) {
+      currentInterval = minInterval;
+      speedUps++;
+    }
+    window.reset();
+    window.add(value);
+    return;
+  }
+
+  window.add(value);
+  if (window.count() < ADAPTIVE_SAMPLER_WINDOW) {
+    return;
+  }
+  if (window.stddev() <= band(window.mean()) && currentInterval < maxInterval) {
+    currentInterval = min(currentInterval * 2, maxInterval);
+    slowDowns++;
+  }
+  reference = window.mean();
+  haveReference = true;
+  window.reset();
+}
+
+/**
+ * Back to the full rate, e.g. when a central connects and wants fresh values.
+ */
+void AdaptiveSampler::reset() {
+  currentInterval = minInterval;
+  window.reset();
+  haveReference = false;
+}
+
+float AdaptiveSampler::band(float center) const {
+  return max(deadband, relativeDeadband * (float)fabs(center));
+}
@@ -0,0 +1,50 @@
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+#include <Arduino.h>
+#include "running_stats.h"
+
+#define ADAPTIVE_SAMPLER_WINDOW 8 // samples per stability check
+
+/**
+ * Decides how often one sensor is sampled from how much it has been changing.
+ *
+ * Samples are collected in windows of ADAPTIVE_SAMPLER_WINDOW. When a whole window's standard deviation
+ * stays under the sensor's deadband the interval doubles, up to maxInterval. As soon as a sample is more
+ * than the deadband from the window's mean (the last window's, for the first sample of a window) the
+ * interval drops back to minInterval, so a real change is followed at the full rate (and a spike is
+ * sampled fast enough for the outlier filter to tell it apart from a step). The deadband is the larger
+ * of `deadband` and `relativeDeadband` of the mean, like the realtime deadbands in sensor_registry.h.
+ */
+class AdaptiveSampler {
+  public:
+    AdaptiveSampler(unsigned long minInterval, unsigned long maxInterval, float deadband, float relativeDeadband = 0);
+
+    bool isDue(unsigned long now) const;
+    unsigned long timeUntilDue(unsigned long now) const;
+    void add(float value, unsigned long now);
+    void reset();
+
+    unsigned long interval() const { return currentInterval; }
+    bool isStable() const { return currentInterval >= maxInterval; }
+
+    unsigned long samples = 0;
+    unsigned long speedUps = 0;   // drops back to minInterval on a change
+    unsigned long slowDowns = 0;  // doublings after a stable window
+
+  private:
+    float band(float center) const;
+
+    unsigned long minInterval;
+    unsigned long maxInterval;
+    float deadband;
+    float relativeDeadband;
+    unsigned long currentInterval;
+    unsigned long lastSample;
+    bool sampled; // the first sample is due straight away
+    RunningStats<float> window;
+    float reference;    // mean of the last full window
+    bool haveReference;
+};
+
+#endif // ADAPTIVE_SAMPLER_H
@@ -0,0 +1,222 @@
+#include "adc_sampler.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+#include "wiring_private.h" // pinPeripheral()
+
+// The sampler currently attached to the ADC interrupt
+static AdcSampler* activeSampler = nullptr;
+
+static inline void syncADC() {
+  while (ADC->STATUS.bit.SYNCBUSY == 1);
+}
+
+// Result ready interrupt: hand the (hardware averaged) result to the sampler, which starts the next conversion
+void ADC_Handler() {
+  uint16_t result = ADC->RESULT.reg; // reading RESULT also clears the RESRDY flag
+  if (activeSampler != nullptr) {
+    activeSampler->onConversionComplete(result);
+  }
+}
+#elif defined(ARDUINO_ARCH_HOST)
+#include "host_sim.h"
+
+// A 16 sample hardware averaged conversion at the core's prescaler (a window of 3 channels fills in ~300ms)
+#define HOST_ADC_CONVERSION_MICROS 6250
+
+static AdcSampler* activeSampler = nullptr;
+static unsigned long long nextConversion = 0;
+
+// Stands in for the result ready interrupt: completes the conversions that are due (called by the pump)
+static void hostAdcInterrupt() {
+  while (activeSampler != nullptr && hostNowMicros() >= nextConversion) {
+    nextConversion += HOST_ADC_CONVERSION_MICROS;
+    activeSampler->onConversionComplete(hostAnalogSample(activeSampler->currentPin()));
+  }
+}
+#endif
+
+AdcSampler::AdcSampler() : numChannels(0), currentChannel(0), conversions(0), running(false) {
+}
+
+/**
+ * Add an analog pin to the round robin. Must be called before begin().
+ * @param pin The analog pin (e.g. A1)
+ * @return The channel index to pass to the read functions, or -1 if all channels are in use
+ */
+int8_t AdcSampler::addChannel(uint8_t pin) {
+  if (numChannels >= ADC_SAMPLER_MAX_CHANNELS) {
+    return -1;
+  }
+  Channel& channel = channels[numChannels];
+  channel.pin = pin;
+#if defined(ARDUINO_ARCH_SAMD)
+  channel.adcInput = g_APinDescription[pin].ulADCChannelNumber;
+#else
+  channel.adcInput = pin;
+#endif
+  channel.next = 0;
+  channel.count = 0;
+  channel.sum = 0;
+  return numChannels++;
+}
+
+/**
+ * Configure the ADC and start sampling in the background.
+ */
+void AdcSampler::begin() {
+  if (numChannels == 0) {
+    return;
+  }
+  // Start every window afresh, results from before a stop() may be long out of date
+  for (uint8_t i = 0; i < numChannels; i++) {
+    channels[i].next = 0;
+    channels[i].count = 0;
+    channels[i].sum = 0;
+  }
+  currentChannel = 0;
+  running = true;
+
+#if defined(ARDUINO_ARCH_SAMD)
+  for (uint8_t i = 0; i < numChannels; i++) {
+    pinPeripheral(channels[i].pin, PIO_ANALOG);
+  }
+
+  activeSampler = this;
+
+  syncADC();
+  ADC->CTRLA.bit.ENABLE = 0;
+  syncADC();
+  // Keep the core's prescaler, accumulate 16 samples per result and shift the sum right by 4
+  // so each result is a 12-bit value averaged in hardware (RESSEL must be 16 bit for averaging)
+  ADC->CTRLB.reg = ADC_CTRLB_PRESCALER_DIV512 | ADC_CTRLB_RESSEL_16BIT;
+  syncADC();
+  ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_16 | ADC_AVGCTRL_ADJRES(4);
+  syncADC();
+  ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+  ADC->INTENSET.reg = ADC_INTENSET_RESRDY;
+  NVIC_SetPriority(ADC_IRQn, 3);
+  NVIC_EnableIRQ(ADC_IRQn);
+  ADC->CTRLA.bit.ENABLE = 1;
+  syncADC();
+
+  startConversion(0);
+#elif defined(ARDUINO_ARCH_HOST)
+  static bool pumpHandlerAdded = false;
+  if (!pumpHandlerAdded) {
+    hostAddPumpHandler(hostAdcInterrupt);
+    pumpHandlerAdded = true;
+  }
+  activeSampler = this;
+  nextConversion = hostNowMicros() + HOST_ADC_CONVERSION_MICROS;
+#else
+  analogReadResolution(12);
+#endif
+}
+
+/**
+ * Stop background sampling and hand the ADC back to analogRead().
+ */
+void AdcSampler::stop() {
+  running = false;
+#if defined(ARDUINO_ARCH_SAMD)
+  NVIC_DisableIRQ(ADC_IRQn);
+  ADC->INTENCLR.reg = ADC_INTENCLR_RESRDY;
+  syncADC();
+  ADC->CTRLA.bit.ENABLE = 0;
+  syncADC();
+  // Restore the single sample, 12-bit configuration analogRead() expects
+  ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_1 | ADC_AVGCTRL_ADJRES(0);
+  syncADC();
+  ADC->CTRLB.reg = ADC_CTRLB_PRESCALER_DIV512 | ADC_CTRLB_RESSEL_12BIT;
+  syncADC();
+  activeSampler = nullptr;
+#elif defined(ARDUINO_ARCH_HOST)
+  activeSampler = nullptr;
+#endif
+}
+
+/**
+ * Take the next round robin sample on boards without the interrupt driven sampler.
+ * Does nothing on the SAMD21 where sampling happens in the ADC interrupt (or the host build's stand-in for it).
+ */
+void AdcSampler::poll() {
+#if defined(ARDUINO_ARCH_HOST)
+  yield(); // lets the simulated interrupt catch up
+#elif !defined(ARDUINO_ARCH_SAMD)
+  if (running) {
+    onConversionComplete(analogRead(channels[currentChannel].pin));
+  }
+#endif
+}
+
+/**
+ * Store a finished conversion for the current channel and move on to the next one.
+ * Called from the ADC interrupt on the SAMD21.
+ */
+void AdcSampler::onConversionComplete(uint16_t result) {
+  Channel& channel = channels[currentChannel];
+
+  // Update the ring buffer and its running sum in O(1)
+  if (channel.count == ADC_SAMPLER_WINDOW) {
+    channel.sum -= channel.samples[channel.next];
+  } else {
+    channel.count++;
+  }
+  channel.samples[channel.next] = result;
+  channel.sum += result;
+  channel.next = (channel.next + 1) % ADC_SAMPLER_WINDOW;
+  conversions++;
+
+  uint8_t nextChannel = (currentChannel + 1) % numChannels;
+  if (running) {
+    startConversion(nextChannel);
+  } else {
+    currentChannel = nextChannel;
+  }
+}
+
+void AdcSampler::startConversion(uint8_t channel) {
+  currentChannel = channel;
+#if defined(ARDUINO_ARCH_SAMD)
+  syncADC();
+  ADC->INPUTCTRL.bit.MUXPOS = channels[channel].adcInput;
+  syncADC();
+  ADC->SWTRIG.bit.START = 1;
+#endif
+}
+
+/**
+ * @return The average of the last ADC_SAMPLER_WINDOW results of the channel (12-bit, 0-4095)
+ */
+uint16_t AdcSampler::readRaw(int8_t channel) const {
+  if (channel < 0 || channel >= numChannels) {
+    return 0;
+  }
+  const Channel& c = channels[channel];
+  noInterrupts();
+  uint32_t sum = c.sum;
+  uint8_t count = c.count;
+  interrupts();
+  return count == 0 ? 0 : (sum + count / 2) / count;
+}
+
+/**
+ * @return The windowed average of the channel converted to millivolts
+ */
+float AdcSampler::readMillivolts(int8_t channel, float vref_mV) const {
+  return readRaw(channel) * vref_mV / 4095.0;
+}
+
+/**
+ * @return true once the channel has at least one conversion stored
+ */
+bool AdcSampler::isReady(int8_t channel) const {
+  return channel >= 0 && channel < numChannels && channels[channel].count > 0;
+}
+
+/**
+ * @return true once the channel's whole window has been filled since begin()
+ */
+bool AdcSampler::isFull(int8_t channel) const {
+  return channel >= 0 && channel < numChannels && channels[channel].count == ADC_SAMPLER_WINDOW;
+}
@@ -0,0 +1,61 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+
+#define ADC_SAMPLER_MAX_CHANNELS 4
+#define ADC_SAMPLER_WINDOW 16 // number of conversions averaged per channel (ring buffer length)
+
+/**
+ * Background round-robin sampler for the analog sensor pins.
+ *
+ * On the SAMD21 the ADC runs on its own: each conversion uses the ADC's hardware averaging
+ * (16 accumulated samples per result), and the result-ready interrupt stores the value into the
+ * channel's ring buffer, switches the input mux to the next channel and starts the next conversion.
+ * A running sum is kept alongside each ring buffer, so reading the decimated (windowed average)
+ * value of a channel is O(1) and never waits on the ADC.
+ *
+ * On other boards poll() must be called from loop(); it performs one analogRead() per call.
+ * The host build (host/README.md) simulates the SAMD21's interrupt.
+ *
+ * Note: while the sampler is running it owns the ADC, so analogRead() must not be used elsewhere.
+ * Call stop() before any code that needs analogRead() (e.g. Gravity_pH calibration) and begin() after.
+ */
+class AdcSampler {
+  public:
+    AdcSampler();
+
+    int8_t addChannel(uint8_t pin);
+    void begin();
+    void stop();
+    void poll();
+
+    uint16_t readRaw(int8_t channel) const;
+    float readMillivolts(int8_t channel, float vref_mV = 3300.0) const;
+    bool isReady(int8_t channel) const;
+    bool isFull(int8_t channel) const;
+    unsigned long conversionCount() const { return conversions; }
+    uint8_t currentPin() const { return channels[currentChannel].pin; } // the pin being converted
+
+    void onConversionComplete(uint16_t result);
+
+  private:
+    struct Channel {
+      uint8_t pin;
+      uint8_t adcInput;
+      uint16_t samples[ADC_SAMPLER_WINDOW];
+      uint8_t next;
+      uint8_t count;
+      uint32_t sum;
+    };
+
+    void startConversion(uint8_t channel);
+
+    Channel channels[ADC_SAMPLER_MAX_CHANNELS];
+    uint8_t numChannels;
+    volatile uint8_t currentChannel;
+    volatile unsigned long conversions;
+    volatile bool running;
+};
+
+#endif // ADC_SAMPLER_H
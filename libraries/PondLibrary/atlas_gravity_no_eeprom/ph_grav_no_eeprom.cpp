@@ -16,31 +16,37 @@ bool Gravity_pH::begin(){
 }
 
 float Gravity_pH::read_voltage() {
-	float voltage_mV = 0;
+	// Configure the ADC once and sum the raw counts; the conversion to mV is done once at the end
+	// rather than as a float division on every one of the volt_avg_len samples
+	float mV_per_count;
+	float offset_mV = 0;
+	#if defined(ESP32)
+	//ESP32 has significant nonlinearity in its ADC, we will attempt to compensate 
+	//but you're on your own to some extent
+	//this compensation is only for the ESP32
+	//https://github.com/espressif/arduino-esp32/issues/92
+	  mV_per_count = 3300.0 / 4095.0;
+	  offset_mV = 130;
+	#elif defined(ARDUINO_SAMD_NANO_33_IOT)
+	  analogReadResolution(12);
+	  mV_per_count = 3300.0 / 4095.0;
+	#elif defined(ARDUINO_AVR_UNO)
+	  // UNO has only 10-bit ADC
+	  mV_per_count = 5000.0 / 1024.0;
+	#elif defined(ARDUINO_SAMD_MKRWIFI1010)
+	  analogReadResolution(12);
+	  mV_per_count = 3300.0 / 4095.0;
+	#else
+	  // Default case if board not recognized
+	  analogReadResolution(10);
+	  mV_per_count = 5000.0 / 1024.0;
+	#endif
+
+	uint32_t counts = 0;
 	for (int i = 0; i < volt_avg_len; ++i) {
-    #if defined(ESP32)
-    //ESP32 has significant nonlinearity in its ADC, we will attempt to compensate 
-    //but you're on your own to some extent
-    //this compensation is only for the ESP32
-    //https://github.com/espressif/arduino-esp32/issues/92
-      voltage_mV += analogRead(this->pin) / 4095.0 * 3300.0 + 130;
-    #elif defined(ARDUINO_SAMD_NANO_33_IOT)
-      analogReadResolution(12);
-      voltage_mV += analogRead(this->pin) / 4095.0 * 3300.0;
-    #elif defined(ARDUINO_AVR_UNO)
-      // UNO has only 10-bit ADC
-      voltage_mV += analogRead(this->pin) / 1024.0 * 5000.0;
-    #elif defined(ARDUINO_SAMD_MKRWIFI1010)
-      analogReadResolution(12);
-      voltage_mV += analogRead(this->pin) / 4095.0 * 3300.0;
-    #else
-      // Default case if board not recognized
-      analogReadResolution(10);
-      voltage_mV += analogRead(this->pin) / 1024.0 * 5000.0;
-    #endif
+	  counts += analogRead(this->pin);
 	}
-	voltage_mV /= volt_avg_len;
-	return voltage_mV;
+	return (float)counts / volt_avg_len * mV_per_count + offset_mV;
 }
 
 float Gravity_pH::read_ph(float voltage_mV) {
@@ -65,6 +71,7 @@ float Gravity_pH::calc_ph_from_formula() {
 
 void Gravity_pH::cal_mid(float voltage_mV) {
   this->pH.mid_cal = voltage_mV;
+  cal_count++;
 }
 
 void Gravity_pH::cal_mid() {
@@ -73,6 +80,7 @@ void Gravity_pH::cal_mid() {
 
 void Gravity_pH::cal_low(float voltage_mV) {
   this->pH.low_cal = voltage_mV;
+  cal_count++;
 }
 
 void Gravity_pH::cal_low() {
@@ -81,6 +89,7 @@ void Gravity_pH::cal_low() {
 
 void Gravity_pH::cal_high(float voltage_mV) {
   this->pH.high_cal = voltage_mV;
+  cal_count++;
 }
 
 void Gravity_pH::cal_high() {
@@ -93,4 +102,19 @@ void Gravity_pH::cal_clear() {
   this->pH.low_cal = 2033; // changing from 2030 to 2033 to match pH solution which is 4.01 instead of 4.00
   this->pH.high_cal = 1119; // changing from 975 to match pH solution which is 9.18 instead of 10
   // used formula pH = (-5.6548 * voltage) + 15.509 then solved for voltage
+  cal_count++;
+}
+
+uint8_t Gravity_pH::get_cal_points(float* voltages_mV, float* phs) {
+  voltages_mV[0] = this->pH.low_cal;
+  phs[0] = this->pH.low_solution_ph;
+  voltages_mV[1] = this->pH.mid_cal;
+  phs[1] = this->pH.mid_solution_ph;
+  voltages_mV[2] = this->pH.high_cal;
+  phs[2] = this->pH.high_solution_ph;
+  return 3;
+}
+
+uint16_t Gravity_pH::get_cal_count() {
+  return cal_count;
 }
@@ -58,8 +58,14 @@ class Gravity_pH : public Gravity_Base{
 		void cal_high();
 	
 		void cal_clear();
+
+		// calibration points (mV, pH) for building a lookup table, and a count of calibration
+		// changes so the table can be rebuilt when it changes
+		uint8_t get_cal_points(float* voltages_mV, float* phs);
+		uint16_t get_cal_count();
 		
 	private:
+		uint16_t cal_count = 0;
 		
 		struct PH {
           const uint8_t type = GRAV_PH;
@@ -0,0 +1,63 @@
+#include "change_reporter.h"
+
+ChangeReporter::ChangeReporter(unsigned long heartbeat)
+  : heartbeat(heartbeat) {
+  reset();
+}
+
+/**
+ * Remove the values that shouldn't be reported from a realtime snapshot.
+ * @param readings The snapshot; the present bits of the suppressed sensors are cleared
+ * @return true if any sensor is left to report
+ */
+bool ChangeReporter::filter(SensorReadings& readings) {
+  unsigned long now = millis();
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    SensorId id = (SensorId)i;
+    if (!readings.has(id)) {
+      continue;
+    }
+    valuesReceived++;
+    float value = readings.values[i];
+
+    if (isChange(id, value)) {
+      lastReported.set(id, value);
+      lastReportTime[i] = now;
+      valuesReported++;
+    } else if (now - lastReportTime[i] >= heartbeat) {
+      lastReported.set(id, value);
+      lastReportTime[i] = now;
+      valuesReported++;
+      heartbeats++;
+    } else {
+      readings.present &= ~((SensorMask)1 << i);
+      valuesSuppressed++;
+    }
+  }
+  return readings.present != 0;
+}
+
+/**
+ * Forget the last reported values so the next value of every sensor is reported (e.g. after a reconnect).
+ */
+void ChangeReporter::reset() {
+  lastReported = SensorReadings();
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    lastReportTime[i] = 0;
+  }
+}
+
+bool ChangeReporter::isChange(SensorId id, float value) const {
+  if (!lastReported.has(id)) {
+    return true;
+  }
+  float last = lastReported.values[id];
+  // a sensor going to or coming back from NaN (e.g. a disconnected probe) is always a change
+  if (isnan(value) || isnan(last)) {
+    return isnan(value) != isnan(last);
+  }
+  const SensorDescriptor& sensor = sensorRegistry[id];
+  float band = max(sensor.deadband, sensor.relativeDeadband * fabs(last));
+  // a deadband of 0 reports any change
+  return band > 0 ? fabs(value - last) >= band : value != last;
+}
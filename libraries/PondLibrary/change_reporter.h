@@ -0,0 +1,36 @@
+#ifndef CHANGE_REPORTER_H
+#define CHANGE_REPORTER_H
+
+#include <Arduino.h>
+#include "sensor_readings.h"
+
+#define CHANGE_REPORTER_HEARTBEAT 300000 // report every sensor at least every 5 minutes, even if it hasn't changed
+
+/**
+ * Decides which sensor values are worth sending as realtime updates. A value is reported when it
+ * differs from the last reported value of the sensor by at least the sensor's deadband (the larger
+ * of its absolute and relative deadbands in sensor_registry.h), or when the sensor hasn't been
+ * reported for `heartbeat` ms so the receiver can tell a steady pond from a dead link.
+ * The first value of each sensor (after construction or reset()) is always reported.
+ */
+class ChangeReporter {
+  public:
+    ChangeReporter(unsigned long heartbeat = CHANGE_REPORTER_HEARTBEAT);
+
+    bool filter(SensorReadings& readings);
+    void reset();
+
+    unsigned long valuesReceived = 0;   // present sensor values passed to filter()
+    unsigned long valuesReported = 0;   // values that were left in the readings
+    unsigned long valuesSuppressed = 0; // values removed because they were within their deadband
+    unsigned long heartbeats = 0;       // values reported only because the heartbeat was due
+
+  private:
+    bool isChange(SensorId id, float value) const;
+
+    unsigned long heartbeat;
+    SensorReadings lastReported;
+    unsigned long lastReportTime[SENSOR_COUNT];
+};
+
+#endif // CHANGE_REPORTER_H
@@ -0,0 +1,201 @@
+#include "cooperative_scheduler.h"
+#include "memory_monitor.h"
+
+CooperativeScheduler scheduler;
+
+CooperativeScheduler::CooperativeScheduler()
+  : currentTick(0), lastTickTime(0), numActive(0), stackWindow(0), maxTaskStack(0) {
+  for (int i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    tasks[i].function = nullptr;
+    tasks[i].generation = 0;
+    tasks[i].slot = -1;
+    tasks[i].next = -1;
+  }
+  for (int i = 0; i < SCHEDULER_WHEEL_SLOTS; i++) {
+    wheel[i] = -1;
+  }
+}
+
+/**
+ * Schedule a task to run after a delay.
+ * @param function The task function (see TaskFunction for the return value contract)
+ * @param context Pointer handed back to the task on every call (task state, object, etc.)
+ * @param delayMs The delay before the first run (rounded up to the next SCHEDULER_TICK_MS)
+ * @return A handle for cancel()/isScheduled(), or NO_TASK if all task slots are in use
+ */
+TaskHandle CooperativeScheduler::schedule(TaskFunction function, void* context, unsigned long delayMs) {
+  for (int8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    if (tasks[i].function == nullptr) {
+      tasks[i].function = function;
+      tasks[i].context = context;
+      tasks[i].stackUsed = 0;
+      numActive++;
+      insert(i, delayMs);
+      return ((TaskHandle)tasks[i].generation << 16) | (i + 1);
+    }
+  }
+  return NO_TASK;
+}
+
+/**
+ * Cancel a task. Safe to call with NO_TASK or the handle of a task that already finished.
+ */
+void CooperativeScheduler::cancel(TaskHandle handle) {
+  int8_t index = indexFor(handle);
+  if (index >= 0) {
+    unlink(index);
+    release(index);
+  }
+}
+
+/**
+ * @return true while the task is waiting to run or running
+ */
+bool CooperativeScheduler::isScheduled(TaskHandle handle) const {
+  return indexFor(handle) >= 0;
+}
+
+/**
+ * Run every task that has come due since the last call. Call from every pass of loop().
+ */
+void CooperativeScheduler::run() {
+  unsigned long now = millis();
+
+  while (now - lastTickTime >= SCHEDULER_TICK_MS) {
+    lastTickTime += SCHEDULER_TICK_MS;
+    currentTick++;
+    int8_t slot = currentTick % SCHEDULER_WHEEL_SLOTS;
+
+    // Take the due tasks out of the slot first; tasks that reschedule themselves may land back in it
+    int8_t due[SCHEDULER_MAX_TASKS];
+    uint16_t dueGeneration[SCHEDULER_MAX_TASKS];
+    uint8_t numDue = 0;
+    int8_t* link = &wheel[slot];
+    while (*link >= 0) {
+      Task& task = tasks[*link];
+      if (task.rounds > 0) {
+        task.rounds--;
+        link = &task.next;
+      } else {
+        due[numDue] = *link;
+        dueGeneration[numDue] = task.generation;
+        numDue++;
+        *link = task.next;
+        task.next = -1;
+        task.slot = -1;
+      }
+    }
+
+    for (uint8_t i = 0; i < numDue; i++) {
+      int8_t index = due[i];
+      // skip tasks cancelled by a task that ran before them in this tick
+      if (tasks[index].function == nullptr || tasks[index].generation != dueGeneration[i]) {
+        continue;
+      }
+      if (stackWindow > 0) {
+        paintStackWindow(stackWindow);
+      }
+      long nextDelay = tasks[index].function(tasks[index].context);
+      size_t stackUsed = stackWindow > 0 ? measureStackWindow(stackWindow) : 0;
+      // the task may have cancelled itself
+      if (tasks[index].function == nullptr || tasks[index].generation != dueGeneration[i]) {
+        continue;
+      }
+      recordStackUse(index, stackUsed);
+      if (nextDelay == TASK_DONE) {
+        release(index);
+      } else {
+        insert(index, nextDelay < 0 ? 0 : nextDelay);
+      }
+    }
+  }
+}
+
+/**
+ * Wait for `ms` milliseconds while keeping scheduled tasks (LED animations, LCD effects, etc.) running.
+ * Use instead of delay() where a wait cannot be avoided. Must not be called from inside a task.
+ */
+void CooperativeScheduler::delay(unsigned long ms) {
+  unsigned long start = millis();
+  while (millis() - start < ms) {
+    run();
+    yield();
+  }
+}
+
+/**
+ * Measure how much stack each task run uses, by painting `windowBytes` below the stack pointer
+ * before the task runs and checking how much of the pattern it overwrote (see memory_monitor.h).
+ * Costs a memset and a scan of the window per task run, so leave it off (0) outside profiling.
+ * A task that uses the whole window may have used more.
+ */
+void CooperativeScheduler::trackStack(uint16_t windowBytes) {
+  stackWindow = windowBytes;
+}
+
+/**
+ * @return The most stack (bytes) one run of the task has used, 0 if unknown or the task has finished
+ */
+uint16_t CooperativeScheduler::stackHighWater(TaskHandle handle) const {
+  int8_t index = indexFor(handle);
+  return index >= 0 ? tasks[index].stackUsed : 0;
+}
+
+void CooperativeScheduler::recordStackUse(int8_t index, size_t used) {
+  if (used > tasks[index].stackUsed) {
+    tasks[index].stackUsed = used;
+  }
+  if (used > maxTaskStack) {
+    maxTaskStack = used;
+  }
+}
+
+void CooperativeScheduler::insert(int8_t index, unsigned long delayMs) {
+  // Count from the last processed tick so time that has passed since the last run() is accounted for
+  unsigned long pending = millis() - lastTickTime;
+  unsigned long ticks = (pending + delayMs + SCHEDULER_TICK_MS - 1) / SCHEDULER_TICK_MS;
+  if (ticks == 0) {
+    ticks = 1;
+  }
+
+  Task& task = tasks[index];
+  task.rounds = (ticks - 1) / SCHEDULER_WHEEL_SLOTS;
+  task.slot = (currentTick + ticks) % SCHEDULER_WHEEL_SLOTS;
+  task.next = wheel[task.slot];
+  wheel[task.slot] = index;
+}
+
+void CooperativeScheduler::unlink(int8_t index) {
+  Task& task = tasks[index];
+  if (task.slot < 0) {
+    return;
+  }
+  int8_t* link = &wheel[task.slot];
+  while (*link >= 0) {
+    if (*link == index) {
+      *link = task.next;
+      break;
+    }
+    link = &tasks[*link].next;
+  }
+  task.slot = -1;
+  task.next = -1;
+}
+
+void CooperativeScheduler::release(int8_t index) {
+  tasks[index].function = nullptr;
+  tasks[index].context = nullptr;
+  tasks[index].generation++;
+  numActive--;
+}
+
+int8_t CooperativeScheduler::indexFor(TaskHandle handle) const {
+  int index = (handle & 0xFF) - 1;
+  if (index < 0 || index >= SCHEDULER_MAX_TASKS) {
+    return -1;
+  }
+  if (tasks[index].function == nullptr || tasks[index].generation != (handle >> 16)) {
+    return -1;
+  }
+  return index;
+}
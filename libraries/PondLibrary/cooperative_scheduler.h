@@ -0,0 +1,82 @@
+#ifndef COOPERATIVE_SCHEDULER_H
+#define COOPERATIVE_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_TASKS 12
+#define SCHEDULER_TICK_MS 10    // resolution of the timer wheel
+#define SCHEDULER_WHEEL_SLOTS 32 // one revolution of the wheel covers 320ms, longer delays take extra rounds
+
+// Returned by a task function when it has finished and should not run again
+#define TASK_DONE (-1)
+
+/**
+ * A task is a plain function that does a small amount of work and returns straight away.
+ * @param context The pointer passed to schedule()
+ * @return The number of milliseconds until the task should run again, or TASK_DONE
+ *
+ * - one-shot timers return TASK_DONE
+ * - periodic tasks return their period
+ * - resumable animations keep their progress in `context`, advance one step per call
+ *   and return the delay to the next step until the animation ends
+ */
+typedef long (*TaskFunction)(void* context);
+
+// Identifies a scheduled task: the slot's generation in the upper 16 bits, slot index + 1 in the
+// lower 8. Handles are never reused while the task is alive, and a stale handle to a finished task
+// is safe to cancel until its slot has been reused 65536 times.
+typedef uint32_t TaskHandle;
+#define NO_TASK 0
+
+/**
+ * Cooperative scheduler built on a hashed timer wheel.
+ * Scheduling, cancelling and advancing a tick are O(1) apart from walking the (short) list of
+ * tasks in a slot, so run() can be called on every pass of loop() without costing the ingest path.
+ */
+class CooperativeScheduler {
+  public:
+    CooperativeScheduler();
+
+    TaskHandle schedule(TaskFunction function, void* context = nullptr, unsigned long delayMs = 0);
+    void cancel(TaskHandle handle);
+    bool isScheduled(TaskHandle handle) const;
+
+    void run();
+    void delay(unsigned long ms);
+
+    uint8_t activeTasks() const { return numActive; }
+
+    void trackStack(uint16_t windowBytes);
+    uint16_t stackHighWater(TaskHandle handle) const;
+    uint16_t deepestTaskStack() const { return maxTaskStack; }
+
+  private:
+    struct Task {
+      TaskFunction function;
+      void* context;
+      uint16_t rounds;    // full wheel revolutions left before the task is due
+      uint16_t generation; // bumped every time the task slot is reused
+      int8_t next;        // next task in the same wheel slot (-1 ends the list)
+      int8_t slot;        // wheel slot the task is queued in (-1 when not queued)
+      uint16_t stackUsed; // most stack a run of the task has used (when stack tracking is on)
+    };
+
+    void insert(int8_t index, unsigned long delayMs);
+    void unlink(int8_t index);
+    void release(int8_t index);
+    int8_t indexFor(TaskHandle handle) const;
+    void recordStackUse(int8_t index, size_t used);
+
+    Task tasks[SCHEDULER_MAX_TASKS];
+    int8_t wheel[SCHEDULER_WHEEL_SLOTS];
+    uint32_t currentTick;
+    unsigned long lastTickTime;
+    uint8_t numActive;
+    uint16_t stackWindow;  // bytes painted below the stack before each task runs, 0 when not tracking
+    uint16_t maxTaskStack;
+};
+
+// Shared scheduler instance; call scheduler.run() from every loop()
+extern CooperativeScheduler scheduler;
+
+#endif // COOPERATIVE_SCHEDULER_H
@@ -0,0 +1,110 @@
+#include "fixed_point.h"
+
+#define Q24_ONE 16777216.0f
+
+#define SCALE_BITS 30
+#define SCALE_MIN_SHIFT 16 // scales up to 2^14 units per count
+#define SCALE_MAX_SHIFT 62
+
+FixedPolynomial::FixedPolynomial() : scale(0), scaleShift(SCALE_BITS), offset(0), degree(0) {
+  coefficients[0] = 0;
+}
+
+/**
+ * Set the conversion from ADC counts to the polynomial's input, e.g. volts per count and a sensor offset.
+ */
+void FixedPolynomial::setInput(float unitsPerCount, float offset) {
+  int exponent;
+  frexpf(unitsPerCount, &exponent); // |unitsPerCount| < 2^exponent
+  scaleShift = constrain(SCALE_BITS - exponent, SCALE_MIN_SHIFT, SCALE_MAX_SHIFT);
+  scale = (int32_t)lroundf(ldexpf(unitsPerCount, scaleShift));
+  this->offset = toQ16(offset);
+}
+
+/**
+ * @param coefficients degree + 1 coefficients, highest power first
+ * @return false if the degree is above FIXED_POLYNOMIAL_MAX_DEGREE (the polynomial is unchanged)
+ */
+bool FixedPolynomial::setCoefficients(const float* coefficients, uint8_t degree) {
+  if (degree > FIXED_POLYNOMIAL_MAX_DEGREE) {
+    return false;
+  }
+  for (uint8_t i = 0; i <= degree; i++) {
+    this->coefficients[i] = toQ16(coefficients[i]);
+  }
+  this->degree = degree;
+  return true;
+}
+
+q16_t FixedPolynomial::input(uint16_t counts) const {
+  uint8_t shift = scaleShift - 16;
+  int64_t rounding = shift > 0 ? 1LL << (shift - 1) : 0;
+  return (q16_t)(((int64_t)counts * scale + rounding) >> shift) + offset;
+}
+
+q16_t FixedPolynomial::evaluate(q16_t x) const {
+  q16_t y = coefficients[0];
+  for (uint8_t i = 1; i <= degree; i++) {
+    y = q16Mul(y, x) + coefficients[i];
+  }
+  return y;
+}
+
+FixedInterpolation::FixedInterpolation() : numPoints(0) {
+}
+
+/**
+ * @param inputs Calibration point inputs in any order, in the same units as unitsPerCount (e.g. mV)
+ * @param outputs Calibrated value at each input
+ * @return false if there are fewer than 2 or more than FIXED_INTERPOLATION_MAX_POINTS points,
+ *         two points share an input or unitsPerCount isn't positive (the table is unchanged)
+ */
+bool FixedInterpolation::setPoints(const float* inputs, const float* outputs, uint8_t count, float unitsPerCount) {
+  if (count < 2 || count > FIXED_INTERPOLATION_MAX_POINTS || unitsPerCount <= 0) {
+    return false;
+  }
+
+  // Sort the points by input (insertion sort, there are only a handful)
+  float sortedInputs[FIXED_INTERPOLATION_MAX_POINTS];
+  float sortedOutputs[FIXED_INTERPOLATION_MAX_POINTS];
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t j = i;
+    for (; j > 0 && sortedInputs[j - 1] > inputs[i]; j--) {
+      sortedInputs[j] = sortedInputs[j - 1];
+      sortedOutputs[j] = sortedOutputs[j - 1];
+    }
+    sortedInputs[j] = inputs[i];
+    sortedOutputs[j] = outputs[i];
+  }
+  for (uint8_t i = 1; i < count; i++) {
+    if (sortedInputs[i] == sortedInputs[i - 1]) {
+      return false;
+    }
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    points[i] = toQ16(sortedInputs[i] / unitsPerCount);
+    values[i] = toQ16(sortedOutputs[i]);
+    if (i + 1 < count) {
+      float slope = (sortedOutputs[i + 1] - sortedOutputs[i]) / (sortedInputs[i + 1] - sortedInputs[i]) * unitsPerCount;
+      slopes[i] = (int32_t)(slope * Q24_ONE + (slope >= 0 ? 0.5f : -0.5f));
+    }
+  }
+  numPoints = count;
+  return true;
+}
+
+/**
+ * @return The calibrated value, or 0 if no points have been set
+ */
+q16_t FixedInterpolation::convert(uint16_t counts) const {
+  if (numPoints < 2) {
+    return 0;
+  }
+  q16_t x = (q16_t)counts << 16;
+  uint8_t segment = 0;
+  while (segment + 2 < numPoints && x >= points[segment + 1]) {
+    segment++;
+  }
+  return values[segment] + (q16_t)(((int64_t)(x - points[segment]) * slopes[segment] + (1 << 23)) >> 24);
+}
@@ -0,0 +1,85 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <Arduino.h>
+
+/*
+  Integer sensor conversions for boards without an FPU (the SAMD21 does every float operation in
+  software, and pow() is hundreds of times the cost of an integer multiply).
+
+  Values are Q16.16: a signed 32 bit integer holding value * 65536, so the range is about +/-32767
+  with a resolution of 0.000015. Calibration is still set up in float, but only when it changes;
+  the per-sample path from ADC counts to calibrated units is integer multiplies, adds and shifts.
+*/
+typedef int32_t q16_t;
+
+#define Q16_ONE 65536L
+#define FIXED_POLYNOMIAL_MAX_DEGREE 3
+#define FIXED_INTERPOLATION_MAX_POINTS 8
+
+// Constant conversions, done at compile time
+constexpr q16_t toQ16(float value) {
+  return (q16_t)(value * Q16_ONE + (value >= 0 ? 0.5f : -0.5f));
+}
+
+inline float q16ToFloat(q16_t value) {
+  return value * (1.0f / Q16_ONE);
+}
+
+// Nearest whole number, halves away from zero like round()
+inline int32_t q16Round(q16_t value) {
+  return value >= 0 ? (value + Q16_ONE / 2) >> 16 : -((-value + Q16_ONE / 2) >> 16);
+}
+
+inline q16_t q16Mul(q16_t a, q16_t b) {
+  return (q16_t)(((int64_t)a * b + Q16_ONE / 2) >> 16);
+}
+
+/**
+ * Polynomial of an ADC reading: x = counts * unitsPerCount + offset, then
+ * y = c[0] x^n + c[1] x^(n-1) + ... + c[n] by Horner's rule (n multiplies, no powers).
+ * The input scale and coefficients are converted from float by setInput()/setCoefficients(), so call
+ * them again whenever the calibration changes (e.g. a temperature compensated scale).
+ * x and every partial sum must stay within the Q16.16 range.
+ */
+class FixedPolynomial {
+  public:
+    FixedPolynomial();
+
+    void setInput(float unitsPerCount, float offset = 0);
+    bool setCoefficients(const float* coefficients, uint8_t degree);
+
+    q16_t input(uint16_t counts) const;
+    q16_t evaluate(q16_t x) const;
+    q16_t convert(uint16_t counts) const { return evaluate(input(counts)); }
+
+  private:
+    int32_t scale;      // units per count = scale * 2^-scaleShift, keeping 30 significant bits
+    uint8_t scaleShift; // (Q8.24 lost the low digits of small steps, e.g. TDS volts per count in cold water)
+    q16_t offset;
+    q16_t coefficients[FIXED_POLYNOMIAL_MAX_DEGREE + 1];
+    uint8_t degree;
+};
+
+/**
+ * Piecewise linear map from an ADC reading to calibrated units through up to
+ * FIXED_INTERPOLATION_MAX_POINTS calibration points, extrapolating the first and last segments.
+ * setPoints() converts the points to counts and precomputes each segment's slope, so a conversion
+ * is a short search and one multiply. Rebuild it whenever a calibration point changes.
+ */
+class FixedInterpolation {
+  public:
+    FixedInterpolation();
+
+    bool setPoints(const float* inputs, const float* outputs, uint8_t count, float unitsPerCount);
+    q16_t convert(uint16_t counts) const;
+    uint8_t size() const { return numPoints; }
+
+  private:
+    q16_t points[FIXED_INTERPOLATION_MAX_POINTS];  // point inputs in counts, ascending
+    q16_t values[FIXED_INTERPOLATION_MAX_POINTS];  // outputs at the points
+    int32_t slopes[FIXED_INTERPOLATION_MAX_POINTS]; // output per count from point i to i + 1, Q8.24
+    uint8_t numPoints;
+};
+
+#endif // FIXED_POINT_H
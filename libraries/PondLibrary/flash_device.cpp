@@ -0,0 +1,195 @@
+#include "flash_device.h"
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+SamdFlash::SamdFlash(const uint8_t* storage, uint32_t size)
+  : storage(storage), regionSize(size) {
+}
+
+static void waitForNvmReady() {
+  while (NVMCTRL->INTFLAG.bit.READY == 0) {
+  }
+}
+
+uint32_t SamdFlash::eraseSize() const {
+  return FLASH_PAGE_SIZE * NVMCTRL_ROW_PAGES; // one row, 256 bytes
+}
+
+bool SamdFlash::erase(uint32_t address) {
+  if (address % eraseSize() != 0 || address >= regionSize) {
+    return false;
+  }
+  // ADDR takes a 16-bit word address
+  NVMCTRL->ADDR.reg = (uint32_t)(storage + address) / 2;
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+  waitForNvmReady();
+  return true;
+}
+
+/**
+ * Program `length` bytes. Words are loaded into the page buffer and each page is written as
+ * soon as it is complete; the rest of a partially loaded page stays 0xFF, which leaves the bytes
+ * already programmed in that page unchanged.
+ */
+bool SamdFlash::write(uint32_t address, const uint8_t* data, size_t length) {
+  if (address % 4 != 0 || length % 4 != 0 || address + length > regionSize) {
+    return false;
+  }
+  volatile uint32_t* destination = (volatile uint32_t*)(storage + address);
+  NVMCTRL->STATUS.reg |= NVMCTRL_STATUS_MASK; // clear the error flags from earlier commands
+  NVMCTRL->CTRLB.bit.MANW = 1; // pages are written by the WP command below, not on the last word
+
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+  waitForNvmReady();
+  for (size_t i = 0; i < length; i += 4) {
+    uint32_t word;
+    memcpy(&word, data + i, 4);
+    *destination++ = word;
+    // end of a page, or of the data
+    if ((uint32_t)destination % FLASH_PAGE_SIZE == 0 || i + 4 == length) {
+      NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+      waitForNvmReady();
+      if (i + 4 < length) {
+        NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+        waitForNvmReady();
+      }
+    }
+  }
+  return NVMCTRL->STATUS.bit.PROGE == 0 && NVMCTRL->STATUS.bit.LOCKE == 0;
+}
+
+bool SamdFlash::read(uint32_t address, uint8_t* data, size_t length) {
+  if (address + length > regionSize) {
+    return false;
+  }
+  memcpy(data, (const void*)(storage + address), length);
+  return true;
+}
+
+#elif defined(ARDUINO_ARCH_HOST)
+
+#include "host_sim.h"
+
+#define HOST_FLASH_ROW_ERASE_MICROS 6000 // SAMD21 datasheet, row erase
+#define HOST_FLASH_PAGE_WRITE_MICROS 2500 // page write
+#define HOST_FLASH_PAGE_SIZE 64
+
+SamdFlash::SamdFlash(const uint8_t* /* storage */, uint32_t size)
+  : storage((uint8_t*)malloc(size)), regionSize(size) {
+  memset(this->storage, 0x00, size);
+}
+
+bool SamdFlash::erase(uint32_t address) {
+  if (address % eraseSize() != 0 || address >= regionSize) {
+    return false;
+  }
+  memset(storage + address, 0xFF, eraseSize());
+  hostAdvanceMicros(HOST_FLASH_ROW_ERASE_MICROS);
+  return true;
+}
+
+bool SamdFlash::write(uint32_t address, const uint8_t* data, size_t length) {
+  if (address % 4 != 0 || length % 4 != 0 || address + length > regionSize) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    storage[address + i] &= data[i];
+  }
+  uint32_t pages = (address + length - 1) / HOST_FLASH_PAGE_SIZE - address / HOST_FLASH_PAGE_SIZE + 1;
+  hostAdvanceMicros(pages * HOST_FLASH_PAGE_WRITE_MICROS);
+  return true;
+}
+
+bool SamdFlash::read(uint32_t address, uint8_t* data, size_t length) {
+  if (address + length > regionSize) {
+    return false;
+  }
+  memcpy(data, storage + address, length);
+  return true;
+}
+
+FileFlash::FileFlash(const char* path, uint32_t size, uint32_t eraseSize)
+  : file(fopen(path, "r+b")), regionSize(size), unitSize(eraseSize) {
+  if (file == nullptr) {
+    file = fopen(path, "w+b");
+  }
+  if (file == nullptr) {
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  for (long i = length; i < (long)size; i++) {
+    fputc(0xFF, file);
+  }
+  fflush(file);
+}
+
+FileFlash::~FileFlash() {
+  if (file != nullptr) {
+    fclose(file);
+  }
+}
+
+bool FileFlash::erase(uint32_t address) {
+  if (address % unitSize != 0 || address >= regionSize) {
+    return false;
+  }
+  return program(address, nullptr, unitSize, true);
+}
+
+bool FileFlash::write(uint32_t address, const uint8_t* data, size_t length) {
+  if (address % 4 != 0 || length % 4 != 0 || address + length > regionSize) {
+    return false;
+  }
+  return program(address, data, length, false);
+}
+
+bool FileFlash::read(uint32_t address, uint8_t* data, size_t length) {
+  if (file == nullptr || powerCut || address + length > regionSize) {
+    return false;
+  }
+  fseek(file, address, SEEK_SET);
+  return fread(data, 1, length, file) == length;
+}
+
+void FileFlash::cutPowerAfter(uint32_t bytes) {
+  cutScheduled = true;
+  bytesBeforeCut = bytes;
+}
+
+// Erase (set to 0xFF) or write (clear bits, as NOR flash does) `length` bytes, stopping at the power cut
+bool FileFlash::program(uint32_t address, const uint8_t* data, size_t length, bool erasing) {
+  if (file == nullptr || powerCut) {
+    return false;
+  }
+  size_t count = length;
+  if (cutScheduled && bytesBeforeCut < count) {
+    count = bytesBeforeCut;
+    powerCut = true;
+  }
+  if (cutScheduled) {
+    bytesBeforeCut -= count;
+  }
+  bytesProgrammed += count;
+
+  uint8_t bytes[256];
+  for (size_t done = 0; done < count; ) {
+    size_t chunk = min(count - done, sizeof(bytes));
+    fseek(file, address + done, SEEK_SET);
+    if (fread(bytes, 1, chunk, file) != chunk) {
+      return false;
+    }
+    for (size_t i = 0; i < chunk; i++) {
+      bytes[i] = erasing ? 0xFF : bytes[i] & data[done + i];
+    }
+    fseek(file, address + done, SEEK_SET);
+    if (fwrite(bytes, 1, chunk, file) != chunk) {
+      return false;
+    }
+    done += chunk;
+  }
+  fflush(file);
+  return !powerCut;
+}
+
+#endif // ARDUINO_ARCH_SAMD
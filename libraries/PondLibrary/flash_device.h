@@ -0,0 +1,109 @@
+#ifndef FLASH_DEVICE_H
+#define FLASH_DEVICE_H
+
+#include <Arduino.h>
+
+/**
+ * Raw access to a region of NOR flash (erased bytes read 0xFF, writes can only clear bits).
+ * Addresses are offsets into the region. Writes must be 4 byte aligned and a multiple of 4 bytes long.
+ * FlashRingLog only talks to this interface, so it can run on a RAM or file backed stand-in off the board.
+ */
+class FlashDevice {
+  public:
+    virtual uint32_t size() const = 0;
+    virtual uint32_t eraseSize() const = 0; // smallest erasable unit
+    virtual bool erase(uint32_t address) = 0; // erase the unit starting at address
+    virtual bool write(uint32_t address, const uint8_t* data, size_t length) = 0;
+    virtual bool read(uint32_t address, uint8_t* data, size_t length) = 0;
+};
+
+#if defined(ARDUINO_ARCH_SAMD)
+
+/**
+ * A region of the SAMD21's internal flash, written through the NVM controller.
+ * The storage is a const array in the sketch, aligned to a row so it can be erased on its own:
+ *   __attribute__((__aligned__(256))) const uint8_t logStorage[32768] = {};
+ * The array is in the sketch's image, so an upload programs it with zeros rather than leaving it
+ * erased (0xFF); FlashRingLog::begin() finds no sector magic there and formats the region.
+ * The CPU stalls while a row is erased or a page written (a few ms per row).
+ */
+class SamdFlash : public FlashDevice {
+  public:
+    SamdFlash(const uint8_t* storage, uint32_t size);
+
+    uint32_t size() const override { return regionSize; }
+    uint32_t eraseSize() const override;
+    bool erase(uint32_t address) override;
+    bool write(uint32_t address, const uint8_t* data, size_t length) override;
+    bool read(uint32_t address, uint8_t* data, size_t length) override;
+
+  private:
+    const uint8_t* storage;
+    uint32_t regionSize;
+};
+
+#elif defined(ARDUINO_ARCH_HOST)
+
+/**
+ * The host build's stand-in for the SAMD21 region: the sketch's const array can't be written on a PC,
+ * so the region lives in its own RAM, zeroed as after an upload. Writes AND into the bytes as on NOR
+ * flash, and erases and page writes take the SAMD21's time.
+ */
+class SamdFlash : public FlashDevice {
+  public:
+    SamdFlash(const uint8_t* storage, uint32_t size);
+
+    uint32_t size() const override { return regionSize; }
+    uint32_t eraseSize() const override { return 256; }
+    bool erase(uint32_t address) override;
+    bool write(uint32_t address, const uint8_t* data, size_t length) override;
+    bool read(uint32_t address, uint8_t* data, size_t length) override;
+
+  private:
+    uint8_t* storage;
+    uint32_t regionSize;
+};
+
+#include <stdio.h>
+
+/**
+ * A region of NOR flash kept in a file, so what was written outlives the FlashRingLog (and the process)
+ * that wrote it, as the board's flash outlives a reset. Open the file again with a new FileFlash to
+ * power the board back up; a new or short file is extended with erased bytes.
+ *
+ * Power cuts: after cutPowerAfter(n), n more bytes can be programmed or erased. The write or erase
+ * that runs past them stops part way (the bytes before the cut are changed, the rest aren't) and
+ * every later call fails, as when the board loses power in the middle of a write. bytesProgrammed
+ * counts the bytes of every write and erase, so a test can run a workload once to find its cut points.
+ */
+class FileFlash : public FlashDevice {
+  public:
+    FileFlash(const char* path, uint32_t size, uint32_t eraseSize = 256);
+    ~FileFlash();
+
+    bool isOpen() const { return file != nullptr; }
+    uint32_t size() const override { return regionSize; }
+    uint32_t eraseSize() const override { return unitSize; }
+    bool erase(uint32_t address) override;
+    bool write(uint32_t address, const uint8_t* data, size_t length) override;
+    bool read(uint32_t address, uint8_t* data, size_t length) override;
+
+    void cutPowerAfter(uint32_t bytes);
+    bool powerLost() const { return powerCut; }
+
+    unsigned long bytesProgrammed = 0; // written or erased, including a cut operation's bytes before the cut
+
+  private:
+    bool program(uint32_t address, const uint8_t* data, size_t length, bool erasing);
+
+    FILE* file;
+    uint32_t regionSize;
+    uint32_t unitSize;
+    bool cutScheduled = false;
+    uint32_t bytesBeforeCut = 0;
+    bool powerCut = false;
+};
+
+#endif // ARDUINO_ARCH_SAMD
+
+#endif // FLASH_DEVICE_H
@@ -0,0 +1,327 @@
+#include "flash_ring_log.h"
+#include "serial_frame.h" // crc16()
+
+#define SECTOR_MAGIC 0x474F4C50 // "PLOG"
+#define SECTOR_HEADER_SIZE 12
+#define RECORD_HEADER_SIZE 8
+#define RECORD_CRC_SIZE 2
+
+#define RECORD_DATA 0x01
+#define RECORD_COMMIT 0x02 // seq is the highest committed sequence number, no payload
+#define RECORD_ERASED 0xFF
+
+// Space a record takes up in flash, padded so every record starts on a 4 byte boundary
+static uint32_t recordSize(size_t length) {
+  return (RECORD_HEADER_SIZE + length + RECORD_CRC_SIZE + 3) & ~3UL;
+}
+
+FlashRingLog::FlashRingLog(FlashDevice& flash, uint32_t sectorSize)
+  : flash(flash), sectorSize(sectorSize), numSectors(0), oldestSector(0), headSector(0), headSectorSeq(0),
+    writeOffset(SECTOR_HEADER_SIZE), headClosed(false), lastSeq(0), committedSeq(0), lostSeq(0) {
+  cursor.sector = 0;
+  cursor.offset = SECTOR_HEADER_SIZE;
+}
+
+/**
+ * Find the newest sector, recover the sequence numbers and commit state, and position readNext()
+ * at the first record that hasn't been committed. A blank or unrecognised region is formatted.
+ * @return false if the flash region is too small for two sectors or can't be written
+ */
+bool FlashRingLog::begin() {
+  numSectors = flash.size() / sectorSize;
+  if (numSectors < 2 || sectorSize % flash.eraseSize() != 0) {
+    return false;
+  }
+
+  // The head is the sector with the highest sequence number
+  bool found = false;
+  for (uint16_t sector = 0; sector < numSectors; sector++) {
+    uint32_t sectorSeq, committed;
+    if (readSectorHeader(sector, sectorSeq, committed) && (!found || sectorSeq > headSectorSeq)) {
+      headSector = sector;
+      headSectorSeq = sectorSeq;
+      found = true;
+    }
+  }
+  if (!found) {
+    lastSeq = 0;
+    committedSeq = 0;
+    lostSeq = 0;
+    oldestSector = 0;
+    cursor.sector = 0;
+    cursor.offset = SECTOR_HEADER_SIZE;
+    return openSector(0, 1);
+  }
+
+  // Walk back around the ring while the sector sequence numbers keep counting down
+  oldestSector = headSector;
+  uint32_t oldestSeq = headSectorSeq;
+  for (uint16_t i = 1; i < numSectors; i++) {
+    uint16_t previous = (oldestSector + numSectors - 1) % numSectors;
+    uint32_t sectorSeq, committed;
+    if (!readSectorHeader(previous, sectorSeq, committed) || sectorSeq != oldestSeq - 1) {
+      break;
+    }
+    oldestSector = previous;
+    oldestSeq = sectorSeq;
+  }
+  readSectorHeader(oldestSector, oldestSeq, committedSeq);
+  lastSeq = committedSeq;
+  uint32_t firstSeq = 0;
+
+  // Replay the records from the oldest sector to the end of the head sector
+  Position position = {oldestSector, SECTOR_HEADER_SIZE};
+  while (true) {
+    RecordHeader header;
+    int result = readRecord(position, header, nullptr, 0);
+    if (result > 0) {
+      if (header.type == RECORD_DATA && header.seq > lastSeq) {
+        lastSeq = header.seq;
+        if (firstSeq == 0) {
+          firstSeq = header.seq;
+        }
+      } else if (header.type == RECORD_COMMIT && header.seq > committedSeq) {
+        committedSeq = header.seq;
+      }
+      position.offset += recordSize(header.length);
+      continue;
+    }
+    if (result < 0) {
+      corruptRecords++;
+    }
+    if (position.sector == headSector) {
+      writeOffset = position.offset;
+      headClosed = result < 0;
+      break;
+    }
+    position.sector = (position.sector + 1) % numSectors;
+    position.offset = SECTOR_HEADER_SIZE;
+  }
+  if (lastSeq < committedSeq) {
+    lastSeq = committedSeq;
+  }
+  lostSeq = firstSeq > 0 ? firstSeq - 1 : lastSeq;
+
+  seekFirstPending();
+  return true;
+}
+
+/**
+ * Append a record. It is in flash when this returns true.
+ * @param data The record payload, at most FLASH_LOG_MAX_RECORD bytes
+ * @return false if the record is too large or the write failed
+ */
+bool FlashRingLog::append(const uint8_t* data, size_t length) {
+  if (!appendRecord(RECORD_DATA, lastSeq + 1, data, length)) {
+    return false;
+  }
+  lastSeq++;
+  recordsAppended++;
+  return true;
+}
+
+/**
+ * Read the next record that hasn't been committed, in the order they were appended.
+ * Each call moves on to the next record; after a reset reading starts again after the last commit.
+ * @param data Destination for the payload (records larger than `size` are skipped)
+ * @param length Set to the payload length
+ * @param seq Set to the record's sequence number, pass the last one read to commit()
+ * @return false if there are no more records
+ */
+bool FlashRingLog::readNext(uint8_t* data, size_t size, size_t& length, uint32_t& seq) {
+  while (true) {
+    RecordHeader header;
+    int result = 0;
+    if (cursor.sector != headSector || cursor.offset < writeOffset) {
+      result = readRecord(cursor, header, data, size);
+    }
+    if (result <= 0) {
+      // end of the sector (or the rest of it is unreadable)
+      if (cursor.sector == headSector) {
+        return false;
+      }
+      cursor.sector = (cursor.sector + 1) % numSectors;
+      cursor.offset = SECTOR_HEADER_SIZE;
+      continue;
+    }
+    cursor.offset += recordSize(header.length);
+    if (header.type == RECORD_DATA && header.seq > committedSeq && header.length <= size) {
+      length = header.length;
+      seq = header.seq;
+      return true;
+    }
+  }
+}
+
+/**
+ * Mark every record up to and including `seq` as uploaded, so they aren't replayed after a reset.
+ */
+bool FlashRingLog::commit(uint32_t seq) {
+  if (seq > lastSeq) {
+    seq = lastSeq;
+  }
+  if (seq <= committedSeq) {
+    return true;
+  }
+  if (!appendRecord(RECORD_COMMIT, seq, nullptr, 0)) {
+    return false;
+  }
+  committedSeq = seq;
+  return true;
+}
+
+bool FlashRingLog::readSectorHeader(uint16_t sector, uint32_t& sectorSeq, uint32_t& committed) {
+  uint32_t header[3];
+  if (!flash.read(sectorAddress(sector), (uint8_t*)header, sizeof(header)) || header[0] != SECTOR_MAGIC) {
+    return false;
+  }
+  sectorSeq = header[1];
+  committed = header[2];
+  return true;
+}
+
+// Read and check the record at `position`: 1 if it's valid, 0 at the end of the sector's records, -1 if it's corrupt
+int FlashRingLog::readRecord(const Position& position, RecordHeader& header, uint8_t* data, size_t size) {
+  if (position.offset + RECORD_HEADER_SIZE + RECORD_CRC_SIZE > sectorSize) {
+    return 0;
+  }
+  uint8_t record[RECORD_HEADER_SIZE + FLASH_LOG_MAX_RECORD + RECORD_CRC_SIZE];
+  uint32_t address = sectorAddress(position.sector) + position.offset;
+  if (!flash.read(address, record, RECORD_HEADER_SIZE)) {
+    return -1;
+  }
+  memcpy(&header, record, RECORD_HEADER_SIZE);
+  if (header.type == RECORD_ERASED) {
+    return 0;
+  }
+  if ((header.type != RECORD_DATA && header.type != RECORD_COMMIT) || header.length > FLASH_LOG_MAX_RECORD ||
+      position.offset + recordSize(header.length) > sectorSize) {
+    return -1;
+  }
+  size_t checkedLength = RECORD_HEADER_SIZE + header.length;
+  if (!flash.read(address + RECORD_HEADER_SIZE, record + RECORD_HEADER_SIZE, header.length + RECORD_CRC_SIZE)) {
+    return -1;
+  }
+  uint16_t crc;
+  memcpy(&crc, record + checkedLength, sizeof(crc));
+  if (crc != crc16(record, checkedLength)) {
+    return -1;
+  }
+  if (data != nullptr && header.length <= size) {
+    memcpy(data, record + RECORD_HEADER_SIZE, header.length);
+  }
+  return 1;
+}
+
+bool FlashRingLog::appendRecord(uint8_t type, uint32_t seq, const uint8_t* data, size_t length) {
+  if (length > FLASH_LOG_MAX_RECORD || numSectors == 0) {
+    return false;
+  }
+  uint32_t size = recordSize(length);
+  if (headClosed || writeOffset + size > sectorSize) {
+    if (!openNextSector()) {
+      return false;
+    }
+  }
+
+  // Header, payload and CRC go out in one write; a reset part way through leaves a bad CRC
+  uint8_t record[RECORD_HEADER_SIZE + FLASH_LOG_MAX_RECORD + RECORD_CRC_SIZE + 3];
+  memset(record, 0xFF, size);
+  RecordHeader header = {type, 0xFF, (uint16_t)length, seq};
+  memcpy(record, &header, RECORD_HEADER_SIZE);
+  if (length > 0) {
+    memcpy(record + RECORD_HEADER_SIZE, data, length);
+  }
+  uint16_t crc = crc16(record, RECORD_HEADER_SIZE + length);
+  memcpy(record + RECORD_HEADER_SIZE + length, &crc, sizeof(crc));
+
+  if (!flash.write(sectorAddress(headSector) + writeOffset, record, size)) {
+    writeErrors++;
+    headClosed = true; // don't append after a record that may be half written
+    return false;
+  }
+  writeOffset += size;
+  return true;
+}
+
+// Erase a sector and make it the head
+bool FlashRingLog::openSector(uint16_t sector, uint32_t sectorSeq) {
+  for (uint32_t offset = 0; offset < sectorSize; offset += flash.eraseSize()) {
+    if (!flash.erase(sectorAddress(sector) + offset)) {
+      writeErrors++;
+      return false;
+    }
+  }
+  sectorsErased++;
+
+  // The magic goes in last, so a header torn by a reset doesn't make the sector look like the newest one
+  uint32_t sequences[2] = {sectorSeq, committedSeq};
+  uint32_t magic = SECTOR_MAGIC;
+  if (!flash.write(sectorAddress(sector) + sizeof(magic), (const uint8_t*)sequences, sizeof(sequences))
+      || !flash.write(sectorAddress(sector), (const uint8_t*)&magic, sizeof(magic))) {
+    writeErrors++;
+    return false;
+  }
+  headSector = sector;
+  headSectorSeq = sectorSeq;
+  writeOffset = SECTOR_HEADER_SIZE;
+  headClosed = false;
+  return true;
+}
+
+// Move the head to the next sector around the ring, reusing the oldest sector once the ring is full
+bool FlashRingLog::openNextSector() {
+  uint16_t next = (headSector + 1) % numSectors;
+  if (next == oldestSector) {
+    uint32_t highestSeq = 0;
+    recordsDropped += countPending(next, highestSeq);
+    if (highestSeq > lostSeq) {
+      lostSeq = highestSeq;
+    }
+    oldestSector = (next + 1) % numSectors;
+    if (cursor.sector == next) {
+      cursor.sector = oldestSector;
+      cursor.offset = SECTOR_HEADER_SIZE;
+    }
+  }
+  return openSector(next, headSectorSeq + 1);
+}
+
+// Number of records in a sector that haven't been committed, and the highest sequence number in it
+uint32_t FlashRingLog::countPending(uint16_t sector, uint32_t& highestSeq) {
+  uint32_t count = 0;
+  Position position = {sector, SECTOR_HEADER_SIZE};
+  RecordHeader header;
+  while (readRecord(position, header, nullptr, 0) > 0) {
+    if (header.type == RECORD_DATA) {
+      if (header.seq > committedSeq) {
+        count++;
+      }
+      highestSeq = header.seq;
+    }
+    position.offset += recordSize(header.length);
+  }
+  return count;
+}
+
+// Point the read cursor at the first record that hasn't been committed
+void FlashRingLog::seekFirstPending() {
+  Position position = {oldestSector, SECTOR_HEADER_SIZE};
+  while (true) {
+    RecordHeader header;
+    int result = readRecord(position, header, nullptr, 0);
+    if (result <= 0) {
+      if (position.sector == headSector) {
+        break;
+      }
+      position.sector = (position.sector + 1) % numSectors;
+      position.offset = SECTOR_HEADER_SIZE;
+      continue;
+    }
+    if (header.type == RECORD_DATA && header.seq > committedSeq) {
+      break;
+    }
+    position.offset += recordSize(header.length);
+  }
+  cursor = position;
+}
@@ -0,0 +1,83 @@
+#ifndef FLASH_RING_LOG_H
+#define FLASH_RING_LOG_H
+
+#include <Arduino.h>
+#include "flash_device.h"
+
+#define FLASH_LOG_SECTOR_SIZE 4096 // erased together; must be a multiple of the device's erase size
+#define FLASH_LOG_MAX_RECORD 244   // largest record payload (record + header + CRC fit in 256 bytes)
+
+/**
+ * Append-only log of records in a ring of flash sectors, for data that has to survive a reset
+ * until it has been uploaded (store-and-forward).
+ *
+ * Every record gets a sequence number. Records are read back in order with readNext() and marked
+ * as uploaded with commit(seq), which appends a commit marker instead of rewriting anything, so a
+ * reset at any point leaves the log consistent: on begin() the records after the last commit
+ * marker are replayed. A reset between an upload and its commit replays that upload once more,
+ * so uploads should be idempotent (e.g. keyed PATCHes).
+ *
+ * Layout: each sector starts with [magic][sector sequence][committed seq when the sector was opened]
+ * (the magic written last), followed by records: [type (1)][0xFF][payload length (uint16)][seq (uint32)][payload][crc16], padded
+ * to 4 bytes. Sectors are written in turn around the ring, which spreads the erases evenly. A record
+ * with a bad CRC (power lost while writing it) ends its sector; the next append opens a new sector.
+ * When the ring is full the oldest sector is erased, and any records in it that were never
+ * committed are counted in recordsDropped.
+ */
+class FlashRingLog {
+  public:
+    FlashRingLog(FlashDevice& flash, uint32_t sectorSize = FLASH_LOG_SECTOR_SIZE);
+
+    bool begin();
+    bool append(const uint8_t* data, size_t length);
+    bool readNext(uint8_t* data, size_t size, size_t& length, uint32_t& seq);
+    bool commit(uint32_t seq);
+
+    uint32_t pending() const { return lastSeq - (committedSeq > lostSeq ? committedSeq : lostSeq); } // records left to read and commit
+    uint32_t lastSequence() const { return lastSeq; }
+    uint32_t committedSequence() const { return committedSeq; }
+    uint16_t sectorCount() const { return numSectors; }
+
+    unsigned long recordsAppended = 0;
+    unsigned long recordsDropped = 0; // overwritten before they were committed
+    unsigned long corruptRecords = 0; // torn or unreadable records found by begin()
+    unsigned long sectorsErased = 0;
+    unsigned long writeErrors = 0;
+
+  private:
+    struct Position {
+      uint16_t sector;
+      uint32_t offset;
+    };
+
+    struct RecordHeader {
+      uint8_t type;
+      uint8_t reserved;
+      uint16_t length;
+      uint32_t seq;
+    };
+
+    bool readSectorHeader(uint16_t sector, uint32_t& sectorSeq, uint32_t& committed);
+    int readRecord(const Position& position, RecordHeader& header, uint8_t* data, size_t size);
+    bool appendRecord(uint8_t type, uint32_t seq, const uint8_t* data, size_t length);
+    bool openSector(uint16_t sector, uint32_t sectorSeq);
+    bool openNextSector();
+    uint32_t countPending(uint16_t sector, uint32_t& highestSeq);
+    void seekFirstPending();
+    uint32_t sectorAddress(uint16_t sector) const { return (uint32_t)sector * sectorSize; }
+
+    FlashDevice& flash;
+    uint32_t sectorSize;
+    uint16_t numSectors;
+    uint16_t oldestSector;
+    uint16_t headSector;
+    uint32_t headSectorSeq;
+    uint32_t writeOffset;
+    bool headClosed; // the head sector ends in a torn record, so nothing more is appended to it
+    uint32_t lastSeq;
+    uint32_t committedSeq;
+    uint32_t lostSeq; // records up to this one were overwritten (or are older than the oldest sector)
+    Position cursor; // where readNext() continues
+};
+
+#endif // FLASH_RING_LOG_H
@@ -0,0 +1,85 @@
+#include "http_pipeline.h"
+
+HttpPipeline::HttpPipeline(HttpResponseHandler handler, uint8_t maxInFlight, unsigned long timeout)
+  : head(0), numInFlight(0), maxInFlight(maxInFlight), timeout(timeout), closeAfterResponse(false), handler(handler) {
+  if (this->maxInFlight == 0 || this->maxInFlight > HTTP_PIPELINE_DEPTH) {
+    this->maxInFlight = HTTP_PIPELINE_DEPTH;
+  }
+}
+
+/**
+ * Register a request that has just been written to the connection. Check canSend() first.
+ * @param tag Identifies the request to the response handler
+ */
+void HttpPipeline::sent(uint8_t tag) {
+  if (numInFlight >= HTTP_PIPELINE_DEPTH) {
+    return;
+  }
+  PendingRequest& request = requests[(head + numInFlight) % HTTP_PIPELINE_DEPTH];
+  request.tag = tag;
+  request.sentAt = millis();
+  numInFlight++;
+  requestsSent++;
+}
+
+/**
+ * Read whatever part of the responses has arrived and hand every complete response to the handler.
+ * Call from every pass of loop() while the connection is open.
+ * @return false if the connection has to be reset: the oldest request timed out, a response
+ *         couldn't be parsed, or the server said it is closing the connection
+ */
+bool HttpPipeline::poll(Stream& connection) {
+  int budget = HTTP_PIPELINE_READ_BUDGET;
+  while (budget-- > 0 && connection.available() > 0) {
+    int c = connection.read();
+    if (c < 0) {
+      break;
+    }
+    if (numInFlight == 0) {
+      unexpectedBytes++;
+      continue;
+    }
+    HttpResponseState state = response.feed((char)c);
+    if (state == HTTP_RESPONSE_DONE) {
+      responsesReceived++;
+      closeAfterResponse = response.closesConnection();
+      complete(response.statusCode());
+      response.reset();
+      if (closeAfterResponse) {
+        // whatever was pipelined behind this response won't be answered on this connection
+        abort();
+        return false;
+      }
+    } else if (state == HTTP_RESPONSE_ERROR) {
+      parseErrors++;
+      abort();
+      return false;
+    }
+  }
+
+  if (numInFlight > 0 && millis() - requests[head].sentAt > timeout) {
+    timeouts++;
+    abort();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Fail every in-flight request (handler gets HTTP_STATUS_NONE), e.g. when the connection is lost.
+ */
+void HttpPipeline::abort() {
+  while (numInFlight > 0) {
+    complete(HTTP_STATUS_NONE);
+  }
+  response.reset();
+}
+
+void HttpPipeline::complete(int status) {
+  PendingRequest request = requests[head];
+  head = (head + 1) % HTTP_PIPELINE_DEPTH;
+  numInFlight--;
+  if (handler != nullptr) {
+    handler(request.tag, status, millis() - request.sentAt, response);
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef HTTP_PIPELINE_H
+#define HTTP_PIPELINE_H
+
+#include <Arduino.h>
+#include "http_response.h"
+
+#define HTTP_PIPELINE_DEPTH 4          // requests that can be waiting for their response at once
+#define HTTP_RESPONSE_TIMEOUT 10000    // ms to wait for the response to the oldest request
+#define HTTP_PIPELINE_READ_BUDGET 256  // response bytes handled per poll(), so a large reply can't stall loop()
+#define HTTP_STATUS_NONE 0             // status handed to the handler when a request got no response
+
+/**
+ * Called once for every request sent: with the response's status code when it arrives, or with
+ * HTTP_STATUS_NONE if the request timed out or the connection was lost before it was answered.
+ * @param tag The tag passed to sent(), identifying what the request carried
+ * @param latencyMs Time from sent() to the end of the response
+ * @param response The parsed response (status, start of the body)
+ */
+typedef void (*HttpResponseHandler)(uint8_t tag, int status, unsigned long latencyMs, const HttpResponseParser& response);
+
+/**
+ * Tracks requests pipelined on one keep-alive connection.
+ *
+ * HTTP/1.1 answers requests on a connection in the order they were sent, so in-flight requests
+ * are kept in a FIFO and each parsed response is matched to the oldest one. Responses are read
+ * incrementally by poll(), a bounded number of bytes at a time, so waiting for the server never
+ * blocks loop(). If the oldest request times out the responses can no longer be matched, so all
+ * in-flight requests are failed and the caller has to reset the connection.
+ */
+class HttpPipeline {
+  public:
+    HttpPipeline(HttpResponseHandler handler, uint8_t maxInFlight = HTTP_PIPELINE_DEPTH,
+                 unsigned long timeout = HTTP_RESPONSE_TIMEOUT);
+
+    bool canSend() const { return numInFlight < maxInFlight; }
+    void sent(uint8_t tag);
+    bool poll(Stream& connection);
+    void abort();
+
+    uint8_t inFlight() const { return numInFlight; }
+    bool closeRequested() const { return closeAfterResponse; }
+
+    unsigned long requestsSent = 0;
+    unsigned long responsesReceived = 0;
+    unsigned long timeouts = 0;
+    unsigned long parseErrors = 0;
+    unsigned long unexpectedBytes = 0; // bytes received with no request in flight
+
+  private:
+    struct PendingRequest {
+      uint8_t tag;
+      unsigned long sentAt;
+    };
+
+    void complete(int status);
+
+    PendingRequest requests[HTTP_PIPELINE_DEPTH];
+    uint8_t head;
+    uint8_t numInFlight;
+    uint8_t maxInFlight;
+    unsigned long timeout;
+    bool closeAfterResponse;
+    HttpResponseHandler handler;
+    HttpResponseParser response;
+};
+
+#endif // HTTP_PIPELINE_H
@@ -0,0 +1,185 @@
+#include "http_request.h"
+
+HttpRequestParser::HttpRequestParser() {
+  reset();
+}
+
+/**
+ * Get ready for a new request.
+ */
+void HttpRequestParser::reset() {
+  methodBuffer[0] = '\0';
+  pathBuffer[0] = '\0';
+  queryBuffer[0] = '\0';
+  length = 0;
+  headerBytes = 0;
+  lineEmpty = true;
+  parseState = HTTP_PARSE_METHOD;
+  error = 0;
+}
+
+/**
+ * Feed the next received character.
+ * @return The parser state; HTTP_PARSE_DONE once the request line and headers have been read,
+ *         HTTP_PARSE_ERROR if the request is malformed or too long (see errorStatus())
+ */
+HttpParseState HttpRequestParser::feed(char c) {
+  switch (parseState) {
+    case HTTP_PARSE_METHOD:
+      if (c == ' ') {
+        parseState = length > 0 ? HTTP_PARSE_PATH : HTTP_PARSE_METHOD;
+        length = 0;
+      } else if (c == '\r' || c == '\n') {
+        if (length > 0) {
+          fail(400);
+        } // else: blank lines before the request line are allowed
+      } else if (!append(methodBuffer, sizeof(methodBuffer), c)) {
+        fail(400);
+      }
+      break;
+
+    case HTTP_PARSE_PATH:
+      if (c == ' ' || c == '?') {
+        if (length == 0) {
+          fail(400);
+          break;
+        }
+        parseState = c == '?' ? HTTP_PARSE_QUERY : HTTP_PARSE_VERSION;
+        length = 0;
+      } else if (c == '\r' || c == '\n') {
+        fail(400);
+      } else if (!append(pathBuffer, sizeof(pathBuffer), c)) {
+        fail(414);
+      }
+      break;
+
+    case HTTP_PARSE_QUERY:
+      if (c == ' ') {
+        parseState = HTTP_PARSE_VERSION;
+        length = 0;
+      } else if (c == '\r' || c == '\n') {
+        fail(400);
+      } else if (!append(queryBuffer, sizeof(queryBuffer), c)) {
+        fail(414);
+      }
+      break;
+
+    case HTTP_PARSE_VERSION:
+      // The version isn't needed, just wait for the end of the request line
+      if (c == '\n') {
+        parseState = HTTP_PARSE_HEADERS;
+        lineEmpty = true;
+      }
+      break;
+
+    case HTTP_PARSE_HEADERS:
+      if (++headerBytes > HTTP_MAX_HEADER_BYTES) {
+        fail(431);
+      } else if (c == '\n') {
+        if (lineEmpty) {
+          parseState = HTTP_PARSE_DONE;
+        }
+        lineEmpty = true;
+      } else if (c != '\r') {
+        lineEmpty = false;
+      }
+      break;
+
+    case HTTP_PARSE_DONE:
+    case HTTP_PARSE_ERROR:
+      break;
+  }
+  return parseState;
+}
+
+/**
+ * Copy the value of a query string parameter (e.g. "mid_cal" in "low_cal=4&mid_cal=7") into `value`.
+ * @return false if the parameter is missing or its value doesn't fit in `value`
+ */
+bool HttpRequestParser::queryParam(const char* key, char* value, size_t valueSize) const {
+  size_t keyLength = strlen(key);
+  const char* p = queryBuffer;
+  while (*p != '\0') {
+    const char* end = strchr(p, '&');
+    if (end == nullptr) {
+      end = p + strlen(p);
+    }
+    if (strncmp(p, key, keyLength) == 0 && p[keyLength] == '=') {
+      const char* start = p + keyLength + 1;
+      size_t valueLength = end - start;
+      if (valueLength >= valueSize) {
+        return false;
+      }
+      memcpy(value, start, valueLength);
+      value[valueLength] = '\0';
+      return true;
+    }
+    p = *end == '&' ? end + 1 : end;
+  }
+  return false;
+}
+
+bool HttpRequestParser::append(char* buffer, size_t bufferSize, char c) {
+  if (length + 1u >= bufferSize) {
+    return false;
+  }
+  buffer[length++] = c;
+  buffer[length] = '\0';
+  return true;
+}
+
+void HttpRequestParser::fail(int status) {
+  parseState = HTTP_PARSE_ERROR;
+  error = status;
+}
+
+/**
+ * Look up the route for a path in a static route table.
+ * @return The matching route, or nullptr if there is none
+ */
+const HttpRoute* findHttpRoute(const HttpRoute* routes, size_t numRoutes, const char* path) {
+  for (size_t i = 0; i < numRoutes; i++) {
+    if (strcmp(routes[i].path, path) == 0) {
+      return &routes[i];
+    }
+  }
+  return nullptr;
+}
+
+const char* httpStatusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 408: return "Request Timeout";
+    case 414: return "URI Too Long";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Error";
+  }
+}
+
+/**
+ * Send the status line and headers of a response that closes the connection.
+ * The body can be written to the client straight after.
+ */
+void sendHttpHeaders(Print& client, int status, const char* contentType) {
+  client.print(F("HTTP/1.1 "));
+  client.print(status);
+  client.print(' ');
+  client.println(httpStatusText(status));
+  client.print(F("Content-Type: "));
+  client.println(contentType);
+  client.println(F("Connection: close"));
+  client.println();
+}
+
+/**
+ * Send a complete response with a text body.
+ */
+void sendHttpResponse(Print& client, int status, const char* contentType, const char* body) {
+  sendHttpHeaders(client, status, contentType);
+  client.println(body);
+}
@@ -0,0 +1,72 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <Arduino.h>
+
+#define HTTP_MAX_METHOD 8
+#define HTTP_MAX_PATH 48
+#define HTTP_MAX_QUERY 96
+#define HTTP_MAX_HEADER_BYTES 2048 // headers are skipped, but a request can't send more than this
+
+enum HttpParseState : uint8_t {
+  HTTP_PARSE_METHOD,
+  HTTP_PARSE_PATH,
+  HTTP_PARSE_QUERY,
+  HTTP_PARSE_VERSION,
+  HTTP_PARSE_HEADERS,
+  HTTP_PARSE_DONE,
+  HTTP_PARSE_ERROR
+};
+
+/**
+ * Incremental HTTP/1.1 request parser with fixed buffers (no heap allocation).
+ *
+ * Bytes are fed in as they arrive, so a request split across several reads (or a slow client)
+ * is parsed over several passes of loop() instead of blocking it. The method, path and query
+ * string are kept; headers are skipped. Parsing stops at the blank line that ends the headers
+ * (request bodies aren't used by the local API).
+ */
+class HttpRequestParser {
+  public:
+    HttpRequestParser();
+
+    void reset();
+    HttpParseState feed(char c);
+
+    HttpParseState state() const { return parseState; }
+    bool isDone() const { return parseState == HTTP_PARSE_DONE; }
+    bool hasError() const { return parseState == HTTP_PARSE_ERROR; }
+    int errorStatus() const { return error; }
+
+    const char* method() const { return methodBuffer; }
+    const char* path() const { return pathBuffer; }
+    const char* query() const { return queryBuffer; }
+    bool queryParam(const char* key, char* value, size_t valueSize) const;
+
+  private:
+    bool append(char* buffer, size_t bufferSize, char c);
+    void fail(int status);
+
+    char methodBuffer[HTTP_MAX_METHOD + 1];
+    char pathBuffer[HTTP_MAX_PATH + 1];
+    char queryBuffer[HTTP_MAX_QUERY + 1];
+    uint8_t length;         // length of the field being parsed
+    uint16_t headerBytes;
+    bool lineEmpty;         // no characters yet on the current header line
+    HttpParseState parseState;
+    int error;              // HTTP status to answer with when parsing failed
+};
+
+// An entry in a static route table, matched on the exact path
+struct HttpRoute {
+  const char* path;
+  void (*handler)(uint8_t socketNum, const HttpRequestParser& request);
+};
+
+const HttpRoute* findHttpRoute(const HttpRoute* routes, size_t numRoutes, const char* path);
+
+const char* httpStatusText(int status);
+void sendHttpHeaders(Print& client, int status, const char* contentType);
+void sendHttpResponse(Print& client, int status, const char* contentType, const char* body);
+
+#endif // HTTP_REQUEST_H
@@ -0,0 +1,186 @@
+#include "http_response.h"
+
+// Case-insensitive check that `line` starts with `prefix`
+static bool startsWithIgnoreCase(const char* line, const char* prefix) {
+  while (*prefix != '\0') {
+    if (tolower(*line) != tolower(*prefix)) {
+      return false;
+    }
+    line++;
+    prefix++;
+  }
+  return true;
+}
+
+// Skip the spaces after a header name's colon
+static const char* headerValue(const char* line, size_t nameLength) {
+  const char* value = line + nameLength;
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  return value;
+}
+
+HttpResponseParser::HttpResponseParser() {
+  reset();
+}
+
+/**
+ * Get ready for the next response.
+ */
+void HttpResponseParser::reset() {
+  line[0] = '\0';
+  lineLength = 0;
+  bodyBuffer[0] = '\0';
+  storedBody = 0;
+  status = 0;
+  length = -1;
+  remaining = 0;
+  chunked = false;
+  connectionClose = false;
+  parseState = HTTP_RESPONSE_STATUS_LINE;
+}
+
+/**
+ * Feed the next received byte.
+ * @return The parser state; HTTP_RESPONSE_DONE once the whole response (including the body) has been read
+ */
+HttpResponseState HttpResponseParser::feed(char c) {
+  switch (parseState) {
+    case HTTP_RESPONSE_STATUS_LINE:
+      if (endOfLine(c)) {
+        parseStatusLine();
+      }
+      break;
+
+    case HTTP_RESPONSE_HEADERS:
+      if (endOfLine(c)) {
+        if (lineLength == 0) {
+          endOfHeaders();
+        } else {
+          parseHeaderLine();
+        }
+        lineLength = 0;
+      }
+      break;
+
+    case HTTP_RESPONSE_BODY:
+      storeBody(c);
+      if (--remaining == 0) {
+        parseState = HTTP_RESPONSE_DONE;
+      }
+      break;
+
+    case HTTP_RESPONSE_CHUNK_SIZE:
+      if (endOfLine(c)) {
+        // chunk size in hex, optionally followed by ";extensions"
+        char* end;
+        remaining = strtoul(line, &end, 16);
+        if (end == line) {
+          parseState = HTTP_RESPONSE_ERROR;
+        } else {
+          parseState = remaining == 0 ? HTTP_RESPONSE_TRAILERS : HTTP_RESPONSE_CHUNK_DATA;
+        }
+        lineLength = 0;
+      }
+      break;
+
+    case HTTP_RESPONSE_CHUNK_DATA:
+      storeBody(c);
+      if (--remaining == 0) {
+        parseState = HTTP_RESPONSE_CHUNK_END;
+      }
+      break;
+
+    case HTTP_RESPONSE_CHUNK_END:
+      // the CRLF after the chunk data
+      if (endOfLine(c)) {
+        parseState = HTTP_RESPONSE_CHUNK_SIZE;
+        lineLength = 0;
+      }
+      break;
+
+    case HTTP_RESPONSE_TRAILERS:
+      if (endOfLine(c)) {
+        if (lineLength == 0) {
+          parseState = HTTP_RESPONSE_DONE;
+        }
+        lineLength = 0;
+      }
+      break;
+
+    case HTTP_RESPONSE_DONE:
+    case HTTP_RESPONSE_ERROR:
+      break;
+  }
+  return parseState;
+}
+
+// Collect a line; returns true at its '\n' with the line (without CR/LF) in `line`
+bool HttpResponseParser::endOfLine(char c) {
+  if (c == '\n') {
+    line[lineLength] = '\0';
+    return true;
+  }
+  if (c != '\r' && lineLength < HTTP_RESPONSE_MAX_LINE) {
+    line[lineLength++] = c;
+  }
+  return false;
+}
+
+void HttpResponseParser::parseStatusLine() {
+  // "HTTP/1.1 200 OK"
+  if (lineLength == 0) {
+    return; // tolerate a stray blank line between responses
+  }
+  if (!startsWithIgnoreCase(line, "HTTP/")) {
+    parseState = HTTP_RESPONSE_ERROR;
+    return;
+  }
+  const char* space = strchr(line, ' ');
+  status = space != nullptr ? atoi(space + 1) : 0;
+  if (status < 100 || status > 999) {
+    parseState = HTTP_RESPONSE_ERROR;
+    return;
+  }
+  parseState = HTTP_RESPONSE_HEADERS;
+  lineLength = 0;
+}
+
+void HttpResponseParser::parseHeaderLine() {
+  if (startsWithIgnoreCase(line, "Content-Length:")) {
+    length = atol(headerValue(line, 15));
+  } else if (startsWithIgnoreCase(line, "Transfer-Encoding:")) {
+    chunked = startsWithIgnoreCase(headerValue(line, 18), "chunked");
+  } else if (startsWithIgnoreCase(line, "Connection:")) {
+    connectionClose = startsWithIgnoreCase(headerValue(line, 11), "close");
+  }
+}
+
+void HttpResponseParser::endOfHeaders() {
+  if (status < 200) {
+    // an informational (1xx) response has no body and is followed by the real response
+    reset();
+  } else if (status == 204 || status == 304) {
+    parseState = HTTP_RESPONSE_DONE;
+  } else if (chunked) {
+    parseState = HTTP_RESPONSE_CHUNK_SIZE;
+  } else if (length > 0) {
+    remaining = length;
+    parseState = HTTP_RESPONSE_BODY;
+  } else if (length == 0) {
+    parseState = HTTP_RESPONSE_DONE;
+  } else {
+    // No length: the body runs until the server closes the connection. It can't be told apart
+    // from the next response, so treat the response as complete and the connection as closing.
+    connectionClose = true;
+    parseState = HTTP_RESPONSE_DONE;
+  }
+}
+
+void HttpResponseParser::storeBody(char c) {
+  if (storedBody < HTTP_RESPONSE_MAX_BODY) {
+    bodyBuffer[storedBody++] = c;
+    bodyBuffer[storedBody] = '\0';
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include <Arduino.h>
+
+#define HTTP_RESPONSE_MAX_LINE 48 // header lines are cut to this length, enough for the headers that matter
+#define HTTP_RESPONSE_MAX_BODY 64 // the start of the body is kept (e.g. a small GET result or an error message)
+
+enum HttpResponseState : uint8_t {
+  HTTP_RESPONSE_STATUS_LINE,
+  HTTP_RESPONSE_HEADERS,
+  HTTP_RESPONSE_BODY,
+  HTTP_RESPONSE_CHUNK_SIZE,
+  HTTP_RESPONSE_CHUNK_DATA,
+  HTTP_RESPONSE_CHUNK_END,
+  HTTP_RESPONSE_TRAILERS,
+  HTTP_RESPONSE_DONE,
+  HTTP_RESPONSE_ERROR
+};
+
+/**
+ * Incremental HTTP/1.1 response parser with fixed buffers (no heap allocation).
+ *
+ * Reads the status code, the Content-Length, Transfer-Encoding and Connection headers, and
+ * consumes exactly one response body (Content-Length or chunked), so back to back responses on a
+ * keep-alive connection can be told apart. Only the first HTTP_RESPONSE_MAX_BODY bytes of the
+ * body are kept. Feed one byte at a time and stop once isDone(); the next byte belongs to the
+ * next response.
+ */
+class HttpResponseParser {
+  public:
+    HttpResponseParser();
+
+    void reset();
+    HttpResponseState feed(char c);
+
+    HttpResponseState state() const { return parseState; }
+    bool isDone() const { return parseState == HTTP_RESPONSE_DONE; }
+    bool hasError() const { return parseState == HTTP_RESPONSE_ERROR; }
+
+    int statusCode() const { return status; }
+    long contentLength() const { return length; } // -1 if the response didn't send one
+    bool isChunked() const { return chunked; }
+    bool closesConnection() const { return connectionClose; } // the server closes the connection after this response
+
+    const char* body() const { return bodyBuffer; }
+    size_t bodyLength() const { return storedBody; }
+
+  private:
+    bool endOfLine(char c);
+    void parseStatusLine();
+    void parseHeaderLine();
+    void endOfHeaders();
+    void storeBody(char c);
+
+    char line[HTTP_RESPONSE_MAX_LINE + 1];
+    uint8_t lineLength;
+    char bodyBuffer[HTTP_RESPONSE_MAX_BODY + 1];
+    uint8_t storedBody;
+    int status;
+    long length;
+    unsigned long remaining; // body or chunk bytes left to read
+    bool chunked;
+    bool connectionClose;
+    HttpResponseState parseState;
+};
+
+#endif // HTTP_RESPONSE_H
@@ -0,0 +1,80 @@
+#include "latency_histogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::record(unsigned long ms) {
+  uint8_t index = 0;
+  unsigned long bound = LATENCY_HISTOGRAM_FIRST_BUCKET;
+  while (ms >= bound && index < LATENCY_HISTOGRAM_BUCKETS - 1) {
+    bound <<= 1;
+    index++;
+  }
+  buckets[index]++;
+  total++;
+  sumMs += ms;
+  if (ms > maxMs) {
+    maxMs = ms;
+  }
+}
+
+void LatencyHistogram::reset() {
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    buckets[i] = 0;
+  }
+  total = 0;
+  sumMs = 0;
+  maxMs = 0;
+}
+
+/**
+ * @return The exclusive upper bound of a bucket in ms; the last bucket is bounded by the largest latency seen
+ */
+unsigned long LatencyHistogram::bucketUpperBound(uint8_t index) {
+  return (unsigned long)LATENCY_HISTOGRAM_FIRST_BUCKET << index;
+}
+
+/**
+ * @param p Percentile between 0 and 100 (e.g. 99 for p99)
+ * @return The upper bound (ms) of the bucket holding the p-th percentile, or 0 if nothing was recorded
+ */
+unsigned long LatencyHistogram::percentile(float p) const {
+  if (total == 0) {
+    return 0;
+  }
+  // rank of the sample at the percentile, counted from 1
+  uint32_t rank = (uint32_t)ceil(p / 100.0 * total);
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS - 1; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      unsigned long bound = bucketUpperBound(i);
+      return bound < maxMs ? bound : maxMs;
+    }
+  }
+  return maxMs;
+}
+
+/**
+ * Print e.g. "log: 12 requests, avg 840ms, p50 <1024ms, p90 <2048ms, p99 <2048ms, max 1710ms"
+ */
+void LatencyHistogram::printTo(Print& out, const char* label) const {
+  out.print(label);
+  out.print(F(": "));
+  out.print(total);
+  out.print(F(" requests, avg "));
+  out.print(mean(), 0);
+  out.print(F("ms, p50 <"));
+  out.print(percentile(50));
+  out.print(F("ms, p90 <"));
+  out.print(percentile(90));
+  out.print(F("ms, p99 <"));
+  out.print(percentile(99));
+  out.print(F("ms, max "));
+  out.print(maxMs);
+  out.println(F("ms"));
+}
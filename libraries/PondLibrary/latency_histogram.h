@@ -0,0 +1,39 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <Arduino.h>
+
+#define LATENCY_HISTOGRAM_BUCKETS 12    // bucket i counts latencies below LATENCY_HISTOGRAM_FIRST_BUCKET << i,
+#define LATENCY_HISTOGRAM_FIRST_BUCKET 16 // the last bucket everything from 16s up
+
+/**
+ * Histogram of round-trip latencies (ms) in power-of-two buckets: <16, <32, <64, ... <16384, >=16384.
+ * Recording is O(1) and the whole histogram is ~60 bytes, so one can be kept per request type.
+ * Percentiles are reported as the upper bound of the bucket they fall in (i.e. rounded up to
+ * the next power of two), which is precise enough to tell 300ms from 3s.
+ */
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    void record(unsigned long ms);
+    void reset();
+
+    uint32_t count() const { return total; }
+    uint32_t bucket(uint8_t index) const { return buckets[index]; }
+    static unsigned long bucketUpperBound(uint8_t index);
+    unsigned long percentile(float p) const;
+    uint32_t sum() const { return sumMs; }
+    float mean() const { return total > 0 ? (float)sumMs / total : 0; }
+    unsigned long maximum() const { return maxMs; }
+
+    void printTo(Print& out, const char* label) const;
+
+  private:
+    uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t total;
+    uint32_t sumMs;
+    unsigned long maxMs;
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -3,6 +3,31 @@
 
 extern LiquidCrystal_I2C lcd;
 
+// A message waiting to be (or being) printed by the typewriter task
+struct LcdPrintJob {
+    LiquidCrystal_I2C* lcd;
+    const char* text; // copy (async messages) or the caller's string (lcdPrettyPrint(), which waits for it)
+    char copy[LCD_PRINT_MAX_LENGTH + 1];
+    int length;
+    int index;        // next character to print
+    int slowFrom;     // index from which delayTimeEndChar is used
+    uint8_t col;
+    uint8_t row;
+    bool clearDisplay;
+    bool clearing;    // all characters printed, waiting delayBeforeClear before clearing
+    int delayBeforeClear;
+    int delayTimeBetweenChar;
+    int delayTimeEndChar;
+};
+
+static LcdPrintJob printQueue[LCD_PRINT_QUEUE_SIZE];
+static uint8_t printQueueHead = 0;
+static uint8_t printQueueLength = 0;
+static TaskHandle printTask = NO_TASK;
+
+static bool queueLcdPrint(LiquidCrystal_I2C &lcd, uint8_t col, uint8_t row, const char* dataPrintout, bool copy, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar, int delayTimeEndChar);
+static long lcdPrintStep(void* context);
+
 void lcdPrettyPrint(String dataPrintout) {
     lcdPrettyPrint(dataPrintout, lcd, false, 1500, 50, 250);
 }
@@ -25,6 +50,9 @@ void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDispl
 
 /**
  * Prints a string on an LCD display with optional effects and delay times.
+ * Waits until the message has been printed (and cleared if requested), but keeps the cooperative
+ * scheduler running while it does so. Use lcdPrettyPrintAsync() to return immediately instead.
+ * The whole string is printed, however long, as it isn't copied.
  * 
  * @param dataPrintout the string to be printed on the LCD display
  * @param lcd the LiquidCrystal_I2C object representing the LCD display to be used
@@ -34,44 +62,114 @@ void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDispl
  * @param delayTimeEndChar the delay time in milliseconds between the last few characters being printed out (default: 250ms)
  */
 void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar, int delayTimeEndChar) {
-    unsigned long previousMillis = 0;
-    int currentIndex = 0;
-    int stringLength = dataPrintout.length();
-
-    // Iterate over each character in the string and print it out on the LCD display with a delay between characters
-    while (currentIndex < stringLength) {
-        unsigned long currentMillis = millis();
-
-        if (currentMillis - previousMillis >= delayTimeBetweenChar) {
-            lcd.print(dataPrintout.charAt(currentIndex));
-            previousMillis = currentMillis;
-            currentIndex++;
-
-            // Add a longer delay for the last few characters if the message ends with "..." or "!"
-            if (dataPrintout.endsWith("...")) {
-                if (currentIndex >= stringLength - 4) {
-                    delayTimeBetweenChar = delayTimeEndChar;
-                }
-            }
-            else if (dataPrintout.endsWith("!")) {
-                if (currentIndex >= stringLength - 1) {
-                    delayTimeBetweenChar = delayTimeEndChar;
-                }
-            }
-            else {
-                if (currentIndex >= stringLength - 3) {
-                    delayTimeBetweenChar = delayTimeEndChar;
-                }
-            }
-        }
+    if (!queueLcdPrint(lcd, LCD_KEEP_CURSOR, LCD_KEEP_CURSOR, dataPrintout.c_str(), false, clearDisplay, delayBeforeClear, delayTimeBetweenChar, delayTimeEndChar)) {
+        return;
+    }
+    while (lcdPrettyPrintBusy()) {
+        scheduler.run();
+        yield();
+    }
+}
+
+/**
+ * Queues a string to be printed on the LCD display with the same effects as lcdPrettyPrint(),
+ * and returns immediately. The characters are printed by a resumable task on the cooperative scheduler,
+ * so scheduler.run() must be called from loop(). Queued messages are printed in order.
+ *
+ * @param col the column to print at (LCD_KEEP_CURSOR to print at the cursor position when the message starts)
+ * @param row the row to print at (LCD_KEEP_CURSOR to print at the cursor position when the message starts)
+ * @param dataPrintout the string to be printed, copied so it can be a temporary
+ * @return false if the queue is full, or the string is longer than LCD_PRINT_MAX_LENGTH (logged to Serial),
+ *         and the message was dropped
+ */
+bool lcdPrettyPrintAsync(uint8_t col, uint8_t row, const char* dataPrintout, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar, int delayTimeEndChar) {
+    if (strlen(dataPrintout) > LCD_PRINT_MAX_LENGTH) {
+        Serial.print(F("LCD message longer than "));
+        Serial.print(LCD_PRINT_MAX_LENGTH);
+        Serial.print(F(" characters, not printed: "));
+        Serial.println(dataPrintout);
+        return false;
     }
+    return queueLcdPrint(lcd, col, row, dataPrintout, true, clearDisplay, delayBeforeClear, delayTimeBetweenChar, delayTimeEndChar);
+}
+
+/**
+ * @return true while any queued message is still being printed (or waiting to be cleared)
+ */
+bool lcdPrettyPrintBusy() {
+    return printQueueLength > 0;
+}
 
-    // Clear the LCD display if the clearDisplay flag is set to true and delay before clearing the display
-    if (clearDisplay == true) {
-        unsigned long clearMillis = millis();
-        while (millis() - clearMillis < delayBeforeClear) {
-            // Do nothing for the specified delay time
+// `copy`: keep a copy of the string (at most LCD_PRINT_MAX_LENGTH characters), otherwise it must outlive the job
+static bool queueLcdPrint(LiquidCrystal_I2C &lcd, uint8_t col, uint8_t row, const char* dataPrintout, bool copy, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar, int delayTimeEndChar) {
+    if (printQueueLength >= LCD_PRINT_QUEUE_SIZE) {
+        return false;
+    }
+
+    LcdPrintJob& job = printQueue[(printQueueHead + printQueueLength) % LCD_PRINT_QUEUE_SIZE];
+    job.lcd = &lcd;
+    if (copy) {
+        strncpy(job.copy, dataPrintout, LCD_PRINT_MAX_LENGTH);
+        job.copy[LCD_PRINT_MAX_LENGTH] = '\0';
+        job.text = job.copy;
+    } else {
+        job.text = dataPrintout;
+    }
+    job.length = strlen(job.text);
+    job.index = 0;
+    job.col = col;
+    job.row = row;
+    job.clearDisplay = clearDisplay;
+    job.clearing = false;
+    job.delayBeforeClear = delayBeforeClear;
+    job.delayTimeBetweenChar = delayTimeBetweenChar;
+    job.delayTimeEndChar = delayTimeEndChar;
+
+    // Add a longer delay for the last few characters if the message ends with "..." or "!"
+    if (job.length >= 3 && strcmp(job.text + job.length - 3, "...") == 0) {
+        job.slowFrom = job.length - 4;
+    } else if (job.length >= 1 && job.text[job.length - 1] == '!') {
+        job.slowFrom = job.length - 1;
+    } else {
+        job.slowFrom = job.length - 3;
+    }
+
+    printQueueLength++;
+    if (!scheduler.isScheduled(printTask)) {
+        printTask = scheduler.schedule(lcdPrintStep, nullptr, 0);
+    }
+    return true;
+}
+
+// Resumable typewriter animation: prints one character per call and returns the delay before the next one
+static long lcdPrintStep(void* context) {
+    LcdPrintJob& job = printQueue[printQueueHead];
+
+    if (job.index == 0 && !job.clearing && job.col != LCD_KEEP_CURSOR) {
+        job.lcd->setCursor(job.col, job.row);
+    }
+
+    if (job.index < job.length) {
+        job.lcd->print(job.text[job.index]);
+        job.index++;
+        if (job.index < job.length) {
+            return job.index >= job.slowFrom ? job.delayTimeEndChar : job.delayTimeBetweenChar;
+        }
+        // Last character printed, wait before clearing the display if requested
+        if (job.clearDisplay) {
+            job.clearing = true;
+            return job.delayBeforeClear;
         }
-        lcd.clear();
+    } else if (job.clearing) {
+        job.lcd->clear();
     }
-}
\ No newline at end of file
+
+    // Move on to the next message in the queue
+    printQueueHead = (printQueueHead + 1) % LCD_PRINT_QUEUE_SIZE;
+    printQueueLength--;
+    if (printQueueLength == 0) {
+        printTask = NO_TASK;
+        return TASK_DONE;
+    }
+    return 0;
+}
@@ -2,6 +2,11 @@
 #define LCD_DISPLAY_H
 
 #include <LiquidCrystal_I2C.h>
+#include "cooperative_scheduler.h"
+
+#define LCD_PRINT_QUEUE_SIZE 4
+#define LCD_PRINT_MAX_LENGTH 20 // longest lcdPrettyPrintAsync() message, one full line of the 20x4 display
+#define LCD_KEEP_CURSOR 0xFF    // print wherever the cursor currently is
 
 extern LiquidCrystal_I2C lcd;
 
@@ -12,4 +17,7 @@ void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDispl
 void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar);
 void lcdPrettyPrint(String dataPrintout, LiquidCrystal_I2C &lcd, bool clearDisplay, int delayBeforeClear, int delayTimeBetweenChar, int delayTimeEndChar);
 
-#endif // LCD_DISPLAY_H
\ No newline at end of file
+bool lcdPrettyPrintAsync(uint8_t col, uint8_t row, const char* dataPrintout, bool clearDisplay = false, int delayBeforeClear = 1500, int delayTimeBetweenChar = 50, int delayTimeEndChar = 250);
+bool lcdPrettyPrintBusy();
+
+#endif // LCD_DISPLAY_H
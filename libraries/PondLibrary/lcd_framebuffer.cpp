@@ -0,0 +1,145 @@
+#include "lcd_framebuffer.h"
+
+LcdFramebuffer::LcdFramebuffer(LiquidCrystal_I2C& lcd)
+  : lcd(lcd), cursorCol(0), cursorRow(0), fullRedraw(true), refreshInterval(LCD_REFRESH_INTERVAL), task(NO_TASK) {
+  clear();
+  memset(shown, ' ', sizeof(shown));
+}
+
+/**
+ * Start writing the changed cells to the display every refreshInterval ms.
+ * The display contents are unknown at this point (e.g. after lcdPrettyPrint()), so the first refresh redraws everything.
+ */
+void LcdFramebuffer::begin(unsigned long refreshInterval) {
+  this->refreshInterval = refreshInterval;
+  invalidate();
+  if (!scheduler.isScheduled(task)) {
+    task = scheduler.schedule(refreshTask, this, 0);
+  }
+}
+
+/**
+ * Stop refreshing the display, e.g. to hand the display back to lcdPrettyPrint().
+ */
+void LcdFramebuffer::end() {
+  scheduler.cancel(task);
+  task = NO_TASK;
+}
+
+/**
+ * Fill the shadow buffer with spaces and move the cursor home.
+ */
+void LcdFramebuffer::clear() {
+  memset(shadow, ' ', sizeof(shadow));
+  cursorCol = 0;
+  cursorRow = 0;
+}
+
+void LcdFramebuffer::setCursor(uint8_t col, uint8_t row) {
+  cursorCol = col;
+  cursorRow = row;
+}
+
+/**
+ * Put a character in the shadow buffer at the cursor. Characters past the end of the row are dropped.
+ */
+size_t LcdFramebuffer::write(uint8_t c) {
+  if (cursorRow >= LCD_ROWS || cursorCol >= LCD_COLS) {
+    return 0;
+  }
+  shadow[cursorRow][cursorCol++] = c;
+  return 1;
+}
+
+/**
+ * Draw "<label><value><unit>" at the field's position, padded with spaces to the field width.
+ * NaN and infinity (a failed reading) are drawn as "--", and values are clamped to
+ * +/-LCD_FIELD_MAX_VALUE with at most LCD_FIELD_MAX_DECIMALS decimals, as dtostrf() doesn't bound its output.
+ */
+void LcdFramebuffer::printField(const LcdField& field, float value) {
+  if (isnan(value) || isinf(value)) {
+    printField(field, "--");
+    return;
+  }
+  char text[LCD_COLS + 1];
+  value = constrain(value, -LCD_FIELD_MAX_VALUE, LCD_FIELD_MAX_VALUE);
+  dtostrf(value, 1, min(field.decimals, (uint8_t)LCD_FIELD_MAX_DECIMALS), text);
+  printField(field, text);
+}
+
+/**
+ * Draw "<label><text><unit>" at the field's position, padded with spaces to the field width.
+ */
+void LcdFramebuffer::printField(const LcdField& field, const char* text) {
+  setCursor(field.col, field.row);
+  uint8_t end = field.col + field.width;
+  if (end > LCD_COLS) {
+    end = LCD_COLS;
+  }
+  const char* parts[3] = {field.label, text, field.unit};
+  for (int i = 0; i < 3; i++) {
+    for (const char* p = parts[i]; p != nullptr && *p != '\0' && cursorCol < end; p++) {
+      write(*p);
+    }
+  }
+  while (cursorCol < end) {
+    write(' ');
+  }
+}
+
+/**
+ * Write the cells that differ from what is on the display. Changed cells separated by up to
+ * LCD_RUN_MERGE_GAP unchanged cells are sent as one run, since a setCursor() costs as much as a character.
+ * @return true if anything was written
+ */
+bool LcdFramebuffer::refresh() {
+  bool wrote = false;
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    uint8_t col = 0;
+    while (col < LCD_COLS) {
+      if (!fullRedraw && shadow[row][col] == shown[row][col]) {
+        col++;
+        continue;
+      }
+
+      // Extend the run while there are changed cells within the merge gap
+      uint8_t runEnd = col + 1;
+      uint8_t scan = runEnd;
+      while (scan < LCD_COLS && scan - runEnd <= LCD_RUN_MERGE_GAP) {
+        if (fullRedraw || shadow[row][scan] != shown[row][scan]) {
+          runEnd = scan + 1;
+        }
+        scan++;
+      }
+
+      lcd.setCursor(col, row);
+      bytesWritten++;
+      for (uint8_t i = col; i < runEnd; i++) {
+        lcd.write(shadow[row][i]);
+        shown[row][i] = shadow[row][i];
+      }
+      bytesWritten += runEnd - col;
+      wrote = true;
+      col = runEnd;
+    }
+  }
+  fullRedraw = false;
+  if (wrote) {
+    refreshes++;
+  }
+  return wrote;
+}
+
+/**
+ * Forget what is on the display so the next refresh() redraws every cell.
+ * Call after anything else has written to or cleared the display.
+ */
+void LcdFramebuffer::invalidate() {
+  fullRedraw = true;
+}
+
+long LcdFramebuffer::refreshTask(void* context) {
+  LcdFramebuffer* framebuffer = static_cast<LcdFramebuffer*>(context);
+  framebuffer->refresh();
+  return framebuffer->refreshInterval;
+}
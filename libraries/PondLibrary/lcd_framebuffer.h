@@ -0,0 +1,69 @@
+#ifndef LCD_FRAMEBUFFER_H
+#define LCD_FRAMEBUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+#include "cooperative_scheduler.h"
+
+#define LCD_COLS 20
+#define LCD_ROWS 4
+#define LCD_REFRESH_INTERVAL 250 // ms between refreshes of the changed cells to the display
+#define LCD_RUN_MERGE_GAP 1    // unchanged cells between two changed runs that are rewritten rather than skipped with setCursor()
+#define LCD_FIELD_MAX_VALUE 99999.0f // larger values are shown as +/- this, so "-99999.9999" fits the text buffer
+#define LCD_FIELD_MAX_DECIMALS 4
+
+// A fixed position on the screen: "<label><value><unit>" padded with spaces to `width` cells
+struct LcdField {
+  uint8_t col;
+  uint8_t row;
+  uint8_t width;
+  const char* label;
+  uint8_t decimals;
+  const char* unit;
+};
+
+/**
+ * In-RAM shadow of the 20x4 LCD.
+ *
+ * Drawing (print(), printField(), ...) only touches the shadow buffer, so it costs no I2C time.
+ * refresh() compares the shadow with what is on the display and writes only the runs of cells that
+ * changed, one setCursor() per run. begin() runs refresh() on the cooperative scheduler every
+ * refreshInterval ms, which rate-limits the bus traffic however often the screen is redrawn.
+ *
+ * Custom characters 0-7 can be drawn as 8-15 (the HD44780 mirrors them), since 0 ends a C string.
+ */
+class LcdFramebuffer : public Print {
+  public:
+    LcdFramebuffer(LiquidCrystal_I2C& lcd);
+
+    void begin(unsigned long refreshInterval = LCD_REFRESH_INTERVAL);
+    void end();
+
+    void clear();
+    void setCursor(uint8_t col, uint8_t row);
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+    void printField(const LcdField& field, float value);
+    void printField(const LcdField& field, const char* text);
+
+    bool refresh();
+    void invalidate();
+
+    unsigned long bytesWritten = 0; // characters and cursor commands sent to the display
+    unsigned long refreshes = 0;    // refreshes that had something to write
+
+  private:
+    static long refreshTask(void* context);
+
+    LiquidCrystal_I2C& lcd;
+    char shadow[LCD_ROWS][LCD_COLS]; // what should be on the display
+    char shown[LCD_ROWS][LCD_COLS];  // what is on the display
+    uint8_t cursorCol;
+    uint8_t cursorRow;
+    bool fullRedraw; // the display contents are unknown, write every cell on the next refresh
+    unsigned long refreshInterval;
+    TaskHandle task;
+};
+
+#endif // LCD_FRAMEBUFFER_H
@@ -0,0 +1,51 @@
+#include "line_reader.h"
+
+LineReader::LineReader() {
+  reset();
+}
+
+/**
+ * Read the bytes that have arrived, up to the end of the current line.
+ * @return true if a complete line is available in line(); it stays valid until the next poll()
+ */
+bool LineReader::poll(Stream& input) {
+  if (complete) {
+    reset();
+  }
+
+  while (input.available() > 0) {
+    int c = input.read();
+    if (c < 0) {
+      break;
+    }
+    if (c == '\n') {
+      if (overflowed) {
+        overflows++;
+        reset();
+        continue;
+      }
+      while (length > 0 && isspace((unsigned char)buffer[length - 1])) {
+        length--;
+      }
+      buffer[length] = '\0';
+      complete = true;
+      return true;
+    }
+    if (length == 0 && isspace(c)) {
+      continue; // skip leading whitespace
+    }
+    if (length < LINE_READER_MAX_LENGTH) {
+      buffer[length++] = (char)c;
+    } else {
+      overflowed = true;
+    }
+  }
+  return false;
+}
+
+void LineReader::reset() {
+  buffer[0] = '\0';
+  length = 0;
+  complete = false;
+  overflowed = false;
+}
@@ -0,0 +1,31 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <Arduino.h>
+
+#define LINE_READER_MAX_LENGTH 64 // longest command line; longer lines are discarded
+
+/**
+ * Reads newline terminated text commands from a serial port into a fixed buffer.
+ * Unlike readStringUntil() it never allocates and never waits: poll() takes whatever bytes
+ * have arrived and returns true once a whole line is in. Leading and trailing whitespace
+ * (including the '\r' of "\r\n") is trimmed.
+ */
+class LineReader {
+  public:
+    LineReader();
+
+    bool poll(Stream& input);
+    const char* line() const { return buffer; }
+    void reset();
+
+    unsigned long overflows = 0; // lines discarded for being longer than LINE_READER_MAX_LENGTH
+
+  private:
+    char buffer[LINE_READER_MAX_LENGTH + 1];
+    uint8_t length;
+    bool complete;
+    bool overflowed;
+};
+
+#endif // LINE_READER_H
@@ -0,0 +1,114 @@
+#include "loop_profiler.h"
+
+#if defined(ARDUINO_ARCH_HOST) && !defined(ESP32)
+#include "host_sim.h"
+#elif !defined(ESP32)
+extern "C" char* sbrk(int incr);
+#endif
+
+LoopProfiler::LoopProfiler(const char* boardName, unsigned long reportInterval)
+  : boardName(boardName), reportInterval(reportInterval), lastReport(0), loopStart(0) {
+  reset();
+}
+
+/**
+ * Mark the start of a loop() iteration. Call as the first statement of loop().
+ */
+void LoopProfiler::beginLoop() {
+  loopStart = micros();
+}
+
+/**
+ * Mark the end of a loop() iteration, fold its latency into the running totals and
+ * print the report to Serial once every report interval.
+ * Call before every exit point of loop() (including early returns).
+ */
+void LoopProfiler::endLoop() {
+  unsigned long elapsed = micros() - loopStart;
+
+  loops++;
+  totalLoopMicros += elapsed;
+  if (elapsed < fastestLoop) {
+    fastestLoop = elapsed;
+  }
+  if (elapsed > slowestLoop) {
+    slowestLoop = elapsed;
+  }
+
+  int ram = freeRam();
+  if (ram < lowestFreeRam) {
+    lowestFreeRam = ram;
+  }
+
+  if (millis() - lastReport >= reportInterval) {
+    report(Serial);
+    reset();
+    lastReport = millis();
+  }
+}
+
+/**
+ * Record a message moved by the board (UART frame, BLE update, HTTP payload, etc.)
+ * @param bytes The number of bytes moved for this message
+ */
+void LoopProfiler::recordMessage(size_t bytes) {
+  messages++;
+  totalMessageBytes += bytes;
+  if (bytes > largestMessage) {
+    largestMessage = bytes;
+  }
+}
+
+/**
+ * Print a one line summary of the current profiling window.
+ * @param output Where to print the report (usually Serial)
+ */
+void LoopProfiler::report(Print& output) {
+  output.print(F("[profile] "));
+  output.print(boardName);
+  output.print(F(": loops="));
+  output.print(loops);
+  output.print(F(" avg="));
+  output.print(averageLoopMicros());
+  output.print(F("us min="));
+  output.print(minLoopMicros());
+  output.print(F("us max="));
+  output.print(slowestLoop);
+  output.print(F("us | msgs="));
+  output.print(messages);
+  output.print(F(" bytes="));
+  output.print(totalMessageBytes);
+  output.print(F(" avg="));
+  output.print(messages == 0 ? 0 : totalMessageBytes / messages);
+  output.print(F(" max="));
+  output.print((unsigned long)largestMessage);
+  output.print(F(" | free RAM min="));
+  output.print(lowestFreeRam);
+  output.print(F(" now="));
+  output.println(freeRam());
+}
+
+/**
+ * Clear all counters and start a new profiling window.
+ */
+void LoopProfiler::reset() {
+  loops = 0;
+  totalLoopMicros = 0;
+  fastestLoop = 0xFFFFFFFFUL;
+  slowestLoop = 0;
+  messages = 0;
+  totalMessageBytes = 0;
+  largestMessage = 0;
+  lowestFreeRam = 0x7FFFFFFF;
+}
+
+int freeRam() {
+#if defined(ESP32)
+  return ESP.getFreeHeap();
+#elif defined(ARDUINO_ARCH_HOST)
+  return hostFreeRam();
+#else
+  char top;
+  return &top - reinterpret_cast<char*>(sbrk(0));
+#endif
+}
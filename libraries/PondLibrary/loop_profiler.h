@@ -0,0 +1,100 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+// Default interval between profile reports (in milliseconds)
+#ifndef PROFILE_REPORT_INTERVAL
+#define PROFILE_REPORT_INTERVAL 60000
+#endif
+
+/**
+ * Lightweight on-target profiler for a sketch's loop().
+ * Tracks per-loop latency (min/avg/max), bytes moved per message and the lowest free RAM seen,
+ * and periodically prints a single summary line so regressions show up on the Serial monitor.
+ *
+ * Usage:
+ *   LoopProfiler profiler("Nano Central Hub");
+ *   void loop() {
+ *     profiler.beginLoop();
+ *     ...
+ *     profiler.recordMessage(bytesSent);
+ *     ...
+ *     profiler.endLoop(); // also prints the report once every report interval
+ *   }
+ */
+class LoopProfiler {
+  public:
+    LoopProfiler(const char* boardName, unsigned long reportInterval = PROFILE_REPORT_INTERVAL);
+
+    void beginLoop();
+    void endLoop();
+    void recordMessage(size_t bytes);
+
+    void report(Print& output);
+    void reset();
+
+    unsigned long loopCount() const { return loops; }
+    unsigned long minLoopMicros() const { return loops == 0 ? 0 : fastestLoop; }
+    unsigned long maxLoopMicros() const { return slowestLoop; }
+    unsigned long averageLoopMicros() const { return loops == 0 ? 0 : totalLoopMicros / loops; }
+    unsigned long messageCount() const { return messages; }
+    unsigned long messageBytes() const { return totalMessageBytes; }
+    int minFreeRam() const { return lowestFreeRam; }
+
+  private:
+    const char* boardName;
+    unsigned long reportInterval;
+    unsigned long lastReport;
+    unsigned long loopStart;
+
+    unsigned long loops;
+    unsigned long totalLoopMicros;
+    unsigned long fastestLoop;
+    unsigned long slowestLoop;
+
+    unsigned long messages;
+    unsigned long totalMessageBytes;
+    size_t largestMessage;
+
+    int lowestFreeRam;
+};
+
+/**
+ * Profiles one pass from here to the end of the enclosing scope, for a pass with several ways out:
+ * every return ends it, so none of them leaves the profiler waiting on an endLoop() that never comes.
+ *
+ *   void readStream() {
+ *     LoopProfileScope pass(profiler, PROFILE);
+ *     if (!Firebase.ready()) {
+ *       return; // still counted
+ *     }
+ *     ...
+ *   }
+ *
+ * Use one per pass, inside a function that doesn't begin/end the same profiler itself.
+ */
+class LoopProfileScope {
+  public:
+    LoopProfileScope(LoopProfiler& profiler, bool enabled = true) : profiler(enabled ? &profiler : nullptr) {
+      if (this->profiler != nullptr) {
+        this->profiler->beginLoop();
+      }
+    }
+    ~LoopProfileScope() {
+      if (profiler != nullptr) {
+        profiler->endLoop();
+      }
+    }
+
+    LoopProfileScope(const LoopProfileScope&) = delete;
+    LoopProfileScope& operator=(const LoopProfileScope&) = delete;
+
+  private:
+    LoopProfiler* profiler;
+};
+
+// Returns the number of bytes between the top of the heap and the stack (SAMD) or the free heap (ESP32)
+int freeRam();
+
+#endif // LOOP_PROFILER_H
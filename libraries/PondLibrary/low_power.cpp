@@ -0,0 +1,48 @@
+#include "low_power.h"
+
+IdleSleep::IdleSleep() : windowStart(0), asleepMicros(0) {
+}
+
+/**
+ * Sleep for `ms` milliseconds in the IDLE sleep mode (see low_power.h).
+ */
+void IdleSleep::sleep(unsigned long ms) {
+  if (ms == 0) {
+    return;
+  }
+  sleeps++;
+  unsigned long start = micros();
+  unsigned long startMs = millis();
+#if defined(ARDUINO_ARCH_SAMD)
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  PM->SLEEP.reg = PM_SLEEP_IDLE_CPU;
+  while (millis() - startMs < ms) {
+    __DSB();
+    __WFI();
+  }
+#else
+  while (millis() - startMs < ms) {
+    yield();
+  }
+#endif
+  asleepMicros += micros() - start;
+}
+
+/**
+ * @return The share of the time since startWindow() the CPU was awake (0 to 1)
+ */
+float IdleSleep::dutyCycle() const {
+  unsigned long elapsed = micros() - windowStart;
+  if (elapsed == 0) {
+    return 1;
+  }
+  return 1.0f - (float)min(asleepMicros, elapsed) / elapsed;
+}
+
+/**
+ * Start a new duty cycle window, e.g. after reporting the last one.
+ */
+void IdleSleep::startWindow() {
+  windowStart = micros();
+  asleepMicros = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include <Arduino.h>
+
+/*
+  Sleep between loop() passes, and the share of time the CPU was awake (its duty cycle).
+
+  On the SAMD21 the CPU is halted with WFI in the IDLE sleep mode: only the CPU clock stops, so millis(),
+  the ADC sampler, the LCD's I2C, the UART to the NINA BLE module and their interrupts keep running, and
+  any interrupt wakes it (at the latest the 1ms SysTick, after which it goes back to sleep until the time
+  is up). STANDBY (what Adafruit_SleepyDog's Watchdog.sleep() uses) would save more, but it stops the SysTick
+  behind millis() and the BLE module's UART, so the board would miss BLE events.
+  Sleeps are short (the caller bounds them), so the 8 second watchdog is still kicked every pass of loop().
+  On other boards sleep() just waits.
+*/
+class IdleSleep {
+  public:
+    IdleSleep();
+
+    void sleep(unsigned long ms);
+
+    float dutyCycle() const;
+    void startWindow();
+
+    unsigned long sleeps = 0;
+
+  private:
+    unsigned long windowStart;  // micros() the duty cycle window started at
+    unsigned long asleepMicros; // time asleep in the window
+};
+
+#endif // LOW_POWER_H
@@ -0,0 +1,243 @@
+#include "memory_monitor.h"
+#include "loop_profiler.h"
+
+#if defined(ESP32)
+#include <esp_heap_caps.h>
+#elif defined(ARDUINO_ARCH_HOST)
+#include "host_sim.h"
+#else
+#include <malloc.h>
+extern "C" char* sbrk(int incr);
+extern "C" char __StackTop; // end of RAM, where the main stack starts (from the linker script)
+#endif
+
+MemoryMonitor memoryMonitor;
+
+volatile uint32_t memoryAllocations = 0;
+volatile uint32_t memoryFrees = 0;
+
+#if MEMORY_MONITOR_WRAP_MALLOC
+extern "C" {
+  void* __real_malloc(size_t size);
+  void __real_free(void* ptr);
+  void* __real_realloc(void* ptr, size_t size);
+  void* __real_calloc(size_t count, size_t size);
+
+  void* __wrap_malloc(size_t size) {
+    memoryAllocations++;
+    return __real_malloc(size);
+  }
+
+  void __wrap_free(void* ptr) {
+    if (ptr != nullptr) {
+      memoryFrees++;
+    }
+    __real_free(ptr);
+  }
+
+  void* __wrap_realloc(void* ptr, size_t size) {
+    memoryAllocations++;
+    return __real_realloc(ptr, size);
+  }
+
+  void* __wrap_calloc(size_t count, size_t size) {
+    memoryAllocations++;
+    return __real_calloc(count, size);
+  }
+}
+#endif
+
+// Base of the last stack window painted by paintStackWindow(), 0 before the first one
+static uintptr_t stackWindowBase = 0;
+
+#if !defined(ESP32)
+// Lowest address the stack has painted, i.e. the bytes below it are still unused
+static uint8_t* paintedStackBottom = nullptr;
+
+#if defined(ARDUINO_ARCH_HOST)
+// The simulated board's RAM is the HOST_RAM_SIZE bytes below main()'s frame, with the heap's growth at the bottom
+static char* heapTop() {
+  return hostStackTop() - HOST_RAM_SIZE + hostHeapInUse();
+}
+
+static char* stackTop() {
+  return hostStackTop();
+}
+#else
+static char* heapTop() {
+  return sbrk(0);
+}
+
+static char* stackTop() {
+  return &__StackTop;
+}
+#endif
+#endif
+
+MemoryMonitor::MemoryMonitor()
+  : lowestFreeRam(0x7FFFFFFF), steadyAllocations(0), steadyHeapInUse(0), steady(false) {
+}
+
+/**
+ * Paint the unused RAM between the heap and the stack. Call first thing in setup(), before any
+ * large allocations, so the high-watermark covers the whole run.
+ */
+void MemoryMonitor::begin() {
+#if !defined(ESP32)
+  uintptr_t paintFrom = reinterpret_cast<uintptr_t>(heapTop()) + STACK_PAINT_MARGIN;
+  uintptr_t stackNow = reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) - STACK_PAINT_MARGIN;
+  if (stackNow > paintFrom) {
+    memset(reinterpret_cast<void*>(paintFrom), STACK_PAINT_VALUE, stackNow - paintFrom);
+    paintedStackBottom = reinterpret_cast<uint8_t*>(paintFrom);
+  }
+#endif
+  update();
+}
+
+/**
+ * Track the minimum free RAM. Call from every pass of loop() (it's cheap).
+ */
+void MemoryMonitor::update() {
+  int ram = freeRam();
+  if (ram < lowestFreeRam) {
+    lowestFreeRam = ram;
+  }
+}
+
+/**
+ * Record the allocation count and heap usage as the steady state baseline. Call at the end of setup().
+ */
+void MemoryMonitor::markSteadyState() {
+  MemoryStats now = stats();
+  steadyAllocations = now.allocations;
+  steadyHeapInUse = now.heapInUse;
+  steady = true;
+}
+
+/**
+ * @return Allocations since markSteadyState() (or, without wrapped malloc, 1 if the heap has grown since)
+ */
+uint32_t MemoryMonitor::steadyStateAllocations() const {
+  if (!steady) {
+    return 0;
+  }
+  MemoryStats now = stats();
+  if (allocationsTracked()) {
+    return now.allocations - steadyAllocations;
+  }
+  return now.heapInUse > steadyHeapInUse ? 1 : 0;
+}
+
+/**
+ * @return The most stack the main loop has used since begin(), in bytes
+ */
+size_t MemoryMonitor::stackHighWater() const {
+#if defined(ESP32)
+  return 0; // FreeRTOS tasks report their own high-watermark (uxTaskGetStackHighWaterMark)
+#else
+  if (paintedStackBottom == nullptr) {
+    return 0;
+  }
+  // The heap may have grown into the painted area; only look above its current top
+  uint8_t* p = paintedStackBottom;
+  uint8_t* heap = reinterpret_cast<uint8_t*>(heapTop());
+  if (p < heap) {
+    p = heap;
+  }
+  uint8_t* stackNow = static_cast<uint8_t*>(__builtin_frame_address(0));
+  while (p < stackNow && *p == STACK_PAINT_VALUE) {
+    p++;
+  }
+  return stackTop() - reinterpret_cast<char*>(p);
+#endif
+}
+
+MemoryStats MemoryMonitor::stats() const {
+  MemoryStats s;
+  s.allocations = memoryAllocations;
+  s.frees = memoryFrees;
+#if defined(ESP32)
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  s.heapInUse = info.total_allocated_bytes;
+  s.heapFree = info.total_free_bytes;
+  s.heapFreeBlocks = info.free_blocks;
+  s.minFreeRam = info.minimum_free_bytes;
+#else
+#if defined(ARDUINO_ARCH_HOST)
+  s.heapInUse = hostHeapInUse();
+  s.heapFree = hostHeapFree();
+  s.heapFreeBlocks = hostHeapFreeBlocks();
+#else
+  struct mallinfo info = mallinfo();
+  s.heapInUse = info.uordblks;
+  s.heapFree = info.fordblks;
+  s.heapFreeBlocks = info.ordblks;
+#endif
+  s.minFreeRam = lowestFreeRam;
+  // The painted area shows how close the stack came to the heap, even between update() calls
+  size_t stackUsed = stackHighWater();
+  if (stackUsed > 0) {
+    int gap = (stackTop() - stackUsed) - heapTop();
+    if (gap < s.minFreeRam) {
+      s.minFreeRam = gap;
+    }
+  }
+#endif
+  s.freeRam = freeRam();
+  s.stackHighWater = stackHighWater();
+  return s;
+}
+
+/**
+ * Print e.g. "[memory] allocs=12 frees=10 steady=0 | heap used=2048 free=96 (3 blocks) | RAM free=9120 min=8704 | stack max=1380"
+ */
+void MemoryMonitor::printTo(Print& out) const {
+  MemoryStats s = stats();
+  out.print(F("[memory] "));
+  if (allocationsTracked()) {
+    out.print(F("allocs="));
+    out.print(s.allocations);
+    out.print(F(" frees="));
+    out.print(s.frees);
+    out.print(' ');
+  }
+  out.print(F("steady="));
+  out.print(steadyStateAllocations());
+  out.print(F(" | heap used="));
+  out.print((unsigned long)s.heapInUse);
+  out.print(F(" free="));
+  out.print((unsigned long)s.heapFree);
+  out.print(F(" ("));
+  out.print((unsigned long)s.heapFreeBlocks);
+  out.print(F(" blocks) | RAM free="));
+  out.print(s.freeRam);
+  out.print(F(" min="));
+  out.print(s.minFreeRam);
+  out.print(F(" | stack max="));
+  out.println((unsigned long)s.stackHighWater);
+}
+
+/**
+ * Paint `bytes` of stack below the caller's frame. Call right before the code to measure.
+ */
+void __attribute__((noinline)) paintStackWindow(size_t bytes) {
+  stackWindowBase = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+  memset(reinterpret_cast<void*>(stackWindowBase - bytes), STACK_PAINT_VALUE, bytes - STACK_PAINT_MARGIN);
+}
+
+/**
+ * @return How much of the window painted by the last paintStackWindow(bytes) has been used since;
+ *         `bytes` means the window may have overflowed. Interrupts that fired in between count too.
+ */
+size_t measureStackWindow(size_t bytes) {
+  if (stackWindowBase == 0) {
+    return 0;
+  }
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(stackWindowBase - bytes);
+  const uint8_t* end = reinterpret_cast<const uint8_t*>(stackWindowBase - STACK_PAINT_MARGIN);
+  while (p < end && *p == STACK_PAINT_VALUE) {
+    p++;
+  }
+  return p == end ? 0 : stackWindowBase - reinterpret_cast<uintptr_t>(p);
+}
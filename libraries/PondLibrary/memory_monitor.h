@@ -0,0 +1,83 @@
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+
+#define STACK_PAINT_VALUE 0xA5
+#define STACK_PAINT_MARGIN 64 // bytes left unpainted next to the heap and the live stack
+
+/*
+  Counting malloc/free calls
+
+  The allocation counters are only updated when the sketch is linked with malloc wrapped, by
+  adding these lines to the core's platform.local.txt:
+
+    compiler.cpp.extra_flags=-DMEMORY_MONITOR_WRAP_MALLOC=1
+    compiler.c.elf.extra_flags=-Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc
+
+  Without it the monitor still reports heap usage and fragmentation (mallinfo), free RAM and
+  stack high-watermarks, and steady state allocations show up as heap growth instead.
+*/
+#ifndef MEMORY_MONITOR_WRAP_MALLOC
+#define MEMORY_MONITOR_WRAP_MALLOC 0
+#endif
+
+// Heap and stack usage at one point in time
+struct MemoryStats {
+  uint32_t allocations = 0;  // malloc/calloc/realloc calls since boot (wrapped malloc only)
+  uint32_t frees = 0;        // free calls since boot (wrapped malloc only)
+  size_t heapInUse = 0;      // bytes in allocated heap blocks
+  size_t heapFree = 0;       // free bytes inside the heap (holes left by freed blocks)
+  size_t heapFreeBlocks = 0; // number of free heap blocks; many small ones means a fragmented heap
+  int freeRam = 0;           // bytes between the top of the heap and the stack (SAMD) or free heap (ESP32)
+  int minFreeRam = 0;        // lowest freeRam seen (including the deepest the stack ever reached)
+  size_t stackHighWater = 0; // most stack the main loop has ever used
+};
+
+/**
+ * Runtime view of the board's memory: malloc/free counts, heap fragmentation, the stack
+ * high-watermark found by stack painting and the minimum free RAM ever seen.
+ *
+ * Stack painting: begin() fills the unused RAM between the heap and the stack with
+ * STACK_PAINT_VALUE. The stack overwrites the pattern as it grows, so the lowest overwritten byte
+ * marks the deepest the stack has ever been. The cooperative scheduler uses the same trick on a
+ * window below the stack pointer to measure each task (see CooperativeScheduler::trackStack()).
+ *
+ * markSteadyState() records the allocation count (and heap usage) once setup is done; after that
+ * the ingest -> upload cycle is expected not to allocate, and steadyStateAllocations() says
+ * whether it did.
+ */
+class MemoryMonitor {
+  public:
+    MemoryMonitor();
+
+    void begin();
+    void update();
+    void markSteadyState();
+
+    MemoryStats stats() const;
+    size_t stackHighWater() const;
+    uint32_t steadyStateAllocations() const;
+    bool allocationsTracked() const { return MEMORY_MONITOR_WRAP_MALLOC != 0; }
+
+    void printTo(Print& out) const;
+
+  private:
+    int lowestFreeRam;
+    uint32_t steadyAllocations;
+    size_t steadyHeapInUse;
+    bool steady;
+};
+
+// Shared monitor; call memoryMonitor.begin() at the start of setup()
+extern MemoryMonitor memoryMonitor;
+
+// Paint / measure a window of `bytes` just below the caller's stack frame (used to measure one function call)
+void paintStackWindow(size_t bytes);
+size_t measureStackWindow(size_t bytes);
+
+// Counters updated by the malloc wrappers
+extern volatile uint32_t memoryAllocations;
+extern volatile uint32_t memoryFrees;
+
+#endif // MEMORY_MONITOR_H
@@ -0,0 +1,104 @@
+#include "metrics_writer.h"
+
+/**
+ * Start a metric family with its HELP and TYPE lines, before its samples.
+ * @param type "counter", "gauge" or "histogram"
+ */
+void MetricsWriter::family(const char* name, const char* type, const char* help) {
+  print(F("# HELP "));
+  print(name);
+  print(' ');
+  print(help);
+  write('\n');
+  print(F("# TYPE "));
+  print(name);
+  print(' ');
+  print(type);
+  write('\n');
+}
+
+/**
+ * Write one sample, e.g. `pond_ble_rssi_dbm{device="1"} -67`.
+ * @param labels Formatted labels without the braces, or nullptr for none
+ */
+void MetricsWriter::sample(const char* name, const char* labels, unsigned long value) {
+  sampleName(name, nullptr, labels);
+  print(value);
+  write('\n');
+}
+
+void MetricsWriter::sample(const char* name, const char* labels, float value, uint8_t decimals) {
+  sampleName(name, nullptr, labels);
+  print(value, decimals);
+  write('\n');
+}
+
+/**
+ * Write a latency histogram as cumulative `_bucket` samples plus `_sum` and `_count`. Bucket bounds
+ * are the histogram's (exclusive) upper bounds in seconds, its last bucket is "+Inf".
+ */
+void MetricsWriter::histogram(const char* name, const char* labels, const LatencyHistogram& latency) {
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    cumulative += latency.bucket(i);
+    print(name);
+    print(F("_bucket{"));
+    if (labels != nullptr) {
+      print(labels);
+      print(',');
+    }
+    print(F("le=\""));
+    if (i < LATENCY_HISTOGRAM_BUCKETS - 1) {
+      print(LatencyHistogram::bucketUpperBound(i) / 1000.0, 3);
+    } else {
+      print(F("+Inf"));
+    }
+    print(F("\"} "));
+    print((unsigned long)cumulative);
+    write('\n');
+  }
+  sampleName(name, "_sum", labels);
+  print(latency.sum() / 1000.0, 3);
+  write('\n');
+  sampleName(name, "_count", labels);
+  print((unsigned long)latency.count());
+  write('\n');
+}
+
+void MetricsWriter::sampleName(const char* name, const char* suffix, const char* labels) {
+  print(name);
+  if (suffix != nullptr) {
+    print(suffix);
+  }
+  if (labels != nullptr) {
+    print('{');
+    print(labels);
+    print('}');
+  }
+  print(' ');
+}
+
+size_t MetricsWriter::write(uint8_t byte) {
+  if (used == sizeof(buffer)) {
+    flush();
+  }
+  buffer[used++] = byte;
+  return 1;
+}
+
+size_t MetricsWriter::write(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    write(data[i]);
+  }
+  return length;
+}
+
+/**
+ * Write out whatever is buffered.
+ */
+void MetricsWriter::flush() {
+  if (used > 0) {
+    out.write(buffer, used);
+    used = 0;
+  }
+}
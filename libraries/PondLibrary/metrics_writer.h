@@ -0,0 +1,48 @@
+#ifndef METRICS_WRITER_H
+#define METRICS_WRITER_H
+
+#include <Arduino.h>
+#include "latency_histogram.h"
+
+#define METRICS_WRITER_BUFFER 256 // bytes collected before they're written on, one Ethernet packet each
+
+/*
+  Writes metrics in the Prometheus text exposition format (version 0.0.4), e.g.
+
+    # HELP pond_uart_frames_total Frames received from the Nano.
+    # TYPE pond_uart_frames_total counter
+    pond_uart_frames_total 1234
+    pond_ble_connected{device="0"} 1
+
+  Lines end in '\n' only, println()'s "\r\n" isn't valid in the format. Output is collected in a small
+  buffer so a response to an EthernetClient goes out in a few packets instead of one per print().
+  Call flush() when done.
+
+  Labels are passed already formatted, e.g. `stage="ble"`. Latencies are recorded in ms but written
+  in seconds, as Prometheus expects.
+*/
+
+class MetricsWriter : public Print {
+  public:
+    MetricsWriter(Print& out) : out(out) {}
+
+    void family(const char* name, const char* type, const char* help);
+    void sample(const char* name, const char* labels, unsigned long value);
+    void sample(const char* name, const char* labels, float value, uint8_t decimals = 3);
+    void histogram(const char* name, const char* labels, const LatencyHistogram& latency);
+
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t* data, size_t length) override;
+    void flush() override;
+
+    using Print::write;
+
+  private:
+    void sampleName(const char* name, const char* suffix, const char* labels);
+
+    Print& out;
+    uint8_t buffer[METRICS_WRITER_BUFFER];
+    size_t used = 0;
+};
+
+#endif // METRICS_WRITER_H
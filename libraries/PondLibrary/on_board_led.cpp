@@ -1,3 +1,8 @@
+// The RGB LED is driven through the NINA-W102 module, which only exists on the SAMD (MKR/Nano 33 IoT) boards.
+// Guarded so sketches on other architectures (e.g. the ESP32) can still share PondLibrary; the host build
+// simulates the module for the SAMD sketches (see host/hal/utility/wifi_drv.h).
+#if defined(ARDUINO_ARCH_SAMD) || (defined(ARDUINO_ARCH_HOST) && !defined(ESP32))
+
 #include "on_board_led.h"
 
 // Global variables to store the current LED color and intensity
@@ -6,6 +11,23 @@ int currentGreen = 0;
 int currentBlue = 0;
 int currentIntensity = 0;
 
+// State of the fade animation running on the LED (there is only one LED, so only one fade at a time)
+struct LedFade {
+  int red, green, blue, intensity; // final color once the fade is done
+  const int* colorCode;            // set when fading a color code, in which case only the intensity fades
+  float stepR, stepG, stepB, stepI;
+  int numSteps;
+  int step;
+  bool fadingIn;
+};
+static LedFade ledFade;
+static TaskHandle ledFadeTask = NO_TASK;
+
+static void writeOnBoardLEDColor(int red, int green, int blue, int intensity);
+static void writeLedColorForCode(const int* colorCode, int intensity);
+static void startLedFade(int fadeDuration);
+static long ledFadeStep(void* context);
+
 /**
  * Get the RGB color and brightness of the on-board LED of the MKR WiFi 1010
  * @param red The red intensity of the LED (0-255)
@@ -23,12 +45,18 @@ void getOnBoardLEDColor(int* red, int* green, int* blue, int* intensity) {
 
 /**
 * Set the RGB color and brightness of the on-board LED of the MKR WiFi 1010
+* Stops any fade that is currently running.
 * @param red The red intensity of the LED (0-255)
 * @param green The green intensity of the LED (0-255)
 * @param blue The blue intensity of the LED (0-255)
 * @param intensity The brightness of the LED (0-255)
 */
 void setOnBoardLEDColor(int red, int green, int blue, int intensity) {
+  scheduler.cancel(ledFadeTask);
+  writeOnBoardLEDColor(red, green, blue, intensity);
+}
+
+static void writeOnBoardLEDColor(int red, int green, int blue, int intensity) {
   // Ensure the input values are within the valid range
   currentRed = constrain(red, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
   currentGreen = constrain(green, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
@@ -44,6 +72,8 @@ void setOnBoardLEDColor(int red, int green, int blue, int intensity) {
 /**
 * Fade the on-board LED of the MKR WiFi 1010 to show user an operation is in progress
 * red, green, blue, and intensity params are same as setLedColor()
+* The fade runs on the cooperative scheduler and this function returns immediately;
+* the LED ends on the given color once the fade is done (scheduler.run() must be called from loop()).
 * @param red The red intensity of the LED (0-255)
 * @param green The green intensity of the LED (0-255)
 * @param blue The blue intensity of the LED (0-255)
@@ -52,46 +82,27 @@ void setOnBoardLEDColor(int red, int green, int blue, int intensity) {
 */
 void fadeOnBoardLedColor(int red, int green, int blue, int intensity, int fadeDuration) {
   // Ensure the input values are within the valid range
-  red = constrain(red, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
-  green = constrain(green, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
-  blue = constrain(blue, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
-  intensity = constrain(intensity, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
-
-  // Determine the number of steps for the fade effect
-  int numSteps = fadeDuration / 10;
-  if (numSteps < 1) {
-    numSteps = 1;
-  }
-
-  // Calculate the step size for each color component
-  float stepR = ((float)(red - LED_INTENSITY_MIN) / numSteps);
-  float stepG = ((float)(green - LED_INTENSITY_MIN) / numSteps);
-  float stepB = ((float)(blue - LED_INTENSITY_MIN) / numSteps);
-  float stepI = ((float)(intensity - LED_INTENSITY_MIN) / numSteps);
-
-  // Fade the LED color in
-  for (int i = 0; i < numSteps; i++) {
-    setOnBoardLEDColor((int)(i * stepR), (int)(i * stepG), (int)(i * stepB), (int)(i * stepI));
-    delay(10);
-  }
-
-  // Fade the LED color out
-  for (int i = numSteps; i > 0; i--) {
-    setOnBoardLEDColor((int)((i - 1) * stepR), (int)((i - 1) * stepG), (int)((i - 1) * stepB), (int)((i - 1) * stepI));
-    delay(10);
-  }
-
-  // Set the final LED color and intensity
-  setOnBoardLEDColor(red, green, blue, intensity);
+  ledFade.red = constrain(red, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+  ledFade.green = constrain(green, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+  ledFade.blue = constrain(blue, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+  ledFade.intensity = constrain(intensity, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+  ledFade.colorCode = nullptr;
+  startLedFade(fadeDuration);
 }
 
 /**
 * Set the RGB color and brightness of the on-board LED of the MKR WiFi 1010 based on a color code
 * set in the config.h file
+* Stops any fade that is currently running.
 * @param colorCode The color code to set the LED to (see config.h)
 * @param intensity The brightness of the LED (0-255)
 */
 void setLedColorForCode(const int* colorCode, int intensity) {
+    scheduler.cancel(ledFadeTask);
+    writeLedColorForCode(colorCode, intensity);
+}
+
+static void writeLedColorForCode(const int* colorCode, int intensity) {
     intensity = constrain(intensity, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
 
     WiFiDrv::analogWrite(LED_RED, colorCode[0] * intensity / LED_INTENSITY_MAX);
@@ -102,39 +113,77 @@ void setLedColorForCode(const int* colorCode, int intensity) {
 /**
 * Fade the on-board LED of the MKR WiFi 1010 to show user an operation is in progress
 * colorCode and intensity params are same as setLedColorForCode()
+* Runs on the cooperative scheduler and returns immediately, like fadeOnBoardLedColor().
 * @param colorCode The color code to set the LED to (see config.h)
 * @param intensity The brightness of the LED (0-255)
 * @param duration The duration of the fade in milliseconds
 */
 void fadeOnBoardLedColorForCode(const int* colorCode, int intensity, int fadeDuration) {
+    ledFade.colorCode = colorCode;
+    ledFade.red = colorCode[0];
+    ledFade.green = colorCode[1];
+    ledFade.blue = colorCode[2];
     // Ensure the input values are within the valid range
-    intensity = constrain(intensity, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+    ledFade.intensity = constrain(intensity, LED_INTENSITY_MIN, LED_INTENSITY_MAX);
+    startLedFade(fadeDuration);
+}
 
-    // Determine the number of steps for the fade effect
-    int numSteps = fadeDuration / 10;
-    if (numSteps < 1) {
-        numSteps = 1;
-    }
+/**
+* @return true while a fade started by one of the fade functions is still running
+*/
+bool isOnBoardLedFading() {
+  return scheduler.isScheduled(ledFadeTask);
+}
 
-    // Calculate the step size for each color component
-    float stepR = ((float)(colorCode[0] - LED_INTENSITY_MIN) / numSteps);
-    float stepG = ((float)(colorCode[1] - LED_INTENSITY_MIN) / numSteps);
-    float stepB = ((float)(colorCode[2] - LED_INTENSITY_MIN) / numSteps);
-    float stepI = ((float)(intensity - LED_INTENSITY_MIN) / numSteps);
+static void startLedFade(int fadeDuration) {
+  scheduler.cancel(ledFadeTask);
 
-    // Fade the LED color in
-    for (int i = 0; i < numSteps; i++) {
-        setLedColorForCode(colorCode, (int)(i * stepI));
-        delay(10);
-    }
+  // Determine the number of 10ms steps for the fade effect
+  ledFade.numSteps = fadeDuration / 10;
+  if (ledFade.numSteps < 1) {
+    ledFade.numSteps = 1;
+  }
 
-    // Fade the LED color out
-    for (int i = numSteps; i > 0; i--) {
-        setLedColorForCode(colorCode, (int)((i - 1) * stepI));
-        delay(10);
-    }
+  // Calculate the step size for each color component
+  ledFade.stepR = ((float)(ledFade.red - LED_INTENSITY_MIN) / ledFade.numSteps);
+  ledFade.stepG = ((float)(ledFade.green - LED_INTENSITY_MIN) / ledFade.numSteps);
+  ledFade.stepB = ((float)(ledFade.blue - LED_INTENSITY_MIN) / ledFade.numSteps);
+  ledFade.stepI = ((float)(ledFade.intensity - LED_INTENSITY_MIN) / ledFade.numSteps);
+
+  ledFade.step = 0;
+  ledFade.fadingIn = true;
+  ledFadeTask = scheduler.schedule(ledFadeStep, &ledFade, 0);
+}
 
+// Resumable fade animation: one 10ms step per call, fading in, then out, then setting the final color
+static long ledFadeStep(void* context) {
+  LedFade& fade = *static_cast<LedFade*>(context);
+
+  int level;
+  if (fade.fadingIn) {
+    level = fade.step++;
+    if (fade.step >= fade.numSteps) {
+      fade.fadingIn = false;
+    }
+  } else if (fade.step > 0) {
+    level = --fade.step;
+  } else {
     // Set the final LED color and intensity
-    setLedColorForCode(colorCode, intensity);
+    if (fade.colorCode != nullptr) {
+      writeLedColorForCode(fade.colorCode, fade.intensity);
+    } else {
+      writeOnBoardLEDColor(fade.red, fade.green, fade.blue, fade.intensity);
+    }
+    ledFadeTask = NO_TASK;
+    return TASK_DONE;
+  }
+
+  if (fade.colorCode != nullptr) {
+    writeLedColorForCode(fade.colorCode, (int)(level * fade.stepI));
+  } else {
+    writeOnBoardLEDColor((int)(level * fade.stepR), (int)(level * fade.stepG), (int)(level * fade.stepB), (int)(level * fade.stepI));
+  }
+  return 10;
 }
-   
\ No newline at end of file
+
+#endif // ARDUINO_ARCH_SAMD || ARDUINO_ARCH_HOST
@@ -2,6 +2,7 @@
 #define ON_BOARD_LED_H
 
 #include "config_codes.h"
+#include "cooperative_scheduler.h"
 #include <WiFiNINA.h>
 #include <utility/wifi_drv.h>
 
@@ -30,5 +31,6 @@ void setOnBoardLEDColor(int red, int green, int blue, int intensity);
 void fadeOnBoardLedColor(int red, int green, int blue, int intensity, int fadeDuration);
 void setLedColorForCode(const int* colorCode, int intensity);
 void fadeOnBoardLedColorForCode(const int* colorCode, int intensity, int fadeDuration);
+bool isOnBoardLedFading();
 
 #endif // ON_BOARD_LED_H
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef PATH_HASH_H
+#define PATH_HASH_H
+
+#include <stdint.h>
+
+#define PATH_HASH_OFFSET_BASIS 2166136261UL // FNV-1a 32 bit
+#define PATH_HASH_PRIME 16777619UL
+
+/**
+ * FNV-1a hash of a path, so an incoming path can be matched against a table of precomputed hashes
+ * with one pass over its characters instead of a string compare per entry. Hashes can collide,
+ * so confirm a match with a compare against the one entry it hit.
+ */
+inline uint32_t hashPath(const char* path) {
+  uint32_t hash = PATH_HASH_OFFSET_BASIS;
+  for (; *path != '\0'; path++) {
+    hash = (hash ^ (uint8_t)*path) * PATH_HASH_PRIME;
+  }
+  return hash;
+}
+
+#endif // PATH_HASH_H
@@ -0,0 +1,80 @@
+#include "pipeline_timing.h"
+
+/**
+ * Pack a stamp to follow the readings in a realtime frame.
+ * @param out Destination buffer, must hold at least PIPELINE_STAMP_SIZE bytes
+ * @return The number of bytes written (PIPELINE_STAMP_SIZE)
+ */
+size_t packPipelineStamp(const PipelineStamp& stamp, uint8_t* out) {
+  memcpy(out, &stamp.sampleSequence, sizeof(stamp.sampleSequence));
+  memcpy(out + 2, &stamp.readAge, sizeof(stamp.readAge));
+  memcpy(out + 4, &stamp.bleDelay, sizeof(stamp.bleDelay));
+  memcpy(out + 6, &stamp.nanoHold, sizeof(stamp.nanoHold));
+  memcpy(out + 8, &stamp.sentAt, sizeof(stamp.sentAt));
+  return PIPELINE_STAMP_SIZE;
+}
+
+/**
+ * Unpack a stamp written by packPipelineStamp().
+ * @return false if the stamp is the wrong size
+ */
+bool unpackPipelineStamp(const uint8_t* in, size_t length, PipelineStamp& stamp) {
+  if (length != PIPELINE_STAMP_SIZE) {
+    return false;
+  }
+  memcpy(&stamp.sampleSequence, in, sizeof(stamp.sampleSequence));
+  memcpy(&stamp.readAge, in + 2, sizeof(stamp.readAge));
+  memcpy(&stamp.bleDelay, in + 4, sizeof(stamp.bleDelay));
+  memcpy(&stamp.nanoHold, in + 6, sizeof(stamp.nanoHold));
+  memcpy(&stamp.sentAt, in + 8, sizeof(stamp.sentAt));
+  return true;
+}
+
+uint16_t pipelineTime(unsigned long ms) {
+  return ms < PIPELINE_TIME_UNKNOWN ? (uint16_t)ms : PIPELINE_TIME_UNKNOWN - 1;
+}
+
+OneWayDelay::OneWayDelay() {
+  reset();
+}
+
+/**
+ * Record a message that arrived at `now` (the receiver's millis()).
+ * @param sentAt The low 16 bits of the sender's millis() when it was sent
+ * @return ms the message took over the base delay
+ */
+uint16_t OneWayDelay::add(uint16_t sentAt, unsigned long now) {
+  uint16_t offset = (uint16_t)now - sentAt; // delay plus the clock offset, modulo 2^16
+  if (!haveBase) {
+    base = offset;
+    windowLowest = offset;
+    windowStart = now;
+    haveBase = true;
+  }
+
+  // Faster than the base: the link has never been this quick (or the clocks drifted), so it's the new base
+  int16_t overBase = (int16_t)(offset - base);
+  if (overBase < 0) {
+    base = offset;
+    overBase = 0;
+  }
+  if ((int16_t)(offset - windowLowest) < 0) {
+    windowLowest = offset;
+  }
+  if (now - windowStart >= ONE_WAY_DELAY_WINDOW) {
+    base = windowLowest;
+    windowLowest = offset;
+    windowStart = now;
+  }
+  return overBase;
+}
+
+/**
+ * Forget the base, e.g. when the link reconnects to a board that may have restarted.
+ */
+void OneWayDelay::reset() {
+  base = 0;
+  windowLowest = 0;
+  windowStart = 0;
+  haveBase = false;
+}
@@ -0,0 +1,67 @@
+#ifndef PIPELINE_TIMING_H
+#define PIPELINE_TIMING_H
+
+#include <Arduino.h>
+
+/*
+  Timing of one realtime sample on its way from the monitor to Firebase.
+
+  The three boards don't share a clock, so each hop is timed on the board it runs on and carried forward
+  as a duration: the monitor puts the age of its newest reading in the sensor packet (see sensor_packet.h),
+  the Nano appends a PipelineStamp to the realtime frame (see serial_frame.h) and the MKR adds its own
+  stages before aggregating them (see /metrics in the hub's main.ino).
+
+  PipelineStamp layout (little-endian, 10 bytes, after the packed SensorReadings of a realtime frame):
+    [sample sequence (uint16)][read age (uint16)][BLE delay (uint16)][Nano hold (uint16)][sent at (uint16)]
+
+  - sample sequence is the monitor's sensor packet sequence number
+  - read age is ms from the monitor's newest sensor read to its BLE notification
+  - BLE delay is ms the notification took over the link's base delay (see OneWayDelay)
+  - Nano hold is ms from the notification arriving at the Nano to the frame being written to the UART
+  - sent at is the low 16 bits of the Nano's millis() when the frame was written, for the MKR's OneWayDelay
+  - a duration of PIPELINE_TIME_UNKNOWN wasn't measured (e.g. the single value characteristics or fake data)
+*/
+
+#define PIPELINE_STAMP_SIZE 10
+#define PIPELINE_TIME_UNKNOWN 0xFFFF
+#define ONE_WAY_DELAY_WINDOW 300000 // 5 minutes, how long a base delay is kept before it's taken again
+
+struct PipelineStamp {
+  uint16_t sampleSequence = 0;
+  uint16_t readAge = PIPELINE_TIME_UNKNOWN;
+  uint16_t bleDelay = PIPELINE_TIME_UNKNOWN;
+  uint16_t nanoHold = PIPELINE_TIME_UNKNOWN;
+  uint16_t sentAt = 0;
+};
+
+size_t packPipelineStamp(const PipelineStamp& stamp, uint8_t* out);
+bool unpackPipelineStamp(const uint8_t* in, size_t length, PipelineStamp& stamp);
+
+// A duration in ms as a PipelineStamp field, saturated just below PIPELINE_TIME_UNKNOWN
+uint16_t pipelineTime(unsigned long ms);
+
+/**
+ * Delay of the messages over a link between two boards that don't share a clock.
+ *
+ * Each message carries the low 16 bits of the sender's millis(). The receiver's millis() minus that is
+ * the delay plus the unknown offset between the two clocks. The lowest of those seen is taken as the base
+ * (the offset plus the fastest the link goes), and each message is reported as how far it's above the base:
+ * the time it spent queued or retried on the link, not the link's fixed latency. The base is re-taken from
+ * the lowest of the last ONE_WAY_DELAY_WINDOW so the clocks drifting apart doesn't add up. Delays more than
+ * 32 seconds over the base can't be told apart from a new base.
+ */
+class OneWayDelay {
+  public:
+    OneWayDelay();
+
+    uint16_t add(uint16_t sentAt, unsigned long now);
+    void reset();
+
+  private:
+    uint16_t base;
+    uint16_t windowLowest;
+    unsigned long windowStart;
+    bool haveBase;
+};
+
+#endif // PIPELINE_TIMING_H
@@ -0,0 +1,65 @@
+#include "rf_command_queue.h"
+
+RfCommandQueue::RfCommandQueue() : head(0), numEntries(0) {}
+
+/**
+ * Queue a command, merging it into the newest waiting entry where possible (see the class comment).
+ * @param queuedAt millis() when the command was requested, e.g. when its stream event arrived
+ * @return false if the queue is full and the command was dropped
+ */
+bool RfCommandQueue::push(RfCommandType type, uint32_t code, uint8_t bits, unsigned long queuedAt) {
+  commandsQueued++;
+  if (numEntries > 0) {
+    RfCommand& newest = entries[(head + numEntries - 1) % RF_COMMAND_QUEUE_SIZE];
+    if (type == RF_COMMAND_COLOR && newest.type == RF_COMMAND_COLOR) {
+      newest.code = code;
+      newest.bits = bits;
+      commandsCoalesced++;
+      return true;
+    }
+    if (type == RF_COMMAND_BRIGHTNESS && newest.type == RF_COMMAND_BRIGHTNESS &&
+        newest.code == code && newest.bits == bits && newest.count < 255) {
+      newest.count++;
+      return true;
+    }
+  }
+
+  if (numEntries == RF_COMMAND_QUEUE_SIZE) {
+    commandsDropped++;
+    return false;
+  }
+  RfCommand& entry = entries[(head + numEntries) % RF_COMMAND_QUEUE_SIZE];
+  entry.type = type;
+  entry.code = code;
+  entry.bits = bits;
+  entry.count = 1;
+  entry.queuedAt = queuedAt;
+  numEntries++;
+  return true;
+}
+
+/**
+ * Take the next transmission off the queue. An entry with a count stays at the front until
+ * its last step has been taken.
+ * @return false if the queue is empty
+ */
+bool RfCommandQueue::pop(RfCommand& command) {
+  if (numEntries == 0) {
+    return false;
+  }
+  RfCommand& front = entries[head];
+  command = front;
+  command.count = 1;
+  if (--front.count == 0) {
+    head = (head + 1) % RF_COMMAND_QUEUE_SIZE;
+    numEntries--;
+  } else {
+    front.queuedAt = millis(); // the remaining steps are measured from when the previous one went out
+  }
+  return true;
+}
+
+void RfCommandQueue::clear() {
+  head = 0;
+  numEntries = 0;
+}
@@ -0,0 +1,50 @@
+#ifndef RF_COMMAND_QUEUE_H
+#define RF_COMMAND_QUEUE_H
+
+#include <Arduino.h>
+
+#define RF_COMMAND_QUEUE_SIZE 8
+
+enum RfCommandType : uint8_t {
+  RF_COMMAND_COLOR,      // select a colour/mode, only the latest one matters
+  RF_COMMAND_BRIGHTNESS, // one brightness step (the current colour's code sent again), every step counts
+  RF_COMMAND_POWER       // power state code, sent as received
+};
+
+struct RfCommand {
+  RfCommandType type;
+  uint32_t code;
+  uint8_t bits;
+  uint8_t count;            // transmissions still to send (brightness steps)
+  unsigned long queuedAt;   // millis() when the first of them was requested
+};
+
+/**
+ * Commands waiting for the RF transmitter, which takes about half a second per transmission.
+ * A colour command that is still waiting when the next one arrives is replaced by it, so a burst of
+ * colour changes costs one transmission. Brightness steps on the same code are merged into one
+ * entry with a count, and each step is still sent. Commands stay in the order they arrived:
+ * only the newest entry is ever merged into.
+ */
+class RfCommandQueue {
+  public:
+    RfCommandQueue();
+
+    bool push(RfCommandType type, uint32_t code, uint8_t bits, unsigned long queuedAt);
+    bool pop(RfCommand& command);
+    void clear();
+
+    bool isEmpty() const { return numEntries == 0; }
+    uint8_t count() const { return numEntries; }
+
+    unsigned long commandsQueued = 0;
+    unsigned long commandsCoalesced = 0; // colour commands replaced before they were sent
+    unsigned long commandsDropped = 0;   // arrived while the queue was full
+
+  private:
+    RfCommand entries[RF_COMMAND_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t numEntries;
+};
+
+#endif // RF_COMMAND_QUEUE_H
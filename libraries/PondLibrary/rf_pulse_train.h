@@ -0,0 +1,85 @@
+#ifndef RF_PULSE_TRAIN_H
+#define RF_PULSE_TRAIN_H
+
+#include <Arduino.h>
+
+// RCSwitch protocol 1 (the protocol the LED receiver listens for), in pulse lengths
+#define RF_PULSE_SHORT 1
+#define RF_PULSE_LONG 3
+#define RF_SYNC_HIGH 1
+#define RF_SYNC_LOW 31
+
+#define RF_MAX_BITS 32
+#define RF_MAX_EDGES (2 * RF_MAX_BITS + 2) // a high and a low per bit, then the sync pulse
+
+/**
+ * One RF code as the durations of its edges, in pulse lengths: high, low, high, low, ... starting
+ * with the most significant bit (a 1 is long-short, a 0 short-long), then the sync pulse.
+ * The transmitter only has to walk the array, so the codes in config.h are encoded at compile time
+ * and codes that only arrive at runtime are encoded once, before they're sent.
+ */
+struct RfPulseTrain {
+  uint32_t code;
+  uint8_t bits;
+  uint8_t edges;
+  uint8_t units[RF_MAX_EDGES];
+};
+
+// Duration of edge `edge` of `code` sent as `bits` bits
+constexpr uint8_t rfPulseUnits(uint32_t code, uint8_t bits, size_t edge) {
+  return edge >= 2u * bits + 2 ? 0
+    : edge == 2u * bits ? RF_SYNC_HIGH
+    : edge == 2u * bits + 1 ? RF_SYNC_LOW
+    // the high half of a bit is long for a 1, the low half for a 0
+    : (((code >> (bits - 1 - edge / 2)) & 1) == (edge % 2 == 0 ? 1u : 0u)) ? RF_PULSE_LONG : RF_PULSE_SHORT;
+}
+
+// Compile-time 0..N-1 index list, to expand rfPulseUnits() over the edges (std::index_sequence isn't C++11)
+template <size_t... I> struct RfEdgeIndices {};
+template <size_t N, size_t... I> struct RfMakeEdgeIndices : RfMakeEdgeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct RfMakeEdgeIndices<0, I...> { typedef RfEdgeIndices<I...> type; };
+
+template <size_t... I>
+constexpr RfPulseTrain encodeRfPulseTrain(uint32_t code, uint8_t bits, RfEdgeIndices<I...>) {
+  return {code, bits, (uint8_t)(2 * bits + 2), {rfPulseUnits(code, bits, I)...}};
+}
+
+/**
+ * Encode an RF code, at compile time when the arguments are constants.
+ * @param bits Number of bits sent (at most RF_MAX_BITS), leading zeros included
+ */
+constexpr RfPulseTrain encodeRfPulseTrain(uint32_t code, uint8_t bits) {
+  return encodeRfPulseTrain(code, bits, RfMakeEdgeIndices<RF_MAX_EDGES>::type());
+}
+
+/**
+ * Find a code in a table of pre-encoded pulse trains.
+ * @return The table entry, or nullptr if the code isn't in the table with that number of bits
+ */
+inline const RfPulseTrain* findRfPulseTrain(const RfPulseTrain* table, size_t count, uint32_t code, uint8_t bits) {
+  for (size_t i = 0; i < count; i++) {
+    if (table[i].code == code && table[i].bits == bits) {
+      return &table[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * Parse a binary code string ("000001010001110000000011") once, instead of on every repeat.
+ * @return false if the string is empty, too long or contains anything but 0 and 1
+ */
+inline bool parseRfBinaryCode(const char* binary, uint32_t& code, uint8_t& bits) {
+  code = 0;
+  bits = 0;
+  for (; *binary != '\0'; binary++) {
+    if ((*binary != '0' && *binary != '1') || bits == RF_MAX_BITS) {
+      return false;
+    }
+    code = (code << 1) | (*binary - '0');
+    bits++;
+  }
+  return bits > 0;
+}
+
+#endif // RF_PULSE_TRAIN_H
@@ -0,0 +1,80 @@
+#include "rf_transmitter.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#include "soc/gpio_reg.h"
+
+RfTransmitter* RfTransmitter::instance = nullptr;
+
+RfTransmitter::RfTransmitter(uint8_t pin, uint16_t pulseLength, uint8_t repeats)
+  : pin(pin), pulseLength(pulseLength), repeats(repeats), timer(nullptr), lastFinished(0),
+    active(false), finished(false), edge(0), unitsLeft(0), repeatsLeft(0) {}
+
+/**
+ * Set up the pin and the timer (1us ticks, an alarm every pulse length that stays disabled while idle).
+ */
+void RfTransmitter::begin() {
+  instance = this;
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, LOW);
+  timer = timerBegin(RF_TRANSMITTER_TIMER, 80, true); // 80MHz APB clock / 80
+  timerAttachInterrupt(timer, &RfTransmitter::onTimer, true);
+  timerAlarmWrite(timer, pulseLength, true);
+}
+
+/**
+ * Start sending a pulse train.
+ * @return false if a transmission is still running or the train is empty
+ */
+bool RfTransmitter::start(const RfPulseTrain& pulses) {
+  if (active || timer == nullptr || pulses.edges == 0) {
+    return false;
+  }
+  train = pulses;
+  edge = 0;
+  unitsLeft = train.units[0];
+  repeatsLeft = repeats;
+  finished = false;
+  active = true;
+  transmissions++;
+  digitalWrite(pin, HIGH);
+  timerWrite(timer, 0);
+  timerAlarmEnable(timer);
+  return true;
+}
+
+/**
+ * Stop the timer after a transmission has finished. Call from every pass of loop().
+ */
+void RfTransmitter::update() {
+  if (finished) {
+    finished = false;
+    timerAlarmDisable(timer);
+    lastFinished = millis();
+  }
+}
+
+void IRAM_ATTR RfTransmitter::onTimer() {
+  instance->tick();
+}
+
+// One pulse length has passed: move to the next edge once the current one has lasted its units
+void IRAM_ATTR RfTransmitter::tick() {
+  if (!active || --unitsLeft > 0) {
+    return;
+  }
+  if (++edge == train.edges) {
+    if (--repeatsLeft == 0) {
+      REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << pin);
+      active = false;
+      finished = true;
+      return;
+    }
+    edge = 0;
+  }
+  // even edges are high, odd ones low (the pin is below 32, so the plain GPIO registers reach it)
+  REG_WRITE(edge % 2 == 0 ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1UL << pin);
+  unitsLeft = train.units[edge];
+}
+
+#endif // ARDUINO_ARCH_ESP32
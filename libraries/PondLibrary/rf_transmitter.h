@@ -0,0 +1,55 @@
+#ifndef RF_TRANSMITTER_H
+#define RF_TRANSMITTER_H
+
+#include <Arduino.h>
+#include "rf_pulse_train.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+#define RF_TRANSMITTER_TIMER 0 // hardware timer used to time the pulses
+
+/**
+ * Non-blocking replacement for RCSwitch::send(). A hardware timer interrupt fires every pulse length
+ * and walks a pulse train (see rf_pulse_train.h), so loop() keeps running while a code is sent
+ * `repeats` times (about 50ms per repeat for a 25 bit code at 390us).
+ *
+ * start() copies the pulse train into RAM, as the interrupt can't read flash. Call update() from
+ * loop() to stop the timer once the transmission has finished.
+ */
+class RfTransmitter {
+  public:
+    RfTransmitter(uint8_t pin, uint16_t pulseLength, uint8_t repeats);
+
+    void begin();
+    bool start(const RfPulseTrain& train);
+    void update();
+
+    bool isBusy() const { return active || finished; } // finished until update() has stopped the timer
+    unsigned long finishedAt() const { return lastFinished; } // millis() when the last transmission ended
+
+    unsigned long transmissions = 0;
+
+  private:
+    static void IRAM_ATTR onTimer();
+    void IRAM_ATTR tick();
+
+    static RfTransmitter* instance;
+
+    uint8_t pin;
+    uint16_t pulseLength;
+    uint8_t repeats;
+    hw_timer_t* timer;
+    unsigned long lastFinished;
+
+    // shared with the interrupt
+    RfPulseTrain train;
+    volatile bool active;
+    volatile bool finished;
+    uint8_t edge;
+    uint8_t unitsLeft;
+    uint8_t repeatsLeft;
+};
+
+#endif // ARDUINO_ARCH_ESP32
+
+#endif // RF_TRANSMITTER_H
@@ -0,0 +1,195 @@
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <Arduino.h>
+
+#define HAMPEL_WINDOW 5          // samples in the outlier filter's median window
+#define HAMPEL_THRESHOLD 3.0     // outlier if further than this many (scaled) MADs from the median
+#define MAD_TO_STDDEV 1.4826     // scales the median absolute deviation to a standard deviation estimate
+
+// Summary of a RunningStats, e.g. for logging or sending over a link
+struct StatsSnapshot {
+  uint32_t count = 0;
+  float mean = 0;
+  float stddev = 0;
+  float minimum = 0;
+  float maximum = 0;
+};
+
+/**
+ * Streaming statistics for one sensor: count, mean, variance (Welford's algorithm), min and max.
+ * Each add() is O(1) and no samples are stored, so a sensor costs ~20 bytes however long the
+ * interval is. Zero is a value like any other (count() says whether there is any data).
+ *
+ * Two RunningStats can be combined with merge() (Chan et al.'s parallel update), e.g. to roll
+ * per-minute stats up into hourly ones.
+ */
+template <typename T>
+class RunningStats {
+  public:
+    void add(T value) {
+      n++;
+      float delta = value - meanValue;
+      meanValue += delta / n;
+      m2 += delta * (value - meanValue);
+      if (n == 1 || value < minValue) {
+        minValue = value;
+      }
+      if (n == 1 || value > maxValue) {
+        maxValue = value;
+      }
+    }
+
+    void merge(const RunningStats& other) {
+      if (other.n == 0) {
+        return;
+      }
+      if (n == 0) {
+        *this = other;
+        return;
+      }
+      uint32_t total = n + other.n;
+      float delta = other.meanValue - meanValue;
+      meanValue += delta * other.n / total;
+      m2 += other.m2 + delta * delta * ((float)n * other.n / total);
+      if (other.minValue < minValue) {
+        minValue = other.minValue;
+      }
+      if (other.maxValue > maxValue) {
+        maxValue = other.maxValue;
+      }
+      n = total;
+    }
+
+    void reset() {
+      n = 0;
+      meanValue = 0;
+      m2 = 0;
+      minValue = 0;
+      maxValue = 0;
+    }
+
+    uint32_t count() const { return n; }
+    float mean() const { return meanValue; }
+    float variance() const { return n > 1 ? m2 / (n - 1) : 0; } // sample variance
+    float stddev() const { return sqrt(variance()); }
+    T minimum() const { return minValue; }
+    T maximum() const { return maxValue; }
+
+    /**
+     * Rebuild the stats a snapshot was taken from (e.g. one received over a link) so they can be merged.
+     */
+    static RunningStats fromSnapshot(const StatsSnapshot& s) {
+      RunningStats stats;
+      if (s.count > 0) {
+        stats.n = s.count;
+        stats.meanValue = s.mean;
+        stats.m2 = s.stddev * s.stddev * (s.count - 1);
+        stats.minValue = s.minimum;
+        stats.maxValue = s.maximum;
+      }
+      return stats;
+    }
+
+    StatsSnapshot snapshot() const {
+      StatsSnapshot s;
+      s.count = n;
+      s.mean = meanValue;
+      s.stddev = stddev();
+      s.minimum = minValue;
+      s.maximum = maxValue;
+      return s;
+    }
+
+  private:
+    uint32_t n = 0;
+    float meanValue = 0;
+    float m2 = 0; // sum of squared differences from the mean
+    T minValue = 0;
+    T maxValue = 0;
+};
+
+/**
+ * Hampel outlier filter over the last N samples.
+ * A sample further than `threshold` scaled median absolute deviations (MAD) from the window median
+ * is an outlier and is replaced by the median. The window keeps the raw samples, so a real step
+ * change is passed through once it makes up most of the window instead of being rejected forever.
+ * `minDeviation` sets the smallest deviation that can count as an outlier, so quantized readings
+ * (where the MAD is often 0) don't flag every small change.
+ *
+ * The cost per sample is fixed by N (two small insertion sorts), not by how long the sensor has run.
+ * The first N - 1 samples are passed through while the window fills.
+ */
+template <typename T, uint8_t N = HAMPEL_WINDOW>
+class HampelFilter {
+  public:
+    HampelFilter(float threshold = HAMPEL_THRESHOLD, float minDeviation = 0) : threshold(threshold), minDeviation(minDeviation) {}
+
+    T filter(T value) {
+      window[next] = value;
+      next = (next + 1) % N;
+      if (count < N) {
+        count++;
+      }
+      outlier = false;
+      if (count < N) {
+        return value;
+      }
+
+      float sorted[N];
+      for (uint8_t i = 0; i < N; i++) {
+        sorted[i] = window[i];
+      }
+      float med = median(sorted);
+
+      float deviations[N];
+      for (uint8_t i = 0; i < N; i++) {
+        deviations[i] = fabs(window[i] - med);
+      }
+      float limit = threshold * MAD_TO_STDDEV * median(deviations);
+      if (limit < minDeviation) {
+        limit = minDeviation;
+      }
+
+      if (fabs(value - med) > limit) {
+        outlier = true;
+        outliers++;
+        return (T)med;
+      }
+      return value;
+    }
+
+    void reset() {
+      next = 0;
+      count = 0;
+      outlier = false;
+    }
+
+    bool lastWasOutlier() const { return outlier; }
+
+    unsigned long outliers = 0; // number of samples replaced since boot
+
+  private:
+    // Sorts the values in place (N is small) and returns the middle one
+    static float median(float* values) {
+      for (uint8_t i = 1; i < N; i++) {
+        float v = values[i];
+        int8_t j = i - 1;
+        while (j >= 0 && values[j] > v) {
+          values[j + 1] = values[j];
+          j--;
+        }
+        values[j + 1] = v;
+      }
+      return N % 2 ? values[N / 2] : (values[N / 2 - 1] + values[N / 2]) / 2;
+    }
+
+    T window[N];
+    uint8_t next = 0;
+    uint8_t count = 0;
+    bool outlier = false;
+    float threshold;
+    float minDeviation;
+};
+
+#endif // RUNNING_STATS_H
@@ -0,0 +1,90 @@
+#include "sensor_packet.h"
+
+/**
+ * Pack a snapshot for the BLE sensor packet characteristic.
+ * Sensors that aren't present (or aren't a number) are sent as 0 with their present bit cleared.
+ * @param packet The snapshot to pack
+ * @param out Destination buffer, must hold at least SENSOR_PACKET_SIZE bytes
+ * @return The number of bytes written (SENSOR_PACKET_SIZE)
+ */
+size_t packSensorPacket(const SensorPacket& packet, uint8_t* out) {
+  out[0] = SENSOR_PACKET_VERSION;
+  memcpy(out + 1, &packet.sequence, sizeof(packet.sequence));
+  memcpy(out + 3, &packet.timestamp, sizeof(packet.timestamp));
+  memcpy(out + 5, &packet.readAge, sizeof(packet.readAge));
+
+  SensorMask present = 0;
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    int16_t value = 0;
+    if (packet.readings.has((SensorId)i) && !isnan(packet.readings.values[i])) {
+      float scaled = round(packet.readings.values[i] * sensorRegistry[i].packetScale);
+      value = scaled > INT16_MAX ? INT16_MAX : (scaled < INT16_MIN ? INT16_MIN : (int16_t)scaled);
+      present |= (SensorMask)1 << i;
+    }
+    memcpy(out + SENSOR_PACKET_VALUES_OFFSET + i * 2, &value, sizeof(value));
+  }
+  memcpy(out + 7, &present, sizeof(SensorMask));
+  return SENSOR_PACKET_SIZE;
+}
+
+/**
+ * Unpack a value written by packSensorPacket().
+ * Version 1 packets (from a monitor that hasn't been updated) have the same size and layout apart from
+ * their 32 bit timestamp, which takes the place of the read age.
+ * @return false if the value is the wrong size or version
+ */
+bool unpackSensorPacket(const uint8_t* in, size_t length, SensorPacket& packet) {
+  if (length != SENSOR_PACKET_SIZE || (in[0] != SENSOR_PACKET_VERSION && in[0] != 1)) {
+    return false;
+  }
+  memcpy(&packet.sequence, in + 1, sizeof(packet.sequence));
+  memcpy(&packet.timestamp, in + 3, sizeof(packet.timestamp)); // the low half of a version 1 timestamp
+  if (in[0] == SENSOR_PACKET_VERSION) {
+    memcpy(&packet.readAge, in + 5, sizeof(packet.readAge));
+  } else {
+    packet.readAge = PIPELINE_TIME_UNKNOWN;
+  }
+
+  packet.readings = SensorReadings();
+  SensorMask present;
+  memcpy(&present, in + 7, sizeof(SensorMask));
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (present & ((SensorMask)1 << i)) {
+      int16_t value;
+      memcpy(&value, in + SENSOR_PACKET_VALUES_OFFSET + i * 2, sizeof(value));
+      packet.readings.set((SensorId)i, value / sensorRegistry[i].packetScale);
+    }
+  }
+  return true;
+}
+
+/**
+ * Pack a power report for the BLE power characteristic.
+ * @param out Destination buffer, must hold at least POWER_REPORT_SIZE bytes
+ * @return The number of bytes written (POWER_REPORT_SIZE)
+ */
+size_t packPowerReport(const PowerReport& report, uint8_t* out) {
+  out[0] = POWER_REPORT_VERSION;
+  memcpy(out + 1, &report.dutyCycle, sizeof(report.dutyCycle));
+  memcpy(out + 3, &report.backlightOn, sizeof(report.backlightOn));
+  memcpy(out + 5, &report.estimatedCurrent, sizeof(report.estimatedCurrent));
+  memcpy(out + 7, &report.notifyInterval, sizeof(report.notifyInterval));
+  memcpy(out + 9, report.sampleIntervals, SENSOR_COUNT);
+  return POWER_REPORT_SIZE;
+}
+
+/**
+ * Unpack a value written by packPowerReport().
+ * @return false if the value is the wrong size or version
+ */
+bool unpackPowerReport(const uint8_t* in, size_t length, PowerReport& report) {
+  if (length != POWER_REPORT_SIZE || in[0] != POWER_REPORT_VERSION) {
+    return false;
+  }
+  memcpy(&report.dutyCycle, in + 1, sizeof(report.dutyCycle));
+  memcpy(&report.backlightOn, in + 3, sizeof(report.backlightOn));
+  memcpy(&report.estimatedCurrent, in + 5, sizeof(report.estimatedCurrent));
+  memcpy(&report.notifyInterval, in + 7, sizeof(report.notifyInterval));
+  memcpy(report.sampleIntervals, in + 9, SENSOR_COUNT);
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef SENSOR_PACKET_H
+#define SENSOR_PACKET_H
+
+#include <Arduino.h>
+#include "sensor_readings.h"
+#include "pipeline_timing.h"
+
+/*
+  Packed sensor snapshot sent by the water-quality monitor in a single BLE notification.
+
+  Layout (little-endian, 20 bytes with six sensors so it fits the default ATT MTU without negotiation):
+    [version (1)][sequence (uint16)][timestamp (uint16)][read age (uint16)][present SensorMask (1, 2 with more than 8 sensors)]
+    [SENSOR_COUNT x int16 values]
+
+  - sequence increments with every snapshot so the central can count dropped notifications
+  - timestamp is the low 16 bits of the peripheral's millis() when the snapshot was taken (the central only
+    compares it between packets, see OneWayDelay in pipeline_timing.h)
+  - read age is ms from the peripheral's newest sensor read to the snapshot
+  - version 1 packets had a 32 bit timestamp and no read age, they're still accepted with the read age
+    PIPELINE_TIME_UNKNOWN
+  - each value is stored as round(value * sensorRegistry[SensorId].packetScale), saturated to the int16 range
+  - more than six sensors makes the packet longer than 20 bytes, so the central has to negotiate a larger MTU
+*/
+
+#define SENSOR_PACKET_VERSION 2
+#define SENSOR_PACKET_VALUES_OFFSET (1 + 2 + 2 + 2 + sizeof(SensorMask))
+#define SENSOR_PACKET_SIZE (SENSOR_PACKET_VALUES_OFFSET + SENSOR_COUNT * 2)
+
+struct SensorPacket {
+  uint16_t sequence = 0;
+  uint16_t timestamp = 0;
+  uint16_t readAge = PIPELINE_TIME_UNKNOWN;
+  SensorReadings readings;
+};
+
+size_t packSensorPacket(const SensorPacket& packet, uint8_t* out);
+bool unpackSensorPacket(const uint8_t* in, size_t length, SensorPacket& packet);
+
+/*
+  The monitor's power report, notified on its own characteristic once a minute.
+
+  Layout (little-endian, 9 + SENSOR_COUNT bytes):
+    [version (1)][duty cycle (uint16)][backlight on (uint16)][estimated current (uint16)][notify interval (uint16)]
+    [SENSOR_COUNT x uint8 sample intervals]
+
+  - duty cycle is the share of the last minute the CPU was awake and backlight on the share the LCD backlight
+    was on, both in 0.1% steps (0-1000)
+  - estimated current is in 0.1mA steps, from the duty cycle, the backlight and typical figures for the other
+    parts (an estimate, not a measurement)
+  - notify interval is the ms between sensor packet notifications
+  - each sensor's current sample interval is in 100ms steps (up to 25.5 seconds), indexed by SensorId
+*/
+
+#define POWER_REPORT_VERSION 1
+#define POWER_REPORT_SIZE (9 + SENSOR_COUNT)
+
+struct PowerReport {
+  uint16_t dutyCycle = 0;        // 0.1%
+  uint16_t backlightOn = 0;      // 0.1%
+  uint16_t estimatedCurrent = 0; // 0.1mA
+  uint16_t notifyInterval = 0;   // ms
+  uint8_t sampleIntervals[SENSOR_COUNT] = {0}; // 100ms
+};
+
+size_t packPowerReport(const PowerReport& report, uint8_t* out);
+bool unpackPowerReport(const uint8_t* in, size_t length, PowerReport& report);
+
+#endif // SENSOR_PACKET_H
@@ -0,0 +1,109 @@
+#include "sensor_readings.h"
+
+/**
+ * Pack a SensorReadings snapshot into a frame payload.
+ * Layout: [present SensorMask (1 byte, 2 with more than 8 sensors)][SENSOR_COUNT little-endian IEEE-754 floats]
+ * @param readings The readings to pack
+ * @param out Destination buffer, must hold at least SENSOR_READINGS_PACKED_SIZE bytes
+ * @return The number of bytes written
+ */
+size_t packSensorReadings(const SensorReadings& readings, uint8_t* out) {
+  // both SAMD21 boards are little-endian so the mask and floats are copied as-is
+  memcpy(out, &readings.present, sizeof(SensorMask));
+  memcpy(out + sizeof(SensorMask), readings.values, SENSOR_COUNT * sizeof(float));
+  return SENSOR_READINGS_PACKED_SIZE;
+}
+
+/**
+ * Unpack a frame payload written by packSensorReadings().
+ * @param in The payload bytes
+ * @param length The payload length
+ * @param readings Where to store the unpacked readings
+ * @return false if the payload is the wrong size for this protocol version
+ */
+bool unpackSensorReadings(const uint8_t* in, size_t length, SensorReadings& readings) {
+  if (length != SENSOR_READINGS_PACKED_SIZE) {
+    return false;
+  }
+  memcpy(&readings.present, in, sizeof(SensorMask));
+  memcpy(readings.values, in + sizeof(SensorMask), SENSOR_COUNT * sizeof(float));
+  return true;
+}
+
+/**
+ * Pack the spreads of the present sensors into a frame payload.
+ * Layout: [present SensorMask (1 byte, 2 with more than 8 sensors)][minimum, maximum, stddev floats and uint16 count for each present sensor in SensorId order]
+ * @param spreads The spreads to pack
+ * @param out Destination buffer, must hold at least SENSOR_SPREADS_MAX_PACKED_SIZE bytes
+ * @return The number of bytes written
+ */
+size_t packSensorSpreads(const SensorSpreads& spreads, uint8_t* out) {
+  memcpy(out, &spreads.present, sizeof(SensorMask));
+  size_t length = sizeof(SensorMask);
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (spreads.has((SensorId)i)) {
+      const SensorSpread& spread = spreads.values[i];
+      memcpy(out + length, &spread.minimum, sizeof(float));
+      memcpy(out + length + 4, &spread.maximum, sizeof(float));
+      memcpy(out + length + 8, &spread.stddev, sizeof(float));
+      uint16_t count = spread.count > UINT16_MAX ? UINT16_MAX : spread.count;
+      memcpy(out + length + 12, &count, sizeof(count));
+      length += SENSOR_SPREAD_PACKED_SIZE;
+    }
+  }
+  return length;
+}
+
+/**
+ * Unpack a frame payload written by packSensorSpreads().
+ * @return false if the payload length doesn't match the number of present sensors
+ */
+bool unpackSensorSpreads(const uint8_t* in, size_t length, SensorSpreads& spreads) {
+  if (length < sizeof(SensorMask)) {
+    return false;
+  }
+  SensorMask present;
+  memcpy(&present, in, sizeof(SensorMask));
+  size_t expected = sizeof(SensorMask);
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (present & ((SensorMask)1 << i)) {
+      expected += SENSOR_SPREAD_PACKED_SIZE;
+    }
+  }
+  if (length != expected || (present >> SENSOR_COUNT) != 0) {
+    return false;
+  }
+
+  spreads.present = present;
+  size_t offset = sizeof(SensorMask);
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (spreads.has((SensorId)i)) {
+      SensorSpread& spread = spreads.values[i];
+      memcpy(&spread.minimum, in + offset, sizeof(float));
+      memcpy(&spread.maximum, in + offset + 4, sizeof(float));
+      memcpy(&spread.stddev, in + offset + 8, sizeof(float));
+      uint16_t count;
+      memcpy(&count, in + offset + 12, sizeof(count));
+      spread.count = count;
+      offset += SENSOR_SPREAD_PACKED_SIZE;
+    }
+  }
+  return true;
+}
+
+/**
+ * Print the present readings as "key: value" pairs on a single line (for debugging)
+ */
+void printSensorReadings(Print& output, const SensorReadings& readings) {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (readings.has((SensorId)i)) {
+      output.print(sensorRegistry[i].jsonKey);
+      output.print(F(": "));
+      output.print(readings.values[i]);
+      output.print(F(" "));
+      output.print(sensorRegistry[i].units);
+      output.print(F("  "));
+    }
+  }
+  output.println();
+}
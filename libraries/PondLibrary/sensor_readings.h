@@ -0,0 +1,70 @@
+#ifndef SENSOR_READINGS_H
+#define SENSOR_READINGS_H
+
+#include <Arduino.h>
+#include "sensor_registry.h"
+
+// Bitmask with bit (1 << SensorId) per sensor, widened automatically once there are more than 8 sensors
+template <bool wide>
+struct SensorMaskType { typedef uint8_t Type; };
+template <>
+struct SensorMaskType<true> { typedef uint16_t Type; };
+typedef SensorMaskType<(SENSOR_COUNT > 8)>::Type SensorMask;
+static_assert(SENSOR_COUNT <= 16, "SensorMask holds at most 16 sensors");
+
+/**
+ * A snapshot of sensor values. Only the values whose bit is set in `present` are valid,
+ * which lets a realtime update carry just the sensors that changed.
+ */
+struct SensorReadings {
+  SensorMask present = 0; // bit (1 << SensorId) is set when values[SensorId] is valid
+  float values[SENSOR_COUNT] = {0};
+
+  void set(SensorId id, float value) {
+    values[id] = value;
+    present |= (SensorMask)1 << id;
+  }
+
+  bool has(SensorId id) const {
+    return present & ((SensorMask)1 << id);
+  }
+};
+
+// Spread of a sensor's values over a log interval (the mean is carried in SensorReadings)
+struct SensorSpread {
+  float minimum = 0;
+  float maximum = 0;
+  float stddev = 0;
+  uint32_t count = 0; // number of values the mean and spread are over (saturates at 65535 when packed)
+};
+
+/**
+ * The spread of each sensor over a log interval. Only the values whose bit is set in `present` are valid.
+ */
+struct SensorSpreads {
+  SensorMask present = 0; // bit (1 << SensorId) is set when values[SensorId] is valid
+  SensorSpread values[SENSOR_COUNT];
+
+  void set(SensorId id, const SensorSpread& spread) {
+    values[id] = spread;
+    present |= (SensorMask)1 << id;
+  }
+
+  bool has(SensorId id) const {
+    return present & ((SensorMask)1 << id);
+  }
+};
+
+// Number of bytes a SensorReadings takes up when packed into a frame payload
+#define SENSOR_READINGS_PACKED_SIZE (sizeof(SensorMask) + SENSOR_COUNT * sizeof(float))
+// Largest packed SensorSpreads (every sensor present); only present sensors are packed
+#define SENSOR_SPREAD_PACKED_SIZE (3 * sizeof(float) + sizeof(uint16_t))
+#define SENSOR_SPREADS_MAX_PACKED_SIZE (sizeof(SensorMask) + SENSOR_COUNT * SENSOR_SPREAD_PACKED_SIZE)
+
+size_t packSensorReadings(const SensorReadings& readings, uint8_t* out);
+bool unpackSensorReadings(const uint8_t* in, size_t length, SensorReadings& readings);
+size_t packSensorSpreads(const SensorSpreads& spreads, uint8_t* out);
+bool unpackSensorSpreads(const uint8_t* in, size_t length, SensorSpreads& spreads);
+void printSensorReadings(Print& output, const SensorReadings& readings);
+
+#endif // SENSOR_READINGS_H
@@ -0,0 +1,108 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+
+/*
+  Every sensor in the system, in SensorId order. The SensorId enum, the Firebase/log JSON keys, the
+  BLE characteristics, the packet scaling, the outlier filters, the realtime deadbands, the fake DEBUG
+  data and the monitor's sampling and read dispatch are all generated from this list, so adding a
+  sensor is one line here, its UUID in config.h and its read function on the monitor. Add new sensors
+  at the end so the existing SensorIds (and the frame layouts) don't move.
+
+  X(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, uuid, reader)
+    id                SensorId name (SENSOR_<id>)
+    jsonKey           key used for the sensor in the Firebase realtime and log JSON
+    valueType         type of the sensor's single value BLE characteristic (float, or int for whole number sensors)
+    units             units printed after the value in debug output
+    packetScale       value multiplier in the packed BLE characteristic, sets its resolution and range (see sensor_packet.h)
+    minDeviation      smallest deviation the monitor's Hampel filter treats as an outlier (see running_stats.h)
+    deadband          smallest change the Nano reports as a realtime update (see change_reporter.h)
+    relativeDeadband  the same as a fraction of the last reported value, the larger of the two applies
+    simulatedMin      lower bound of the fake values the Nano generates in DEBUG mode
+    simulatedMax      upper bound of the fake values the Nano generates in DEBUG mode
+    analog            read from the monitor's ADC sampler, so only sampled once it has warmed up (see adc_sampler.h)
+    uuid              name of the config.h variable holding the single value characteristic's UUID
+                      (only expanded by the sketches, the library doesn't see config.h)
+    reader            the monitor's function that reads the sensor (only expanded by the monitor sketch)
+*/
+#define POND_SENSORS(X) \
+  X(TEMPERATURE,            temperature,          float, "F",   100,  0.5,  0.2,  0,    45, 55,   false, temperatureCharacteristicUuid,          readTemperature) \
+  X(WATER_LEVEL,            waterLevel,           float, "in",  100,  0.5,  0.1,  0,    0,  12,   false, waterLevelCharacteristicUuid,           readWaterLevel) \
+  X(TURBIDITY,              turbidity,            int,   "NTU", 1,    50,   10,   0.05, 0,  3000, true,  turbidityValueCharacteristicUuid,       readTurbidityValue) \
+  X(TURBIDITY_VOLTAGE,      turbidityVoltage,     float, "V",   1000, 0.05, 0.02, 0,    0,  3.3,  true,  turbidityVoltageCharacteristicUuid,     readTurbidityVoltage) \
+  X(TOTAL_DISSOLVED_SOLIDS, totalDissolvedSolids, int,   "ppm", 1,    10,   5,    0.02, 50, 300,  true,  totalDissolvedSolidsCharacteristicUuid, readTotalDissolvedSolids) \
+  X(PH,                     pH,                   float, "",    100,  0.1,  0.05, 0,    6,  8,    true,  pHCharacteristicUuid,                   readPH)
+
+// Index of each sensor in a SensorReadings snapshot and the per-sensor arrays
+#define SENSOR_REGISTRY_ID(id, ...) SENSOR_##id,
+enum SensorId : uint8_t {
+  POND_SENSORS(SENSOR_REGISTRY_ID)
+  SENSOR_COUNT
+};
+#undef SENSOR_REGISTRY_ID
+
+/**
+ * Convert a sensor value to its single value characteristic type (whole number sensors are rounded).
+ */
+template <typename T>
+inline T toSensorValueType(float value) {
+  return (T)round(value);
+}
+
+template <>
+inline float toSensorValueType<float>(float value) {
+  return value;
+}
+
+/**
+ * Read a value written to a single value characteristic of type T.
+ */
+template <typename T>
+float decodeSensorValue(const uint8_t* in) {
+  T value;
+  memcpy(&value, in, sizeof(T));
+  return value;
+}
+
+// Everything the shared code needs to know about a sensor at runtime (see POND_SENSORS for the fields)
+struct SensorDescriptor {
+  const char* jsonKey;
+  const char* units;
+  float packetScale;
+  float minDeviation;
+  float deadband;
+  float relativeDeadband;
+  float simulatedMin;
+  float simulatedMax;
+  bool analog;
+  uint8_t valueSize;                  // bytes in the single value characteristic
+  bool wholeNumber;                   // the single value characteristic holds an integer
+  float (*decode)(const uint8_t* in); // reads the single value characteristic
+};
+
+#define SENSOR_REGISTRY_DESCRIPTOR(id, jsonKey, valueType, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, uuid, reader) \
+  {#jsonKey, units, packetScale, minDeviation, deadband, relativeDeadband, simulatedMin, simulatedMax, analog, sizeof(valueType), (valueType)0.5 == 0, decodeSensorValue<valueType>},
+constexpr SensorDescriptor sensorRegistry[SENSOR_COUNT] = {
+  POND_SENSORS(SENSOR_REGISTRY_DESCRIPTOR)
+};
+#undef SENSOR_REGISTRY_DESCRIPTOR
+
+/**
+ * Compile-time view of a sensor for code that handles each sensor separately (typed BLE characteristics, etc.).
+ * SensorTraits<SENSOR_PH>::Value is the type of the pH characteristic.
+ */
+template <SensorId id>
+struct SensorTraits;
+
+#define SENSOR_REGISTRY_TRAITS(id, jsonKey, valueType, ...) \
+  template <> struct SensorTraits<SENSOR_##id> { typedef valueType Value; };
+POND_SENSORS(SENSOR_REGISTRY_TRAITS)
+#undef SENSOR_REGISTRY_TRAITS
+
+// Total bytes of all the single value characteristics (one update of every sensor)
+#define SENSOR_REGISTRY_SIZE(id, jsonKey, valueType, ...) + sizeof(valueType)
+constexpr size_t SENSOR_VALUES_SIZE = 0 POND_SENSORS(SENSOR_REGISTRY_SIZE);
+#undef SENSOR_REGISTRY_SIZE
+
+#endif // SENSOR_REGISTRY_H
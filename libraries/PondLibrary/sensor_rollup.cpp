@@ -0,0 +1,67 @@
+#include "sensor_rollup.h"
+
+SensorRollup::SensorRollup(uint32_t period)
+  : periodLength(period), periodStart(0), started(false) {
+}
+
+/**
+ * Add a log entry (a 1 minute log entry or the output of a finer rollup).
+ * A sensor with a mean but no spread counts as a single value.
+ * @param entry The entry to add, keyed by the RTC epoch at the start of its interval
+ * @param finished Set to the rollup of the previous period when this entry starts a new one
+ * @return true if `finished` was set
+ */
+bool SensorRollup::add(const LogEntry& entry, LogEntry& finished) {
+  uint32_t start = entry.epoch - entry.epoch % periodLength;
+  // a new period, or the RTC was set backwards
+  bool periodEnded = started && start != periodStart;
+  if (periodEnded) {
+    finish(finished);
+    finished.device = entry.device; // one rollup per device, so the period was the same device's
+  }
+  periodStart = start;
+  started = true;
+
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    SensorId id = (SensorId)i;
+    if (!entry.readings.has(id)) {
+      continue;
+    }
+    StatsSnapshot snapshot;
+    snapshot.mean = entry.readings.values[i];
+    if (entry.spreads.has(id)) {
+      const SensorSpread& spread = entry.spreads.values[i];
+      snapshot.count = spread.count > 0 ? spread.count : 1;
+      snapshot.minimum = spread.minimum;
+      snapshot.maximum = spread.maximum;
+      snapshot.stddev = spread.stddev;
+    } else {
+      snapshot.count = 1;
+      snapshot.minimum = snapshot.mean;
+      snapshot.maximum = snapshot.mean;
+    }
+    stats[i].merge(RunningStats<float>::fromSnapshot(snapshot));
+  }
+  return periodEnded;
+}
+
+// Write out the current period and start over
+void SensorRollup::finish(LogEntry& out) {
+  out.epoch = periodStart;
+  out.readings = SensorReadings();
+  out.spreads = SensorSpreads();
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (stats[i].count() == 0) {
+      continue;
+    }
+    StatsSnapshot snapshot = stats[i].snapshot();
+    out.readings.set((SensorId)i, snapshot.mean);
+    SensorSpread spread;
+    spread.minimum = snapshot.minimum;
+    spread.maximum = snapshot.maximum;
+    spread.stddev = snapshot.stddev;
+    spread.count = snapshot.count;
+    out.spreads.set((SensorId)i, spread);
+    stats[i].reset();
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef SENSOR_ROLLUP_H
+#define SENSOR_ROLLUP_H
+
+#include <Arduino.h>
+#include "sensor_readings.h"
+#include "running_stats.h"
+#include "upload_queue.h"
+
+#define ROLLUP_15_MINUTES 900 // rollup periods in seconds (RTC epoch)
+#define ROLLUP_HOUR 3600
+#define ROLLUP_DAY 86400
+
+/**
+ * Rolls log entries up into one entry per `period` seconds, aligned to the RTC epoch (e.g. 15 minute
+ * entries start at :00, :15, :30 and :45). Each entry's per-sensor stats (mean, min, max, stddev and
+ * count) are merged exactly, so rollups can feed coarser rollups: 1 minute entries -> 15 minutes -> 1 hour -> 1 day.
+ *
+ * A period is finished when the first entry of a later period arrives, so a rollup comes out one
+ * input entry after its period ends. The partial period is lost if the board restarts.
+ * Entries from different devices need a rollup each.
+ */
+class SensorRollup {
+  public:
+    SensorRollup(uint32_t period);
+
+    bool add(const LogEntry& entry, LogEntry& finished);
+    bool hasData() const { return started; }
+    uint32_t period() const { return periodLength; }
+
+  private:
+    void finish(LogEntry& out);
+
+    uint32_t periodLength;
+    uint32_t periodStart;
+    bool started;
+    RunningStats<float> stats[SENSOR_COUNT];
+};
+
+#endif // SENSOR_ROLLUP_H
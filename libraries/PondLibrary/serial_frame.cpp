@@ -0,0 +1,211 @@
+#include "serial_frame.h"
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF). Bitwise to keep flash use down;
+ * a ~30 byte frame takes a few microseconds on the SAMD21.
+ */
+uint16_t crc16(const uint8_t* data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/**
+ * Pack a NanoStatus into a frame payload.
+ * Layout: [connected (1 byte)][rssi (int16 LE)][timeSinceLastConnection (uint32 LE)][bleSamplesDropped (uint32 LE)]
+ *         [realtimeValuesReported (uint32 LE)][realtimeValuesSuppressed (uint32 LE)][realtimeHeartbeats (uint32 LE)]
+ *         [bleReconnects (uint32 LE)][bleFullDiscoveries (uint32 LE)][bleReconnectP50/P90/P99 (uint16 LE)][deviceCount (1 byte)]
+ * @return The number of bytes written (NANO_STATUS_PACKED_SIZE)
+ */
+size_t packNanoStatus(const NanoStatus& status, uint8_t* out) {
+  out[0] = status.connected ? 1 : 0;
+  memcpy(out + 1, &status.rssi, sizeof(status.rssi));
+  memcpy(out + 3, &status.timeSinceLastConnection, sizeof(status.timeSinceLastConnection));
+  memcpy(out + 7, &status.bleSamplesDropped, sizeof(status.bleSamplesDropped));
+  memcpy(out + 11, &status.realtimeValuesReported, sizeof(status.realtimeValuesReported));
+  memcpy(out + 15, &status.realtimeValuesSuppressed, sizeof(status.realtimeValuesSuppressed));
+  memcpy(out + 19, &status.realtimeHeartbeats, sizeof(status.realtimeHeartbeats));
+  memcpy(out + 23, &status.bleReconnects, sizeof(status.bleReconnects));
+  memcpy(out + 27, &status.bleFullDiscoveries, sizeof(status.bleFullDiscoveries));
+  memcpy(out + 31, &status.bleReconnectP50, sizeof(status.bleReconnectP50));
+  memcpy(out + 33, &status.bleReconnectP90, sizeof(status.bleReconnectP90));
+  memcpy(out + 35, &status.bleReconnectP99, sizeof(status.bleReconnectP99));
+  out[37] = status.deviceCount;
+  return NANO_STATUS_PACKED_SIZE;
+}
+
+/**
+ * Unpack a frame payload written by packNanoStatus().
+ * @return false if the payload is the wrong size for this protocol version
+ */
+bool unpackNanoStatus(const uint8_t* in, size_t length, NanoStatus& status) {
+  if (length != NANO_STATUS_PACKED_SIZE) {
+    return false;
+  }
+  status.connected = in[0] != 0;
+  memcpy(&status.rssi, in + 1, sizeof(status.rssi));
+  memcpy(&status.timeSinceLastConnection, in + 3, sizeof(status.timeSinceLastConnection));
+  memcpy(&status.bleSamplesDropped, in + 7, sizeof(status.bleSamplesDropped));
+  memcpy(&status.realtimeValuesReported, in + 11, sizeof(status.realtimeValuesReported));
+  memcpy(&status.realtimeValuesSuppressed, in + 15, sizeof(status.realtimeValuesSuppressed));
+  memcpy(&status.realtimeHeartbeats, in + 19, sizeof(status.realtimeHeartbeats));
+  memcpy(&status.bleReconnects, in + 23, sizeof(status.bleReconnects));
+  memcpy(&status.bleFullDiscoveries, in + 27, sizeof(status.bleFullDiscoveries));
+  memcpy(&status.bleReconnectP50, in + 31, sizeof(status.bleReconnectP50));
+  memcpy(&status.bleReconnectP90, in + 33, sizeof(status.bleReconnectP90));
+  memcpy(&status.bleReconnectP99, in + 35, sizeof(status.bleReconnectP99));
+  status.deviceCount = in[37];
+  return true;
+}
+
+/**
+ * Complete the frame whose payload has been written to payload().
+ * @param type The message type (see FrameType)
+ * @param payloadLength The number of payload bytes written
+ * @param device The monitor the frame is about
+ * @return The number of bytes to send (data() .. data() + length), or 0 if the payload is too large
+ */
+size_t FrameWriter::finish(uint8_t type, size_t payloadLength, uint8_t device) {
+  if (payloadLength > FRAME_MAX_PAYLOAD) {
+    encodedLength = 0;
+    return 0;
+  }
+
+  uint8_t* raw = buffer + 2;
+  size_t rawLength = FRAME_HEADER_SIZE + payloadLength + FRAME_CRC_SIZE;
+
+  raw[0] = FRAME_PROTOCOL_VERSION;
+  raw[1] = type;
+  raw[2] = device;
+  raw[3] = nextSequence & 0xFF;
+  raw[4] = nextSequence >> 8;
+  uint16_t crc = crc16(raw, FRAME_HEADER_SIZE + payloadLength);
+  raw[FRAME_HEADER_SIZE + payloadLength] = crc & 0xFF;
+  raw[FRAME_HEADER_SIZE + payloadLength + 1] = crc >> 8;
+
+  // COBS encode in place: every zero byte is replaced with the distance to the next zero,
+  // with buffer[1] as the overhead byte holding the distance to the first one.
+  size_t codeIndex = 1;
+  uint8_t code = 1;
+  for (size_t i = 2; i < 2 + rawLength; i++) {
+    if (buffer[i] == 0) {
+      buffer[codeIndex] = code;
+      codeIndex = i;
+      code = 1;
+    } else {
+      code++;
+    }
+  }
+  buffer[codeIndex] = code;
+
+  buffer[0] = FRAME_DELIMITER;
+  buffer[2 + rawLength] = FRAME_DELIMITER;
+  encodedLength = rawLength + 3;
+
+  nextSequence++;
+  return encodedLength;
+}
+
+/**
+ * Feed one received byte into the reader.
+ * @return true when the byte completed a valid frame (see the accessors)
+ */
+bool FrameReader::feed(uint8_t byte) {
+  if (byte != FRAME_DELIMITER) {
+    if (received < sizeof(buffer)) {
+      buffer[received++] = byte;
+    } else {
+      overflowed = true;
+    }
+    return false;
+  }
+
+  // Empty frame (e.g. the leading delimiter of the next frame)
+  if (received == 0) {
+    return false;
+  }
+
+  bool valid = false;
+  if (overflowed) {
+    overflows++;
+  } else {
+    valid = decode();
+  }
+  lastWireLength = received + 2;
+  received = 0;
+  overflowed = false;
+  return valid;
+}
+
+/**
+ * Read all available bytes from the stream until a complete frame is found.
+ * Any bytes after the frame are left in the stream for the next call.
+ * @return true if a valid frame is available through the accessors
+ */
+bool FrameReader::poll(Stream& stream) {
+  while (stream.available() > 0) {
+    if (feed(stream.read())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Discard any partially received frame, e.g. after the input stream was flushed.
+ */
+void FrameReader::reset() {
+  received = 0;
+  overflowed = false;
+}
+
+bool FrameReader::decode() {
+  // COBS decode in place: walk the chain of code bytes, turning each one back into the zero it replaced
+  size_t index = 0;
+  while (index < received) {
+    uint8_t code = buffer[index];
+    if (code == 0 || index + code > received) {
+      crcErrors++;
+      return false;
+    }
+    if (index > 0) {
+      buffer[index] = 0;
+    }
+    index += code;
+  }
+
+  frame = buffer + 1;
+  frameLength = received - 1;
+
+  if (frameLength < FRAME_HEADER_SIZE + FRAME_CRC_SIZE) {
+    crcErrors++;
+    return false;
+  }
+
+  uint16_t expectedCrc = frame[frameLength - 2] | (frame[frameLength - 1] << 8);
+  if (crc16(frame, frameLength - FRAME_CRC_SIZE) != expectedCrc) {
+    crcErrors++;
+    return false;
+  }
+
+  if (version() != FRAME_PROTOCOL_VERSION) {
+    versionErrors++;
+    return false;
+  }
+
+  // A sequence number of 0 means the sender restarted, so it does not count as a gap
+  uint16_t seq = sequence();
+  if (haveSequence && seq != expectedSequence && seq != 0) {
+    droppedFrames += (uint16_t)(seq - expectedSequence);
+  }
+  expectedSequence = seq + 1;
+  haveSequence = true;
+
+  framesReceived++;
+  return true;
+}
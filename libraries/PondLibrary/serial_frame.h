@@ -0,0 +1,137 @@
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <Arduino.h>
+#include "sensor_readings.h"
+#include "pipeline_timing.h"
+
+/*
+  Binary framing for the Nano 33 IoT -> MKR 1010 UART link.
+
+  Raw frame:     [version][type][device][sequence lo][sequence hi][payload ...][crc lo][crc hi]
+  On the wire:   0x00 [COBS(raw frame)] 0x00
+
+  - COBS (Consistent Overhead Byte Stuffing) guarantees the encoded frame contains no 0x00 bytes,
+    so 0x00 is used as the frame delimiter. The leading delimiter flushes any partial frame or
+    stray text line the receiver may be holding.
+  - The CRC is CRC-16/CCITT-FALSE over the version, type, device, sequence and payload.
+  - The device is the monitor the frame is about (the index of its name in the Nano's peripheralNames),
+    so one Nano can forward several monitors over the same link.
+  - The sequence number increments per frame (across all devices) so the receiver can count dropped frames.
+  - Raw frames are kept under 254 bytes so COBS never needs more than one overhead byte,
+    which lets both encode and decode run in place without copying the payload.
+*/
+
+#define FRAME_PROTOCOL_VERSION 2
+#define FRAME_DELIMITER 0x00
+#define FRAME_MAX_DEVICES 3 // monitors one Nano can forward (the MKR keeps upload state for each, ~0.5KB)
+
+#define FRAME_HEADER_SIZE 5 // version, type, device, 2 byte sequence
+#define FRAME_CRC_SIZE 2
+// room for a log frame: packed SensorReadings + packed SensorSpreads
+#define FRAME_MAX_PAYLOAD (SENSOR_READINGS_PACKED_SIZE + SENSOR_SPREADS_MAX_PACKED_SIZE)
+#define FRAME_MAX_RAW_SIZE (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE)
+static_assert(FRAME_MAX_RAW_SIZE < 254, "frames must stay under 254 bytes for in-place COBS");
+static_assert(SENSOR_READINGS_PACKED_SIZE + PIPELINE_STAMP_SIZE <= FRAME_MAX_PAYLOAD, "a realtime frame must fit its pipeline stamp");
+// COBS overhead byte + raw frame + leading and trailing delimiters
+#define FRAME_MAX_ENCODED_SIZE (1 + FRAME_MAX_RAW_SIZE + 2)
+
+// Message types carried in the frame header
+enum FrameType : uint8_t {
+  FRAME_REALTIME = 1,       // payload: packed SensorReadings, optionally followed by a packed PipelineStamp
+  FRAME_REALTIME_DEBUG = 2, // payload: same as FRAME_REALTIME (fake data)
+  FRAME_LOG = 3,            // payload: packed SensorReadings (1 minute means), optionally followed by packed SensorSpreads
+  FRAME_LOG_DEBUG = 4,      // payload: same as FRAME_LOG (fake data)
+  FRAME_STATUS = 5,         // payload: packed NanoStatus of the frame's device (one frame per device)
+  FRAME_REPLY = 6           // payload: ASCII reply to a command from the MKR (e.g. "CALIBRATION_SUCCESS"), no terminator
+};
+
+// Payload of a FRAME_STATUS frame: the link to one monitor
+struct NanoStatus {
+  uint8_t deviceCount = 1; // monitors the Nano is configured for, the last one's status frame completes the reply
+  bool connected = false;
+  int16_t rssi = 0;
+  uint32_t timeSinceLastConnection = 0; // seconds, only meaningful when not connected
+  uint32_t bleSamplesDropped = 0; // sensor packets missed according to their sequence number
+  // Realtime change reporting (see change_reporter.h)
+  uint32_t realtimeValuesReported = 0;
+  uint32_t realtimeValuesSuppressed = 0; // values within their deadband that weren't sent
+  uint32_t realtimeHeartbeats = 0;       // unchanged values sent because the heartbeat was due
+  // BLE reconnects: time from the connection dropping to data streaming again, in ms
+  // (percentiles are histogram bucket upper bounds, see latency_histogram.h)
+  uint32_t bleReconnects = 0;
+  uint32_t bleFullDiscoveries = 0; // the cached peripheral address or attributes were stale
+  uint16_t bleReconnectP50 = 0;
+  uint16_t bleReconnectP90 = 0;
+  uint16_t bleReconnectP99 = 0;
+};
+
+#define NANO_STATUS_PACKED_SIZE 38
+
+size_t packNanoStatus(const NanoStatus& status, uint8_t* out);
+bool unpackNanoStatus(const uint8_t* in, size_t length, NanoStatus& status);
+
+uint16_t crc16(const uint8_t* data, size_t length);
+
+/**
+ * Builds frames in a single static buffer. Write the payload directly into payload(),
+ * then call finish() to add the header and CRC and COBS encode the frame in place.
+ */
+class FrameWriter {
+  public:
+    uint8_t* payload() { return buffer + 2 + FRAME_HEADER_SIZE; }
+    size_t finish(uint8_t type, size_t payloadLength, uint8_t device = 0);
+
+    const uint8_t* data() const { return buffer; }
+    size_t length() const { return encodedLength; }
+    uint16_t sequence() const { return nextSequence; }
+
+  private:
+    // [leading delimiter][COBS overhead][header][payload][crc][trailing delimiter]
+    uint8_t buffer[FRAME_MAX_ENCODED_SIZE];
+    size_t encodedLength = 0;
+    uint16_t nextSequence = 0;
+};
+
+/**
+ * Reassembles frames from a byte stream. Bytes are accumulated until a delimiter arrives,
+ * then the frame is COBS decoded in place, CRC checked and exposed through the accessors
+ * (which point straight into the receive buffer) until the next call to feed()/poll().
+ */
+class FrameReader {
+  public:
+    bool feed(uint8_t byte);
+    bool poll(Stream& stream);
+    void reset();
+
+    uint8_t version() const { return frame[0]; }
+    uint8_t type() const { return frame[1]; }
+    uint8_t device() const { return frame[2]; }
+    uint16_t sequence() const { return frame[3] | (frame[4] << 8); }
+    const uint8_t* payload() const { return frame + FRAME_HEADER_SIZE; }
+    size_t payloadLength() const { return frameLength - FRAME_HEADER_SIZE - FRAME_CRC_SIZE; }
+    size_t wireLength() const { return lastWireLength; }
+
+    // Link statistics
+    unsigned long framesReceived = 0;
+    unsigned long crcErrors = 0;     // frames that failed COBS decoding or the CRC check
+    unsigned long overflows = 0;     // frames longer than FRAME_MAX_ENCODED_SIZE
+    unsigned long versionErrors = 0; // frames with an unsupported protocol version
+    unsigned long droppedFrames = 0; // frames missing according to the sequence number
+
+  private:
+    bool decode();
+
+    uint8_t buffer[FRAME_MAX_ENCODED_SIZE];
+    size_t received = 0;
+    bool overflowed = false;
+
+    const uint8_t* frame = buffer;
+    size_t frameLength = 0;
+    size_t lastWireLength = 0;
+
+    bool haveSequence = false;
+    uint16_t expectedSequence = 0;
+};
+
+#endif // SERIAL_FRAME_H
@@ -0,0 +1,70 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * Bounded lock-free queue between exactly one producer and one consumer running at the same time,
+ * e.g. two tasks pinned to different cores. Only push() writes the tail and only pop() writes the
+ * head, so neither side ever waits on the other; a push to a full queue fails and is counted.
+ * N must be a power of two.
+ *
+ * Only needs <atomic>, not Arduino, so it can be built and stress tested on a PC with two threads.
+ */
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+  public:
+    SpscQueue() : head(0), tail(0), numDropped(0), maxDepth(0) {}
+
+    /**
+     * Producer side: add an item.
+     * @return false if the queue is full (the item is dropped)
+     */
+    bool push(const T& item) {
+      size_t t = tail.load(std::memory_order_relaxed);
+      size_t depth = t - head.load(std::memory_order_acquire);
+      if (depth == N) {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      items[t & (N - 1)] = item;
+      tail.store(t + 1, std::memory_order_release);
+      if (depth + 1 > maxDepth.load(std::memory_order_relaxed)) {
+        maxDepth.store(depth + 1, std::memory_order_relaxed);
+      }
+      return true;
+    }
+
+    /**
+     * Consumer side: take the oldest item.
+     * @return false if the queue is empty
+     */
+    bool pop(T& item) {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire)) {
+        return false;
+      }
+      item = items[h & (N - 1)];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Either side; a snapshot, the other side may have moved on already
+    size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+    size_t capacity() const { return N; }
+    size_t highWater() const { return maxDepth.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return numDropped.load(std::memory_order_relaxed); }
+
+  private:
+    T items[N];
+    std::atomic<size_t> head; // next item to pop, written by the consumer
+    std::atomic<size_t> tail; // next free slot, written by the producer
+    std::atomic<uint32_t> numDropped;
+    std::atomic<size_t> maxDepth;
+};
+
+#endif // SPSC_QUEUE_H
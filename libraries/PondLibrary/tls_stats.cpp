@@ -0,0 +1,83 @@
+#include "tls_stats.h"
+
+const char* const tlsFailureReasonNames[TLS_FAIL_REASON_COUNT] = {
+  "tcp", "handshake", "write", "memory", "other"
+};
+
+TlsConnectionStats::TlsConnectionStats()
+  : cachedIdLength(0), handshakeStart(0), lastDuration(0), lastFailureReason(TLS_FAIL_OTHER), lastResumed(false) {
+  for (int i = 0; i < TLS_FAIL_REASON_COUNT; i++) {
+    failureCounts[i] = 0;
+  }
+}
+
+/**
+ * Start timing a connection attempt.
+ * @param cachedSessionId The session the client will offer to resume (nullptr or 0 length if none)
+ */
+void TlsConnectionStats::beginHandshake(const uint8_t* cachedSessionId, size_t length) {
+  if (cachedSessionId == nullptr || length > TLS_SESSION_ID_MAX_LENGTH) {
+    length = 0;
+  }
+  cachedIdLength = length;
+  if (length > 0) {
+    memcpy(cachedId, cachedSessionId, length);
+  }
+  handshakeStart = millis();
+}
+
+/**
+ * Record a successful handshake.
+ * @param sessionId The session ID in use after the handshake
+ * @return true if the cached session was resumed
+ */
+bool TlsConnectionStats::endHandshake(const uint8_t* sessionId, size_t length) {
+  lastDuration = millis() - handshakeStart;
+  lastResumed = cachedIdLength > 0 && sessionId != nullptr && length == cachedIdLength
+    && memcmp(sessionId, cachedId, length) == 0;
+  if (lastResumed) {
+    resumedHandshakeMs.add(lastDuration);
+  } else {
+    fullHandshakeMs.add(lastDuration);
+  }
+  return lastResumed;
+}
+
+void TlsConnectionStats::recordFailure(TlsFailureReason reason) {
+  if (reason >= TLS_FAIL_REASON_COUNT) {
+    reason = TLS_FAIL_OTHER;
+  }
+  failureCounts[reason]++;
+  lastFailureReason = reason;
+}
+
+uint32_t TlsConnectionStats::failures() const {
+  uint32_t total = 0;
+  for (int i = 0; i < TLS_FAIL_REASON_COUNT; i++) {
+    total += failureCounts[i];
+  }
+  return total;
+}
+
+/**
+ * Print a one line summary, e.g. "TLS: 2 full (avg 6120ms), 5 resumed (avg 410ms), 1 failed (last: tcp)"
+ */
+void TlsConnectionStats::printTo(Print& out) const {
+  out.print(F("TLS: "));
+  out.print(fullHandshakes());
+  out.print(F(" full (avg "));
+  out.print(fullHandshakeMs.mean(), 0);
+  out.print(F("ms), "));
+  out.print(resumedHandshakes());
+  out.print(F(" resumed (avg "));
+  out.print(resumedHandshakeMs.mean(), 0);
+  out.print(F("ms), "));
+  out.print(failures());
+  out.print(F(" failed"));
+  if (failures() > 0) {
+    out.print(F(" (last: "));
+    out.print(tlsFailureReasonNames[lastFailureReason]);
+    out.print(')');
+  }
+  out.println();
+}
@@ -0,0 +1,61 @@
+#ifndef TLS_STATS_H
+#define TLS_STATS_H
+
+#include <Arduino.h>
+#include "running_stats.h"
+
+#define TLS_SESSION_ID_MAX_LENGTH 32
+
+// Why a TLS connection attempt failed
+enum TlsFailureReason : uint8_t {
+  TLS_FAIL_TCP,       // the TCP connection to the server couldn't be opened
+  TLS_FAIL_HANDSHAKE, // the TLS handshake failed (certificate, protocol or timeout)
+  TLS_FAIL_WRITE,     // a write failed while the connection was being set up
+  TLS_FAIL_MEMORY,    // not enough RAM for the TLS buffers
+  TLS_FAIL_OTHER,
+  TLS_FAIL_REASON_COUNT
+};
+
+extern const char* const tlsFailureReasonNames[TLS_FAIL_REASON_COUNT];
+
+/**
+ * Handshake cost accounting for a TLS connection that is reopened over time.
+ *
+ * Call beginHandshake() with the ID of the cached session (if any) before connecting, then
+ * endHandshake() with the session ID the server settled on, or recordFailure(). When the server
+ * accepts the cached session it echoes the same ID and the handshake is an abbreviated one;
+ * otherwise it issues a new ID and the full handshake (certificate chain + key exchange) ran.
+ * Durations are kept separately for full and resumed handshakes.
+ */
+class TlsConnectionStats {
+  public:
+    TlsConnectionStats();
+
+    void beginHandshake(const uint8_t* cachedSessionId, size_t length);
+    bool endHandshake(const uint8_t* sessionId, size_t length);
+    void recordFailure(TlsFailureReason reason);
+
+    uint32_t fullHandshakes() const { return fullHandshakeMs.count(); }
+    uint32_t resumedHandshakes() const { return resumedHandshakeMs.count(); }
+    uint32_t failures() const;
+    uint32_t failures(TlsFailureReason reason) const { return failureCounts[reason]; }
+    TlsFailureReason lastFailure() const { return lastFailureReason; }
+    bool lastWasResumed() const { return lastResumed; }
+    unsigned long lastHandshakeMs() const { return lastDuration; }
+
+    RunningStats<float> fullHandshakeMs;
+    RunningStats<float> resumedHandshakeMs;
+
+    void printTo(Print& out) const;
+
+  private:
+    uint8_t cachedId[TLS_SESSION_ID_MAX_LENGTH];
+    uint8_t cachedIdLength;
+    unsigned long handshakeStart;
+    unsigned long lastDuration;
+    uint32_t failureCounts[TLS_FAIL_REASON_COUNT];
+    TlsFailureReason lastFailureReason;
+    bool lastResumed;
+};
+
+#endif // TLS_STATS_H
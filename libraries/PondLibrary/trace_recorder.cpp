@@ -0,0 +1,74 @@
+#include "trace_recorder.h"
+
+/**
+ * Mark the start of a capture, so a PC can tell the board restarted (e.g. the watchdog fired).
+ */
+void TraceRecorder::begin(const char* version) {
+  size_t length = startRecord('B');
+  length += out.print(version);
+  endRecord(length);
+}
+
+/**
+ * Record a frame's header and payload, enough to rebuild the frame when the trace is replayed.
+ */
+void TraceRecorder::frame(uint8_t type, uint8_t device, uint16_t sequence, const uint8_t* payload, size_t length) {
+  static const char hexDigits[] = "0123456789abcdef";
+  size_t recordLength = startRecord('F');
+  recordLength += out.print(type);
+  recordLength += out.print(' ');
+  recordLength += out.print(device);
+  recordLength += out.print(' ');
+  recordLength += out.print(sequence);
+  recordLength += out.print(' ');
+  for (size_t i = 0; i < length; i++) {
+    recordLength += out.write(hexDigits[payload[i] >> 4]);
+    recordLength += out.write(hexDigits[payload[i] & 0x0F]);
+  }
+  endRecord(recordLength);
+}
+
+void TraceRecorder::request(uint8_t tag, const char* method, const char* path, size_t bodyLength) {
+  size_t length = startRecord('Q');
+  length += out.print(tag);
+  length += out.print(' ');
+  length += out.print(method);
+  length += out.print(' ');
+  length += out.print(path);
+  length += out.print(' ');
+  length += out.print(bodyLength);
+  endRecord(length);
+}
+
+void TraceRecorder::response(uint8_t tag, int status, unsigned long latencyMs) {
+  size_t length = startRecord('R');
+  length += out.print(tag);
+  length += out.print(' ');
+  length += out.print(status);
+  length += out.print(' ');
+  length += out.print(latencyMs);
+  endRecord(length);
+}
+
+void TraceRecorder::counter(const char* name, unsigned long value) {
+  size_t length = startRecord('C');
+  length += out.print(name);
+  length += out.print(' ');
+  length += out.print(value);
+  endRecord(length);
+}
+
+size_t TraceRecorder::startRecord(char event) {
+  size_t length = out.write(TRACE_RECORD_PREFIX);
+  length += out.print(millis());
+  length += out.write(' ');
+  length += out.write(event);
+  length += out.write(' ');
+  return length;
+}
+
+void TraceRecorder::endRecord(size_t length) {
+  length += out.println();
+  recordsWritten++;
+  bytesWritten += length;
+}
@@ -0,0 +1,41 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+
+/*
+  Timestamped trace of a board's traffic, written as text lines to a Print (the USB Serial port) so it
+  can be captured on a PC alongside the normal debug output, then replayed and analysed there
+  (see tools/hub_load_test.py).
+
+  Every record is one line starting with '@' and the millis() it was recorded at:
+    @<ms> B <version>                                  the board started (a second one in a capture means it was reset)
+    @<ms> F <type> <device> <sequence> <payload hex>   a frame received over the UART (see serial_frame.h)
+    @<ms> Q <tag> <method> <path> <bytes>              an HTTP request sent, with the size of its body
+    @<ms> R <tag> <status> <latency ms>                the response to the oldest request of that tag (status 0: none)
+    @<ms> C <name> <value>                             a counter, e.g. the UART link or upload queue statistics
+*/
+
+#define TRACE_RECORD_PREFIX '@'
+
+class TraceRecorder {
+  public:
+    TraceRecorder(Print& out) : out(out) {}
+
+    void begin(const char* version);
+    void frame(uint8_t type, uint8_t device, uint16_t sequence, const uint8_t* payload, size_t length);
+    void request(uint8_t tag, const char* method, const char* path, size_t bodyLength);
+    void response(uint8_t tag, int status, unsigned long latencyMs);
+    void counter(const char* name, unsigned long value);
+
+    unsigned long recordsWritten = 0;
+    unsigned long bytesWritten = 0;
+
+  private:
+    size_t startRecord(char event);
+    void endRecord(size_t length);
+
+    Print& out;
+};
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,164 @@
+#include "upload_queue.h"
+
+LogUploadQueue::LogUploadQueue(uint8_t batchSize, unsigned long maxAge)
+  : head(0), numEntries(0), inFlight(0), batchSize(batchSize), maxAge(maxAge), oldestEntryTime(0) {
+  if (this->batchSize == 0 || this->batchSize > UPLOAD_LOG_BATCH_SIZE) {
+    this->batchSize = UPLOAD_LOG_BATCH_SIZE;
+  }
+}
+
+/**
+ * Queue a log entry. An entry with the same device and epoch as the newest queued entry is merged into it,
+ * since it would overwrite that entry's key in the PATCH anyway.
+ * @param epoch The RTC epoch the entry is logged under
+ * @param readings The averaged sensor values
+ * @param spreads The spread of each sensor over the interval
+ * @param device The monitor the entry is from
+ */
+void LogUploadQueue::add(uint32_t epoch, const SensorReadings& readings, const SensorSpreads& spreads, uint8_t device) {
+  if (numEntries > inFlight) {
+    LogEntry& newest = entries[(head + numEntries - 1) % UPLOAD_LOG_BATCH_SIZE];
+    if (newest.epoch == epoch && newest.device == device) {
+      for (int i = 0; i < SENSOR_COUNT; i++) {
+        if (readings.has((SensorId)i)) {
+          newest.readings.set((SensorId)i, readings.values[i]);
+        }
+        if (spreads.has((SensorId)i)) {
+          newest.spreads.set((SensorId)i, spreads.values[i]);
+        }
+      }
+      return;
+    }
+  }
+
+  if (numEntries == UPLOAD_LOG_BATCH_SIZE) {
+    // Full, drop the oldest entry
+    head = (head + 1) % UPLOAD_LOG_BATCH_SIZE;
+    numEntries--;
+    if (inFlight > 0) {
+      inFlight--; // its acknowledgement will just be ignored
+    }
+    droppedEntries++;
+  }
+  if (numEntries == 0) {
+    oldestEntryTime = millis();
+  }
+
+  LogEntry& entry = entries[(head + numEntries) % UPLOAD_LOG_BATCH_SIZE];
+  entry.device = device;
+  entry.epoch = epoch;
+  entry.readings = readings;
+  entry.spreads = spreads;
+  numEntries++;
+}
+
+/**
+ * @return true once the batch is full or the oldest entry has waited maxAge ms
+ */
+bool LogUploadQueue::isFlushDue() const {
+  // one batch at a time, so the entries of a failed batch can be put back in order
+  if (numEntries == 0 || inFlight > 0) {
+    return false;
+  }
+  return numEntries >= batchSize || millis() - oldestEntryTime >= maxAge;
+}
+
+/**
+ * Remove all entries, call after the batch has been sent.
+ */
+void LogUploadQueue::clear() {
+  head = 0;
+  numEntries = 0;
+  inFlight = 0;
+}
+
+/**
+ * Remove the entries marked in flight, call once the server has accepted the batch.
+ */
+void LogUploadQueue::acknowledge() {
+  head = (head + inFlight) % UPLOAD_LOG_BATCH_SIZE;
+  numEntries -= inFlight;
+  inFlight = 0;
+  if (numEntries > 0) {
+    oldestEntryTime = millis(); // entries added while the batch was in flight start a new wait
+  }
+}
+
+RealtimeCoalescer::RealtimeCoalescer(unsigned long maxAge) : maxAge(maxAge), firstUpdateTime(0) {
+}
+
+/**
+ * Merge a realtime update into the pending readings.
+ */
+void RealtimeCoalescer::update(const SensorReadings& readings) {
+  if (readings.present == 0) {
+    return;
+  }
+  if (!isPending()) {
+    firstUpdateTime = millis();
+  }
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (readings.has((SensorId)i)) {
+      pending.set((SensorId)i, readings.values[i]);
+    }
+  }
+  updatesReceived++;
+}
+
+/**
+ * @return true once the first pending update has waited maxAge ms
+ */
+bool RealtimeCoalescer::isFlushDue() const {
+  return isPending() && millis() - firstUpdateTime >= maxAge;
+}
+
+/**
+ * Put back readings whose write failed. Sensors that have been updated since keep their newer value.
+ * The readings are due to be written again straight away.
+ */
+void RealtimeCoalescer::requeue(const SensorReadings& readings) {
+  if (!isPending()) {
+    firstUpdateTime = millis() - maxAge;
+  }
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (readings.has((SensorId)i) && !pending.has((SensorId)i)) {
+      pending.set((SensorId)i, readings.values[i]);
+    }
+  }
+}
+
+/**
+ * Drop the pending readings, call after they have been written.
+ */
+void RealtimeCoalescer::clear() {
+  pending.present = 0;
+  writesFlushed++;
+}
+
+/**
+ * Pack a log entry, e.g. to keep it in flash until it has been uploaded.
+ * @param out Destination buffer, must hold at least LOG_ENTRY_MAX_PACKED_SIZE bytes
+ * @return The number of bytes written
+ */
+size_t packLogEntry(const LogEntry& entry, uint8_t* out) {
+  out[0] = entry.device;
+  memcpy(out + 1, &entry.epoch, sizeof(entry.epoch));
+  size_t length = 5;
+  length += packSensorReadings(entry.readings, out + length);
+  length += packSensorSpreads(entry.spreads, out + length);
+  return length;
+}
+
+/**
+ * Unpack a log entry written by packLogEntry().
+ * @return false if the data is malformed
+ */
+bool unpackLogEntry(const uint8_t* in, size_t length, LogEntry& entry) {
+  if (length < 5 + SENSOR_READINGS_PACKED_SIZE) {
+    return false;
+  }
+  entry.device = in[0];
+  memcpy(&entry.epoch, in + 1, sizeof(entry.epoch));
+  return unpackSensorReadings(in + 5, SENSOR_READINGS_PACKED_SIZE, entry.readings) &&
+    unpackSensorSpreads(in + 5 + SENSOR_READINGS_PACKED_SIZE, length - 5 - SENSOR_READINGS_PACKED_SIZE, entry.spreads);
+}
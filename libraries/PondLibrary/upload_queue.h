@@ -0,0 +1,89 @@
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include <Arduino.h>
+#include "sensor_readings.h"
+
+#define UPLOAD_LOG_BATCH_SIZE 5           // log entries merged into one PATCH (flush once this many are queued)
+#define UPLOAD_LOG_MAX_AGE 300000         // flush queued log entries once the oldest is 5 minutes old
+#define UPLOAD_REALTIME_MAX_AGE 1000      // collapse realtime updates arriving within 1 second into one write
+
+// A log entry waiting to be uploaded, keyed by its device and RTC epoch
+struct LogEntry {
+  uint8_t device = 0; // the monitor it's from (see serial_frame.h)
+  uint32_t epoch;
+  SensorReadings readings;
+  SensorSpreads spreads; // min/max/stddev over the interval (empty if the sender didn't include them)
+};
+
+// Largest packed LogEntry: [device][epoch (uint32)][packed SensorReadings][packed SensorSpreads]
+#define LOG_ENTRY_MAX_PACKED_SIZE (5 + SENSOR_READINGS_PACKED_SIZE + SENSOR_SPREADS_MAX_PACKED_SIZE)
+
+size_t packLogEntry(const LogEntry& entry, uint8_t* out);
+bool unpackLogEntry(const uint8_t* in, size_t length, LogEntry& entry);
+
+/**
+ * Collects log entries so they can be uploaded as one multi-location PATCH at the database root
+ * ({"<node>/<epoch>": {...}, "Devices/<id>/<node>/<epoch>": {...}, ...}) instead of one request each. The queue is due to be flushed once it holds `batchSize` entries
+ * or its oldest entry is `maxAge` ms old. If the queue fills up (e.g. while the server is
+ * unreachable) the oldest entry is dropped to make room and counted in `droppedEntries`.
+ *
+ * Entries stay queued until the server acknowledges them: markInFlight() after sending the batch,
+ * then acknowledge() on success or requeue() to send them again. Entries added meanwhile are sent
+ * in the next batch.
+ */
+class LogUploadQueue {
+  public:
+    LogUploadQueue(uint8_t batchSize = UPLOAD_LOG_BATCH_SIZE, unsigned long maxAge = UPLOAD_LOG_MAX_AGE);
+
+    void add(uint32_t epoch, const SensorReadings& readings, const SensorSpreads& spreads = SensorSpreads(), uint8_t device = 0);
+    bool isFlushDue() const;
+    void clear();
+
+    void markInFlight() { inFlight = numEntries; }
+    void acknowledge();
+    void requeue() { inFlight = 0; }
+    bool isInFlight() const { return inFlight > 0; }
+
+    uint8_t count() const { return numEntries; }
+    const LogEntry& entry(uint8_t index) const { return entries[(head + index) % UPLOAD_LOG_BATCH_SIZE]; }
+
+    unsigned long droppedEntries = 0;
+
+  private:
+    LogEntry entries[UPLOAD_LOG_BATCH_SIZE];
+    uint8_t head;
+    uint8_t numEntries;
+    uint8_t inFlight; // entries at the head that have been sent and are waiting for acknowledgement
+    uint8_t batchSize;
+    unsigned long maxAge;
+    unsigned long oldestEntryTime;
+};
+
+/**
+ * Collapses a burst of realtime updates into a single write of the latest value of each sensor.
+ * Each update is merged into the pending readings (only the sensors it carries are overwritten),
+ * and the merged readings are due to be written `maxAge` ms after the first pending update.
+ * A maxAge of 0 makes every update due immediately.
+ */
+class RealtimeCoalescer {
+  public:
+    RealtimeCoalescer(unsigned long maxAge = UPLOAD_REALTIME_MAX_AGE);
+
+    void update(const SensorReadings& readings);
+    bool isFlushDue() const;
+    bool isPending() const { return pending.present != 0; }
+    const SensorReadings& latest() const { return pending; }
+    void clear();
+    void requeue(const SensorReadings& readings);
+
+    unsigned long updatesReceived = 0;
+    unsigned long writesFlushed = 0;
+
+  private:
+    SensorReadings pending;
+    unsigned long maxAge;
+    unsigned long firstUpdateTime;
+};
+
+#endif // UPLOAD_QUEUE_H
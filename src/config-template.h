@@ -5,7 +5,11 @@
 
 // Bluetooth configuration 
 // replace with your own UUID values here:
-const char* peripheralName = "";
+// (one single value characteristic per sensor, named by the uuid column in sensor_registry.h)
+const char* peripheralName = ""; // the monitor's local name, give each monitor its own
+// the Nano connects to every monitor named here, the index is the device ID in its frames to the MKR
+// (see serial_frame.h), at most FRAME_MAX_DEVICES names. Device 0 keeps the original Firebase paths.
+const char* const peripheralNames[] = { "" };
 const char* sensorDataServiceUuid = ""; 
 const char* temperatureCharacteristicUuid = "";
 const char* totalDissolvedSolidsCharacteristicUuid = "";
@@ -13,5 +17,9 @@ const char* turbidityValueCharacteristicUuid = "";
 const char* turbidityVoltageCharacteristicUuid = "";
 const char* waterLevelCharacteristicUuid = "";
 const char* pHCharacteristicUuid = "";
+// all readings in one notification (see sensor_packet.h), the single characteristics above are kept for older centrals
+const char* sensorPacketCharacteristicUuid = "";
+// duty cycle, estimated current and sample intervals of the monitor (see POWER_REPORT_SIZE in sensor_packet.h)
+const char* powerReportCharacteristicUuid = "";
 
 #endif // CONFIG_TEMPLATE_H
@@ -6,6 +6,9 @@
 // Firebase database credentials
 #define SECRET_DATABASE_URL ""
 #define SECRET_DATABASE_SECRET ""
+// Optional: port of the database host, e.g. to run the hub against a local TLS stand-in server
+// (whose certificate must chain to a trust anchor in certificates.h). Defaults to 443.
+// #define SECRET_DATABASE_PORT 443
 
 // WiFi credentials
 #define SECRET_SSID ""
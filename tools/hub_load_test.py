@@ -0,0 +1,473 @@
+#!/usr/bin/env python3
+"""
+Load test the MKR 1010 central hub's ingest and upload path from a PC.
+
+The PC takes the Nano's place on the hub's Serial1 (a 3.3V USB-UART adapter on the hub's RX/TX pins) and
+sends it frames, either replayed from a trace or generated at a set rate, while the hub uploads to a local
+HTTPS stand-in for Firebase. The hub has to be built with TRACE set to true, so its USB Serial port carries
+a trace of every frame it received and every request it sent (see libraries/PondLibrary/trace_recorder.h).
+
+  record   capture the trace from the hub's USB Serial port (e.g. with the real Nano in the field)
+  serve    run the HTTPS stand-in (point SECRET_DATABASE_URL/SECRET_DATABASE_PORT at it)
+  run      act as the Nano: replay a trace at N times its speed, or generate load, while capturing the trace
+  report   throughput, drops and latency percentiles of a captured trace
+
+Examples:
+  hub_load_test.py serve --cert standin.crt --key standin.key --port 8443 --outage 60 --outage-every 300
+  hub_load_test.py record --hub /dev/ttyACM0 --out field.trace --duration 3600
+  hub_load_test.py run --uart /dev/ttyUSB0 --hub /dev/ttyACM0 --out replay.trace --replay field.trace --speed 50
+  hub_load_test.py run --uart /dev/ttyUSB0 --hub /dev/ttyACM0 --out load.trace --rate 20 --burst 200 --burst-every 120
+  hub_load_test.py run --uart /dev/ttyUSB0 --hub /dev/ttyACM0 --out three.trace --rate 5 --devices 3
+  hub_load_test.py report load.trace
+
+The stand-in's certificate must chain to a trust anchor in MKR-1010-Central-Hub/main/certificates.h.
+Needs pyserial for record and run.
+"""
+
+import argparse
+import http.server
+import json
+import random
+import re
+import socketserver
+import ssl
+import struct
+import sys
+import threading
+import time
+
+# serial_frame.h
+FRAME_PROTOCOL_VERSION = 2
+FRAME_REALTIME = 1
+FRAME_LOG = 3
+FRAME_STATUS = 5
+FRAME_REPLY = 6
+NANO_STATUS_PACKED_SIZE = 38
+NANO_STATUS_DEVICE_COUNT_OFFSET = 37
+
+# FirebaseRequestTag names, in the order of the hub's requestTagNames
+REQUEST_TAG_NAMES = ["realtime", "log", "debugLog", "rollup15Minutes", "rollupHourly", "rollupDaily", "timestamp", "other"]
+
+# (simulatedMin, simulatedMax, whole number) of each sensor, in POND_SENSORS order (sensor_registry.h)
+SENSOR_RANGES = [(45, 55, False), (0, 12, False), (0, 3000, True), (0, 3.3, False), (50, 300, True), (6, 8, False)]
+
+TRACE_RECORD = re.compile(r"@(\d+) ([BFQRC]) (.*)")
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as crc16() in serial_frame.cpp."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_frame(frame_type, device, sequence, payload):
+    """A frame as FrameWriter::finish() puts it on the wire: 0x00 COBS(header payload crc) 0x00."""
+    raw = bytes([FRAME_PROTOCOL_VERSION, frame_type, device, sequence & 0xFF, (sequence >> 8) & 0xFF]) + payload
+    raw += struct.pack("<H", crc16(raw))
+    encoded = bytearray()
+    block = bytearray()
+    for byte in raw:
+        if byte == 0:
+            encoded += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(byte)
+    encoded += bytes([len(block) + 1]) + block
+    return b"\x00" + bytes(encoded) + b"\x00"
+
+
+def pack_readings(values):
+    """Packed SensorReadings (sensor_readings.cpp): presence mask, then a float per sensor."""
+    mask = (1 << len(values)) - 1
+    return struct.pack("<B", mask) + struct.pack("<%df" % len(values), *values)
+
+
+def random_readings():
+    values = []
+    for low, high, whole in SENSOR_RANGES:
+        value = random.uniform(low, high)
+        values.append(round(value) if whole else value)
+    return values
+
+
+class NanoStandIn:
+    """Plays the Nano's side of the UART link: the handshake, STATUS replies and the frames it's given."""
+
+    def __init__(self, port, devices=1):
+        import serial
+        self.uart = serial.Serial(port, 115200, timeout=0.05)
+        self.devices = devices
+        self.sequence = 0
+        self.frames_sent = 0
+        self.bytes_sent = 0
+        self.connected = threading.Event()
+        self.lock = threading.Lock()
+        self.running = True
+        self.reader = threading.Thread(target=self._read_commands, daemon=True)
+        self.reader.start()
+
+    def send(self, frame_type, payload, device=0):
+        # called from the command reader too (STATUS replies), the sequence has to stay in order
+        with self.lock:
+            frame = encode_frame(frame_type, device, self.sequence, payload)
+            self.uart.write(frame)
+            self.sequence = (self.sequence + 1) & 0xFFFF
+            self.frames_sent += 1
+            self.bytes_sent += len(frame)
+
+    def _read_commands(self):
+        line = b""
+        while self.running:
+            data = self.uart.read(64)
+            for byte in data:
+                if byte in b"\r\n":
+                    self._handle_command(line.decode(errors="replace").strip())
+                    line = b""
+                else:
+                    line += bytes([byte])
+
+    def _handle_command(self, command):
+        if command == "READY_TO_CONNECT":
+            with self.lock:
+                self.uart.write(b"NANO_CONNECTED\r\n")
+            self.connected.set()
+        elif command == "STATUS":
+            # one status frame per monitor, like the Nano
+            for device in range(self.devices):
+                status = bytearray(NANO_STATUS_PACKED_SIZE)
+                status[0] = 1  # connected
+                status[NANO_STATUS_DEVICE_COUNT_OFFSET] = self.devices
+                self.send(FRAME_STATUS, bytes(status), device)
+        elif command.startswith("CALIBRATE_PH"):
+            self.send(FRAME_REPLY, b"CALIBRATION_SUCCESS")
+
+    def close(self):
+        self.running = False
+        self.reader.join()
+        self.uart.close()
+
+
+class TraceCapture:
+    """Copies the trace records from the hub's USB Serial port to a file."""
+
+    def __init__(self, port, path):
+        import serial
+        self.usb = serial.Serial(port, 115200, timeout=0.1)
+        self.out = open(path, "w")
+        self.records = 0
+        self.running = True
+        self.thread = threading.Thread(target=self._capture, daemon=True)
+        self.thread.start()
+
+    def _capture(self):
+        while self.running:
+            line = self.usb.readline().decode(errors="replace")
+            # trace records can follow other output on the same line if it didn't end with a newline
+            start = line.find("@")
+            if start >= 0 and TRACE_RECORD.match(line, start):
+                self.out.write(line[start:].rstrip() + "\n")
+                self.records += 1
+
+    def close(self):
+        self.running = False
+        self.thread.join()
+        self.out.close()
+        self.usb.close()
+
+
+def replay_events(path, speed):
+    """(seconds after the start, frame type, device, payload) of each frame in a trace, speed times faster."""
+    events = []
+    first = None
+    for ms, event, fields in read_trace(path):
+        if event == "B" and events:
+            break  # the hub restarted, the board's clock starts again
+        if event != "F" or len(fields) < 3:
+            continue
+        frame_type = int(fields[0])
+        if frame_type in (FRAME_STATUS, FRAME_REPLY):
+            continue  # answers to the hub's commands, not traffic
+        if first is None:
+            first = ms
+        device = int(fields[1])
+        payload = bytes.fromhex(fields[3]) if len(fields) > 3 else b""
+        events.append(((ms - first) / 1000.0 / speed, frame_type, device, payload))
+    return events
+
+
+def generated_events(duration, rate, log_every, burst, burst_every, devices=1):
+    """Realtime frames at `rate` per second with a log frame every `log_every` of them, plus a burst of
+    `burst` back-to-back frames every `burst_every` seconds (the Nano catching up after an outage).
+    With several `devices` each of them sends that load, their frames interleaved."""
+    events = []
+    count = 0
+    interval = 1.0 / rate if rate > 0 else duration
+    at = 0.0
+    next_burst = burst_every if burst > 0 and burst_every > 0 else duration
+    while at < duration:
+        if at >= next_burst:
+            for _ in range(burst):
+                for device in range(devices):
+                    events.append((at, FRAME_LOG, device, pack_readings(random_readings())))
+            next_burst += burst_every
+        count += 1
+        frame_type = FRAME_LOG if log_every > 0 and count % log_every == 0 else FRAME_REALTIME
+        for device in range(devices):
+            events.append((at, frame_type, device, pack_readings(random_readings())))
+        at += interval
+    return events
+
+
+def read_trace(path):
+    with open(path) as trace:
+        for line in trace:
+            match = TRACE_RECORD.match(line.strip())
+            if match:
+                yield int(match.group(1)), match.group(2), match.group(3).split(" ")
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    index = min(len(sorted_values) - 1, max(0, int(round(p / 100.0 * len(sorted_values) + 0.5)) - 1))
+    return sorted_values[index]
+
+
+def report(path, frames_sent=None, out=sys.stdout):
+    boots = 0
+    frames = {}
+    requests = {}
+    latencies = {}
+    failures = {}
+    counters = {}       # change of each counter over the earlier boots
+    counters_first = {} # and over the current one
+    counters_last = {}
+    start_ms = None
+    end_ms = None
+    elapsed_ms = 0
+    for ms, event, fields in read_trace(path):
+        if event == "B":
+            boots += 1
+            if start_ms is not None:
+                elapsed_ms += end_ms - start_ms
+            start_ms = end_ms = ms
+            # counters restart with the board, keep what was counted before the reset
+            for name, value in counters_last.items():
+                counters[name] = counters.get(name, 0) + value - counters_first[name]
+            counters_first = {}
+            counters_last = {}
+            continue
+        if start_ms is None:
+            start_ms = ms
+        end_ms = ms
+        if event == "F":
+            frame_type = int(fields[0])
+            frames[frame_type] = frames.get(frame_type, 0) + 1
+        elif event == "Q":
+            tag = int(fields[0])
+            requests[tag] = requests.get(tag, 0) + 1
+        elif event == "R":
+            tag, status, latency = int(fields[0]), int(fields[1]), int(fields[2])
+            if 200 <= status < 300:
+                latencies.setdefault(tag, []).append(latency)
+            else:
+                failures[tag] = failures.get(tag, 0) + 1
+        elif event == "C":
+            name, value = fields[0], int(fields[1])
+            counters_first.setdefault(name, value)
+            counters_last[name] = value
+    if start_ms is not None:
+        elapsed_ms += end_ms - start_ms
+    for name, value in counters_last.items():
+        counters[name] = counters.get(name, 0) + value - counters_first[name]
+    seconds = max(elapsed_ms / 1000.0, 0.001)
+
+    total_frames = sum(frames.values())
+    total_requests = sum(requests.values())
+    out.write("Trace %s: %.1fs of hub time, %d restart(s)\n" % (path, seconds, max(boots - 1, 0)))
+    out.write("Frames received: %d (%.2f/s)" % (total_frames, total_frames / seconds))
+    if frames_sent is not None:
+        out.write(", sent: %d, lost: %d" % (frames_sent, frames_sent - total_frames))
+    out.write("\n")
+    out.write("Requests sent: %d (%.2f/s)\n" % (total_requests, total_requests / seconds))
+    out.write("Counter changes over the trace:\n")
+    for name in sorted(counters):
+        out.write("  %-18s %d\n" % (name, counters[name]))
+    out.write("Request latency (ms, exact, successful requests):\n")
+    out.write("  %-16s %7s %7s %6s %6s %6s %6s\n" % ("type", "sent", "failed", "p50", "p90", "p99", "max"))
+    for tag in sorted(set(requests) | set(latencies) | set(failures)):
+        values = sorted(latencies.get(tag, []))
+        name = REQUEST_TAG_NAMES[tag] if tag < len(REQUEST_TAG_NAMES) else str(tag)
+        out.write("  %-16s %7d %7d %6d %6d %6d %6d\n" % (name, requests.get(tag, 0), failures.get(tag, 0),
+                  percentile(values, 50), percentile(values, 90), percentile(values, 99), values[-1] if values else 0))
+
+
+class StandInHandler(http.server.BaseHTTPRequestHandler):
+    """Answers the hub's Firebase requests on a keep-alive connection like the Realtime Database does."""
+    protocol_version = "HTTP/1.1"
+
+    def _answer(self):
+        server = self.server
+        if server.in_outage():
+            self.close_connection = True
+            return
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length) if length else b""
+        if server.delay_ms:
+            time.sleep(server.delay_ms / 1000.0)
+        if self.command == "GET" and self.path.startswith("/timestamp.json"):
+            reply = json.dumps({"timestamp": int(time.time() * 1000)}).encode()
+        else:
+            reply = body if body else b"null"
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(reply)))
+        self.end_headers()
+        self.wfile.write(reply)
+        server.count(self.command, len(body))
+
+    do_GET = _answer
+    do_PUT = _answer
+    do_PATCH = _answer
+
+    def log_message(self, format, *args):
+        pass
+
+
+class StandInServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+    def __init__(self, address, delay_ms, outage, outage_every):
+        http.server.HTTPServer.__init__(self, address, StandInHandler)
+        self.delay_ms = delay_ms
+        self.outage = outage
+        self.outage_every = outage_every
+        self.started = time.time()
+        self.requests = {}
+        self.bytes_received = 0
+        self.lock = threading.Lock()
+
+    def in_outage(self):
+        """True during the last `outage` seconds of every `outage_every`: connections are dropped unanswered."""
+        if self.outage <= 0 or self.outage_every <= 0:
+            return False
+        return (time.time() - self.started) % self.outage_every >= self.outage_every - self.outage
+
+    def verify_request(self, request, client_address):
+        return not self.in_outage()
+
+    def count(self, method, body_length):
+        with self.lock:
+            self.requests[method] = self.requests.get(method, 0) + 1
+            self.bytes_received += body_length
+
+
+def serve(args):
+    server = StandInServer(("", args.port), args.delay, args.outage, args.outage_every)
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert, args.key)
+    server.socket = context.wrap_socket(server.socket, server_side=True)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print("HTTPS stand-in on port %d (response delay %dms, %ds outage every %ds)" % (args.port, args.delay, args.outage, args.outage_every))
+    try:
+        while True:
+            time.sleep(args.report_every)
+            print("%.0fs: requests %s, %d body bytes%s" % (time.time() - server.started, server.requests, server.bytes_received,
+                  " (outage)" if server.in_outage() else ""))
+    except KeyboardInterrupt:
+        pass
+
+
+def record(args):
+    capture = TraceCapture(args.hub, args.out)
+    try:
+        time.sleep(args.duration)
+    except KeyboardInterrupt:
+        pass
+    capture.close()
+    print("Captured %d trace records to %s" % (capture.records, args.out))
+
+
+def run(args):
+    if args.replay:
+        events = replay_events(args.replay, args.speed)
+    else:
+        events = generated_events(args.duration, args.rate, args.log_every, args.burst, args.burst_every, args.devices)
+    capture = TraceCapture(args.hub, args.out) if args.hub else None
+    nano = NanoStandIn(args.uart, args.devices)
+
+    print("Waiting for the hub's handshake (reset the hub if it's already running)...")
+    nano.connected.wait()
+    # the hub connects to Ethernet, NTP and the stand-in before it reads frames, its UART buffer would overflow
+    time.sleep(args.settle)
+    print("Sending %d frames..." % len(events))
+    start = time.time()
+    try:
+        for at, frame_type, device, payload in events:
+            wait = start + at - time.time()
+            if wait > 0:
+                time.sleep(wait)
+            nano.send(frame_type, payload, device)
+        time.sleep(args.drain)
+    except KeyboardInterrupt:
+        pass
+    elapsed = time.time() - start
+    nano.close()
+    print("Sent %d frames (%d bytes) in %.1fs, %.2f frames/s" % (nano.frames_sent, nano.bytes_sent, elapsed, nano.frames_sent / max(elapsed, 0.001)))
+    if capture:
+        capture.close()
+        report(args.out, frames_sent=nano.frames_sent)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command")
+    commands.required = True
+
+    serve_parser = commands.add_parser("serve", help="run the HTTPS stand-in for Firebase")
+    serve_parser.add_argument("--cert", required=True, help="certificate (chained to a trust anchor in certificates.h)")
+    serve_parser.add_argument("--key", required=True)
+    serve_parser.add_argument("--port", type=int, default=8443)
+    serve_parser.add_argument("--delay", type=int, default=0, help="ms before each response")
+    serve_parser.add_argument("--outage", type=int, default=0, help="seconds of every --outage-every the server drops connections")
+    serve_parser.add_argument("--outage-every", type=int, default=0)
+    serve_parser.add_argument("--report-every", type=int, default=10, help="seconds between request counts")
+    serve_parser.set_defaults(func=serve)
+
+    record_parser = commands.add_parser("record", help="capture the hub's trace")
+    record_parser.add_argument("--hub", required=True, help="the hub's USB Serial port")
+    record_parser.add_argument("--out", required=True)
+    record_parser.add_argument("--duration", type=float, default=3600, help="seconds to capture")
+    record_parser.set_defaults(func=record)
+
+    run_parser = commands.add_parser("run", help="act as the Nano and drive the hub")
+    run_parser.add_argument("--uart", required=True, help="USB-UART adapter wired to the hub's Serial1")
+    run_parser.add_argument("--hub", help="the hub's USB Serial port, to capture its trace")
+    run_parser.add_argument("--out", default="load.trace", help="where to write the captured trace")
+    run_parser.add_argument("--replay", help="trace to replay the frames of")
+    run_parser.add_argument("--speed", type=float, default=1, help="replay this many times faster than recorded")
+    run_parser.add_argument("--duration", type=float, default=300, help="seconds of generated load")
+    run_parser.add_argument("--rate", type=float, default=1 / 3.0, help="realtime frames per second (field rate is one per 3s)")
+    run_parser.add_argument("--log-every", type=int, default=20, help="send a log frame instead of every Nth realtime frame")
+    run_parser.add_argument("--burst", type=int, default=0, help="log frames sent back to back every --burst-every seconds")
+    run_parser.add_argument("--burst-every", type=float, default=0)
+    run_parser.add_argument("--devices", type=int, default=1, help="monitors the stand-in Nano sends for (at most FRAME_MAX_DEVICES)")
+    run_parser.add_argument("--settle", type=float, default=20, help="seconds after the handshake before sending")
+    run_parser.add_argument("--drain", type=float, default=10, help="seconds to keep capturing after the last frame")
+    run_parser.set_defaults(func=run)
+
+    report_parser = commands.add_parser("report", help="summarise a captured trace")
+    report_parser.add_argument("trace")
+    report_parser.set_defaults(func=lambda args: report(args.trace))
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()